@@ -0,0 +1,321 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/array.h"
+#include "common/atomic.h"
+#include "common/mutex.h"
+#include "common/system.h"
+#include "common/timer.h"
+#include "common/util.h"
+
+#include "audio/decodeahead.h"
+
+namespace Audio {
+
+enum {
+	/** Most samples decoded while holding the decoding mutex of a buffer */
+	kDecodeAheadChunk = 4096,
+	/** Interval of the decoding timer, in microseconds */
+	kDecodeAheadInterval = 10000
+};
+
+/**
+ * The ring buffer of a DecodeAheadAudioStream, along with its source.
+ *
+ * The decoding timer is the producer, and the reader of the stream the
+ * consumer. The stream also produces when it's created and when it seeks,
+ * so every access to the source and to writePos happens with decodeMutex
+ * held. Buffers are shared by the stream and the decoding timer, and are
+ * deleted by the timer once their stream is gone, so that the mixer never
+ * waits for that. Only once the timer is stopped does the stream delete
+ * its buffer itself.
+ */
+struct DecodeAheadBuffer {
+	DecodeAheadBuffer(RewindableAudioStream *source_, DisposeAfterUse::Flag disposeAfterUse, uint32 capacity_)
+		: source(source_, disposeAfterUse), capacity(capacity_), readPos(0), writePos(0),
+		  sourceEndOfData(0), sourceEndOfStream(0), closed(0), refCount(2) {
+		ring = new int16[capacity];
+	}
+
+	~DecodeAheadBuffer() {
+		delete[] ring;
+	}
+
+	Common::DisposablePtr<RewindableAudioStream> source;
+	Common::Mutex decodeMutex;
+
+	int16 *ring;
+	/** Size of the ring, a power of two */
+	const uint32 capacity;
+	/** Number of samples read from the ring and written to it so far */
+	volatile uint32 readPos;
+	volatile uint32 writePos;
+
+	/** The end flags of the source, as of the last short read from it */
+	volatile uint32 sourceEndOfData;
+	volatile uint32 sourceEndOfStream;
+	/** Set when the stream is deleted, with decodeMutex held */
+	volatile uint32 closed;
+	/** Owners of the buffer, the stream and the decoding timer */
+	volatile uint32 refCount;
+
+	/**
+	 * Decodes at most maxSamples into the free space of the ring, which
+	 * requires decodeMutex.
+	 *
+	 * @return the number of samples decoded
+	 */
+	uint32 decode(uint32 maxSamples);
+
+	/** Decodes until the ring is full or the source ends. */
+	void fill();
+
+	/** Drops a reference, and deletes the buffer along with the last one. */
+	void release();
+};
+
+uint32 DecodeAheadBuffer::decode(uint32 maxSamples) {
+	const uint32 write = writePos;
+	const uint32 offset = write & (capacity - 1);
+
+	uint32 samples = capacity - (write - Common::atomicLoad(&readPos));
+	samples = MIN(samples, capacity - offset);
+	samples = MIN(samples, maxSamples);
+	// Stereo sources are read in whole frames
+	if (source->isStereo())
+		samples &= ~1;
+	if (samples == 0 || sourceEndOfData)
+		return 0;
+
+	const int decoded = MAX(source->readBuffer(ring + offset, samples), 0);
+
+	// The samples are published before the end of the source, so that the
+	// reader never sees the end while some are missing.
+	Common::atomicStore(&writePos, write + decoded);
+	if ((uint32)decoded < samples) {
+		Common::atomicStore(&sourceEndOfStream, source->endOfStream() ? 1 : 0);
+		Common::atomicStore(&sourceEndOfData, source->endOfData() ? 1 : 0);
+	}
+	return decoded;
+}
+
+void DecodeAheadBuffer::fill() {
+	for (;;) {
+		Common::StackLock lock(decodeMutex);
+		if (closed || decode(kDecodeAheadChunk) == 0)
+			break;
+	}
+}
+
+void DecodeAheadBuffer::release() {
+	if (Common::atomicDecrement(&refCount) == 0)
+		delete this;
+}
+
+/**
+ * Runs the decoding of all the DecodeAheadAudioStreams from a single timer,
+ * since the timer manager tells timers apart by their procedure.
+ */
+class DecodeAheadScheduler {
+public:
+	static void add(DecodeAheadBuffer *buffer);
+	static void destroy();
+
+private:
+	static DecodeAheadScheduler *_instance;
+	static void timerProc(void *refCon);
+
+	~DecodeAheadScheduler();
+	void run();
+
+	/** Buffers added since the last run of the timer */
+	Common::Mutex _mutex;
+	Common::Array<DecodeAheadBuffer *> _added;
+
+	/** Buffers decoded by the timer, only used by the timer */
+	Common::Array<DecodeAheadBuffer *> _buffers;
+};
+
+DecodeAheadScheduler *DecodeAheadScheduler::_instance = 0;
+
+void DecodeAheadScheduler::add(DecodeAheadBuffer *buffer) {
+	// Streams are created by the engine thread, so this doesn't race
+	if (!_instance) {
+		_instance = new DecodeAheadScheduler();
+		g_system->getTimerManager()->installTimerProc(&timerProc, kDecodeAheadInterval, _instance, "decodeAhead");
+	}
+
+	Common::StackLock lock(_instance->_mutex);
+	_instance->_added.push_back(buffer);
+}
+
+void DecodeAheadScheduler::destroy() {
+	if (!_instance)
+		return;
+
+	// Waits for the running pass of the timer
+	g_system->getTimerManager()->removeTimerProc(&timerProc);
+	delete _instance;
+	_instance = 0;
+}
+
+DecodeAheadScheduler::~DecodeAheadScheduler() {
+	for (uint i = 0; i < _added.size(); i++)
+		_added[i]->release();
+	for (uint i = 0; i < _buffers.size(); i++)
+		_buffers[i]->release();
+}
+
+void DecodeAheadScheduler::timerProc(void *refCon) {
+	((DecodeAheadScheduler *)refCon)->run();
+}
+
+void DecodeAheadScheduler::run() {
+	// The mutex isn't held while decoding, so that add() doesn't wait for it
+	{
+		Common::StackLock lock(_mutex);
+		for (uint i = 0; i < _added.size(); i++)
+			_buffers.push_back(_added[i]);
+		_added.clear();
+	}
+
+	for (uint i = 0; i < _buffers.size(); ) {
+		DecodeAheadBuffer *buffer = _buffers[i];
+		// The stream dropped its reference, the timer holds the last one
+		if (Common::atomicLoad(&buffer->refCount) == 1) {
+			buffer->release();
+			_buffers.remove_at(i);
+			continue;
+		}
+
+		buffer->fill();
+		i++;
+	}
+}
+
+DecodeAheadAudioStream::DecodeAheadAudioStream(RewindableAudioStream *source, uint depth, DisposeAfterUse::Flag disposeAfterUse, const Timestamp &startPos)
+	: _seekableSource(dynamic_cast<SeekableAudioStream *>(source)), _stereo(source->isStereo()), _rate(source->getRate()),
+	  _length(0, source->getRate()), _startPos(startPos.convertToFramerate(source->getRate())), _framesRead(0) {
+	if (_seekableSource)
+		_length = _seekableSource->getLength();
+
+	// A power of two number of samples covering the depth
+	const uint32 samples = MAX<uint32>((uint64)depth * _rate * (_stereo ? 2 : 1) / 1000, kDecodeAheadChunk);
+	uint32 capacity = 1;
+	while (capacity < samples)
+		capacity <<= 1;
+
+	_buffer = new DecodeAheadBuffer(source, disposeAfterUse, capacity);
+	// The first read doesn't wait for the timer
+	_buffer->decode(kDecodeAheadChunk);
+	DecodeAheadScheduler::add(_buffer);
+}
+
+DecodeAheadAudioStream::~DecodeAheadAudioStream() {
+	// Waits for the chunk being decoded, since the source might not be ours.
+	_buffer->decodeMutex.lock();
+	Common::atomicStore(&_buffer->closed, 1);
+	_buffer->decodeMutex.unlock();
+
+	// The buffer itself is deleted by the scheduler, unless it was stopped
+	_buffer->release();
+}
+
+int DecodeAheadAudioStream::readBuffer(int16 *buffer, const int numSamples) {
+	DecodeAheadBuffer *ring = _buffer;
+	const uint32 mask = ring->capacity - 1;
+	int samplesRead = 0;
+
+	while (samplesRead < numSamples) {
+		// The end flag must be read before the position of the samples
+		const bool ended = Common::atomicLoad(&ring->sourceEndOfData) != 0;
+		const uint32 read = ring->readPos;
+		const uint32 available = Common::atomicLoad(&ring->writePos) - read;
+
+		if (available == 0) {
+			if (ended)
+				break;
+
+			// The decoding timer fell behind. The reader never decodes, since
+			// it's usually the mixer: the missing samples are played as silence.
+			memset(buffer + samplesRead, 0, (numSamples - samplesRead) * sizeof(int16));
+			_framesRead += _stereo ? samplesRead / 2 : samplesRead;
+			return numSamples;
+		}
+
+		const uint32 samples = MIN<uint32>(MIN<uint32>(available, numSamples - samplesRead), ring->capacity - (read & mask));
+		memcpy(buffer + samplesRead, ring->ring + (read & mask), samples * sizeof(int16));
+		Common::atomicStore(&ring->readPos, read + samples);
+		samplesRead += samples;
+	}
+
+	_framesRead += _stereo ? samplesRead / 2 : samplesRead;
+	return samplesRead;
+}
+
+bool DecodeAheadAudioStream::endOfData() const {
+	return Common::atomicLoad(&_buffer->sourceEndOfData) && Common::atomicLoad(&_buffer->writePos) == _buffer->readPos;
+}
+
+bool DecodeAheadAudioStream::endOfStream() const {
+	return Common::atomicLoad(&_buffer->sourceEndOfStream) && Common::atomicLoad(&_buffer->writePos) == _buffer->readPos;
+}
+
+bool DecodeAheadAudioStream::seek(const Timestamp &where) {
+	if (!_seekableSource)
+		return false;
+
+	Common::StackLock lock(_buffer->decodeMutex);
+	_startPos = where.convertToFramerate(_rate);
+	return restart(_seekableSource->seek(where));
+}
+
+bool DecodeAheadAudioStream::rewind() {
+	Common::StackLock lock(_buffer->decodeMutex);
+	_startPos = Timestamp(0, _rate);
+	return restart(_buffer->source->rewind());
+}
+
+bool DecodeAheadAudioStream::restart(bool seeked) {
+	// Drops the decoded samples. The ring is only written with decodeMutex held.
+	_framesRead = 0;
+	Common::atomicStore(&_buffer->writePos, _buffer->readPos);
+	Common::atomicStore(&_buffer->sourceEndOfStream, seeked ? 0 : 1);
+	Common::atomicStore(&_buffer->sourceEndOfData, seeked ? 0 : 1);
+
+	// A loop restarting the stream doesn't wait for the timer either
+	if (seeked)
+		_buffer->decode(kDecodeAheadChunk);
+	return seeked;
+}
+
+DecodeAheadAudioStream *makeDecodeAheadStream(RewindableAudioStream *source, DisposeAfterUse::Flag disposeAfterUse, uint depth, const Timestamp &startPos) {
+	if (!source)
+		return 0;
+	return new DecodeAheadAudioStream(source, depth, disposeAfterUse, startPos);
+}
+
+void stopDecodeAhead() {
+	DecodeAheadScheduler::destroy();
+}
+
+} // End of namespace Audio
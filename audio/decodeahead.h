@@ -0,0 +1,120 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef AUDIO_DECODEAHEAD_H
+#define AUDIO_DECODEAHEAD_H
+
+#include "common/scummsys.h"
+#include "common/types.h"
+
+#include "audio/audiostream.h"
+
+namespace Audio {
+
+struct DecodeAheadBuffer;
+
+/**
+ * Wraps a compressed audio stream and decodes it ahead of playback, so that
+ * a slow frame doesn't make the mixer callback underrun the output device.
+ *
+ * The source is decoded from a timer into a ring buffer, which the mixer
+ * reads without locking. If the ring runs empty, the missing samples are
+ * played as silence until the timer catches up. Creating the stream, seeking
+ * and rewinding decode a first chunk synchronously, after waiting for the
+ * decoding of the current one to finish.
+ *
+ * The source may only be used through this stream.
+ */
+class DecodeAheadAudioStream : public SeekableAudioStream {
+public:
+	/**
+	 * @param source          the stream to decode
+	 * @param depth           how far to decode ahead, in milliseconds
+	 * @param disposeAfterUse whether to delete the source along with this stream
+	 * @param startPos        the position of the source, for getPos()
+	 */
+	DecodeAheadAudioStream(RewindableAudioStream *source, uint depth, DisposeAfterUse::Flag disposeAfterUse = DisposeAfterUse::YES,
+	                       const Timestamp &startPos = Timestamp());
+	~DecodeAheadAudioStream();
+
+	int readBuffer(int16 *buffer, const int numSamples);
+	bool isStereo() const { return _stereo; }
+	int getRate() const { return _rate; }
+	bool endOfData() const;
+	bool endOfStream() const;
+
+	/** Seeks the source, which fails if it isn't a SeekableAudioStream. */
+	bool seek(const Timestamp &where);
+	bool rewind();
+	/** The length of the source, or zero if it isn't a SeekableAudioStream. */
+	Timestamp getLength() const { return _length; }
+
+	/**
+	 * Returns the position of the next sample read from this stream, rather
+	 * than the one of the decoder.
+	 */
+	Timestamp getPos() const { return _startPos.addFrames(_framesRead); }
+
+private:
+	DecodeAheadBuffer *_buffer;
+	SeekableAudioStream *_seekableSource;
+
+	const bool _stereo;
+	const int _rate;
+	Timestamp _length;
+
+	/** Position of the last seek, and the frames read since */
+	Timestamp _startPos;
+	uint32 _framesRead;
+
+	bool restart(bool seeked);
+};
+
+enum {
+	/** Default depth of DecodeAheadAudioStream, in milliseconds */
+	kDefaultDecodeAheadDepth = 500
+};
+
+/**
+ * Wraps the given stream into a DecodeAheadAudioStream.
+ *
+ * @param source          the stream to decode, may be NULL
+ * @param disposeAfterUse whether to delete the source along with the new stream
+ * @param depth           how far to decode ahead, in milliseconds
+ * @param startPos        the position of the source, when it was cued before
+ * @return a new DecodeAheadAudioStream, or NULL if the source is NULL
+ */
+DecodeAheadAudioStream *makeDecodeAheadStream(RewindableAudioStream *source,
+	DisposeAfterUse::Flag disposeAfterUse = DisposeAfterUse::YES,
+	uint depth = kDefaultDecodeAheadDepth,
+	const Timestamp &startPos = Timestamp());
+
+/**
+ * Stops the timer decoding the streams and frees its buffers. The Engine
+ * destructor calls this once the sounds of the game are stopped; streams
+ * created afterwards start it again.
+ */
+void stopDecodeAhead();
+
+} // End of namespace Audio
+
+#endif
@@ -222,25 +222,58 @@ void XA_ADPCMStream::decodeXA(const byte *src) {
 
 
 int DVI_ADPCMStream::readBuffer(int16 *buffer, const int numSamples) {
-	int samples;
-	byte data;
+	int samples = 0;
 
-	for (samples = 0; samples < numSamples && !endOfData(); samples++) {
-		if (_decodedSampleCount == 0) {
-			data = _stream->readByte();
-			_decodedSamples[0] = decodeIMA((data >> 4) & 0x0f, 0);
-			_decodedSamples[1] = decodeIMA((data >> 0) & 0x0f, _channels == 2 ? 1 : 0);
-			_decodedSampleCount = 2;
-		}
+	while (samples < numSamples) {
+		if (_decodedSampleIndex == _decodedSampleCount && !decodeChunk())
+			break;
 
-		// (1 - (count - 1)) ensures that _decodedSamples acts as a FIFO of depth 2
-		buffer[samples] = _decodedSamples[1 - (_decodedSampleCount - 1)];
-		_decodedSampleCount--;
+		int count = MIN<int>(numSamples - samples, _decodedSampleCount - _decodedSampleIndex);
+		memcpy(buffer + samples, _decodedSamples + _decodedSampleIndex, count * sizeof(int16));
+		_decodedSampleIndex += count;
+		samples += count;
 	}
 
 	return samples;
 }
 
+bool DVI_ADPCMStream::decodeChunk() {
+	if (_stream->eos() || _stream->pos() >= _endpos)
+		return false;
+
+	byte data[kChunkSize];
+	uint32 size = _stream->read(data, MIN<uint32>(kChunkSize, _endpos - _stream->pos()));
+
+	// The high nibble of each byte goes to the left channel, and the low one
+	// to the right channel. Each channel is decoded on its own.
+	if (_channels == 2) {
+		for (int i = 0; i < 2; i++) {
+			int32 last = _status.ima_ch[i].last;
+			int32 stepIndex = _status.ima_ch[i].stepIndex;
+			const int shift = (i == 0) ? 4 : 0;
+			int16 *dst = _decodedSamples + i;
+			for (uint32 j = 0; j < size; j++, dst += 2)
+				*dst = decodeIMANibble((data[j] >> shift) & 0x0f, last, stepIndex);
+			_status.ima_ch[i].last = last;
+			_status.ima_ch[i].stepIndex = stepIndex;
+		}
+	} else {
+		int32 last = _status.ima_ch[0].last;
+		int32 stepIndex = _status.ima_ch[0].stepIndex;
+		int16 *dst = _decodedSamples;
+		for (uint32 j = 0; j < size; j++) {
+			*dst++ = decodeIMANibble((data[j] >> 4) & 0x0f, last, stepIndex);
+			*dst++ = decodeIMANibble(data[j] & 0x0f, last, stepIndex);
+		}
+		_status.ima_ch[0].last = last;
+		_status.ima_ch[0].stepIndex = stepIndex;
+	}
+
+	_decodedSampleCount = size * 2;
+	_decodedSampleIndex = 0;
+	return size > 0;
+}
+
 #pragma mark -
 
 
@@ -317,40 +350,54 @@ int MSIma_ADPCMStream::readBuffer(int16 *buffer, const int numSamples) {
 
 	int samples = 0;
 
-	while (samples < numSamples && !_stream->eos() && _stream->pos() < _endpos) {
-		if (_blockPos[0] == _blockAlign) {
-			for (int i = 0; i < _channels; i++) {
-				// read block header
-				_status.ima_ch[i].last = _stream->readSint16LE();
-				_status.ima_ch[i].stepIndex = _stream->readSint16LE();
-			}
+	while (samples < numSamples) {
+		if (_blockSampleIndex == _blockSampleCount && !decodeBlock())
+			break;
 
-			_blockPos[0] = _channels * 4;
-		}
+		int count = MIN<int>(numSamples - samples, _blockSampleCount - _blockSampleIndex);
+		memcpy(buffer + samples, _blockSamples + _blockSampleIndex, count * sizeof(int16));
+		_blockSampleIndex += count;
+		samples += count;
+	}
 
-		// Decode a set of samples
-		for (int i = 0; i < _channels; i++) {
-			// The stream encodes four bytes per channel at a time
-			for (int j = 0; j < 4; j++) {
-				byte data = _stream->readByte();
-				_blockPos[0]++;
-				_buffer[i][j * 2] = decodeIMA(data & 0x0f, i);
-				_buffer[i][j * 2 + 1] = decodeIMA((data >> 4) & 0x0f, i);
-				_samplesLeft[i] += 2;
-			}
-		}
+	return samples;
+}
 
-		while (samples < numSamples && _samplesLeft[0] != 0) {
-			for (int i = 0; i < _channels; i++) {
-				buffer[samples + i] = _buffer[i][8 - _samplesLeft[i]];
-				_samplesLeft[i]--;
-			}
+bool MSIma_ADPCMStream::decodeBlock() {
+	if (_stream->eos() || _stream->pos() >= _endpos)
+		return false;
+
+	uint32 size = _stream->read(_blockData, MIN<uint32>(_blockAlign, _endpos - _stream->pos()));
+	const uint32 headerSize = _channels * 4;
+	if (size < headerSize)
+		return false;
+
+	// The channels are interleaved by groups of four bytes, which are
+	// decoded one channel after the other.
+	const uint32 groupSize = _channels * 4;
+	const uint32 numGroups = (size - headerSize) / groupSize;
 
-			samples += _channels;
+	for (int i = 0; i < _channels; i++) {
+		int32 last = READ_LE_INT16(_blockData + i * 4);
+		int32 stepIndex = CLIP<int32>(READ_LE_INT16(_blockData + i * 4 + 2), 0, ARRAYSIZE(_imaTable) - 1);
+
+		const byte *src = _blockData + headerSize + i * 4;
+		int16 *dst = _blockSamples + i;
+		for (uint32 j = 0; j < numGroups; j++, src += groupSize) {
+			for (int k = 0; k < 4; k++) {
+				dst[0] = decodeIMANibble(src[k] & 0x0f, last, stepIndex);
+				dst[_channels] = decodeIMANibble((src[k] >> 4) & 0x0f, last, stepIndex);
+				dst += _channels * 2;
+			}
 		}
+
+		_status.ima_ch[i].last = last;
+		_status.ima_ch[i].stepIndex = stepIndex;
 	}
 
-	return samples;
+	_blockSampleCount = numGroups * 8 * _channels;
+	_blockSampleIndex = 0;
+	return true;
 }
 
 
@@ -389,48 +436,71 @@ int16 MS_ADPCMStream::decodeMS(ADPCMChannelStatus *c, byte code) {
 }
 
 int MS_ADPCMStream::readBuffer(int16 *buffer, const int numSamples) {
-	int samples;
-	byte data;
-	int i;
+	int samples = 0;
 
-	for (samples = 0; samples < numSamples && !endOfData(); samples++) {
-		if (_decodedSampleCount == 0) {
-			if (_blockPos[0] == _blockAlign) {
-				// read block header
-				for (i = 0; i < _channels; i++) {
-					_status.ch[i].predictor = CLIP(_stream->readByte(), (byte)0, (byte)6);
-					_status.ch[i].coeff1 = MSADPCMAdaptCoeff1[_status.ch[i].predictor];
-					_status.ch[i].coeff2 = MSADPCMAdaptCoeff2[_status.ch[i].predictor];
-				}
+	while (samples < numSamples) {
+		if (_blockSampleIndex == _blockSampleCount && !decodeBlock())
+			break;
 
-				for (i = 0; i < _channels; i++)
-					_status.ch[i].delta = _stream->readSint16LE();
+		int count = MIN<int>(numSamples - samples, _blockSampleCount - _blockSampleIndex);
+		memcpy(buffer + samples, _blockSamples + _blockSampleIndex, count * sizeof(int16));
+		_blockSampleIndex += count;
+		samples += count;
+	}
 
-				for (i = 0; i < _channels; i++)
-					_status.ch[i].sample1 = _stream->readSint16LE();
+	return samples;
+}
 
-				for (i = 0; i < _channels; i++)
-					_decodedSamples[_decodedSampleCount++] = _status.ch[i].sample2 = _stream->readSint16LE();
+bool MS_ADPCMStream::decodeBlock() {
+	if (_stream->eos() || _stream->pos() >= _endpos)
+		return false;
 
-				for (i = 0; i < _channels; i++)
-					_decodedSamples[_decodedSampleCount++] = _status.ch[i].sample1;
+	uint32 size = _stream->read(_blockData, MIN<uint32>(_blockAlign, _endpos - _stream->pos()));
+	const uint32 headerSize = _channels * 7;
+	if (size < headerSize)
+		return false;
 
-				_blockPos[0] = _channels * 7;
-			} else {
-				data = _stream->readByte();
-				_blockPos[0]++;
-				_decodedSamples[_decodedSampleCount++] = decodeMS(&_status.ch[0], (data >> 4) & 0x0f);
-				_decodedSamples[_decodedSampleCount++] = decodeMS(&_status.ch[_channels - 1], data & 0x0f);
-			}
-			_decodedSampleIndex = 0;
-		}
+	// The header holds the predictors, the deltas, and the first two samples
+	const byte *header = _blockData;
+	for (int i = 0; i < _channels; i++) {
+		_status.ch[i].predictor = CLIP<byte>(header[i], 0, 6);
+		_status.ch[i].coeff1 = MSADPCMAdaptCoeff1[_status.ch[i].predictor];
+		_status.ch[i].coeff2 = MSADPCMAdaptCoeff2[_status.ch[i].predictor];
+		_status.ch[i].delta = READ_LE_INT16(header + _channels + i * 2);
+		_status.ch[i].sample1 = READ_LE_INT16(header + _channels * 3 + i * 2);
+		_status.ch[i].sample2 = READ_LE_INT16(header + _channels * 5 + i * 2);
+
+		_blockSamples[i] = _status.ch[i].sample2;
+		_blockSamples[_channels + i] = _status.ch[i].sample1;
+	}
 
-		// _decodedSamples acts as a FIFO of depth 2 or 4;
-		buffer[samples] = _decodedSamples[_decodedSampleIndex++];
-		_decodedSampleCount--;
+	// Each byte holds a sample of the left channel in its high nibble, and
+	// one of the right channel in its low nibble. Each channel is decoded on
+	// its own. Mono data just has two samples per byte.
+	const byte *src = _blockData + headerSize;
+	const uint32 numBytes = size - headerSize;
+	int16 *dst = _blockSamples + _channels * 2;
+
+	if (_channels == 2) {
+		for (int i = 0; i < 2; i++) {
+			ADPCMChannelStatus status = _status.ch[i];
+			const int shift = (i == 0) ? 4 : 0;
+			for (uint32 j = 0; j < numBytes; j++)
+				dst[j * 2 + i] = decodeMS(&status, (src[j] >> shift) & 0x0f);
+			_status.ch[i] = status;
+		}
+	} else {
+		ADPCMChannelStatus status = _status.ch[0];
+		for (uint32 j = 0; j < numBytes; j++) {
+			*dst++ = decodeMS(&status, (src[j] >> 4) & 0x0f);
+			*dst++ = decodeMS(&status, src[j] & 0x0f);
+		}
+		_status.ch[0] = status;
 	}
 
-	return samples;
+	_blockSampleCount = _channels * 2 + numBytes * 2;
+	_blockSampleIndex = 0;
+	return true;
 }
 
 
@@ -547,15 +617,7 @@ const int16 Ima_ADPCMStream::_imaTable[89] = {
 };
 
 int16 Ima_ADPCMStream::decodeIMA(byte code, int channel) {
-	int32 E = (2 * (code & 0x7) + 1) * _imaTable[_status.ima_ch[channel].stepIndex] / 8;
-	int32 diff = (code & 0x08) ? -E : E;
-	int32 samp = CLIP<int32>(_status.ima_ch[channel].last + diff, -32768, 32767);
-
-	_status.ima_ch[channel].last = samp;
-	_status.ima_ch[channel].stepIndex += _stepAdjustTable[code];
-	_status.ima_ch[channel].stepIndex = CLIP<int32>(_status.ima_ch[channel].stepIndex, 0, ARRAYSIZE(_imaTable) - 1);
-
-	return samp;
+	return decodeIMANibble(code, _status.ima_ch[channel].last, _status.ima_ch[channel].stepIndex);
 }
 
 SeekableAudioStream *makeADPCMStream(Common::SeekableReadStream *stream, DisposeAfterUse::Flag disposeAfterUse, uint32 size, ADPCMType type, int rate, int channels, uint32 blockAlign) {
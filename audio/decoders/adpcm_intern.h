@@ -120,6 +120,18 @@ class Ima_ADPCMStream : public ADPCMStream {
 protected:
 	int16 decodeIMA(byte code, int channel = 0); // Default to using the left channel/using one channel
 
+	/**
+	 * Decodes a nibble of a channel whose state is held by the caller, so
+	 * that block decoders can keep it in registers for a whole block.
+	 */
+	static inline int16 decodeIMANibble(byte code, int32 &last, int32 &stepIndex) {
+		int32 E = (2 * (code & 0x7) + 1) * _imaTable[stepIndex] / 8;
+		int32 diff = (code & 0x08) ? -E : E;
+		last = CLIP<int32>(last + diff, -32768, 32767);
+		stepIndex = CLIP<int32>(stepIndex + _stepAdjustTable[code], 0, ARRAYSIZE(_imaTable) - 1);
+		return last;
+	}
+
 public:
 	Ima_ADPCMStream(Common::SeekableReadStream *stream, DisposeAfterUse::Flag disposeAfterUse, uint32 size, int rate, int channels, uint32 blockAlign)
 		: ADPCMStream(stream, disposeAfterUse, size, rate, channels, blockAlign) {}
@@ -133,15 +145,27 @@ public:
 class DVI_ADPCMStream : public Ima_ADPCMStream {
 public:
 	DVI_ADPCMStream(Common::SeekableReadStream *stream, DisposeAfterUse::Flag disposeAfterUse, uint32 size, int rate, int channels, uint32 blockAlign)
-		: Ima_ADPCMStream(stream, disposeAfterUse, size, rate, channels, blockAlign) { _decodedSampleCount = 0; }
+		: Ima_ADPCMStream(stream, disposeAfterUse, size, rate, channels, blockAlign) { _decodedSampleCount = _decodedSampleIndex = 0; }
 
-	virtual bool endOfData() const { return (_stream->eos() || _stream->pos() >= _endpos) && (_decodedSampleCount == 0); }
+	virtual bool endOfData() const { return (_stream->eos() || _stream->pos() >= _endpos) && (_decodedSampleIndex == _decodedSampleCount); }
 
 	virtual int readBuffer(int16 *buffer, const int numSamples);
 
+protected:
+	void reset() {
+		Ima_ADPCMStream::reset();
+		_decodedSampleCount = _decodedSampleIndex = 0;
+	}
+
 private:
-	uint8 _decodedSampleCount;
-	int16 _decodedSamples[2];
+	// The data has no blocks, it is decoded in chunks of this many bytes
+	enum { kChunkSize = 256 };
+
+	bool decodeChunk();
+
+	uint16 _decodedSampleCount;
+	uint16 _decodedSampleIndex;
+	int16 _decodedSamples[kChunkSize * 2];
 };
 
 class Apple_ADPCMStream : public Ima_ADPCMStream {
@@ -183,21 +207,32 @@ public:
 		if (blockAlign % (_channels * 4))
 			error("MSIma_ADPCMStream(): invalid blockAlign");
 
-		_samplesLeft[0] = 0;
-		_samplesLeft[1] = 0;
+		_blockData = new byte[blockAlign];
+		_blockSamples = new int16[blockAlign * 2];
+		_blockSampleCount = _blockSampleIndex = 0;
+	}
+
+	~MSIma_ADPCMStream() {
+		delete[] _blockData;
+		delete[] _blockSamples;
 	}
 
+	virtual bool endOfData() const { return (_stream->eos() || _stream->pos() >= _endpos) && (_blockSampleIndex == _blockSampleCount); }
+
 	virtual int readBuffer(int16 *buffer, const int numSamples);
 
 	void reset() {
 		Ima_ADPCMStream::reset();
-		_samplesLeft[0] = 0;
-		_samplesLeft[1] = 0;
+		_blockSampleCount = _blockSampleIndex = 0;
 	}
 
 private:
-	int16 _buffer[2][8];
-	int _samplesLeft[2];
+	bool decodeBlock();
+
+	byte *_blockData;
+	int16 *_blockSamples;
+	uint32 _blockSampleCount;
+	uint32 _blockSampleIndex;
 };
 
 class MS_ADPCMStream : public ADPCMStream {
@@ -216,32 +251,44 @@ protected:
 		ADPCMChannelStatus ch[2];
 	} _status;
 
-	void reset() {
-		ADPCMStream::reset();
-		memset(&_status, 0, sizeof(_status));
-	}
-
 public:
 	MS_ADPCMStream(Common::SeekableReadStream *stream, DisposeAfterUse::Flag disposeAfterUse, uint32 size, int rate, int channels, uint32 blockAlign)
 		: ADPCMStream(stream, disposeAfterUse, size, rate, channels, blockAlign) {
 		if (blockAlign == 0)
 			error("MS_ADPCMStream(): blockAlign isn't specified for MS ADPCM");
+		if (blockAlign < (uint32)channels * 7)
+			error("MS_ADPCMStream(): invalid blockAlign");
 		memset(&_status, 0, sizeof(_status));
-		_decodedSampleCount = 0;
-		_decodedSampleIndex = 0;
+		_blockData = new byte[blockAlign];
+		_blockSamples = new int16[blockAlign * 2];
+		_blockSampleCount = _blockSampleIndex = 0;
 	}
 
-	virtual bool endOfData() const { return (_stream->eos() || _stream->pos() >= _endpos) && (_decodedSampleCount == 0); }
+	~MS_ADPCMStream() {
+		delete[] _blockData;
+		delete[] _blockSamples;
+	}
+
+	virtual bool endOfData() const { return (_stream->eos() || _stream->pos() >= _endpos) && (_blockSampleIndex == _blockSampleCount); }
 
 	virtual int readBuffer(int16 *buffer, const int numSamples);
 
 protected:
+	void reset() {
+		ADPCMStream::reset();
+		memset(&_status, 0, sizeof(_status));
+		_blockSampleCount = _blockSampleIndex = 0;
+	}
+
 	int16 decodeMS(ADPCMChannelStatus *c, byte);
 
 private:
-	uint8 _decodedSampleCount;
-	uint8 _decodedSampleIndex;
-	int16 _decodedSamples[4];
+	bool decodeBlock();
+
+	byte *_blockData;
+	int16 *_blockSamples;
+	uint32 _blockSampleCount;
+	uint32 _blockSampleIndex;
 };
 
 // Duck DK3 IMA ADPCM Decoder
@@ -21,6 +21,7 @@
  */
 
 #include "common/endian.h"
+#include "common/filemapping.h"
 #include "common/memstream.h"
 #include "common/textconsole.h"
 #include "common/util.h"
@@ -45,15 +46,21 @@ namespace Audio {
 
 /**
  * This is a stream, which allows for playing raw PCM data from a stream.
+ *
+ * Samples of memory streams, e.g. over a memory mapped archive, are converted
+ * straight from the memory instead of being copied into a buffer first.
  */
 template<bool is16Bit, bool isUnsigned, bool isLE>
 class RawStream : public SeekableAudioStream {
 public:
 	RawStream(int rate, bool stereo, DisposeAfterUse::Flag disposeStream, Common::SeekableReadStream *stream)
-		: _rate(rate), _isStereo(stereo), _playtime(0, rate), _stream(stream, disposeStream), _endOfData(false), _buffer(0) {
+		: _rate(rate), _isStereo(stereo), _playtime(0, rate), _stream(stream, disposeStream), _endOfData(false),
+		  _memoryStream(dynamic_cast<Common::MemoryReadStream *>(stream)), _buffer(0) {
 		// Setup our buffer for readBuffer
-		_buffer = new byte[kSampleBufferLength * (is16Bit ? 2 : 1)];
-		assert(_buffer);
+		if (!_memoryStream) {
+			_buffer = new byte[kSampleBufferLength * (is16Bit ? 2 : 1)];
+			assert(_buffer);
+		}
 
 		// Calculate the total playtime of the stream
 		_playtime = Timestamp(0, _stream->size() / (_isStereo ? 2 : 1) / (is16Bit ? 2 : 1), rate);
@@ -78,6 +85,7 @@ private:
 	Timestamp _playtime;                                       ///< Calculated total play time
 	Common::DisposablePtr<Common::SeekableReadStream> _stream; ///< Stream to read data from
 	bool _endOfData;                                           ///< Whether the stream end has been reached
+	Common::MemoryReadStream *_memoryStream;                   ///< _stream, when its data can be read in place
 
 	byte *_buffer;                                             ///< Buffer used in readBuffer
 	enum {
@@ -97,10 +105,18 @@ private:
 	 * @return actual count of samples read.
 	 */
 	int fillBuffer(int maxSamples);
+
+	/**
+	 * Convert samples straight from the memory of _memoryStream.
+	 */
+	int readMemory(int16 *buffer, const int numSamples);
 };
 
 template<bool is16Bit, bool isUnsigned, bool isLE>
 int RawStream<is16Bit, isUnsigned, isLE>::readBuffer(int16 *buffer, const int numSamples) {
+	if (_memoryStream)
+		return readMemory(buffer, numSamples);
+
 	int samplesLeft = numSamples;
 
 	while (samplesLeft > 0) {
@@ -159,6 +175,28 @@ int RawStream<is16Bit, isUnsigned, isLE>::fillBuffer(int maxSamples) {
 	return bufferedSamples;
 }
 
+template<bool is16Bit, bool isUnsigned, bool isLE>
+int RawStream<is16Bit, isUnsigned, isLE>::readMemory(int16 *buffer, const int numSamples) {
+	if (endOfData())
+		return 0;
+
+	const uint32 pos = _memoryStream->pos();
+	const uint32 size = _memoryStream->size();
+	const int samples = MIN<uint32>(numSamples, (size - pos) / (is16Bit ? 2 : 1));
+
+	const byte *src = _memoryStream->getData() + pos;
+	for (int i = 0; i < samples; i++) {
+		*buffer++ = READ_ENDIAN_SAMPLE(is16Bit, isUnsigned, src, isLE);
+		src += (is16Bit ? 2 : 1);
+	}
+
+	_memoryStream->seek(pos + samples * (is16Bit ? 2 : 1));
+	if ((uint32)_memoryStream->pos() + (is16Bit ? 2 : 1) > size)
+		_endOfData = true;
+
+	return samples;
+}
+
 template<bool is16Bit, bool isUnsigned, bool isLE>
 bool RawStream<is16Bit, isUnsigned, isLE>::seek(const Timestamp &where) {
 	_endOfData = true;
@@ -221,6 +259,11 @@ SeekableAudioStream *makeRawStream(const byte *buffer, uint32 size,
 	return makeRawStream(new Common::MemoryReadStream(buffer, size, disposeAfterUse), rate, flags, DisposeAfterUse::YES);
 }
 
+SeekableAudioStream *makeRawStream(Common::FileMapping *mapping, uint32 offset, uint32 size,
+                                   int rate, byte flags) {
+	return makeRawStream(new Common::MappedReadStream(mapping, offset, size), rate, flags, DisposeAfterUse::YES);
+}
+
 class PacketizedRawStream : public StatelessPacketizedAudioStream {
 public:
 	PacketizedRawStream(int rate, byte flags) :
@@ -30,6 +30,7 @@
 
 
 namespace Common {
+class FileMapping;
 class SeekableReadStream;
 }
 
@@ -76,6 +77,22 @@ SeekableAudioStream *makeRawStream(const byte *buffer, uint32 size,
                                    int rate, byte flags,
                                    DisposeAfterUse::Flag disposeAfterUse = DisposeAfterUse::YES);
 
+/**
+ * Creates an audio stream, which plays a range of a memory mapped file
+ * without copying it. The stream holds a reference to the mapping, so the
+ * archive it belongs to may be closed while the sound is playing.
+ *
+ * @param mapping Mapping to play from.
+ * @param offset  Offset of the sound data in the mapping.
+ * @param size    Size of the sound data in bytes.
+ * @param rate    Rate of the sound data.
+ * @param flags   Audio flags combination.
+ * @see RawFlags
+ * @return The new SeekableAudioStream (or 0 on failure).
+ */
+SeekableAudioStream *makeRawStream(Common::FileMapping *mapping, uint32 offset, uint32 size,
+                                   int rate, byte flags);
+
 /**
  * Creates an audio stream, which plays from the given stream.
  *
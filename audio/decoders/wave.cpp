@@ -21,8 +21,10 @@
  */
 
 #include "common/debug.h"
+#include "common/memstream.h"
 #include "common/textconsole.h"
 #include "common/stream.h"
+#include "common/substream.h"
 
 #include "audio/audiostream.h"
 #include "audio/decoders/wave.h"
@@ -215,16 +217,31 @@ SeekableAudioStream *makeWAVStream(Common::SeekableReadStream *stream, DisposeAf
 		size &= ~(sampleSize - 1);
 	}
 
-	// Raw PCM. Just read everything at once.
-	// TODO: More elegant would be to wrap the stream.
-	byte *data = (byte *)malloc(size);
-	assert(data);
-	stream->read(data, size);
+	// A file cut off in its data chunk plays what is left of it
+	const int available = MAX<int>(stream->size() - stream->pos(), 0);
+	if (size > available) {
+		warning("makeWAVStream: WAVE file is truncated");
+		size = available & ~(sampleSize - 1);
+	}
+
+	// Raw PCM. Just read everything at once, which doesn't copy anything
+	// when the file is memory mapped. readStream() can't read nothing, so an
+	// empty data chunk gives an empty stream.
+	Common::SeekableReadStream *data;
+	if (size > 0)
+		data = stream->readStream(size);
+	else
+		data = new Common::MemoryReadStream(nullptr, 0);
 
 	if (disposeAfterUse == DisposeAfterUse::YES)
 		delete stream;
 
-	return makeRawStream(data, size, rate, flags);
+	if (data->size() % sampleSize != 0) {
+		warning("makeWAVStream: WAVE file is truncated");
+		data = new Common::SeekableSubReadStream(data, 0, data->size() & ~(sampleSize - 1), DisposeAfterUse::YES);
+	}
+
+	return makeRawStream(data, rate, flags);
 }
 
 } // End of namespace Audio
@@ -0,0 +1,370 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "audio/effects.h"
+#include "audio/mixer.h"
+#include "audio/rate.h"
+#include "common/util.h"
+
+#include <math.h>
+
+#if !defined(OUTPUT_UNSIGNED_AUDIO) && defined(__SSE2__)
+#define AUDIO_EFFECTS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Audio {
+
+bool EffectSettings::isEmpty() const {
+	for (int i = 0; i < kMaxFilters; i++) {
+		if (filters[i].type != FilterSettings::kFilterNone)
+			return false;
+	}
+	return reverbSend == 0;
+}
+
+BiquadCoefficients::BiquadCoefficients(const FilterSettings &settings, uint rate) {
+	const double frequency = CLIP<double>(settings.frequency, 10.0, rate * 0.45);
+	const double w0 = 2.0 * M_PI * frequency / rate;
+	const double cosw0 = cos(w0);
+	const double alpha = sin(w0) / (2.0 * MAX<double>(settings.q, 0.1));
+	const double a = pow(10.0, settings.gain / 40.0);
+	const double shelf = 2.0 * sqrt(a) * alpha;
+
+	double nb0, nb1, nb2, na0, na1, na2;
+	switch (settings.type) {
+	case FilterSettings::kFilterLowPass:
+		nb0 = (1.0 - cosw0) / 2.0;
+		nb1 = 1.0 - cosw0;
+		nb2 = (1.0 - cosw0) / 2.0;
+		na0 = 1.0 + alpha;
+		na1 = -2.0 * cosw0;
+		na2 = 1.0 - alpha;
+		break;
+	case FilterSettings::kFilterHighPass:
+		nb0 = (1.0 + cosw0) / 2.0;
+		nb1 = -(1.0 + cosw0);
+		nb2 = (1.0 + cosw0) / 2.0;
+		na0 = 1.0 + alpha;
+		na1 = -2.0 * cosw0;
+		na2 = 1.0 - alpha;
+		break;
+	case FilterSettings::kFilterPeaking:
+		nb0 = 1.0 + alpha * a;
+		nb1 = -2.0 * cosw0;
+		nb2 = 1.0 - alpha * a;
+		na0 = 1.0 + alpha / a;
+		na1 = -2.0 * cosw0;
+		na2 = 1.0 - alpha / a;
+		break;
+	case FilterSettings::kFilterLowShelf:
+		nb0 = a * ((a + 1.0) - (a - 1.0) * cosw0 + shelf);
+		nb1 = 2.0 * a * ((a - 1.0) - (a + 1.0) * cosw0);
+		nb2 = a * ((a + 1.0) - (a - 1.0) * cosw0 - shelf);
+		na0 = (a + 1.0) + (a - 1.0) * cosw0 + shelf;
+		na1 = -2.0 * ((a - 1.0) + (a + 1.0) * cosw0);
+		na2 = (a + 1.0) + (a - 1.0) * cosw0 - shelf;
+		break;
+	case FilterSettings::kFilterHighShelf:
+		nb0 = a * ((a + 1.0) + (a - 1.0) * cosw0 + shelf);
+		nb1 = -2.0 * a * ((a - 1.0) + (a + 1.0) * cosw0);
+		nb2 = a * ((a + 1.0) + (a - 1.0) * cosw0 - shelf);
+		na0 = (a + 1.0) - (a - 1.0) * cosw0 + shelf;
+		na1 = 2.0 * ((a - 1.0) - (a + 1.0) * cosw0);
+		na2 = (a + 1.0) - (a - 1.0) * cosw0 - shelf;
+		break;
+	default:
+		nb0 = na0 = 1.0;
+		nb1 = nb2 = na1 = na2 = 0.0;
+		break;
+	}
+
+	b0 = (float)(nb0 / na0);
+	b1 = (float)(nb1 / na0);
+	b2 = (float)(nb2 / na0);
+	a1 = (float)(na1 / na0);
+	a2 = (float)(na2 / na0);
+}
+
+EffectChain::EffectChain(const EffectSettings &typeSettings, const EffectSettings &channelSettings, uint rate) :
+		numFilters(0) {
+	const EffectSettings *settings[] = { &typeSettings, &channelSettings };
+	for (int i = 0; i < ARRAYSIZE(settings); i++) {
+		for (int j = 0; j < EffectSettings::kMaxFilters; j++) {
+			if (settings[i]->filters[j].type != FilterSettings::kFilterNone)
+				filters[numFilters++] = BiquadCoefficients(settings[i]->filters[j], rate);
+		}
+	}
+
+	const int send = MIN<int>(typeSettings.reverbSend + channelSettings.reverbSend, Mixer::kMaxChannelVolume);
+	reverbSend = (float)send / Mixer::kMaxChannelVolume;
+}
+
+#pragma mark -
+#pragma mark --- Block processing ---
+#pragma mark -
+
+/**
+ * Runs a biquad over interleaved stereo frames. The SSE2 version filters
+ * both channels of a frame at once; the recursion prevents filtering several
+ * frames of a channel at once.
+ */
+static void processBiquad(const BiquadCoefficients &c, float *z1, float *z2, float *frames, uint numFrames) {
+#if defined(AUDIO_EFFECTS_SSE2)
+	const __m128 b0 = _mm_set1_ps(c.b0), b1 = _mm_set1_ps(c.b1), b2 = _mm_set1_ps(c.b2);
+	const __m128 a1 = _mm_set1_ps(c.a1), a2 = _mm_set1_ps(c.a2);
+	__m128 s1 = _mm_castpd_ps(_mm_load_sd((const double *)z1));
+	__m128 s2 = _mm_castpd_ps(_mm_load_sd((const double *)z2));
+
+	for (uint i = 0; i < numFrames; i++) {
+		const __m128 x = _mm_castpd_ps(_mm_load_sd((const double *)(frames + i * 2)));
+		const __m128 y = _mm_add_ps(_mm_mul_ps(b0, x), s1);
+		s1 = _mm_add_ps(_mm_sub_ps(_mm_mul_ps(b1, x), _mm_mul_ps(a1, y)), s2);
+		s2 = _mm_sub_ps(_mm_mul_ps(b2, x), _mm_mul_ps(a2, y));
+		_mm_store_sd((double *)(frames + i * 2), _mm_castps_pd(y));
+	}
+
+	_mm_store_sd((double *)z1, _mm_castps_pd(s1));
+	_mm_store_sd((double *)z2, _mm_castps_pd(s2));
+#else
+	for (uint i = 0; i < numFrames; i++) {
+		for (int j = 0; j < 2; j++) {
+			const float x = frames[i * 2 + j];
+			const float y = c.b0 * x + z1[j];
+			z1[j] = c.b1 * x - c.a1 * y + z2[j];
+			z2[j] = c.b2 * x - c.a2 * y;
+			frames[i * 2 + j] = y;
+		}
+	}
+#endif
+}
+
+/** Adds the samples scaled by the gain to the destination. */
+static void addScaledSamples(float *dst, const float *src, float gain, uint numSamples) {
+	uint i = 0;
+
+#if defined(AUDIO_EFFECTS_SSE2)
+	const __m128 scale = _mm_set1_ps(gain);
+	for (; i + 4 <= numSamples; i += 4)
+		_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_loadu_ps(src + i), scale)));
+#endif
+
+	for (; i < numSamples; i++)
+		dst[i] += src[i] * gain;
+}
+
+void convertSamplesToFloat(const int16 *in, float *out, uint numSamples) {
+	uint i = 0;
+
+#if defined(AUDIO_EFFECTS_SSE2)
+	for (; i + 8 <= numSamples; i += 8) {
+		const __m128i samples = _mm_loadu_si128((const __m128i *)(in + i));
+		const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+		const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+		_mm_storeu_ps(out + i, _mm_cvtepi32_ps(lo));
+		_mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(hi));
+	}
+#endif
+
+	for (; i < numSamples; i++)
+		out[i] = in[i];
+}
+
+// Every path rounds half away from zero, by adding a half with the sign of
+// the sample and truncating. The output then doesn't depend on the CPU, or on
+// where a sample is in the buffer.
+void mixFloatSamples(int16 *out, const float *in, uint numSamples) {
+	uint i = 0;
+
+#if defined(AUDIO_EFFECTS_SSE2)
+	// Conversions of floats out of the 32-bit range give INT_MIN, so clamp them first
+	const __m128 low = _mm_set1_ps(-65536.0f), high = _mm_set1_ps(65536.0f);
+	const __m128 sign = _mm_set1_ps(-0.0f), half = _mm_set1_ps(0.5f);
+	for (; i + 8 <= numSamples; i += 8) {
+		__m128 lo = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), low), high);
+		__m128 hi = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), low), high);
+		lo = _mm_add_ps(lo, _mm_or_ps(_mm_and_ps(lo, sign), half));
+		hi = _mm_add_ps(hi, _mm_or_ps(_mm_and_ps(hi, sign), half));
+		const __m128i samples = _mm_packs_epi32(_mm_cvttps_epi32(lo), _mm_cvttps_epi32(hi));
+		__m128i *dst = (__m128i *)(out + i);
+		_mm_storeu_si128(dst, _mm_adds_epi16(_mm_loadu_si128(dst), samples));
+	}
+#endif
+
+	for (; i < numSamples; i++) {
+		const float sample = CLIP<float>(in[i], -65536.0f, 65536.0f);
+		clampedAdd(out[i], (int)(sample < 0.0f ? sample - 0.5f : sample + 0.5f));
+	}
+}
+
+#pragma mark -
+#pragma mark --- ChannelEffects ---
+#pragma mark -
+
+ChannelEffects::ChannelEffects() : _chain(nullptr) {
+	memset(_states, 0, sizeof(_states));
+}
+
+ChannelEffects::~ChannelEffects() {
+	delete _chain;
+}
+
+EffectChain *ChannelEffects::setChain(EffectChain *chain) {
+	// Filters which aren't used anymore start from silence when they come back
+	const int numFilters = chain ? chain->numFilters : 0;
+	for (int i = numFilters; i < EffectChain::kMaxFilters; i++)
+		memset(&_states[i], 0, sizeof(_states[i]));
+
+	EffectChain *replaced = _chain;
+	_chain = chain;
+	return replaced;
+}
+
+void ChannelEffects::process(float *frames, uint numFrames, float *reverbInput) {
+	if (!_chain)
+		return;
+
+	for (int i = 0; i < _chain->numFilters; i++)
+		processBiquad(_chain->filters[i], _states[i].z1, _states[i].z2, frames, numFrames);
+
+	if (reverbInput && _chain->reverbSend > 0.0f)
+		addScaledSamples(reverbInput, frames, _chain->reverbSend, numFrames * 2);
+}
+
+#pragma mark -
+#pragma mark --- Reverb ---
+#pragma mark -
+
+namespace {
+
+/** Lengths at 44.1kHz of the delay lines of the left channel, from Freeverb */
+const uint kCombLengths[] = { 1116, 1188, 1277, 1356 };
+const uint kAllpassLengths[] = { 556, 441 };
+/** How much longer the delay lines of the right channel are */
+const uint kStereoSpread = 23;
+
+/** Gain of the (mono) input, so that the sum of the combs has about the level of the input */
+const float kInputGain = 0.03f;
+/** Gain of the output at the maximum level */
+const float kWetGain = 3.0f;
+
+/** Keeps the filters from decaying into denormals, which are slow on many CPUs */
+inline float flushDenormal(float value) {
+	return fabsf(value) < 1e-15f ? 0.0f : value;
+}
+
+} // End of anonymous namespace
+
+Reverb::Reverb(uint rate) : _feedback(0.0f), _damping(0.0f), _wet(0.0f), _ringing(false) {
+	uint sizes[2][kNumCombs + kNumAllpasses];
+	uint total = 0;
+	for (int side = 0; side < 2; side++) {
+		for (int i = 0; i < kNumCombs + kNumAllpasses; i++) {
+			const uint length = (i < kNumCombs ? kCombLengths[i] : kAllpassLengths[i - kNumCombs]) + side * kStereoSpread;
+			sizes[side][i] = MAX<uint>(1, length * rate / 44100);
+			total += sizes[side][i];
+		}
+	}
+
+	_memory = new float[total];
+	memset(_memory, 0, total * sizeof(float));
+
+	float *buffer = _memory;
+	for (int side = 0; side < 2; side++) {
+		for (int i = 0; i < kNumCombs; i++) {
+			Comb &comb = _combs[side][i];
+			comb.buffer = buffer;
+			comb.size = sizes[side][i];
+			comb.pos = 0;
+			comb.store = 0.0f;
+			buffer += comb.size;
+		}
+		for (int i = 0; i < kNumAllpasses; i++) {
+			Allpass &allpass = _allpasses[side][i];
+			allpass.buffer = buffer;
+			allpass.size = sizes[side][kNumCombs + i];
+			allpass.pos = 0;
+			buffer += allpass.size;
+		}
+	}
+
+	ReverbSettings settings;
+	setSettings(settings);
+}
+
+Reverb::~Reverb() {
+	delete[] _memory;
+}
+
+void Reverb::setSettings(const ReverbSettings &settings) {
+	_feedback = 0.7f + 0.28f * CLIP(settings.roomSize, 0.0f, 1.0f);
+	_damping = 0.4f * CLIP(settings.damping, 0.0f, 1.0f);
+	_wet = kWetGain * settings.level / Mixer::kMaxChannelVolume;
+}
+
+void Reverb::process(const float *input, int16 *output, uint numFrames) {
+	float peak = 0.0f;
+
+	while (numFrames > 0) {
+		const uint frames = MIN<uint>(numFrames, kBlockFrames);
+
+		for (int side = 0; side < 2; side++) {
+			for (uint i = 0; i < frames; i++) {
+				const float in = (input[i * 2] + input[i * 2 + 1]) * kInputGain;
+
+				float out = 0.0f;
+				for (int j = 0; j < kNumCombs; j++) {
+					Comb &comb = _combs[side][j];
+					const float delayed = comb.buffer[comb.pos];
+					comb.store = flushDenormal(delayed * (1.0f - _damping) + comb.store * _damping);
+					comb.buffer[comb.pos] = in + comb.store * _feedback;
+					if (++comb.pos == comb.size)
+						comb.pos = 0;
+					out += delayed;
+				}
+
+				for (int j = 0; j < kNumAllpasses; j++) {
+					Allpass &allpass = _allpasses[side][j];
+					const float delayed = allpass.buffer[allpass.pos];
+					allpass.buffer[allpass.pos] = flushDenormal(out + delayed * 0.5f);
+					if (++allpass.pos == allpass.size)
+						allpass.pos = 0;
+					out = delayed - out;
+				}
+
+				out *= _wet;
+				_block[i * 2 + side] = out;
+				peak = MAX(peak, fabsf(out));
+			}
+		}
+
+		mixFloatSamples(output, _block, frames * 2);
+		input += frames * 2;
+		output += frames * 2;
+		numFrames -= frames;
+	}
+
+	// The tail is inaudible once it rounds to silence
+	_ringing = peak >= 0.5f;
+}
+
+} // End of namespace Audio
@@ -0,0 +1,243 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef AUDIO_EFFECTS_H
+#define AUDIO_EFFECTS_H
+
+#include "common/scummsys.h"
+
+namespace Audio {
+
+/**
+ * A second order filter inserted in a mixer channel. The filters follow the
+ * formulas of the Audio EQ Cookbook by Robert Bristow-Johnson.
+ */
+struct FilterSettings {
+	enum Type {
+		kFilterNone,
+		kFilterLowPass,
+		kFilterHighPass,
+		/** Boosts or cuts a band around the frequency */
+		kFilterPeaking,
+		/** Boosts or cuts the frequencies below the frequency */
+		kFilterLowShelf,
+		/** Boosts or cuts the frequencies above the frequency */
+		kFilterHighShelf
+	};
+
+	FilterSettings() : type(kFilterNone), frequency(1000.0f), q(0.7071f), gain(0.0f) {}
+	FilterSettings(Type type_, float frequency_, float q_ = 0.7071f, float gain_ = 0.0f) :
+		type(type_), frequency(frequency_), q(q_), gain(gain_) {}
+
+	Type type;
+	/** The cutoff frequency, or the centre of the band, in Hz */
+	float frequency;
+	/** The resonance of the pass filters, or the width of the band */
+	float q;
+	/** The boost (or cut, if negative) in dB, only used by the peaking and shelving filters */
+	float gain;
+};
+
+/**
+ * The effects inserted after the volume and balance of a mixer channel,
+ * or of all the channels of a sound type.
+ *
+ * @see Mixer::setChannelEffects, Mixer::setEffectsForSoundType
+ */
+struct EffectSettings {
+	enum {
+		kMaxFilters = 2
+	};
+
+	EffectSettings() : reverbSend(0) {}
+
+	bool isEmpty() const;
+
+	/** The filters, applied in order; unused ones are kFilterNone */
+	FilterSettings filters[kMaxFilters];
+	/** How much of the filtered sound is sent to the reverb, 0 - Mixer::kMaxChannelVolume */
+	byte reverbSend;
+};
+
+/**
+ * The settings of the reverb shared by all the channels of the mixer.
+ *
+ * @see Mixer::setReverb
+ */
+struct ReverbSettings {
+	ReverbSettings() : roomSize(0.5f), damping(0.5f), level(0) {}
+
+	/** From 0 (small room) to 1 (large hall) */
+	float roomSize;
+	/** From 0 (bright) to 1 (absorbs the high frequencies) */
+	float damping;
+	/** The level of the reverberation, 0 - Mixer::kMaxChannelVolume; 0 disables the reverb */
+	byte level;
+};
+
+/**
+ * Coefficients of a biquad filter, normalized so that a0 is 1.
+ */
+struct BiquadCoefficients {
+	/** Passes the signal unchanged */
+	BiquadCoefficients() : b0(1.0f), b1(0.0f), b2(0.0f), a1(0.0f), a2(0.0f) {}
+
+	BiquadCoefficients(const FilterSettings &settings, uint rate);
+
+	float b0, b1, b2, a1, a2;
+};
+
+/**
+ * The effects of a mixer channel, prepared for the output rate: the filters
+ * of its sound type followed by its own ones, and the sum of their sends.
+ * The mixer callback never changes a chain, it replaces it.
+ */
+struct EffectChain {
+	enum {
+		kMaxFilters = 2 * EffectSettings::kMaxFilters
+	};
+
+	EffectChain(const EffectSettings &typeSettings, const EffectSettings &channelSettings, uint rate);
+
+	int numFilters;
+	BiquadCoefficients filters[kMaxFilters];
+	/** Gain of the signal sent to the reverb */
+	float reverbSend;
+};
+
+/**
+ * Runs an EffectChain over the blocks of a channel, keeping the history
+ * of the filters from one block to the next.
+ */
+class ChannelEffects {
+public:
+	ChannelEffects();
+	~ChannelEffects();
+
+	/**
+	 * Replaces the effects, keeping the history of the filters so that
+	 * changing their settings doesn't click.
+	 *
+	 * @param chain the new effects, which this takes over, or 0 for none
+	 * @return the replaced effects, which the caller must delete, or 0
+	 */
+	EffectChain *setChain(EffectChain *chain);
+
+	bool isActive() const { return _chain != nullptr; }
+	bool hasReverbSend() const { return _chain && _chain->reverbSend > 0.0f; }
+
+	/**
+	 * Filters the interleaved stereo frames in place, then adds them scaled
+	 * by the send level to the reverb input.
+	 *
+	 * @param reverbInput stereo frames to add the send to, or 0 when the reverb is disabled
+	 */
+	void process(float *frames, uint numFrames, float *reverbInput);
+
+private:
+	/** History of a filter for the two output channels, in transposed direct form II */
+	struct FilterState {
+		float z1[2];
+		float z2[2];
+	};
+
+	EffectChain *_chain;
+	FilterState _states[EffectChain::kMaxFilters];
+};
+
+/**
+ * A small reverb after the Freeverb design of Jezar at Dreampoint: parallel
+ * damped comb filters followed by allpass filters, for each output channel.
+ * The input is mixed to mono.
+ */
+class Reverb {
+public:
+	Reverb(uint rate);
+	~Reverb();
+
+	void setSettings(const ReverbSettings &settings);
+	bool isEnabled() const { return _wet > 0.0f; }
+
+	/**
+	 * Whether the output of the last processed block wasn't silent, so that
+	 * the tail has to be processed even without input.
+	 */
+	bool isRinging() const { return _ringing; }
+
+	/**
+	 * Reverberates the input, and mixes the result into the output.
+	 *
+	 * @param input     interleaved stereo frames
+	 * @param output    interleaved stereo 16-bit samples
+	 * @param numFrames the number of frames of the input and the output
+	 */
+	void process(const float *input, int16 *output, uint numFrames);
+
+private:
+	enum {
+		kNumCombs = 4,
+		kNumAllpasses = 2
+	};
+
+	struct Comb {
+		float *buffer;
+		uint size;
+		uint pos;
+		float store;
+	};
+
+	struct Allpass {
+		float *buffer;
+		uint size;
+		uint pos;
+	};
+
+	float *_memory;
+	Comb _combs[2][kNumCombs];
+	Allpass _allpasses[2][kNumAllpasses];
+
+	float _feedback;
+	float _damping;
+	float _wet;
+	bool _ringing;
+
+	/** Scratch output of process(), mixed into the output a block at a time */
+	enum {
+		kBlockFrames = 256
+	};
+	float _block[kBlockFrames * 2];
+};
+
+/**
+ * Converts 16-bit samples to floats, in the same scale.
+ */
+void convertSamplesToFloat(const int16 *in, float *out, uint numSamples);
+
+/**
+ * Rounds the float samples and mixes them into the 16-bit output, clamped
+ * like clampedAdd does.
+ */
+void mixFloatSamples(int16 *out, const float *in, uint numSamples);
+
+} // End of namespace Audio
+
+#endif
@@ -23,8 +23,10 @@
 #include "gui/EventRecorder.h"
 
 #include "common/util.h"
+#include "common/system.h"
 #include "common/textconsole.h"
 
+#include "audio/effects.h"
 #include "audio/mixer_intern.h"
 #include "audio/rate.h"
 #include "audio/audiostream.h"
@@ -39,11 +41,13 @@ namespace Audio {
 
 
 /**
- * Channel used by the default Mixer implementation.
+ * Channel used by the default Mixer implementation. Channels are only
+ * accessed by the mixer callback; the engine side state of a channel is
+ * kept in MixerImpl::ChannelState.
  */
 class Channel {
 public:
-	Channel(Mixer *mixer, Mixer::SoundType type, AudioStream *stream, DisposeAfterUse::Flag autofreeStream, bool reverseStereo, int id, bool permanent);
+	Channel(Mixer *mixer, AudioStream *stream, DisposeAfterUse::Flag autofreeStream, bool reverseStereo, RateQuality rateQuality);
 	~Channel();
 
 	/**
@@ -58,78 +62,71 @@ public:
 	int mix(int16 *data, uint len);
 
 	/**
-	 * Queries whether the channel is still playing or not.
-	 */
-	bool isFinished() const { return _stream->endOfStream(); }
-
-	/**
-	 * Queries whether the channel is a permanent channel.
-	 * A permanent channel is not affected by a Mixer::stopAll
-	 * call.
-	 */
-	bool isPermanent() const { return _permanent; }
-
-	/**
-	 * Returns the id of the channel.
+	 * Mixes the channel's samples through its effects into the given buffer,
+	 * a block at a time.
+	 *
+	 * @param data        buffer where to mix the data
+	 * @param len         number of sample pairs
+	 * @param samples     scratch buffer of blockFrames sample pairs
+	 * @param frames      scratch buffer of blockFrames float sample pairs
+	 * @param blockFrames the number of sample pairs processed at once
+	 * @param reverbInput len float sample pairs to add the reverb send to,
+	 *                    or 0 when the reverb is disabled
+	 * @return number of sample pairs processed
 	 */
-	int getId() const { return _id; }
+	int mixEffects(int16 *data, uint len, int16 *samples, float *frames, uint blockFrames, float *reverbInput);
 
 	/**
-	 * Pauses or unpaused the channel in a recursive fashion.
+	 * Sets the effects of the channel.
 	 *
-	 * @param paused true, when the channel should be paused.
-	 *               false when it should be unpaused.
+	 * @param effects the new effects, which the channel takes over, or 0 for none
+	 * @return the replaced effects, or 0
 	 */
-	void pause(bool paused);
+	EffectChain *setEffects(EffectChain *effects) { return _effects.setChain(effects); }
 
 	/**
-	 * Queries whether the channel is currently paused.
+	 * Queries whether the channel has to be mixed with mixEffects().
 	 */
-	bool isPaused() const { return (_pauseLevel != 0); }
+	bool hasEffects() const { return _effects.isActive(); }
 
 	/**
-	 * Sets the channel's own volume.
-	 *
-	 * @param volume new volume
+	 * Queries whether the channel sends anything to the reverb.
 	 */
-	void setVolume(const byte volume);
+	bool hasReverbSend() const { return _effects.hasReverbSend(); }
 
 	/**
-	 * Gets the channel's own volume.
-	 *
-	 * @return volume
+	 * Queries whether the channel is still playing or not.
 	 */
-	byte getVolume();
+	bool isFinished() const { return _stream->endOfStream(); }
 
 	/**
-	 * Sets the channel's balance setting.
-	 *
-	 * @param balance new balance
+	 * Pauses or unpauses the channel.
 	 */
-	void setBalance(const int8 balance);
+	void setPaused(bool paused) { _paused = paused; }
 
 	/**
-	 * Gets the channel's balance setting.
-	 *
-	 * @return balance
+	 * Queries whether the channel is currently paused.
 	 */
-	int8 getBalance();
+	bool isPaused() const { return _paused; }
 
 	/**
-	 * Notifies the channel that the global sound type
-	 * volume settings changed.
+	 * Sets the effective volumes of the left and right output channels,
+	 * in the range 0 - Mixer::kMaxMixerVolume.
 	 */
-	void notifyGlobalVolChange() { updateChannelVolumes(); }
+	void setOutputVolumes(st_volume_t volL, st_volume_t volR) {
+		_volL = volL;
+		_volR = volR;
+	}
 
 	/**
-	 * Queries how long the channel has been playing.
+	 * Queries the number of sample pairs output before the last mixed block.
 	 */
-	Timestamp getElapsedTime();
+	uint32 getSamplesConsumed() const { return _samplesConsumed; }
 
 	/**
-	 * Queries the channel's sound type.
+	 * Queries the time at which the last block was mixed.
 	 */
-	Mixer::SoundType getType() const { return _type; }
+	uint32 getMixerTimeStamp() const { return _mixerTimeStamp; }
 
 	/**
 	 * Sets the channel's sound handle.
@@ -144,62 +141,165 @@ public:
 	SoundHandle getHandle() const { return _handle; }
 
 private:
-	const Mixer::SoundType _type;
 	SoundHandle _handle;
-	bool _permanent;
-	int _pauseLevel;
-	int _id;
+	bool _paused;
 
-	byte _volume;
-	int8 _balance;
-
-	void updateChannelVolumes();
 	st_volume_t _volL, _volR;
 
-	Mixer *_mixer;
-
 	uint32 _samplesConsumed;
 	uint32 _samplesDecoded;
 	uint32 _mixerTimeStamp;
-	uint32 _pauseStartTime;
-	uint32 _pauseTime;
 
 	RateConverter *_converter;
 	Common::DisposablePtr<AudioStream> _stream;
+	ChannelEffects _effects;
 };
 
 #pragma mark -
 #pragma mark --- Mixer ---
 #pragma mark -
 
-MixerImpl::MixerImpl(uint sampleRate)
-	: _mutex(), _sampleRate(sampleRate), _mixerReady(false), _handleSeed(0), _soundTypeSettings() {
+MixerImpl::MixerImpl(uint sampleRate, RateQuality rateQuality)
+	: _mutex(), _sampleRate(sampleRate), _rateQuality(rateQuality), _mixerReady(0), _handleSeed(0), _soundTypeSettings(), _mixEpoch(0),
+	  _reverbCreated(false), _reverb(0) {
 
 	assert(sampleRate > 0);
 
-	for (int i = 0; i != NUM_CHANNELS; i++)
+	for (int i = 0; i != NUM_CHANNELS; i++) {
 		_channels[i] = 0;
+		_finishedHandles[i] = SoundHandle()._val;
+		_stopHandles[i] = SoundHandle()._val;
+		_clocks[i].sequence = 0;
+		_clocks[i].handle = SoundHandle()._val;
+		_clocks[i].samplesConsumed = 0;
+		_clocks[i].mixerTimeStamp = 0;
+	}
 }
 
 MixerImpl::~MixerImpl() {
+	// Channels which were posted but never reached the callback
+	Command command;
+	while (_commands.pop(command))
+		deleteCommand(command);
+	for (Common::List<Command>::iterator i = _pendingCommands.begin(); i != _pendingCommands.end(); ++i)
+		deleteCommand(*i);
+	deleteRetiredEffects();
+
 	for (int i = 0; i != NUM_CHANNELS; i++)
 		delete _channels[i];
+
+	delete _reverb;
 }
 
 void MixerImpl::setReady(bool ready) {
-	Common::StackLock lock(_mutex);
-
-	_mixerReady = ready;
+	Common::atomicStore(&_mixerReady, ready ? 1 : 0);
 }
 
 uint MixerImpl::getOutputRate() const {
 	return _sampleRate;
 }
 
-void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
+void MixerImpl::postCommand(const Command &command) {
+	deleteRetiredEffects();
+	flushCommands();
+
+	if (_pendingCommands.empty() && _commands.push(command))
+		return;
+
+	// The queue only fills up when the callback doesn't run for a long time,
+	// e.g. while the audio device is suspended. The command waits until it
+	// catches up, but the settings of a channel don't pile up meanwhile.
+	if (command.type != kCommandPlay) {
+		for (Common::List<Command>::iterator i = _pendingCommands.begin(); i != _pendingCommands.end(); ++i) {
+			if (i->type != command.type || (command.type != kCommandSetReverb && i->handle != command.handle))
+				continue;
+
+			Command replaced = *i;
+			*i = command;
+			// The reverb waiting to be created is kept
+			if (command.type == kCommandSetReverb && replaced.reverb) {
+				i->reverb = replaced.reverb;
+				replaced.reverb = 0;
+			}
+			deleteCommand(replaced);
+			return;
+		}
+	}
+
+	_pendingCommands.push_back(command);
+}
+
+void MixerImpl::flushCommands() {
+	deleteRetiredEffects();
+	while (!_pendingCommands.empty() && _commands.push(_pendingCommands.front()))
+		_pendingCommands.pop_front();
+}
+
+void MixerImpl::dropPendingCommands(uint32 handle) {
+	Common::List<Command>::iterator i = _pendingCommands.begin();
+	while (i != _pendingCommands.end()) {
+		if (i->type != kCommandSetReverb && i->handle == handle) {
+			deleteCommand(*i);
+			i = _pendingCommands.erase(i);
+		} else {
+			++i;
+		}
+	}
+}
+
+void MixerImpl::deleteCommand(const Command &command) {
+	if (command.type == kCommandPlay)
+		delete command.channel;
+	else if (command.type == kCommandSetEffects)
+		delete command.effects;
+	else if (command.type == kCommandSetReverb)
+		delete command.reverb;
+}
+
+void MixerImpl::deleteRetiredEffects() {
+	EffectChain *effects;
+	while (_retiredEffects.pop(effects))
+		delete effects;
+}
+
+void MixerImpl::retireEffects(EffectChain *effects) {
+	// Can't fail as long as the engine empties the queue before posting commands
+	if (effects && !_retiredEffects.push(effects))
+		delete effects;
+}
+
+void MixerImpl::waitForMix() {
+	const uint32 epoch = Common::atomicLoad(&_mixEpoch);
+	if (!(epoch & 1))
+		return;
+
+	while (Common::atomicLoad(&_mixEpoch) == epoch)
+		g_system->delayMillis(1);
+}
+
+bool MixerImpl::isSlotActive(int index) {
+	// Every call of the engine goes through here, which lets the commands
+	// which didn't fit in the queue catch up even when nothing is posted
+	flushCommands();
+
+	ChannelState &state = _states[index];
+	if (state.active && Common::atomicLoad(&_finishedHandles[index]) == state.handle._val)
+		state.active = false;
+	return state.active;
+}
+
+int MixerImpl::findSlot(SoundHandle handle) {
+	const int index = handle._val % NUM_CHANNELS;
+	if (!isSlotActive(index) || _states[index].handle._val != handle._val)
+		return -1;
+	return index;
+}
+
+void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan, SoundType type, int id, bool permanent,
+                              DisposeAfterUse::Flag autofreeStream, byte volume, int8 balance) {
 	int index = -1;
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] == 0) {
+		if (!isSlotActive(i)) {
 			index = i;
 			break;
 		}
@@ -210,12 +310,33 @@ void MixerImpl::insertChannel(SoundHandle *handle, Channel *chan) {
 		return;
 	}
 
-	_channels[index] = chan;
-
 	SoundHandle chanHandle;
 	chanHandle._val = index + (_handleSeed * NUM_CHANNELS);
 
+	ChannelState &state = _states[index];
+	state = ChannelState();
+	state.active = true;
+	state.handle = chanHandle;
+	state.type = type;
+	state.id = id;
+	state.permanent = permanent;
+	state.autofree = (autofreeStream == DisposeAfterUse::YES);
+	state.volume = volume;
+	state.balance = balance;
+
+	int volL, volR;
+	computeVolumes(state, volL, volR);
+	chan->setOutputVolumes(volL, volR);
+	chan->setEffects(makeEffectChain(state));
 	chan->setHandle(chanHandle);
+
+	Command command;
+	command.type = kCommandPlay;
+	command.index = index;
+	command.handle = chanHandle._val;
+	command.channel = chan;
+	postCommand(command);
+
 	_handleSeed++;
 	if (handle)
 		*handle = chanHandle;
@@ -237,12 +358,12 @@ void MixerImpl::playStream(
 	}
 
 
-	assert(_mixerReady);
+	assert(isReady());
 
 	// Prevent duplicate sounds
 	if (id != -1) {
 		for (int i = 0; i != NUM_CHANNELS; i++)
-			if (_channels[i] != 0 && _channels[i]->getId() == id) {
+			if (isSlotActive(i) && _states[i].id == id) {
 				// Delete the stream if were asked to auto-dispose it.
 				// Note: This could cause trouble if the client code does not
 				// yet expect the stream to be gone. The primary example to
@@ -260,16 +381,21 @@ void MixerImpl::playStream(
 #endif
 
 	// Create the channel
-	Channel *chan = new Channel(this, type, stream, autofreeStream, reverseStereo, id, permanent);
-	chan->setVolume(volume);
-	chan->setBalance(balance);
-	insertChannel(handle, chan);
+	Channel *chan = new Channel(this, stream, autofreeStream, reverseStereo, _rateQuality);
+	insertChannel(handle, chan, type, id, permanent, autofreeStream, volume, balance);
 }
 
 int MixerImpl::mixCallback(byte *samples, uint len) {
 	assert(samples);
 
-	Common::StackLock lock(_mutex);
+	// Marks the block as being mixed before taking the commands, so that
+	// waitForMix() can't miss a block that started without its commands.
+	const uint32 epoch = _mixEpoch;
+	Common::atomicStore(&_mixEpoch, epoch + 1);
+
+	Command command;
+	while (_commands.pop(command))
+		applyCommand(command);
 
 	int16 *buf = (int16 *)samples;
 	// we store stereo, 16-bit samples
@@ -277,20 +403,54 @@ int MixerImpl::mixCallback(byte *samples, uint len) {
 	len >>= 2;
 
 	// Since the mixer callback has been called, the mixer must be ready...
-	_mixerReady = true;
+	Common::atomicStore(&_mixerReady, 1);
 
 	//  zero the buf
 	memset(buf, 0, 2 * len * sizeof(int16));
 
-	// mix all channels
+	int res = 0;
+	bool reverbSent = false;
+	if (!_reverb || !_reverb->isEnabled()) {
+		res = mixChannels(buf, len, 0, reverbSent);
+	} else {
+		// The channels are mixed in blocks which fit the input of the reverb
+		for (uint pos = 0; pos < len; pos += REVERB_BLOCK_FRAMES) {
+			const uint block = MIN<uint>(len - pos, REVERB_BLOCK_FRAMES);
+			memset(_reverbInput, 0, block * 2 * sizeof(float));
+
+			reverbSent = false;
+			const int mixed = mixChannels(buf + pos * 2, block, _reverbInput, reverbSent);
+			if (mixed > 0)
+				res = pos + mixed;
+
+			// The reverb keeps playing its tail after the channels stopped sending to it
+			if (reverbSent || _reverb->isRinging())
+				_reverb->process(_reverbInput, buf + pos * 2, block);
+		}
+	}
+
+	Common::atomicStore(&_mixEpoch, epoch + 2);
+	return res;
+}
+
+int MixerImpl::mixChannels(int16 *buf, uint len, float *reverbInput, bool &reverbSent) {
 	int res = 0, tmp;
 	for (int i = 0; i != NUM_CHANNELS; i++)
 		if (_channels[i]) {
-			if (_channels[i]->isFinished()) {
-				delete _channels[i];
-				_channels[i] = 0;
+			if (Common::atomicLoad(&_stopHandles[i]) == _channels[i]->getHandle()._val) {
+				deleteChannel(i);
+			} else if (_channels[i]->isFinished()) {
+				const uint32 handle = _channels[i]->getHandle()._val;
+				deleteChannel(i);
+				Common::atomicStore(&_finishedHandles[i], handle);
 			} else if (!_channels[i]->isPaused()) {
-				tmp = _channels[i]->mix(buf, len);
+				if (_channels[i]->hasEffects()) {
+					tmp = _channels[i]->mixEffects(buf, len, _effectSamples, _effectFrames, EFFECT_BLOCK_FRAMES, reverbInput);
+					reverbSent |= _channels[i]->hasReverbSend();
+				} else {
+					tmp = _channels[i]->mix(buf, len);
+				}
+				publishClock(i);
 
 				if (tmp > res)
 					res = tmp;
@@ -300,45 +460,123 @@ int MixerImpl::mixCallback(byte *samples, uint len) {
 	return res;
 }
 
+void MixerImpl::applyCommand(const Command &command) {
+	if (command.type == kCommandSetReverb) {
+		// The reverb is only posted along with the first settings, so there
+		// is never one to delete here
+		if (command.reverb) {
+			assert(!_reverb);
+			_reverb = command.reverb;
+		}
+		_reverb->setSettings(command.reverbSettings);
+		return;
+	}
+
+	if (command.type == kCommandPlay) {
+		// The slot was freed by a stop before this one, or its channel finished
+		if (_channels[command.index])
+			deleteChannel(command.index);
+		_channels[command.index] = command.channel;
+		return;
+	}
+
+	Channel *chan = _channels[command.index];
+
+	// Commands for channels which finished in the meantime are dropped
+	if (!chan || chan->getHandle()._val != command.handle) {
+		if (command.type == kCommandSetEffects)
+			retireEffects(command.effects);
+		return;
+	}
+
+	switch (command.type) {
+	case kCommandSetVolumes:
+		chan->setOutputVolumes(command.volL, command.volR);
+		break;
+	case kCommandSetPaused:
+		chan->setPaused(command.paused);
+		break;
+	case kCommandSetEffects:
+		retireEffects(chan->setEffects(command.effects));
+		break;
+	default:
+		break;
+	}
+}
+
+void MixerImpl::deleteChannel(int index) {
+	retireEffects(_channels[index]->setEffects(0));
+	delete _channels[index];
+	_channels[index] = 0;
+}
+
+void MixerImpl::publishClock(int index) {
+	ChannelClock &clock = _clocks[index];
+	const Channel *chan = _channels[index];
+
+	const uint32 sequence = clock.sequence;
+	Common::atomicStore(&clock.sequence, sequence + 1);
+	Common::atomicStore(&clock.handle, chan->getHandle()._val);
+	Common::atomicStore(&clock.samplesConsumed, chan->getSamplesConsumed());
+	Common::atomicStore(&clock.mixerTimeStamp, chan->getMixerTimeStamp());
+	Common::atomicStore(&clock.sequence, sequence + 2);
+}
+
+bool MixerImpl::stopSlot(int index) {
+	ChannelState &state = _states[index];
+
+	// A channel which didn't reach the callback yet is deleted right here
+	dropPendingCommands(state.handle._val);
+	Common::atomicStore(&_stopHandles[index], state.handle._val);
+
+	state.active = false;
+	return !state.autofree;
+}
+
 void MixerImpl::stopAll() {
 	Common::StackLock lock(_mutex);
+	bool wait = false;
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && !_channels[i]->isPermanent()) {
-			delete _channels[i];
-			_channels[i] = 0;
-		}
+		if (isSlotActive(i) && !_states[i].permanent)
+			wait |= stopSlot(i);
 	}
+	if (wait)
+		waitForMix();
 }
 
 void MixerImpl::stopID(int id) {
 	Common::StackLock lock(_mutex);
+	bool wait = false;
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && _channels[i]->getId() == id) {
-			delete _channels[i];
-			_channels[i] = 0;
-		}
+		if (isSlotActive(i) && _states[i].id == id)
+			wait |= stopSlot(i);
 	}
+	if (wait)
+		waitForMix();
 }
 
 void MixerImpl::stopHandle(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
 
 	// Simply ignore stop requests for handles of sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findSlot(handle);
+	if (index < 0)
 		return;
 
-	delete _channels[index];
-	_channels[index] = 0;
+	// The caller may delete a stream it still owns as soon as we return
+	if (stopSlot(index))
+		waitForMix();
 }
 
 void MixerImpl::muteSoundType(SoundType type, bool mute) {
 	assert(0 <= (int)type && (int)type < ARRAYSIZE(_soundTypeSettings));
+
+	Common::StackLock lock(_mutex);
 	_soundTypeSettings[type].mute = mute;
 
 	for (int i = 0; i != NUM_CHANNELS; ++i) {
-		if (_channels[i] && _channels[i]->getType() == type)
-			_channels[i]->notifyGlobalVolChange();
+		if (isSlotActive(i) && _states[i].type == type)
+			updateSlotVolumes(i);
 	}
 }
 
@@ -347,40 +585,139 @@ bool MixerImpl::isSoundTypeMuted(SoundType type) const {
 	return _soundTypeSettings[type].mute;
 }
 
+void MixerImpl::computeVolumes(const ChannelState &state, int &volL, int &volR) const {
+	// From the channel balance/volume and the global volume, we compute
+	// the effective volume for the left and right channel. Note the
+	// slightly odd divisor: the 255 reflects the fact that the maximal
+	// value for volume is 255, while the 127 is there because the
+	// balance value ranges from -127 to 127.  The mixer (music/sound)
+	// volume is in the range 0 - kMaxMixerVolume.
+	// Hence, the vol_l/vol_r values will be in that range, too
+
+	if (!isSoundTypeMuted(state.type)) {
+		int vol = getVolumeForSoundType(state.type) * state.volume;
+
+		if (state.balance == 0) {
+			volL = vol / kMaxChannelVolume;
+			volR = vol / kMaxChannelVolume;
+		} else if (state.balance < 0) {
+			volL = vol / kMaxChannelVolume;
+			volR = ((127 + state.balance) * vol) / (kMaxChannelVolume * 127);
+		} else {
+			volL = ((127 - state.balance) * vol) / (kMaxChannelVolume * 127);
+			volR = vol / kMaxChannelVolume;
+		}
+	} else {
+		volL = volR = 0;
+	}
+}
+
+void MixerImpl::updateSlotVolumes(int index) {
+	Command command;
+	command.type = kCommandSetVolumes;
+	command.index = index;
+	command.handle = _states[index].handle._val;
+	computeVolumes(_states[index], command.volL, command.volR);
+	postCommand(command);
+}
+
+EffectChain *MixerImpl::makeEffectChain(const ChannelState &state) const {
+	const EffectSettings &typeEffects = _soundTypeSettings[state.type].effects;
+	if (typeEffects.isEmpty() && state.effects.isEmpty())
+		return 0;
+
+	// The chain is prepared here, so that the callback doesn't compute any coefficients
+	return new EffectChain(typeEffects, state.effects, _sampleRate);
+}
+
+void MixerImpl::updateSlotEffects(int index) {
+	Command command;
+	command.type = kCommandSetEffects;
+	command.index = index;
+	command.handle = _states[index].handle._val;
+	command.effects = makeEffectChain(_states[index]);
+	postCommand(command);
+}
+
+void MixerImpl::setChannelEffects(SoundHandle handle, const EffectSettings &effects) {
+	Common::StackLock lock(_mutex);
+
+	const int index = findSlot(handle);
+	if (index < 0)
+		return;
+
+	_states[index].effects = effects;
+	updateSlotEffects(index);
+}
+
+void MixerImpl::setEffectsForSoundType(SoundType type, const EffectSettings &effects) {
+	assert(0 <= (int)type && (int)type < ARRAYSIZE(_soundTypeSettings));
+
+	Common::StackLock lock(_mutex);
+	_soundTypeSettings[type].effects = effects;
+
+	for (int i = 0; i != NUM_CHANNELS; ++i) {
+		if (isSlotActive(i) && _states[i].type == type)
+			updateSlotEffects(i);
+	}
+}
+
+void MixerImpl::setReverb(const ReverbSettings &reverb) {
+	Common::StackLock lock(_mutex);
+
+	// The delay lines are only allocated once a game asks for a reverb
+	if (!_reverbCreated && reverb.level == 0)
+		return;
+
+	Command command;
+	command.type = kCommandSetReverb;
+	command.reverb = _reverbCreated ? 0 : new Reverb(_sampleRate);
+	command.reverbSettings = reverb;
+	postCommand(command);
+
+	_reverbCreated = true;
+}
+
 void MixerImpl::setChannelVolume(SoundHandle handle, byte volume) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findSlot(handle);
+	if (index < 0)
 		return;
 
-	_channels[index]->setVolume(volume);
+	_states[index].volume = volume;
+	updateSlotVolumes(index);
 }
 
 byte MixerImpl::getChannelVolume(SoundHandle handle) {
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	Common::StackLock lock(_mutex);
+
+	const int index = findSlot(handle);
+	if (index < 0)
 		return 0;
 
-	return _channels[index]->getVolume();
+	return _states[index].volume;
 }
 
 void MixerImpl::setChannelBalance(SoundHandle handle, int8 balance) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findSlot(handle);
+	if (index < 0)
 		return;
 
-	_channels[index]->setBalance(balance);
+	_states[index].balance = balance;
+	updateSlotVolumes(index);
 }
 
 int8 MixerImpl::getChannelBalance(SoundHandle handle) {
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	Common::StackLock lock(_mutex);
+
+	const int index = findSlot(handle);
+	if (index < 0)
 		return 0;
 
-	return _channels[index]->getBalance();
+	return _states[index].balance;
 }
 
 uint32 MixerImpl::getSoundElapsedTime(SoundHandle handle) {
@@ -390,18 +727,84 @@ uint32 MixerImpl::getSoundElapsedTime(SoundHandle handle) {
 Timestamp MixerImpl::getElapsedTime(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
 
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
-		return Timestamp(0, _sampleRate);
+	Audio::Timestamp ts(0, _sampleRate);
+
+	const int index = findSlot(handle);
+	if (index < 0)
+		return ts;
+
+	// Read a consistent play position, retrying while the callback publishes one
+	const ChannelClock &clock = _clocks[index];
+	uint32 sequence, clockHandle, samplesConsumed, mixerTimeStamp;
+	do {
+		sequence = Common::atomicLoad(&clock.sequence);
+		clockHandle = Common::atomicLoad(&clock.handle);
+		samplesConsumed = Common::atomicLoad(&clock.samplesConsumed);
+		mixerTimeStamp = Common::atomicLoad(&clock.mixerTimeStamp);
+	} while ((sequence & 1) || Common::atomicLoad(&clock.sequence) != sequence);
+
+	// Not mixed yet
+	if (clockHandle != handle._val || mixerTimeStamp == 0)
+		return ts;
+
+	const ChannelState &state = _states[index];
+	int32 delta;
+	if (state.pauseLevel) {
+		delta = (int32)(state.pauseStartTime - mixerTimeStamp);
+	} else {
+		delta = (int32)(g_system->getMillis(true) - mixerTimeStamp);
+		// The length of the last pause counts until a block is mixed after it
+		if ((int32)(mixerTimeStamp - state.resumeTime) < 0)
+			delta -= state.pauseTime;
+	}
+
+	// Convert the number of samples into a time duration.
 
-	return _channels[index]->getElapsedTime();
+	ts = ts.addFrames(samplesConsumed);
+	ts = ts.addMsecs(MAX<int32>(delta, 0));
+
+	// In theory it would seem like a good idea to limit the approximation
+	// so that it never exceeds the theoretical upper bound set by the
+	// number of decoded samples. Meanwhile, back in the real world, doing
+	// so makes the Broken Sword cutscenes noticeably jerkier. I guess the
+	// mixer isn't invoked at the regular intervals that I first imagined.
+
+	return ts;
+}
+
+void MixerImpl::pauseSlot(int index, bool paused) {
+	ChannelState &state = _states[index];
+
+	if (paused) {
+		state.pauseLevel++;
+
+		if (state.pauseLevel == 1)
+			state.pauseStartTime = g_system->getMillis(true);
+	} else if (state.pauseLevel > 0) {
+		state.pauseLevel--;
+
+		if (!state.pauseLevel) {
+			state.resumeTime = g_system->getMillis(true);
+			state.pauseTime = state.resumeTime - state.pauseStartTime;
+			state.pauseStartTime = 0;
+		}
+	}
+
+	if (state.pauseLevel == (paused ? 1 : 0)) {
+		Command command;
+		command.type = kCommandSetPaused;
+		command.index = index;
+		command.handle = state.handle._val;
+		command.paused = paused;
+		postCommand(command);
+	}
 }
 
 void MixerImpl::pauseAll(bool paused) {
 	Common::StackLock lock(_mutex);
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0) {
-			_channels[i]->pause(paused);
+		if (isSlotActive(i)) {
+			pauseSlot(i, paused);
 		}
 	}
 }
@@ -409,8 +812,8 @@ void MixerImpl::pauseAll(bool paused) {
 void MixerImpl::pauseID(int id, bool paused) {
 	Common::StackLock lock(_mutex);
 	for (int i = 0; i != NUM_CHANNELS; i++) {
-		if (_channels[i] != 0 && _channels[i]->getId() == id) {
-			_channels[i]->pause(paused);
+		if (isSlotActive(i) && _states[i].id == id) {
+			pauseSlot(i, paused);
 			return;
 		}
 	}
@@ -420,11 +823,11 @@ void MixerImpl::pauseHandle(SoundHandle handle, bool paused) {
 	Common::StackLock lock(_mutex);
 
 	// Simply ignore (un)pause requests for sounds that already terminated
-	const int index = handle._val % NUM_CHANNELS;
-	if (!_channels[index] || _channels[index]->getHandle()._val != handle._val)
+	const int index = findSlot(handle);
+	if (index < 0)
 		return;
 
-	_channels[index]->pause(paused);
+	pauseSlot(index, paused);
 }
 
 bool MixerImpl::isSoundIDActive(int id) {
@@ -435,16 +838,16 @@ bool MixerImpl::isSoundIDActive(int id) {
 #endif
 
 	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i] && _channels[i]->getId() == id)
+		if (isSlotActive(i) && _states[i].id == id)
 			return true;
 	return false;
 }
 
 int MixerImpl::getSoundID(SoundHandle handle) {
 	Common::StackLock lock(_mutex);
-	const int index = handle._val % NUM_CHANNELS;
-	if (_channels[index] && _channels[index]->getHandle()._val == handle._val)
-		return _channels[index]->getId();
+	const int index = findSlot(handle);
+	if (index >= 0)
+		return _states[index].id;
 	return 0;
 }
 
@@ -455,14 +858,13 @@ bool MixerImpl::isSoundHandleActive(SoundHandle handle) {
 	g_eventRec.updateSubsystems();
 #endif
 
-	const int index = handle._val % NUM_CHANNELS;
-	return _channels[index] && _channels[index]->getHandle()._val == handle._val;
+	return findSlot(handle) >= 0;
 }
 
 bool MixerImpl::hasActiveChannelOfType(SoundType type) {
 	Common::StackLock lock(_mutex);
 	for (int i = 0; i != NUM_CHANNELS; i++)
-		if (_channels[i] && _channels[i]->getType() == type)
+		if (isSlotActive(i) && _states[i].type == type)
 			return true;
 	return false;
 }
@@ -480,8 +882,8 @@ void MixerImpl::setVolumeForSoundType(SoundType type, int volume) {
 	_soundTypeSettings[type].volume = volume;
 
 	for (int i = 0; i != NUM_CHANNELS; ++i) {
-		if (_channels[i] && _channels[i]->getType() == type)
-			_channels[i]->notifyGlobalVolChange();
+		if (isSlotActive(i) && _states[i].type == type)
+			updateSlotVolumes(i);
 	}
 }
 
@@ -496,112 +898,51 @@ int MixerImpl::getVolumeForSoundType(SoundType type) const {
 #pragma mark --- Channel implementations ---
 #pragma mark -
 
-Channel::Channel(Mixer *mixer, Mixer::SoundType type, AudioStream *stream,
-                 DisposeAfterUse::Flag autofreeStream, bool reverseStereo, int id, bool permanent)
-    : _type(type), _mixer(mixer), _id(id), _permanent(permanent), _volume(Mixer::kMaxChannelVolume),
-      _balance(0), _pauseLevel(0), _samplesConsumed(0), _samplesDecoded(0), _mixerTimeStamp(0),
-      _pauseStartTime(0), _pauseTime(0), _converter(0), _volL(0), _volR(0),
-      _stream(stream, autofreeStream) {
+Channel::Channel(Mixer *mixer, AudioStream *stream, DisposeAfterUse::Flag autofreeStream, bool reverseStereo, RateQuality rateQuality)
+    : _paused(false), _volL(0), _volR(0), _samplesConsumed(0), _samplesDecoded(0), _mixerTimeStamp(0),
+      _converter(0), _stream(stream, autofreeStream) {
 	assert(mixer);
 	assert(stream);
 
 	// Get a rate converter instance
-	_converter = makeRateConverter(_stream->getRate(), mixer->getOutputRate(), _stream->isStereo(), reverseStereo);
+	_converter = makeRateConverter(_stream->getRate(), mixer->getOutputRate(), _stream->isStereo(), reverseStereo, rateQuality);
 }
 
 Channel::~Channel() {
 	delete _converter;
 }
 
-void Channel::setVolume(const byte volume) {
-	_volume = volume;
-	updateChannelVolumes();
-}
-
-byte Channel::getVolume() {
-	return _volume;
-}
-
-void Channel::setBalance(const int8 balance) {
-	_balance = balance;
-	updateChannelVolumes();
-}
-
-int8 Channel::getBalance() {
-	return _balance;
-}
-
-void Channel::updateChannelVolumes() {
-	// From the channel balance/volume and the global volume, we compute
-	// the effective volume for the left and right channel. Note the
-	// slightly odd divisor: the 255 reflects the fact that the maximal
-	// value for _volume is 255, while the 127 is there because the
-	// balance value ranges from -127 to 127.  The mixer (music/sound)
-	// volume is in the range 0 - kMaxMixerVolume.
-	// Hence, the vol_l/vol_r values will be in that range, too
+int Channel::mixEffects(int16 *data, uint len, int16 *samples, float *frames, uint blockFrames, float *reverbInput) {
+	assert(_stream);
 
-	if (!_mixer->isSoundTypeMuted(_type)) {
-		int vol = _mixer->getVolumeForSoundType(_type) * _volume;
+	if (_stream->endOfData())
+		return 0;
 
-		if (_balance == 0) {
-			_volL = vol / Mixer::kMaxChannelVolume;
-			_volR = vol / Mixer::kMaxChannelVolume;
-		} else if (_balance < 0) {
-			_volL = vol / Mixer::kMaxChannelVolume;
-			_volR = ((127 + _balance) * vol) / (Mixer::kMaxChannelVolume * 127);
-		} else {
-			_volL = ((127 - _balance) * vol) / (Mixer::kMaxChannelVolume * 127);
-			_volR = vol / Mixer::kMaxChannelVolume;
-		}
-	} else {
-		_volL = _volR = 0;
-	}
-}
+	assert(_converter);
+	_samplesConsumed = _samplesDecoded;
+	_mixerTimeStamp = g_system->getMillis(true);
 
-void Channel::pause(bool paused) {
-	//assert((paused && _pauseLevel >= 0) || (!paused && _pauseLevel));
+	uint res = 0;
+	while (res < len) {
+		const uint block = MIN<uint>(len - res, blockFrames);
 
-	if (paused) {
-		_pauseLevel++;
+		// The converter applies the volumes, then the effects filter its output
+		memset(samples, 0, block * 2 * sizeof(int16));
+		const int flowed = _converter->flow(*_stream, samples, block, _volL, _volR);
+		if (flowed <= 0)
+			break;
 
-		if (_pauseLevel == 1)
-			_pauseStartTime = g_system->getMillis(true);
-	} else if (_pauseLevel > 0) {
-		_pauseLevel--;
+		convertSamplesToFloat(samples, frames, flowed * 2);
+		_effects.process(frames, flowed, reverbInput ? reverbInput + res * 2 : 0);
+		mixFloatSamples(data + res * 2, frames, flowed * 2);
 
-		if (!_pauseLevel) {
-			_pauseTime = (g_system->getMillis(true) - _pauseStartTime);
-			_pauseStartTime = 0;
-		}
+		res += flowed;
+		if ((uint)flowed < block)
+			break;
 	}
-}
-
-Timestamp Channel::getElapsedTime() {
-	const uint32 rate = _mixer->getOutputRate();
-	uint32 delta = 0;
 
-	Audio::Timestamp ts(0, rate);
-
-	if (_mixerTimeStamp == 0)
-		return ts;
-
-	if (isPaused())
-		delta = _pauseStartTime - _mixerTimeStamp;
-	else
-		delta = g_system->getMillis(true) - _mixerTimeStamp - _pauseTime;
-
-	// Convert the number of samples into a time duration.
-
-	ts = ts.addFrames(_samplesConsumed);
-	ts = ts.addMsecs(delta);
-
-	// In theory it would seem like a good idea to limit the approximation
-	// so that it never exceeds the theoretical upper bound set by
-	// _samplesDecoded. Meanwhile, back in the real world, doing so makes
-	// the Broken Sword cutscenes noticeably jerkier. I guess the mixer
-	// isn't invoked at the regular intervals that I first imagined.
-
-	return ts;
+	_samplesDecoded += res;
+	return res;
 }
 
 int Channel::mix(int16 *data, uint len) {
@@ -614,7 +955,6 @@ int Channel::mix(int16 *data, uint len) {
 		assert(_converter);
 		_samplesConsumed = _samplesDecoded;
 		_mixerTimeStamp = g_system->getMillis(true);
-		_pauseTime = 0;
 		res = _converter->flow(*_stream, data, len, _volL, _volR);
 		_samplesDecoded += res;
 	}
@@ -31,6 +31,8 @@ namespace Audio {
 class AudioStream;
 class Channel;
 class Timestamp;
+struct EffectSettings;
+struct ReverbSettings;
 
 /**
  * A SoundHandle instances corresponds to a specific sound
@@ -271,6 +273,31 @@ public:
 	 */
 	virtual int getVolumeForSoundType(SoundType type) const = 0;
 
+	/**
+	 * Set the effects (filters and reverb send) of the channel for the given
+	 * handle. They are applied after the effects of its sound type.
+	 *
+	 * @param handle the sound to affect
+	 * @param effects the new effects, see audio/effects.h
+	 */
+	virtual void setChannelEffects(SoundHandle handle, const EffectSettings &effects) = 0;
+
+	/**
+	 * Set the effects (filters and reverb send) of all the channels, current
+	 * and future, of the given sound type.
+	 *
+	 * @param type the sound type
+	 * @param effects the new effects, see audio/effects.h
+	 */
+	virtual void setEffectsForSoundType(SoundType type, const EffectSettings &effects) = 0;
+
+	/**
+	 * Set up the reverb which the channels send to.
+	 *
+	 * @param reverb the new settings, see audio/effects.h
+	 */
+	virtual void setReverb(const ReverbSettings &reverb) = 0;
+
 	/**
 	 * Query the system's audio output sample rate.
 	 *
@@ -24,8 +24,14 @@
 #define AUDIO_MIXER_INTERN_H
 
 #include "common/scummsys.h"
+#include "common/atomic.h"
+#include "common/lockfreequeue.h"
+#include "common/array.h"
+#include "common/list.h"
 #include "common/mutex.h"
+#include "audio/effects.h"
 #include "audio/mixer.h"
+#include "audio/rate.h"
 
 namespace Audio {
 
@@ -42,6 +48,17 @@ namespace Audio {
  * 4) Change the mixer into ready mode via setReady(true).
  * 5) Start audio processing (e.g. by resuming the audio thread, if applicable).
  *
+ * The mixer callback never waits for the engine: the engine side of the mixer
+ * keeps its own state of the channels, and posts the changes to them as
+ * commands which the callback applies at the start of each block it mixes.
+ * The callback reports finished channels and their play positions back
+ * through atomic words.
+ *
+ * Channels with effects are rendered a block at a time into a scratch
+ * buffer, filtered, then mixed into the output and into the input of the
+ * shared reverb, which is mixed into the output last. Channels without
+ * effects are mixed straight into the output.
+ *
  * In the future, we might make it possible for backends to provide
  * (partial) alternative implementations of the mixer, e.g. to make
  * better use of native sound mixing support on low-end devices.
@@ -51,13 +68,21 @@ namespace Audio {
 class MixerImpl : public Mixer {
 private:
 	enum {
-		NUM_CHANNELS = 32
+		NUM_CHANNELS = 32,
+		/** Capacity of the command queue, a power of two */
+		NUM_COMMANDS = 1024,
+		/** Frames of a channel with effects which are processed at once */
+		EFFECT_BLOCK_FRAMES = 256,
+		/** Frames mixed at once while the reverb is enabled, the size of its input */
+		REVERB_BLOCK_FRAMES = 1024
 	};
 
+	/** Serializes the engine threads; the mixer callback never takes it. */
 	Common::Mutex _mutex;
 
 	const uint _sampleRate;
-	bool _mixerReady;
+	const RateQuality _rateQuality;
+	volatile uint32 _mixerReady;
 	uint32 _handleSeed;
 
 	struct SoundTypeSettings {
@@ -65,18 +90,131 @@ private:
 
 		bool mute;
 		int volume;
+		EffectSettings effects;
 	};
 
 	SoundTypeSettings _soundTypeSettings[4];
+
+	/**
+	 * The engine side state of a channel slot, only accessed with _mutex held.
+	 */
+	struct ChannelState {
+		ChannelState() : active(false), type(kPlainSoundType), id(-1), permanent(false), autofree(false),
+			volume(kMaxChannelVolume), balance(0), pauseLevel(0), pauseStartTime(0), pauseTime(0), resumeTime(0) {}
+
+		bool active;
+		SoundHandle handle;
+		SoundType type;
+		int id;
+		bool permanent;
+		/** Whether the mixer deletes the stream when the channel stops */
+		bool autofree;
+		byte volume;
+		int8 balance;
+		int pauseLevel;
+		/** Start, duration and end of the last pause, in milliseconds */
+		uint32 pauseStartTime;
+		uint32 pauseTime;
+		uint32 resumeTime;
+		EffectSettings effects;
+	};
+
+	ChannelState _states[NUM_CHANNELS];
+
+	enum CommandType {
+		kCommandPlay,
+		kCommandSetVolumes,
+		kCommandSetPaused,
+		kCommandSetEffects,
+		kCommandSetReverb
+	};
+
+	/** A change to a channel slot, posted by the engine and applied by the callback. */
+	struct Command {
+		CommandType type;
+		int index;
+		uint32 handle;
+		/** The new channel for kCommandPlay */
+		Channel *channel;
+		/** Output volumes for kCommandSetVolumes */
+		int volL, volR;
+		bool paused;
+		/** The new effects for kCommandSetEffects, 0 for none */
+		EffectChain *effects;
+		/** For kCommandSetReverb, the reverb to create if not 0, and its settings */
+		Reverb *reverb;
+		ReverbSettings reverbSettings;
+	};
+
+	Common::LockFreeQueue<Command, NUM_COMMANDS> _commands;
+
+	/**
+	 * Commands which didn't fit in the queue, because the callback didn't run
+	 * for a while, only accessed with _mutex held. They are posted before any
+	 * later command, and a later change of the same setting of a channel
+	 * replaces the one waiting here.
+	 */
+	Common::List<Command> _pendingCommands;
+
+	/**
+	 * Handle of the channel to stop in each slot. Stops don't go through the
+	 * queue, so that they reach the callback before its next block even when
+	 * the queue is full.
+	 */
+	volatile uint32 _stopHandles[NUM_CHANNELS];
+
+	/**
+	 * Effects replaced by the callback, or of the channels it deleted, handed
+	 * back to be deleted by the engine threads. Each chain reaches the
+	 * callback through a command, so this can't fill up while the engine
+	 * keeps emptying it before posting commands.
+	 */
+	Common::LockFreeQueue<EffectChain *, NUM_COMMANDS * 2> _retiredEffects;
+
+	/** The channels being mixed, only accessed by the mixer callback. */
 	Channel *_channels[NUM_CHANNELS];
 
+	/** Handle of the last channel of each slot which the callback retired at the end of its stream. */
+	volatile uint32 _finishedHandles[NUM_CHANNELS];
+
+	/**
+	 * Play position of the channel of each slot, as of its last mixed block.
+	 * Published by the callback with a sequence number, which is odd while the
+	 * other fields are being written.
+	 */
+	struct ChannelClock {
+		volatile uint32 sequence;
+		volatile uint32 handle;
+		volatile uint32 samplesConsumed;
+		volatile uint32 mixerTimeStamp;
+	};
+
+	ChannelClock _clocks[NUM_CHANNELS];
+
+	/** Incremented by the callback before it applies the commands and after it has mixed the block. */
+	volatile uint32 _mixEpoch;
+
+	/** Whether a reverb was posted to the callback */
+	bool _reverbCreated;
+
+	/** The shared reverb, and the stereo frames sent to it, only accessed by the mixer callback. */
+	Reverb *_reverb;
+	float _reverbInput[REVERB_BLOCK_FRAMES * 2];
+
+	/** Scratch buffers of the callback for the channels with effects */
+	int16 _effectSamples[EFFECT_BLOCK_FRAMES * 2];
+	float _effectFrames[EFFECT_BLOCK_FRAMES * 2];
 
 public:
 
-	MixerImpl(uint sampleRate);
+	/**
+	 * @param sampleRate The output sample rate.
+	 * @param rateQuality The interpolation used to convert the streams to the output rate.
+	 */
+	MixerImpl(uint sampleRate, RateQuality rateQuality = kRateQualityFast);
 	~MixerImpl();
 
-	virtual bool isReady() const { Common::StackLock lock(_mutex); return _mixerReady; }
+	virtual bool isReady() const { return Common::atomicLoad(&_mixerReady) != 0; }
 
 	virtual void playStream(
 		SoundType type,
@@ -116,10 +254,64 @@ public:
 	virtual void setVolumeForSoundType(SoundType type, int volume);
 	virtual int getVolumeForSoundType(SoundType type) const;
 
+	virtual void setChannelEffects(SoundHandle handle, const EffectSettings &effects);
+	virtual void setEffectsForSoundType(SoundType type, const EffectSettings &effects);
+	virtual void setReverb(const ReverbSettings &reverb);
+
 	virtual uint getOutputRate() const;
 
 protected:
-	void insertChannel(SoundHandle *handle, Channel *chan);
+	void insertChannel(SoundHandle *handle, Channel *chan, SoundType type, int id, bool permanent,
+	                   DisposeAfterUse::Flag autofreeStream, byte volume, int8 balance);
+
+	/** Whether the slot holds a channel which hasn't finished yet. */
+	bool isSlotActive(int index);
+	/** Returns the slot of the handle, or -1 if its channel isn't active anymore. */
+	int findSlot(SoundHandle handle);
+
+	/**
+	 * Stops the channel in the given slot.
+	 *
+	 * @return true if the caller must call waitForMix() before returning,
+	 *         since the stream isn't owned by the mixer.
+	 */
+	bool stopSlot(int index);
+	void pauseSlot(int index, bool paused);
+	void updateSlotVolumes(int index);
+	void computeVolumes(const ChannelState &state, int &volL, int &volR) const;
+	/** Returns the effects of the slot for the callback, or 0 if it has none. */
+	EffectChain *makeEffectChain(const ChannelState &state) const;
+	void updateSlotEffects(int index);
+
+	/** Posts a command to the callback, without ever waiting for it. */
+	void postCommand(const Command &command);
+	/** Posts the commands which didn't fit in the queue before. */
+	void flushCommands();
+	/** Drops the commands waiting for a channel which was stopped. */
+	void dropPendingCommands(uint32 handle);
+	static void deleteCommand(const Command &command);
+	/** Deletes the effects which the callback replaced. */
+	void deleteRetiredEffects();
+	/**
+	 * Waits until the callback is done with the block it is mixing, if any,
+	 * so that the commands posted before are applied to any later block.
+	 */
+	void waitForMix();
+
+	void applyCommand(const Command &command);
+	/** Hands effects which the callback doesn't use anymore back to the engine threads. */
+	void retireEffects(EffectChain *effects);
+	/** Deletes the channel of a slot, retiring its effects. */
+	void deleteChannel(int index);
+	/**
+	 * Mixes a block of all the channels, retiring the finished ones.
+	 *
+	 * @param reverbInput len float sample pairs to add the reverb sends to, or 0
+	 * @param reverbSent  set to true if a channel sent anything to the reverb
+	 * @return the largest number of sample pairs mixed from a channel
+	 */
+	int mixChannels(int16 *buf, uint len, float *reverbInput, bool &reverbSent);
+	void publishClock(int index);
 
 public:
 	/**
@@ -2,9 +2,13 @@ MODULE := audio
 
 MODULE_OBJS := \
 	audiostream.o \
+	decodeahead.o \
+	effects.o \
 	mididrv.o \
 	mixer.o \
 	musicplugin.o \
+	pcmcache.o \
+	rate_sinc.o \
 	timestamp.o \
 	decoders/3do.o \
 	decoders/aac.o \
@@ -0,0 +1,202 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "audio/pcmcache.h"
+
+#include "common/atomic.h"
+#include "common/textconsole.h"
+
+namespace Audio {
+
+PCMClip::PCMClip(int16 *samples, uint32 numSamples, int rate, bool stereo) :
+		_samples(samples), _numSamples(numSamples), _rate(rate), _stereo(stereo), _refCount(1) {
+	assert(!stereo || (numSamples & 1) == 0);
+}
+
+PCMClip::~PCMClip() {
+	delete[] _samples;
+}
+
+void PCMClip::incRef() {
+	Common::atomicIncrement(&_refCount);
+}
+
+void PCMClip::decRef() {
+	if (Common::atomicDecrement(&_refCount) == 0)
+		delete this;
+}
+
+PCMClipStream::PCMClipStream(PCMClip *clip, uint32 start, uint32 end) :
+		_clip(clip), _samples(clip->getSamples()),
+		_start(start), _end(MIN(end, clip->getNumSamples())), _pos(start),
+		_length(0, (_end - _start) / (clip->isStereo() ? 2 : 1), clip->getRate()) {
+	assert(_start <= _end);
+	assert(!clip->isStereo() || ((_start | _end) & 1) == 0);
+	_clip->incRef();
+}
+
+PCMClipStream::~PCMClipStream() {
+	_clip->decRef();
+}
+
+int PCMClipStream::readBuffer(int16 *buffer, const int numSamples) {
+	const int samples = MIN<uint32>(numSamples, _end - _pos);
+	memcpy(buffer, _samples + _pos, samples * sizeof(int16));
+	_pos += samples;
+	return samples;
+}
+
+bool PCMClipStream::seek(const Timestamp &where) {
+	const uint32 pos = convertTimeToStreamPos(where, getRate(), isStereo()).totalNumberOfFrames();
+
+	if (pos > _end - _start) {
+		_pos = _end;
+		return false;
+	}
+
+	_pos = _start + pos;
+	return true;
+}
+
+PCMCache::PCMCache(uint32 maxSize, uint32 maxClipLength) :
+		_size(0), _maxSize(maxSize), _maxClipLength(maxClipLength) {
+}
+
+PCMCache::~PCMCache() {
+	clear();
+}
+
+PCMClip *PCMCache::get(const Common::String &name) {
+	EntryMap::iterator it = _map.find(name);
+	if (it == _map.end())
+		return nullptr;
+
+	EntryList::iterator entry = it->_value;
+	if (entry != _entries.begin()) {
+		_entries.push_front(*entry);
+		_entries.erase(entry);
+		it->_value = _entries.begin();
+	}
+
+	PCMClip *clip = _entries.front().clip;
+	clip->incRef();
+	return clip;
+}
+
+void PCMCache::put(const Common::String &name, PCMClip *clip) {
+	EntryMap::iterator it = _map.find(name);
+	if (it != _map.end())
+		remove(it->_value);
+
+	if (clip->getSize() > _maxSize)
+		return;
+
+	Entry entry;
+	entry.name = name;
+	entry.clip = clip;
+	clip->incRef();
+
+	_entries.push_front(entry);
+	_map[name] = _entries.begin();
+	_size += clip->getSize();
+
+	while (_size > _maxSize)
+		remove(--_entries.end());
+}
+
+void PCMCache::clear() {
+	while (!_entries.empty())
+		remove(_entries.begin());
+}
+
+void PCMCache::remove(EntryList::iterator entry) {
+	_size -= entry->clip->getSize();
+	_map.erase(entry->name);
+	entry->clip->decRef();
+	_entries.erase(entry);
+}
+
+SeekableAudioStream *PCMCache::makeStream(const Common::String &name) {
+	PCMClip *clip = get(name);
+	if (!clip)
+		return nullptr;
+
+	SeekableAudioStream *stream = new PCMClipStream(clip);
+	clip->decRef();
+	return stream;
+}
+
+RewindableAudioStream *PCMCache::cacheStream(const Common::String &name, RewindableAudioStream *stream) {
+	if (!stream)
+		return nullptr;
+
+	const int channels = stream->isStereo() ? 2 : 1;
+	const uint32 maxSamples = Timestamp(_maxClipLength, stream->getRate()).totalNumberOfFrames() * channels;
+
+	SeekableAudioStream *seekable = dynamic_cast<SeekableAudioStream *>(stream);
+	if (seekable) {
+		const Timestamp length = seekable->getLength();
+		if ((uint32)length.msecs() > _maxClipLength)
+			return stream;
+	}
+
+	// Decode one more chunk than needed to find out whether the stream is too long
+	const uint32 chunkSize = 4096;
+	uint32 capacity = chunkSize;
+	uint32 numSamples = 0;
+	int16 *samples = new int16[capacity];
+
+	while (!stream->endOfData() && numSamples <= maxSamples) {
+		if (capacity - numSamples < chunkSize) {
+			capacity *= 2;
+			int16 *grown = new int16[capacity];
+			memcpy(grown, samples, numSamples * sizeof(int16));
+			delete[] samples;
+			samples = grown;
+		}
+
+		const int read = stream->readBuffer(samples + numSamples, chunkSize);
+		if (read <= 0)
+			break;
+
+		numSamples += read;
+	}
+
+	if (numSamples > maxSamples || !stream->endOfData()) {
+		delete[] samples;
+		if (!stream->rewind())
+			warning("PCMCache::cacheStream(): Failed to rewind '%s'", name.c_str());
+		return stream;
+	}
+
+	numSamples -= numSamples % channels;
+
+	PCMClip *clip = new PCMClip(samples, numSamples, stream->getRate(), stream->isStereo());
+	delete stream;
+
+	put(name, clip);
+	PCMClipStream *clipStream = new PCMClipStream(clip);
+	clip->decRef();
+	return clipStream;
+}
+
+} // End of namespace Audio
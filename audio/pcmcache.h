@@ -0,0 +1,196 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef AUDIO_PCMCACHE_H
+#define AUDIO_PCMCACHE_H
+
+#include "common/scummsys.h"
+#include "common/types.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/list.h"
+#include "common/str.h"
+
+#include "audio/audiostream.h"
+
+namespace Audio {
+
+/**
+ * A fully decoded sound, in native endian 16-bit samples, shared between
+ * a PCMCache and the streams playing it.
+ *
+ * Clips are reference counted: the last owner to call decRef() deletes the
+ * clip. References may be dropped from any thread, so a stream can be
+ * deleted by the mixer while the cache evicts its clip.
+ */
+class PCMClip {
+public:
+	/**
+	 * @param samples    the samples, allocated with new[], which the clip takes over
+	 * @param numSamples the number of samples, counting both channels of a stereo clip
+	 * @param rate       the sample rate
+	 * @param stereo     whether the samples are interleaved stereo
+	 */
+	PCMClip(int16 *samples, uint32 numSamples, int rate, bool stereo);
+
+	void incRef();
+	void decRef();
+
+	const int16 *getSamples() const { return _samples; }
+	uint32 getNumSamples() const { return _numSamples; }
+	int getRate() const { return _rate; }
+	bool isStereo() const { return _stereo; }
+
+	/** The memory used by the samples, in bytes */
+	uint32 getSize() const { return _numSamples * sizeof(int16); }
+
+protected:
+	virtual ~PCMClip();
+
+private:
+	int16 *_samples;
+	const uint32 _numSamples;
+	const int _rate;
+	const bool _stereo;
+	volatile uint32 _refCount;
+};
+
+/**
+ * Plays a range of the samples of a PCMClip, without copying them.
+ */
+class PCMClipStream : public SeekableAudioStream {
+public:
+	/**
+	 * @param clip  the clip to play, which the stream keeps a reference to
+	 * @param start the first sample to play
+	 * @param end   the sample after the last one to play, or kClipEnd for
+	 *              the end of the clip
+	 */
+	PCMClipStream(PCMClip *clip, uint32 start = 0, uint32 end = kClipEnd);
+	~PCMClipStream();
+
+	enum {
+		kClipEnd = 0xFFFFFFFF
+	};
+
+	int readBuffer(int16 *buffer, const int numSamples);
+	bool isStereo() const { return _clip->isStereo(); }
+	int getRate() const { return _clip->getRate(); }
+	bool endOfData() const { return _pos >= _end; }
+
+	bool seek(const Timestamp &where);
+	Timestamp getLength() const { return _length; }
+
+private:
+	PCMClip *_clip;
+	const int16 *_samples;
+
+	const uint32 _start;
+	const uint32 _end;
+	uint32 _pos;
+	const Timestamp _length;
+};
+
+/**
+ * A size-bounded cache of decoded sounds, evicting the least recently used
+ * ones first.
+ *
+ * It is meant for short sound effects which are played over and over, and
+ * would otherwise be read and decoded on every play. Only sounds shorter
+ * than a given length are kept, since long ones would evict everything else.
+ *
+ * The cache itself is not thread safe and should be used from a single
+ * thread, or under a lock of the engine. The clips and their streams
+ * may be used from any thread.
+ */
+class PCMCache {
+public:
+	/**
+	 * @param maxSize       the memory budget of the cached samples, in bytes
+	 * @param maxClipLength the length of the longest clip to cache, in milliseconds
+	 */
+	PCMCache(uint32 maxSize, uint32 maxClipLength);
+	~PCMCache();
+
+	/**
+	 * Looks up a clip, and marks it as the most recently used one.
+	 *
+	 * @return the clip, with a reference the caller must drop, or NULL
+	 */
+	PCMClip *get(const Common::String &name);
+
+	/**
+	 * Adds a clip to the cache, which takes its own reference to it. Older
+	 * clips are evicted until the cache fits in its budget again. Clips
+	 * bigger than the whole budget aren't kept.
+	 */
+	void put(const Common::String &name, PCMClip *clip);
+
+	/** Removes all the clips from the cache */
+	void clear();
+
+	/**
+	 * Makes a new stream over a cached clip.
+	 *
+	 * @return the new stream, or NULL if the clip isn't cached
+	 */
+	SeekableAudioStream *makeStream(const Common::String &name);
+
+	/**
+	 * Decodes a short stream into a clip and adds it to the cache.
+	 *
+	 * @param name   the name to cache the clip under
+	 * @param stream the stream to decode, which the cache takes over
+	 * @return a stream over the new clip, after deleting the given stream,
+	 *         or the given stream, rewound, if it is too long to be cached
+	 */
+	RewindableAudioStream *cacheStream(const Common::String &name, RewindableAudioStream *stream);
+
+	/** Whether a clip of the given length, in milliseconds, is short enough to be cached */
+	bool isCacheable(uint32 length) const { return length <= _maxClipLength; }
+
+	/** The memory used by the cached samples, in bytes */
+	uint32 getSize() const { return _size; }
+
+private:
+	struct Entry {
+		Common::String name;
+		PCMClip *clip;
+	};
+
+	typedef Common::List<Entry> EntryList;
+	typedef Common::HashMap<Common::String, EntryList::iterator> EntryMap;
+
+	/** The cached clips, the most recently used first */
+	EntryList _entries;
+	EntryMap _map;
+
+	uint32 _size;
+	const uint32 _maxSize;
+	const uint32 _maxClipLength;
+
+	void remove(EntryList::iterator entry);
+};
+
+} // End of namespace Audio
+
+#endif
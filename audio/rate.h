@@ -78,7 +78,19 @@ public:
 	virtual int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) = 0;
 };
 
-RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo = false);
+/**
+ * The interpolation used by the rate converters.
+ */
+enum RateQuality {
+	/** Nearest neighbour or linear interpolation. */
+	kRateQualityFast,
+	/** Band-limited interpolation with a polyphase windowed sinc filter, see rate_sinc.cpp. */
+	kRateQualityHigh
+};
+
+RateConverter *makeRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo = false, RateQuality quality = kRateQualityFast);
+
+RateConverter *makeSincRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo);
 
 } // End of namespace Audio
 
@@ -0,0 +1,111 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef AUDIO_RATE_MIX_H
+#define AUDIO_RATE_MIX_H
+
+#include "audio/mixer.h"
+#include "audio/rate.h"
+
+/*
+ * Mixing of the converted frames into the output of the mixer, shared by the
+ * rate converters of rate.cpp and rate_sinc.cpp.
+ */
+
+#if !defined(OUTPUT_UNSIGNED_AUDIO) && defined(__SSE2__)
+#define AUDIO_RATE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Audio {
+
+#if defined(AUDIO_RATE_SSE2)
+
+/**
+ * Scales eight samples by the volumes of their channels and divides them by
+ * kMaxMixerVolume (256), rounding towards zero like the integer division does.
+ */
+static inline __m128i scaleSamples(__m128i samples, __m128i volumes) {
+	const __m128i round = _mm_set1_epi32(255);
+	__m128i lo = _mm_mullo_epi16(samples, volumes);
+	__m128i hi = _mm_mulhi_epi16(samples, volumes);
+	__m128i scaled0 = _mm_unpacklo_epi16(lo, hi);
+	__m128i scaled1 = _mm_unpackhi_epi16(lo, hi);
+	scaled0 = _mm_srai_epi32(_mm_add_epi32(scaled0, _mm_and_si128(_mm_srai_epi32(scaled0, 31), round)), 8);
+	scaled1 = _mm_srai_epi32(_mm_add_epi32(scaled1, _mm_and_si128(_mm_srai_epi32(scaled1, 31), round)), 8);
+	return _mm_packs_epi32(scaled0, scaled1);
+}
+
+#endif
+
+/**
+ * Mixes frames of (stereo or mono) samples into the output buffer, scaled by
+ * the volume of each channel and clamped like clampedAdd does. The SSE2
+ * version produces the same output as the scalar one, which it uses for
+ * the remaining frames and for volumes above kMaxMixerVolume (where the
+ * scaled samples may not fit 16 bits).
+ */
+template<bool stereo, bool reverseStereo>
+static void mixFrames(st_sample_t *obuf, const st_sample_t *ibuf, st_size_t frames, st_volume_t vol_l, st_volume_t vol_r) {
+	st_size_t i = 0;
+
+#if defined(AUDIO_RATE_SSE2)
+	if (vol_l <= Audio::Mixer::kMaxMixerVolume && vol_r <= Audio::Mixer::kMaxMixerVolume) {
+		// The volumes of the left and the right output samples, in the order in which
+		// the input samples arrive (swapped for reverse stereo).
+		const uint32 volumePair = reverseStereo ? (vol_r | (vol_l << 16)) : (vol_l | (vol_r << 16));
+		const __m128i volumes = _mm_set1_epi32((int)volumePair);
+		if (stereo) {
+			for (; i + 4 <= frames; i += 4) {
+				__m128i samples = _mm_loadu_si128((const __m128i *)(ibuf + i * 2));
+				if (reverseStereo)
+					samples = _mm_shufflehi_epi16(_mm_shufflelo_epi16(samples, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+				__m128i *out = (__m128i *)(obuf + i * 2);
+				_mm_storeu_si128(out, _mm_adds_epi16(_mm_loadu_si128(out), scaleSamples(samples, volumes)));
+			}
+		} else {
+			for (; i + 8 <= frames; i += 8) {
+				__m128i samples = _mm_loadu_si128((const __m128i *)(ibuf + i));
+				__m128i *out = (__m128i *)(obuf + i * 2);
+				_mm_storeu_si128(out, _mm_adds_epi16(_mm_loadu_si128(out), scaleSamples(_mm_unpacklo_epi16(samples, samples), volumes)));
+				_mm_storeu_si128(out + 1, _mm_adds_epi16(_mm_loadu_si128(out + 1), scaleSamples(_mm_unpackhi_epi16(samples, samples), volumes)));
+			}
+		}
+	}
+#endif
+
+	for (; i < frames; i++) {
+		st_sample_t out0, out1;
+		out0 = ibuf[stereo ? i * 2 : i];
+		out1 = (stereo ? ibuf[i * 2 + 1] : out0);
+
+		// output left channel
+		clampedAdd(obuf[i * 2 + reverseStereo    ], (out0 * (int)vol_l) / Audio::Mixer::kMaxMixerVolume);
+
+		// output right channel
+		clampedAdd(obuf[i * 2 + (reverseStereo ^ 1)], (out1 * (int)vol_r) / Audio::Mixer::kMaxMixerVolume);
+	}
+}
+
+} // End of namespace Audio
+
+#endif
@@ -0,0 +1,320 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the AUTHORS
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ * Band-limited rate conversion with a polyphase windowed sinc filter.
+ *
+ * The output position advances through the input in steps of inrate / outrate
+ * input samples, tracked exactly as a rational number with the common factor
+ * of the two rates removed. Every output sample is the dot product of kTaps
+ * input samples around its position with one of the precomputed phases of the
+ * filter: the phase matching the fractional part of the position, or the
+ * nearest one of kMaxPhases when the rates have few common factors.
+ *
+ * When the rates divide evenly, the filter has a single phase (decimation) or
+ * outrate / inrate ones (interpolation), so the table is tiny and the position
+ * needs no rounding.
+ */
+
+#include "audio/audiostream.h"
+#include "audio/rate.h"
+#include "audio/rate_mix.h"
+#include "audio/mixer.h"
+#include "common/algorithm.h"
+#include "common/textconsole.h"
+#include "common/util.h"
+
+#include <math.h>
+
+#if defined(__SSE2__)
+#define AUDIO_RATE_SINC_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Audio {
+
+enum {
+	/** Filter length, in input samples. Must be a multiple of 8. */
+	kTaps = 32,
+	/** Limit for the number of phases, which is outrate divided by the common factor of the rates. */
+	kMaxPhases = 1024,
+	/** The filter coefficients are fixed point numbers with this many fractional bits. */
+	kCoefficientBits = 14,
+	/** Size of the input history of each channel, including the kTaps - 1 samples kept between refills. */
+	kHistorySize = 512 + kTaps,
+	/** Number of output frames filtered before they are mixed into the output all at once */
+	kOutputFrames = 256
+};
+
+/** Modified Bessel function of the first kind of order 0, for the Kaiser window. */
+static double besselI0(double x) {
+	double sum = 1.0, term = 1.0;
+	for (int k = 1; k < 32; k++) {
+		term *= (x / (2.0 * k)) * (x / (2.0 * k));
+		sum += term;
+		if (term < sum * 1e-12)
+			break;
+	}
+	return sum;
+}
+
+/**
+ * Sum of the products of kTaps samples and coefficients. The partial sums fit
+ * 32 bits, since the filter has a gain below 2 for any input.
+ */
+static inline int dotProduct(const int16 *samples, const int16 *coefficients) {
+#if defined(AUDIO_RATE_SINC_SSE2)
+	__m128i sum = _mm_setzero_si128();
+	for (int i = 0; i < kTaps; i += 8) {
+		__m128i s = _mm_loadu_si128((const __m128i *)(samples + i));
+		__m128i c = _mm_loadu_si128((const __m128i *)(coefficients + i));
+		sum = _mm_add_epi32(sum, _mm_madd_epi16(s, c));
+	}
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	return _mm_cvtsi128_si32(sum);
+#else
+	int sum = 0;
+	for (int i = 0; i < kTaps; i++)
+		sum += samples[i] * coefficients[i];
+	return sum;
+#endif
+}
+
+static inline st_sample_t filterSample(const int16 *samples, const int16 *coefficients) {
+	int sum = (dotProduct(samples, coefficients) + (1 << (kCoefficientBits - 1))) >> kCoefficientBits;
+	return (st_sample_t)CLIP<int>(sum, ST_SAMPLE_MIN, ST_SAMPLE_MAX);
+}
+
+template<bool stereo, bool reverseStereo>
+class SincRateConverter : public RateConverter {
+protected:
+	/** Interleaved input, as read from the stream */
+	st_sample_t _inBuf[kHistorySize * 2];
+	/** Input samples of each channel; the filter of output samples covers _history[c][_pos .. _pos + kTaps) */
+	int16 _history[2][kHistorySize];
+	int _historyLen;
+	int _pos;
+	/** Whether the input has ended, and the history is padded with silence after _dataEnd */
+	bool _endOfInput;
+	int _dataEnd;
+
+	/** The output position is _pos + _phase / _phaseCount input samples (past the filter centre) */
+	uint32 _phase;
+	uint32 _phaseCount;
+	/** Step of the output position: _intStep + _fracStep / _phaseCount input samples */
+	uint32 _intStep;
+	uint32 _fracStep;
+
+	/** Number of phases of the filter table, at most kMaxPhases */
+	uint32 _filterPhases;
+	int16 *_filter;
+
+	void createFilter(st_rate_t inrate, st_rate_t outrate);
+	bool refill(AudioStream &input);
+
+	/** Whether the filter centre of the next output sample is past the last input sample */
+	bool isPastEnd() const { return _endOfInput && _pos + kTaps / 2 - 1 >= _dataEnd; }
+
+public:
+	SincRateConverter(st_rate_t inrate, st_rate_t outrate);
+	~SincRateConverter() {
+		delete[] _filter;
+	}
+
+	int flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r);
+	int drain(st_sample_t *obuf, st_size_t osamp, st_volume_t vol) {
+		return ST_SUCCESS;
+	}
+};
+
+template<bool stereo, bool reverseStereo>
+SincRateConverter<stereo, reverseStereo>::SincRateConverter(st_rate_t inrate, st_rate_t outrate) {
+	if (inrate == 0 || outrate == 0) {
+		error("rate effect can only handle non-zero rates");
+	}
+
+	uint32 divisor = Common::gcd<uint32>(inrate, outrate);
+	_phaseCount = outrate / divisor;
+	_intStep = (inrate / divisor) / _phaseCount;
+	_fracStep = (inrate / divisor) % _phaseCount;
+	_phase = 0;
+	_filterPhases = MIN<uint32>(_phaseCount, kMaxPhases);
+	createFilter(inrate, outrate);
+
+	// The first output sample is centred on the first input sample, preceded by silence.
+	memset(_history, 0, sizeof(_history));
+	_historyLen = kTaps / 2 - 1;
+	_pos = 0;
+	_endOfInput = false;
+	_dataEnd = 0;
+}
+
+template<bool stereo, bool reverseStereo>
+void SincRateConverter<stereo, reverseStereo>::createFilter(st_rate_t inrate, st_rate_t outrate) {
+	// Kaiser windowed sinc, with the cutoff just below the lower of the two Nyquist
+	// frequencies, relative to the input one.
+	const double beta = 8.0;
+	const double cutoff = 0.91 * MIN<double>(1.0, (double)outrate / inrate);
+	const double windowScale = 1.0 / besselI0(beta);
+	const int halfTaps = kTaps / 2;
+
+	// One more phase than _filterPhases, centred on the next input sample, for
+	// the positions which are nearer to it than to the last of the others
+	_filter = new int16[(_filterPhases + 1) * kTaps];
+	for (uint32 phase = 0; phase <= _filterPhases; phase++) {
+		double offset = (double)phase / _filterPhases;
+		double coefficients[kTaps];
+		double sum = 0.0;
+		for (int i = 0; i < kTaps; i++) {
+			// Distance of the tap to the output position, in input samples
+			double t = (i - (halfTaps - 1)) - offset;
+			double x = t / halfTaps;
+			double window = (x <= -1.0 || x >= 1.0) ? 0.0 : besselI0(beta * sqrt(1.0 - x * x)) * windowScale;
+			double sinc = (t == 0.0) ? 1.0 : sin(M_PI * cutoff * t) / (M_PI * cutoff * t);
+			coefficients[i] = cutoff * sinc * window;
+			sum += coefficients[i];
+		}
+
+		// Normalize every phase to unity gain, putting the rounding error on the largest tap.
+		int16 *filter = _filter + phase * kTaps;
+		int total = 0, largest = 0;
+		for (int i = 0; i < kTaps; i++) {
+			filter[i] = (int16)floor(coefficients[i] / sum * (1 << kCoefficientBits) + 0.5);
+			total += filter[i];
+			if (ABS(filter[i]) > ABS(filter[largest]))
+				largest = i;
+		}
+		filter[largest] += (1 << kCoefficientBits) - total;
+	}
+}
+
+/**
+ * Moves the samples which are still needed to the start of the history and
+ * appends input samples after them. Once the input has ended, silence is
+ * appended instead, until the filter centre passes the last input sample.
+ * Returns false if there is nothing left to output.
+ */
+template<bool stereo, bool reverseStereo>
+bool SincRateConverter<stereo, reverseStereo>::refill(AudioStream &input) {
+	// With large decimation steps, _pos may be past the end of the history: the
+	// input samples before it are then skipped as they arrive.
+	int shift = MIN(_pos, _historyLen);
+	if (shift > 0) {
+		for (int c = 0; c < (stereo ? 2 : 1); c++)
+			memmove(_history[c], _history[c] + shift, (_historyLen - shift) * sizeof(int16));
+		_historyLen -= shift;
+		_pos -= shift;
+		_dataEnd -= shift;
+	}
+
+	int frames = kHistorySize - _historyLen;
+	int len = _endOfInput ? 0 : input.readBuffer(_inBuf, frames * (stereo ? 2 : 1));
+	if (len <= 0) {
+		// A stream which is only waiting for more data keeps its history as it is
+		if (!_endOfInput && !input.endOfStream())
+			return false;
+
+		if (!_endOfInput) {
+			_endOfInput = true;
+			_dataEnd = _historyLen;
+		}
+		if (isPastEnd())
+			return false;
+
+		for (int c = 0; c < (stereo ? 2 : 1); c++)
+			memset(_history[c] + _historyLen, 0, frames * sizeof(int16));
+		_historyLen = kHistorySize;
+		return true;
+	}
+
+	if (stereo) {
+		for (int i = 0; i < len / 2; i++) {
+			_history[0][_historyLen + i] = _inBuf[i * 2];
+			_history[1][_historyLen + i] = _inBuf[i * 2 + 1];
+		}
+		_historyLen += len / 2;
+	} else {
+		memcpy(_history[0] + _historyLen, _inBuf, len * sizeof(int16));
+		_historyLen += len;
+	}
+	return true;
+}
+
+template<bool stereo, bool reverseStereo>
+int SincRateConverter<stereo, reverseStereo>::flow(AudioStream &input, st_sample_t *obuf, st_size_t osamp, st_volume_t vol_l, st_volume_t vol_r) {
+	st_sample_t *ostart = obuf;
+	st_sample_t *oend = obuf + osamp * 2;
+	// The filtered stereo sample pairs, which are mixed into obuf all at once
+	st_sample_t outBuf[kOutputFrames * 2];
+
+	while (obuf < oend) {
+		st_size_t frames = 0;
+		st_size_t maxFrames = MIN<st_size_t>((oend - obuf) / 2, kOutputFrames);
+		bool endOfInput = false;
+
+		while (frames < maxFrames) {
+			// The filter of the output sample needs the input up to _pos + kTaps
+			if (isPastEnd() || (_pos + kTaps > _historyLen && !refill(input))) {
+				endOfInput = true;
+				break;
+			}
+			if (_pos + kTaps > _historyLen)
+				continue;
+
+			// The nearest phase, which may be the extra one at the next input sample
+			uint32 filterPhase = (_filterPhases == _phaseCount) ? _phase : (uint32)(((uint64)_phase * _filterPhases + _phaseCount / 2) / _phaseCount);
+			const int16 *coefficients = _filter + filterPhase * kTaps;
+
+			outBuf[frames * 2] = filterSample(_history[0] + _pos, coefficients);
+			outBuf[frames * 2 + 1] = (stereo ? filterSample(_history[1] + _pos, coefficients) : outBuf[frames * 2]);
+			frames++;
+
+			// Increment output position
+			_pos += _intStep;
+			_phase += _fracStep;
+			if (_phase >= _phaseCount) {
+				_phase -= _phaseCount;
+				_pos++;
+			}
+		}
+
+		mixFrames<true, reverseStereo>(obuf, outBuf, frames, vol_l, vol_r);
+		obuf += frames * 2;
+
+		if (endOfInput)
+			break;
+	}
+	return (obuf - ostart) / 2;
+}
+
+RateConverter *makeSincRateConverter(st_rate_t inrate, st_rate_t outrate, bool stereo, bool reverseStereo) {
+	if (stereo) {
+		if (reverseStereo)
+			return new SincRateConverter<true, true>(inrate, outrate);
+		else
+			return new SincRateConverter<true, false>(inrate, outrate);
+	} else
+		return new SincRateConverter<false, false>(inrate, outrate);
+}
+
+} // End of namespace Audio
@@ -183,6 +183,26 @@ public:
 	 */
 	virtual Common::SeekableReadStream *createReadStream() = 0;
 
+	/**
+	 * Maps the file referred by this node into memory, read only.
+	 * Backends without support for memory mapped files keep this
+	 * default, and files are read through createReadStream() instead.
+	 *
+	 * @return the mapping holding one reference, 0 in case of a failure
+	 */
+	virtual Common::FileMapping *createMapping() { return nullptr; }
+
+	/**
+	 * Gets the size of the file referred by this node, and the time it was
+	 * last modified, without opening it. Backends which can't tell keep this
+	 * default.
+	 *
+	 * @param modificationTime set to the time of the last modification, in
+	 *                         seconds since an epoch defined by the backend
+	 * @return true if the size and the time were set, false otherwise
+	 */
+	virtual bool getFileStatus(uint32 &size, uint32 &modificationTime) const { return false; }
+
 	/**
 	 * Creates a WriteStream instance corresponding to the file
 	 * referred by this node. This assumes that the node actually refers
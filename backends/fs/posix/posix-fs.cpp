@@ -35,6 +35,7 @@
 #include "backends/fs/posix/posix-fs.h"
 #include "backends/fs/posix/posix-iostream.h"
 #include "common/algorithm.h"
+#include "common/filemapping.h"
 
 #include <sys/param.h>
 #include <sys/stat.h>
@@ -50,6 +51,12 @@
 #include <fcntl.h>
 #include <unistd.h>
 
+// Platforms without a usable mmap() fall back to reading files into memory
+#if defined(POSIX) && !defined(__OS2__) && !defined(__3DS__) && !defined(NINTENDO_SWITCH)
+#define POSIX_FS_HAS_MMAP
+#include <sys/mman.h>
+#endif
+
 #ifdef __OS2__
 #define INCL_DOS
 #include <os2.h>
@@ -290,6 +297,58 @@ Common::SeekableReadStream *POSIXFilesystemNode::createReadStream() {
 	return PosixIoStream::makeFromPath(getPath(), false);
 }
 
+#ifdef POSIX_FS_HAS_MMAP
+namespace {
+
+class PosixFileMapping : public Common::FileMapping {
+public:
+	PosixFileMapping(void *data, uint32 size) : Common::FileMapping((const byte *)data, size) {}
+
+protected:
+	~PosixFileMapping() {
+		munmap(const_cast<byte *>(getData()), size());
+	}
+};
+
+} // End of anonymous namespace
+#endif
+
+Common::FileMapping *POSIXFilesystemNode::createMapping() {
+#ifdef POSIX_FS_HAS_MMAP
+	int fd = open(_path.c_str(), O_RDONLY);
+	if (fd < 0)
+		return nullptr;
+
+	// Empty files can't be mapped, and mappings are limited to what a
+	// MemoryReadStream can address
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size <= 0 || (uint64)st.st_size > 0xFFFFFFFFULL) {
+		close(fd);
+		return nullptr;
+	}
+
+	// The mapping stays valid after the file is closed
+	void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+		return nullptr;
+
+	return new PosixFileMapping(data, st.st_size);
+#else
+	return nullptr;
+#endif
+}
+
+bool POSIXFilesystemNode::getFileStatus(uint32 &size, uint32 &modificationTime) const {
+	struct stat st;
+	if (stat(_path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || (uint64)st.st_size > 0xFFFFFFFFULL)
+		return false;
+
+	size = st.st_size;
+	modificationTime = st.st_mtime;
+	return true;
+}
+
 Common::WriteStream *POSIXFilesystemNode::createWriteStream() {
 	return PosixIoStream::makeFromPath(getPath(), true);
 }
@@ -67,6 +67,8 @@ public:
 	virtual AbstractFSNode *getParent() const;
 
 	virtual Common::SeekableReadStream *createReadStream();
+	virtual Common::FileMapping *createMapping();
+	virtual bool getFileStatus(uint32 &size, uint32 &modificationTime) const;
 	virtual Common::WriteStream *createWriteStream();
 	virtual bool createDirectory();
 
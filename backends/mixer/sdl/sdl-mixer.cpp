@@ -111,7 +111,20 @@ void SdlMixerManager::init() {
 		error("SDL mixer output requires stereo output device");
 #endif
 
-	_mixer = new Audio::MixerImpl(_obtained.freq);
+	// Like the buffer size, the band-limited resampler is only configurable in the
+	// config file, for users who trade CPU time for quality. It's selected for all
+	// the output rates ("audio_resampler=sinc"), or for the one the device runs
+	// at ("audio_resampler_48000=sinc"), which takes precedence.
+	Audio::RateQuality rateQuality = Audio::kRateQualityFast;
+	Common::String resamplerKey = Common::String::format("audio_resampler_%d", _obtained.freq);
+	if (!ConfMan.hasKey(resamplerKey, Common::ConfigManager::kApplicationDomain))
+		resamplerKey = "audio_resampler";
+	if (ConfMan.hasKey(resamplerKey, Common::ConfigManager::kApplicationDomain) &&
+	    ConfMan.get(resamplerKey, Common::ConfigManager::kApplicationDomain) == "sinc")
+		rateQuality = Audio::kRateQualityHigh;
+	debug(1, "Resampler: %s", rateQuality == Audio::kRateQualityHigh ? "sinc" : "linear");
+
+	_mixer = new Audio::MixerImpl(_obtained.freq, rateQuality);
 	assert(_mixer);
 	_mixer->setReady(true);
 
@@ -0,0 +1,233 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/archiveindex.h"
+
+#include "common/archive.h"
+#include "common/fs.h"
+#include "common/memstream.h"
+#include "common/savefile.h"
+#include "common/system.h"
+
+namespace Common {
+
+DECLARE_SINGLETON(ArchiveIndexCache);
+
+static const char *const kArchiveIndexFilename = "archive-index.dat";
+
+enum {
+	kArchiveIndexVersion = 1
+};
+
+ArchiveIndexCache::ArchiveIndexCache() :
+		_loaded(false), _dirty(false) {
+}
+
+SeekableReadStream *ArchiveIndexCache::getIndex(const String &type, const FSNode &node) {
+	uint32 size, modificationTime;
+	if (!node.getFileStatus(size, modificationTime))
+		return nullptr;
+
+	return getIndex(type, node.getPath(), size, modificationTime);
+}
+
+SeekableReadStream *ArchiveIndexCache::getIndex(const String &type, const String &filename) {
+	FSNode node;
+	if (!getNode(filename, node))
+		return nullptr;
+
+	return getIndex(type, node);
+}
+
+void ArchiveIndexCache::putIndex(const String &type, const FSNode &node, MemoryWriteStreamDynamic &index) {
+	uint32 size, modificationTime;
+	if (!node.getFileStatus(size, modificationTime))
+		return;
+
+	putIndex(type, node.getPath(), size, modificationTime, index.getData(), index.size());
+}
+
+void ArchiveIndexCache::putIndex(const String &type, const String &filename, MemoryWriteStreamDynamic &index) {
+	FSNode node;
+	if (getNode(filename, node))
+		putIndex(type, node, index);
+}
+
+SeekableReadStream *ArchiveIndexCache::getIndex(const String &type, const String &path, uint32 size, uint32 modificationTime) {
+	loadFile();
+
+	IndexMap::iterator i = _indices.find(type + ":" + path);
+	if (i == _indices.end())
+		return nullptr;
+
+	// A changed archive replaces its index once it's parsed again
+	i->_value.used = true;
+	if (i->_value.size != size || i->_value.modificationTime != modificationTime)
+		return nullptr;
+
+	return new MemoryReadStream(i->_value.data.begin(), i->_value.data.size());
+}
+
+void ArchiveIndexCache::putIndex(const String &type, const String &path, uint32 size, uint32 modificationTime, const byte *data, uint32 dataSize) {
+	loadFile();
+
+	Index &index = _indices[type + ":" + path];
+	index.size = size;
+	index.modificationTime = modificationTime;
+	index.used = true;
+	index.data.resize(dataSize);
+	if (dataSize)
+		memcpy(index.data.begin(), data, dataSize);
+	_dirty = true;
+}
+
+bool ArchiveIndexCache::load(SeekableReadStream &stream) {
+	_indices.clear();
+
+	if (stream.readUint32BE() != MKTAG('A','I','D','X') || stream.readUint32LE() != kArchiveIndexVersion)
+		return false;
+
+	uint32 count = stream.readUint32LE();
+	for (uint32 i = 0; i < count; i++) {
+		String key = readString(stream);
+		Index index;
+		index.size = stream.readUint32LE();
+		index.modificationTime = stream.readUint32LE();
+		index.used = false;
+
+		uint32 dataSize = stream.readUint32LE();
+		int32 remaining = stream.size() - stream.pos();
+		if (stream.eos() || remaining < 0 || dataSize > (uint32)remaining) {
+			_indices.clear();
+			return false;
+		}
+		index.data.resize(dataSize);
+		stream.read(index.data.begin(), dataSize);
+		_indices[key] = index;
+	}
+
+	return !stream.err();
+}
+
+void ArchiveIndexCache::save(WriteStream &stream) const {
+	stream.writeUint32BE(MKTAG('A','I','D','X'));
+	stream.writeUint32LE(kArchiveIndexVersion);
+	stream.writeUint32LE(_indices.size());
+
+	for (IndexMap::const_iterator i = _indices.begin(); i != _indices.end(); ++i) {
+		writeString(stream, i->_key);
+		stream.writeUint32LE(i->_value.size);
+		stream.writeUint32LE(i->_value.modificationTime);
+		stream.writeUint32LE(i->_value.data.size());
+		stream.write(i->_value.data.begin(), i->_value.data.size());
+	}
+}
+
+void ArchiveIndexCache::flush() {
+	if (!_dirty)
+		return;
+
+	dropStaleIndices();
+
+	SaveFileManager *saveFileMan = g_system->getSavefileManager();
+	OutSaveFile *file = saveFileMan->openForSaving(kArchiveIndexFilename, false);
+	if (!file) {
+		warning("Could not write the archive index cache");
+		return;
+	}
+
+	save(*file);
+	file->finalize();
+	if (file->err())
+		warning("Could not write the archive index cache");
+	delete file;
+
+	_dirty = false;
+}
+
+void ArchiveIndexCache::writeString(WriteStream &stream, const String &str) {
+	stream.writeUint16LE(str.size());
+	stream.writeString(str);
+}
+
+String ArchiveIndexCache::readString(SeekableReadStream &stream) {
+	uint16 length = stream.readUint16LE();
+	int32 remaining = MAX<int32>(stream.size() - stream.pos(), 0);
+	if (length > (uint32)remaining)
+		length = remaining;
+
+	char *buffer = new char[length + 1];
+	stream.read(buffer, length);
+	String str(buffer, length);
+	delete[] buffer;
+	return str;
+}
+
+void ArchiveIndexCache::loadFile() {
+	if (_loaded)
+		return;
+	_loaded = true;
+
+	// The unit tests don't have a system
+	if (!g_system || !g_system->getSavefileManager())
+		return;
+
+	InSaveFile *file = g_system->getSavefileManager()->openForLoading(kArchiveIndexFilename);
+	if (!file)
+		return;
+
+	if (!load(*file))
+		warning("The archive index cache is invalid, ignoring it");
+	delete file;
+}
+
+void ArchiveIndexCache::dropStaleIndices() {
+	// The indices of the archives of other games are kept, as long as their
+	// archive is still where it was, as it was
+	Array<String> stale;
+	for (IndexMap::const_iterator i = _indices.begin(); i != _indices.end(); ++i) {
+		if (i->_value.used)
+			continue;
+
+		// The types don't contain colons, the paths may
+		const char *path = strchr(i->_key.c_str(), ':');
+		uint32 size, modificationTime;
+		if (!path || !FSNode(path + 1).getFileStatus(size, modificationTime) ||
+		    size != i->_value.size || modificationTime != i->_value.modificationTime)
+			stale.push_back(i->_key);
+	}
+
+	for (uint i = 0; i < stale.size(); i++)
+		_indices.erase(stale[i]);
+}
+
+bool ArchiveIndexCache::getNode(const String &filename, FSNode &node) {
+	ArchiveMemberPtr member = SearchMan.getMember(filename);
+	const FSNode *fsNode = dynamic_cast<const FSNode *>(member.get());
+	if (!fsNode)
+		return false;
+
+	node = *fsNode;
+	return true;
+}
+
+} // End of namespace Common
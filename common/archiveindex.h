@@ -0,0 +1,134 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_ARCHIVEINDEX_H
+#define COMMON_ARCHIVEINDEX_H
+
+#include "common/array.h"
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/singleton.h"
+#include "common/str.h"
+
+namespace Common {
+
+/**
+ * @defgroup common_archiveindex Archive index cache
+ * @ingroup common_arch
+ *
+ * @brief Directories of archives, kept from one run to the next.
+ * @{
+ */
+
+class FSNode;
+class MemoryWriteStreamDynamic;
+class SeekableReadStream;
+class WriteStream;
+
+/**
+ * Keeps the parsed directories of archives in a file of the save path, so
+ * that opening an archive again doesn't need to read its directory table.
+ *
+ * Each archive format stores its directory in whatever layout it likes,
+ * under a type naming the format and the version of that layout. A stored
+ * index is only returned while the archive has the same path, size and
+ * modification time as when it was stored. Files whose backend can't tell
+ * their modification time are never cached.
+ *
+ * The cache file is read on the first lookup, and written by flush(), which
+ * the Engine destructor calls. Indices which weren't used since it was read
+ * are dropped then, when their archive was moved or changed.
+ */
+class ArchiveIndexCache : public Singleton<ArchiveIndexCache> {
+public:
+	/**
+	 * Returns a stream over the index stored for a file on disk, or 0 when
+	 * there is none or when the file changed since. The stream is only
+	 * valid until the index is replaced.
+	 */
+	SeekableReadStream *getIndex(const String &type, const FSNode &node);
+
+	/**
+	 * Like getIndex(type, node), for a file found in SearchMan.
+	 */
+	SeekableReadStream *getIndex(const String &type, const String &filename);
+
+	/**
+	 * Stores the index of a file on disk, replacing any previous one.
+	 */
+	void putIndex(const String &type, const FSNode &node, MemoryWriteStreamDynamic &index);
+	void putIndex(const String &type, const String &filename, MemoryWriteStreamDynamic &index);
+
+	/**
+	 * Looks an index up by its key directly.
+	 */
+	SeekableReadStream *getIndex(const String &type, const String &path, uint32 size, uint32 modificationTime);
+	void putIndex(const String &type, const String &path, uint32 size, uint32 modificationTime, const byte *data, uint32 dataSize);
+
+	/**
+	 * Replaces the indices with the ones of a cache file.
+	 *
+	 * @return false if the stream isn't a valid cache file
+	 */
+	bool load(SeekableReadStream &stream);
+	void save(WriteStream &stream) const;
+
+	/**
+	 * Writes the cache file if indices were stored since it was read,
+	 * dropping the stale ones.
+	 */
+	void flush();
+
+	/** Helpers for the archives writing strings into their index */
+	static void writeString(WriteStream &stream, const String &str);
+	static String readString(SeekableReadStream &stream);
+
+private:
+	friend class Singleton<SingletonBaseType>;
+	ArchiveIndexCache();
+
+	struct Index {
+		uint32 size;
+		uint32 modificationTime;
+		Array<byte> data;
+		/** Whether it was looked up or stored since the cache file was read */
+		bool used;
+	};
+	typedef HashMap<String, Index> IndexMap;
+
+	void loadFile();
+	void dropStaleIndices();
+	static bool getNode(const String &filename, FSNode &node);
+
+	IndexMap _indices;
+	bool _loaded;
+	bool _dirty;
+};
+
+/** @} */
+
+} // End of namespace Common
+
+/** Shortcut for accessing the archive index cache. */
+#define ArchiveIndexMan Common::ArchiveIndexCache::instance()
+
+#endif
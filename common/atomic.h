@@ -0,0 +1,118 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_ATOMIC_H
+#define COMMON_ATOMIC_H
+
+#include "common/scummsys.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Common {
+
+/**
+ * @defgroup common_atomic Atomic operations
+ * @ingroup common
+ *
+ * @brief Sequentially consistent operations on 32-bit words shared
+ * between threads, e.g. between the engine and the audio callback.
+ * @{
+ */
+
+/**
+ * Load a word written by another thread.
+ */
+inline uint32 atomicLoad(const volatile uint32 *ptr) {
+#if GCC_ATLEAST(4, 7) || defined(__clang__)
+	return __atomic_load_n(ptr, __ATOMIC_SEQ_CST);
+#elif GCC_ATLEAST(4, 1)
+	__sync_synchronize();
+	uint32 value = *ptr;
+	__sync_synchronize();
+	return value;
+#elif defined(_MSC_VER)
+	return (uint32)_InterlockedCompareExchange((volatile long *)ptr, 0, 0);
+#else
+	// Compilers without atomic builtins only target single core systems,
+	// where a volatile access is enough.
+	return *ptr;
+#endif
+}
+
+/**
+ * Store a word read by another thread.
+ */
+inline void atomicStore(volatile uint32 *ptr, uint32 value) {
+#if GCC_ATLEAST(4, 7) || defined(__clang__)
+	__atomic_store_n(ptr, value, __ATOMIC_SEQ_CST);
+#elif GCC_ATLEAST(4, 1)
+	__sync_synchronize();
+	*ptr = value;
+	__sync_synchronize();
+#elif defined(_MSC_VER)
+	_InterlockedExchange((volatile long *)ptr, (long)value);
+#else
+	*ptr = value;
+#endif
+}
+
+/**
+ * Increment a word shared with other threads.
+ *
+ * @return the incremented value.
+ */
+inline uint32 atomicIncrement(volatile uint32 *ptr) {
+#if GCC_ATLEAST(4, 7) || defined(__clang__)
+	return __atomic_add_fetch(ptr, 1, __ATOMIC_SEQ_CST);
+#elif GCC_ATLEAST(4, 1)
+	return __sync_add_and_fetch(ptr, 1);
+#elif defined(_MSC_VER)
+	return (uint32)_InterlockedIncrement((volatile long *)ptr);
+#else
+	return ++*ptr;
+#endif
+}
+
+/**
+ * Decrement a word shared with other threads.
+ *
+ * @return the decremented value.
+ */
+inline uint32 atomicDecrement(volatile uint32 *ptr) {
+#if GCC_ATLEAST(4, 7) || defined(__clang__)
+	return __atomic_sub_fetch(ptr, 1, __ATOMIC_SEQ_CST);
+#elif GCC_ATLEAST(4, 1)
+	return __sync_sub_and_fetch(ptr, 1);
+#elif defined(_MSC_VER)
+	return (uint32)_InterlockedDecrement((volatile long *)ptr);
+#else
+	return --*ptr;
+#endif
+}
+
+/** @} */
+
+} // End of namespace Common
+
+#endif
@@ -0,0 +1,76 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/filemapping.h"
+
+#include "common/archive.h"
+#include "common/atomic.h"
+#include "common/fs.h"
+
+namespace Common {
+
+FileMapping::FileMapping(const byte *data, uint32 size) :
+		_data(data), _size(size), _refCount(1) {
+}
+
+void FileMapping::incRef() {
+	atomicIncrement(&_refCount);
+}
+
+void FileMapping::decRef() {
+	if (atomicDecrement(&_refCount) == 0)
+		delete this;
+}
+
+MappedReadStream::MappedReadStream(FileMapping *mapping, uint32 offset, uint32 size) :
+		MemoryReadStream(mapping->getData() + offset, size),
+		_mapping(mapping), _offset(offset) {
+	assert(offset <= mapping->size() && size <= mapping->size() - offset);
+	_mapping->incRef();
+}
+
+MappedReadStream::~MappedReadStream() {
+	_mapping->decRef();
+}
+
+SeekableReadStream *MappedReadStream::readStream(uint32 dataSize) {
+	const uint32 start = pos();
+	const uint32 available = MIN<uint32>(dataSize, size() - start);
+	seek(start + available);
+
+	// Flag the end of the stream like a short read would
+	if (available < dataSize)
+		readByte();
+
+	return new MappedReadStream(_mapping, _offset + start, available);
+}
+
+FileMapping *mapFile(const String &filename) {
+	ArchiveMemberPtr member = SearchMan.getMember(filename);
+	const FSNode *node = dynamic_cast<const FSNode *>(member.get());
+	if (!node)
+		return nullptr;
+
+	return node->createMapping();
+}
+
+} // End of namespace Common
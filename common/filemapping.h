@@ -0,0 +1,101 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_FILEMAPPING_H
+#define COMMON_FILEMAPPING_H
+
+#include "common/scummsys.h"
+#include "common/memstream.h"
+#include "common/str.h"
+
+namespace Common {
+
+/**
+ * @defgroup common_filemapping File mappings
+ * @ingroup common_memory
+ *
+ * @brief Read only views of whole files, shared by the streams reading them.
+ * @{
+ */
+
+/**
+ * The read only contents of a file, mapped into memory by the backend.
+ *
+ * Mappings are reference counted: the last owner to call decRef() unmaps
+ * the file. References may be dropped from any thread, so the mixer can
+ * delete a stream playing from an archive after the engine closed it.
+ */
+class FileMapping {
+public:
+	/**
+	 * Wrap memory which stays valid for the lifetime of the mapping.
+	 * Backends subclass this to release the memory in their destructor.
+	 */
+	FileMapping(const byte *data, uint32 size);
+
+	void incRef();
+	void decRef();
+
+	const byte *getData() const { return _data; }
+	uint32 size() const { return _size; }
+
+protected:
+	virtual ~FileMapping() {}
+
+private:
+	const byte *_data;
+	const uint32 _size;
+	volatile uint32 _refCount;
+};
+
+/**
+ * A MemoryReadStream over a range of a FileMapping, which holds a reference
+ * to the mapping for as long as it lives.
+ *
+ * Unlike other streams, readStream() doesn't copy anything: it returns
+ * another MappedReadStream over the next bytes of the same mapping.
+ */
+class MappedReadStream : public MemoryReadStream {
+public:
+	MappedReadStream(FileMapping *mapping, uint32 offset, uint32 size);
+	~MappedReadStream();
+
+	SeekableReadStream *readStream(uint32 dataSize) override;
+
+private:
+	FileMapping *_mapping;
+	const uint32 _offset;
+};
+
+/**
+ * Map a file found in SearchMan into memory.
+ *
+ * @return the mapping, or 0 when the file isn't a plain file on disk or
+ *         when the backend doesn't support mapping files
+ */
+FileMapping *mapFile(const String &filename);
+
+/** @} */
+
+} // End of namespace Common
+
+#endif
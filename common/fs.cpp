@@ -140,6 +140,20 @@ SeekableReadStream *FSNode::createReadStream() const {
 	return _realNode->createReadStream();
 }
 
+FileMapping *FSNode::createMapping() const {
+	if (_realNode == nullptr || !_realNode->exists() || _realNode->isDirectory())
+		return nullptr;
+
+	return _realNode->createMapping();
+}
+
+bool FSNode::getFileStatus(uint32 &size, uint32 &modificationTime) const {
+	if (_realNode == nullptr || _realNode->isDirectory())
+		return false;
+
+	return _realNode->getFileStatus(size, modificationTime);
+}
+
 WriteStream *FSNode::createWriteStream() const {
 	if (_realNode == nullptr)
 		return nullptr;
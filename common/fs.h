@@ -44,6 +44,7 @@ namespace Common {
  */
 
 class FSNode;
+class FileMapping;
 class SeekableReadStream;
 class WriteStream;
 
@@ -231,6 +232,26 @@ public:
 	 */
 	virtual SeekableReadStream *createReadStream() const;
 
+	/**
+	 * Maps the file referred by this node into memory, read only. This
+	 * assumes that the node actually refers to a readable file. If this
+	 * is not the case, or if the backend can't map files, 0 is returned
+	 * and the file has to be read with createReadStream() instead.
+	 *
+	 * @return the mapping holding one reference, 0 in case of a failure
+	 */
+	FileMapping *createMapping() const;
+
+	/**
+	 * Gets the size of the file referred by this node, and the time it was
+	 * last modified, without opening it. The time is only meant to be
+	 * compared with other times of the same backend.
+	 *
+	 * @return true if the size and the time were set, false if the node
+	 *         isn't a file or if the backend can't tell
+	 */
+	bool getFileStatus(uint32 &size, uint32 &modificationTime) const;
+
 	/**
 	 * Creates a WriteStream instance corresponding to the file
 	 * referred by this node. This assumes that the node actually refers
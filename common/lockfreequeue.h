@@ -0,0 +1,113 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_LOCKFREEQUEUE_H
+#define COMMON_LOCKFREEQUEUE_H
+
+#include "common/scummsys.h"
+#include "common/atomic.h"
+
+namespace Common {
+
+/**
+ * @defgroup common_lockfreequeue Lock-free queue
+ * @ingroup common
+ *
+ * @brief Fixed size queue passing items between two threads.
+ * @{
+ */
+
+/**
+ * Bounded queue for a single producer thread and a single consumer thread,
+ * which never block each other. Only the producer may call push() and only
+ * the consumer may call pop(); callers with several producer threads must
+ * serialize their pushes.
+ *
+ * SIZE must be a power of two.
+ */
+template<class T, uint32 SIZE>
+class LockFreeQueue {
+public:
+	LockFreeQueue() : _head(0), _tail(0) {
+		STATIC_ASSERT((SIZE & (SIZE - 1)) == 0, LockFreeQueue_size_must_be_a_power_of_two);
+	}
+
+	/**
+	 * Append an item, unless the queue is full.
+	 *
+	 * @return false if the queue is full.
+	 */
+	bool push(const T &item) {
+		const uint32 tail = _tail;
+		if (tail - atomicLoad(&_head) == SIZE)
+			return false;
+
+		_items[tail & (SIZE - 1)] = item;
+		// Publishes the item to the consumer
+		atomicStore(&_tail, tail + 1);
+		return true;
+	}
+
+	/**
+	 * Remove the oldest item, unless the queue is empty.
+	 *
+	 * @return false if the queue is empty.
+	 */
+	bool pop(T &item) {
+		const uint32 head = _head;
+		if (atomicLoad(&_tail) == head)
+			return false;
+
+		item = _items[head & (SIZE - 1)];
+		// Hands the slot back to the producer
+		atomicStore(&_head, head + 1);
+		return true;
+	}
+
+	bool empty() const {
+		return atomicLoad(&_tail) == atomicLoad(&_head);
+	}
+
+	uint32 size() const {
+		return atomicLoad(&_tail) - atomicLoad(&_head);
+	}
+
+	uint32 capacity() const {
+		return SIZE;
+	}
+
+private:
+	LockFreeQueue(const LockFreeQueue &);
+	LockFreeQueue &operator=(const LockFreeQueue &);
+
+	T _items[SIZE];
+	/** Number of items popped so far, only written by the consumer */
+	volatile uint32 _head;
+	/** Number of items pushed so far, only written by the producer */
+	volatile uint32 _tail;
+};
+
+/** @} */
+
+} // End of namespace Common
+
+#endif
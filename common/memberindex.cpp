@@ -0,0 +1,194 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/memberindex.h"
+
+#include "common/algorithm.h"
+#include "common/hash-str.h"
+#include "common/hashmap.h"
+#include "common/textconsole.h"
+
+namespace Common {
+
+enum {
+	/** The average number of names in a bucket */
+	kBucketSize = 4,
+	/** How many seeds are tried before giving up building the index */
+	kMaxSeeds = 16
+};
+
+static const uint32 kFreeSlot = 0xFFFFFFFF;
+
+/** The finalizer of MurmurHash3, so that all the bits of the hash depend on all the bits of the input */
+static inline uint32 mixHash(uint32 hash) {
+	hash ^= hash >> 16;
+	hash *= 0x85EBCA6B;
+	hash ^= hash >> 13;
+	hash *= 0xC2B2AE35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+MemberIndex::MemberIndex() :
+		_seed(0) {
+}
+
+void MemberIndex::build(const Array<String> &names) {
+	clear();
+
+	uint32 namesSize = 0;
+	for (uint i = 0; i < names.size(); i++)
+		namesSize += names[i].size() + 1;
+
+	_names.resize(namesSize);
+	_nameOffsets.resize(names.size());
+	uint32 offset = 0;
+	for (uint i = 0; i < names.size(); i++) {
+		_nameOffsets[i] = offset;
+		memcpy(&_names[offset], names[i].c_str(), names[i].size() + 1);
+		offset += names[i].size() + 1;
+	}
+
+	// Only the first of the members with the same name gets a slot
+	HashMap<String, uint32, IgnoreCase_Hash, IgnoreCase_EqualTo> firstMembers;
+	Array<uint32> members;
+	for (uint i = 0; i < names.size(); i++) {
+		if (!firstMembers.contains(names[i])) {
+			firstMembers[names[i]] = i;
+			members.push_back(i);
+		}
+	}
+
+	if (members.empty())
+		return;
+
+	for (uint32 seed = 0; seed < kMaxSeeds; seed++) {
+		if (buildSlots(members, seed)) {
+			_seed = seed;
+			return;
+		}
+	}
+
+	error("MemberIndex: Could not build a perfect hash over %d names", members.size());
+}
+
+bool MemberIndex::buildSlots(const Array<uint32> &members, uint32 seed) {
+	const uint32 numSlots = members.size();
+	const uint32 numBuckets = (numSlots + kBucketSize - 1) / kBucketSize;
+
+	// Hash the names, and chain the names of each bucket
+	Array<uint32> slotHashes(numSlots);
+	Array<uint32> next(numSlots);
+	Array<uint32> heads(numBuckets, kFreeSlot);
+	Array<uint32> bucketSizes(numBuckets, 0);
+	uint32 maxBucketSize = 0;
+	for (uint32 i = 0; i < numSlots; i++) {
+		uint32 bucketHash;
+		hashName(getName(members[i]), seed, bucketHash, slotHashes[i]);
+
+		uint32 bucket = bucketHash % numBuckets;
+		next[i] = heads[bucket];
+		heads[bucket] = i;
+		maxBucketSize = MAX(maxBucketSize, ++bucketSizes[bucket]);
+	}
+
+	_displacements = Array<uint32>(numBuckets, 0);
+	_slots = Array<uint32>(numSlots, kFreeSlot);
+
+	// Place the largest buckets first, while most slots are free. The last
+	// buckets have a single name, and only need to find one free slot.
+	const uint32 maxDisplacement = 16 * numSlots + 64;
+	Array<uint32> bucketSlots;
+	for (uint32 size = maxBucketSize; size > 0; size--) {
+		for (uint32 bucket = 0; bucket < numBuckets; bucket++) {
+			if (bucketSizes[bucket] != size)
+				continue;
+
+			uint32 displacement = 0;
+			for (; displacement < maxDisplacement; displacement++) {
+				bool fits = true;
+				bucketSlots.clear();
+				for (uint32 i = heads[bucket]; i != kFreeSlot && fits; i = next[i]) {
+					uint32 slot = getSlot(slotHashes[i], displacement, numSlots);
+					fits = _slots[slot] == kFreeSlot && Common::find(bucketSlots.begin(), bucketSlots.end(), slot) == bucketSlots.end();
+					bucketSlots.push_back(slot);
+				}
+
+				if (fits)
+					break;
+			}
+
+			if (displacement == maxDisplacement)
+				return false;
+
+			_displacements[bucket] = displacement;
+			for (uint32 i = heads[bucket]; i != kFreeSlot; i = next[i])
+				_slots[getSlot(slotHashes[i], displacement, numSlots)] = members[i];
+		}
+	}
+
+	return true;
+}
+
+void MemberIndex::clear() {
+	_seed = 0;
+	_displacements.clear();
+	_slots.clear();
+	_nameOffsets.clear();
+	_names.clear();
+}
+
+int MemberIndex::find(const char *name) const {
+	if (_slots.empty())
+		return kNoMember;
+
+	uint32 bucketHash, slotHash;
+	hashName(name, _seed, bucketHash, slotHash);
+
+	uint32 displacement = _displacements[bucketHash % _displacements.size()];
+	uint32 member = _slots[getSlot(slotHash, displacement, _slots.size())];
+	if (scumm_stricmp(name, getName(member)) != 0)
+		return kNoMember;
+
+	return member;
+}
+
+void MemberIndex::hashName(const char *name, uint32 seed, uint32 &bucketHash, uint32 &slotHash) {
+	// Two independent hashes of the lowercase name, in a single pass
+	uint32 hash1 = 2166136261u ^ seed;
+	uint32 hash2 = 0x9E3779B9 * (seed + 1);
+	for (; *name; name++) {
+		byte c = tolower((byte)*name);
+		hash1 = (hash1 ^ c) * 16777619u;
+		hash2 = (hash2 + c) * 0x5BD1E995;
+		hash2 ^= hash2 >> 15;
+	}
+
+	bucketHash = mixHash(hash1);
+	slotHash = mixHash(hash2);
+}
+
+uint32 MemberIndex::getSlot(uint32 slotHash, uint32 displacement, uint32 numSlots) {
+	return mixHash(slotHash ^ (displacement * 0x9E3779B9)) % numSlots;
+}
+
+} // End of namespace Common
@@ -0,0 +1,95 @@
+/* ScummVM - Graphic Adventure Engine
+ *
+ * ScummVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef COMMON_MEMBERINDEX_H
+#define COMMON_MEMBERINDEX_H
+
+#include "common/array.h"
+#include "common/str.h"
+
+namespace Common {
+
+/**
+ * @defgroup common_memberindex Archive member index
+ * @ingroup common_arch
+ *
+ * @brief Immutable name lookup for the members of read only archives.
+ * @{
+ */
+
+/**
+ * Maps the names of the members of an archive to their position in the
+ * member table of the archive, ignoring the case of the names.
+ *
+ * The index is built once, when the archive is opened. The names are copied
+ * into a single buffer, and a minimal perfect hash is computed over them
+ * with the hash and displace method: the names are spread into buckets, and
+ * each bucket gets a displacement which sends all its names to free slots.
+ * A lookup then hashes the name once, and compares it to the single name
+ * stored in its slot, without allocating anything.
+ */
+class MemberIndex {
+public:
+	enum {
+		/** Returned by find() when no member has the name */
+		kNoMember = -1
+	};
+
+	MemberIndex();
+
+	/**
+	 * Replaces the index with one over the names, member i being names[i].
+	 * When several members have the same name, the first one is found.
+	 */
+	void build(const Array<String> &names);
+	void clear();
+
+	/** The number of members, including those with duplicated names */
+	uint size() const { return _nameOffsets.size(); }
+	bool empty() const { return _nameOffsets.empty(); }
+
+	/**
+	 * Returns the position of the member with the name, or kNoMember.
+	 */
+	int find(const char *name) const;
+	int find(const String &name) const { return find(name.c_str()); }
+
+	/** The name of a member, as it was given to build() */
+	const char *getName(uint member) const { return &_names[_nameOffsets[member]]; }
+
+private:
+	static void hashName(const char *name, uint32 seed, uint32 &bucketHash, uint32 &slotHash);
+	static uint32 getSlot(uint32 slotHash, uint32 displacement, uint32 numSlots);
+	bool buildSlots(const Array<uint32> &members, uint32 seed);
+
+	uint32 _seed;
+	Array<uint32> _displacements;
+	Array<uint32> _slots;
+	Array<uint32> _nameOffsets;
+	Array<char> _names;
+};
+
+/** @} */
+
+} // End of namespace Common
+
+#endif
@@ -79,6 +79,9 @@ public:
 	int32 size() const { return _size; }
 
 	bool seek(int32 offs, int whence = SEEK_SET);
+
+	/** The memory read by the stream, starting at position 0 */
+	const byte *getData() const { return _ptrOrig; }
 };
 
 
@@ -3,6 +3,7 @@ MODULE := common
 MODULE_OBJS := \
 	achievements.o \
 	archive.o \
+	archiveindex.o \
 	config-manager.o \
 	coroutines.o \
 	dcl.o \
@@ -10,6 +11,7 @@ MODULE_OBJS := \
 	error.o \
 	events.o \
 	file.o \
+	filemapping.o \
 	fs.o \
 	gui_options.o \
 	hashmap.o \
@@ -20,6 +22,7 @@ MODULE_OBJS := \
 	language.o \
 	localization.o \
 	macresman.o \
+	memberindex.o \
 	memorypool.o \
 	md5.o \
 	mdct.o \
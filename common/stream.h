@@ -558,8 +558,10 @@ public:
 	 * if reading more failed, because of an I/O error or because
 	 * the end of the stream was reached. Which can be determined by
 	 * calling err() and eos().
+	 * Streams over memory which outlives them may return a view of
+	 * that memory instead of a copy.
 	 */
-	SeekableReadStream *readStream(uint32 dataSize);
+	virtual SeekableReadStream *readStream(uint32 dataSize);
 
 	/**
 	 * Read stream in Pascal format, that is, one byte is
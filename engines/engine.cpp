@@ -33,6 +33,7 @@
 #include "engines/util.h"
 #include "engines/metaengine.h"
 
+#include "common/archiveindex.h"
 #include "common/config-manager.h"
 #include "common/events.h"
 #include "common/file.h"
@@ -59,6 +60,7 @@
 #include "gui/message.h"
 #include "gui/saveload.h"
 
+#include "audio/decodeahead.h"
 #include "audio/mixer.h"
 
 #include "graphics/cursorman.h"
@@ -184,11 +186,18 @@ Engine::Engine(OSystem *syst)
 
 Engine::~Engine() {
 	_mixer->stopAll();
+	Audio::stopDecodeAhead();
 
 	delete _debugger;
 	delete _mainMenuDialog;
 	g_engine = NULL;
 
+	// The cache lives in the save path of the game, so it goes with the engine
+	if (Common::ArchiveIndexCache::hasInstance()) {
+		ArchiveIndexMan.flush();
+		Common::ArchiveIndexCache::destroy();
+	}
+
 	// Remove our cursors again to prevent memory leaks
 	CursorMan.popCursor();
 	CursorMan.popCursorPalette();
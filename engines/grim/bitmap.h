@@ -142,6 +142,7 @@ public:
 	static Bitmap *create(const Common::String &filename);
 
 	const Common::String &getFilename() const { return _data->_fname; }
+	bool isLoaded() const { return _data->_loaded; }
 
 	void draw();
 	void draw(int x, int y);
@@ -26,6 +26,7 @@
 #include "engines/grim/debugger.h"
 #include "engines/grim/md5check.h"
 #include "engines/grim/grim.h"
+#include "engines/grim/resource.h"
 
 namespace Grim {
 
@@ -38,6 +39,7 @@ Debugger::Debugger() :
 	registerCmd("set_renderer", WRAP_METHOD(Debugger, cmd_set_renderer));
 	registerCmd("save", WRAP_METHOD(Debugger, cmd_save));
 	registerCmd("load", WRAP_METHOD(Debugger, cmd_load));
+	registerCmd("resource_cache", WRAP_METHOD(Debugger, cmd_resource_cache));
 }
 
 Debugger::~Debugger() {
@@ -127,4 +129,32 @@ bool Debugger::cmd_load(int argc, const char **argv) {
 	return true;
 }
 
+bool Debugger::cmd_resource_cache(int argc, const char **argv) {
+	ResourceCache &cache = g_resourceloader->getCache();
+
+	if (argc >= 2 && !strcmp(argv[1], "clear")) {
+		cache.clear();
+	} else if (argc >= 2 && !strcmp(argv[1], "reset")) {
+		cache.resetStats();
+	} else if (argc >= 3 && !strcmp(argv[1], "size")) {
+		int size = atoi(argv[2]);
+		cache.setMaxSize(size * 1024);
+		ConfMan.setInt("resource_cache_size", size);
+	} else if (argc >= 2) {
+		debugPrintf("Usage: resource_cache [clear | reset | size <kilobytes>]\n");
+		return true;
+	}
+
+	ResourceCache::Stats stats = cache.getStats();
+	debugPrintf("Size: %u / %u KB\n", stats.size / 1024, stats.maxSize / 1024);
+	debugPrintf("Files: %u, objects: %u (%u retained)\n", stats.numFiles, stats.numObjects, stats.numRetainedObjects);
+	debugPrintf("File hits: %u, misses: %u\n", stats.fileHits, stats.fileMisses);
+	debugPrintf("Object hits: %u, misses: %u\n", stats.objectHits, stats.objectMisses);
+	debugPrintf("Evictions: %u\n", stats.evictions);
+
+	Prefetcher &prefetcher = g_resourceloader->getPrefetcher();
+	debugPrintf("Prefetched: %u, queued: %u\n", prefetcher.getNumPrefetched(), prefetcher.getNumQueued());
+	return true;
+}
+
 }
@@ -47,7 +47,7 @@ namespace Grim {
 
 EMISound *g_emiSound = nullptr;
 
-extern uint16 imuseDestTable[];
+extern VimaStep imuseVimaSteps[];
 
 MusicEntry emiPS2MusicTable[] = {
 	{ 0, 0, 0, 127, 0, "", "", "" },
@@ -189,7 +189,7 @@ EMISound::EMISound(int fps) {
 	_musicTrack = nullptr;
 	_curTrackId = 0;
 	_callbackFps = fps;
-	vimaInit(imuseDestTable);
+	vimaInit(imuseVimaSteps);
 	initMusicTable();
 	g_system->getTimerManager()->installTimerProc(timerHandler, 1000000 / _callbackFps, this, "emiSoundCallback");
 }
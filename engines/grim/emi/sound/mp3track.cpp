@@ -23,6 +23,7 @@
 #include "common/mutex.h"
 #include "audio/mixer.h"
 #include "audio/audiostream.h"
+#include "audio/decodeahead.h"
 #include "audio/decoders/mp3.h"
 #include "engines/grim/debug.h"
 #include "engines/grim/resource.h"
@@ -179,7 +180,10 @@ bool MP3Track::openSound(const Common::String &filename, const Common::String &s
 	if (start)
 		cuePoints._start = *start;
 
-	Audio::SeekableAudioStream *mp3Stream = Audio::makeMP3Stream(file, DisposeAfterUse::YES);
+	// Decoded ahead, so that the mixer doesn't wait for the MP3 frames
+	Audio::SeekableAudioStream *mp3Stream = Audio::makeDecodeAheadStream(Audio::makeMP3Stream(file, DisposeAfterUse::YES));
+	if (!mp3Stream)
+		return false;
 
 	if (cuePoints._loopEnd <= cuePoints._loopStart) {
 		_stream = mp3Stream;
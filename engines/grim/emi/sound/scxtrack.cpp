@@ -24,6 +24,7 @@
 #include "common/textconsole.h"
 #include "audio/mixer.h"
 #include "audio/audiostream.h"
+#include "audio/decodeahead.h"
 #include "engines/grim/debug.h"
 #include "engines/grim/resource.h"
 #include "engines/grim/emi/sound/codecs/scx.h"
@@ -52,8 +53,12 @@ bool SCXTrack::openSound(const Common::String &filename, const Common::String &s
 		return false;
 	}
 	_soundName = soundName;
-	Audio::RewindableAudioStream *scxStream = makeSCXStream(file, start, DisposeAfterUse::YES);
-	_stream = scxStream;
+	SCXStream *scxStream = makeSCXStream(file, start, DisposeAfterUse::YES);
+	if (!scxStream)
+		return false;
+	// Decoded ahead, so that the mixer doesn't wait for the ADPCM blocks. The
+	// position carries on from where the SCX stream was cued to.
+	_stream = Audio::makeDecodeAheadStream(scxStream, DisposeAfterUse::YES, Audio::kDefaultDecodeAheadDepth, scxStream->getPos());
 	_handle = new Audio::SoundHandle();
 	return true;
 }
@@ -68,7 +73,7 @@ bool SCXTrack::isPlaying() {
 Audio::Timestamp SCXTrack::getPos() {
 	if (!_stream || _looping)
 		return Audio::Timestamp(0);
-	return dynamic_cast<SCXStream*>(_stream)->getPos();
+	return dynamic_cast<Audio::DecodeAheadAudioStream *>(_stream)->getPos();
 }
 
 bool SCXTrack::play() {
@@ -92,6 +92,7 @@ void GfxTinyGL::setupScreen(int screenW, int screenH, bool fullscreen) {
 	_zb = new TinyGL::FrameBuffer(screenW, screenH, buf);
 	TinyGL::glInit(_zb, 256);
 	tglEnableDirtyRects(ConfMan.getBool("dirtyrects"));
+	tglEnableTiledRendering(ConfMan.getBool("tiledrendering"));
 
 	_storedDisplay.create(_pixelFormat, _gameWidth * _gameHeight, DisposeAfterUse::YES);
 	_storedDisplay.clear(_gameWidth * _gameHeight);
@@ -655,8 +655,14 @@ void GrimEngine::playAspyrLogo() {
 		if (_speedLimitMs == 0)
 			continue;
 		if (diffTime < _speedLimitMs) {
-			uint32 delayTime = _speedLimitMs - diffTime;
-			g_system->delayMillis(delayTime);
+			// Spend the time left in the frame reading ahead the files of the set
+			g_resourceloader->getPrefetcher().update(startTime + _speedLimitMs);
+
+			endTime = g_system->getMillis();
+			if (endTime < startTime + _speedLimitMs) {
+				uint32 delayTime = startTime + _speedLimitMs - endTime;
+				g_system->delayMillis(delayTime);
+			}
 		}
 	}
 	delete g_movie;
@@ -1149,8 +1155,14 @@ void GrimEngine::mainLoop() {
 		if (_speedLimitMs == 0)
 			continue;
 		if (diffTime < _speedLimitMs) {
-			uint32 delayTime = _speedLimitMs - diffTime;
-			g_system->delayMillis(delayTime);
+			// Spend the time left in the frame reading ahead the files of the set
+			g_resourceloader->getPrefetcher().update(startTime + _speedLimitMs);
+
+			endTime = g_system->getMillis();
+			if (endTime < startTime + _speedLimitMs) {
+				uint32 delayTime = startTime + _speedLimitMs - endTime;
+				g_system->delayMillis(delayTime);
+			}
 		}
 	}
 }
@@ -1468,6 +1480,9 @@ void GrimEngine::setSetLock(const char *name, bool lockStatus) {
 
 	if (!scene) {
 		Debug::warning(Debug::Engine, "Set object '%s' not found in list", name);
+		// The scripts are likely to switch to it soon
+		if (lockStatus)
+			g_resourceloader->getPrefetcher().prefetchSet(name);
 		return;
 	}
 	// Change the locking status
@@ -1517,6 +1532,9 @@ void GrimEngine::setSet(Set *scene) {
 
 	Set *lastSet = _currSet;
 	_currSet = scene;
+	// What is still queued for the previous set won't be needed anymore
+	g_resourceloader->getPrefetcher().clear();
+	_currSet->prefetchBitmaps();
 	_currSet->setSoundParameters(20, 127);
 	// should delete the old scene after setting the new one
 	if (lastSet && !lastSet->_locked) {
@@ -20,6 +20,7 @@
  *
  */
 
+#include "common/atomic.h"
 #include "common/textconsole.h"
 #include "common/timer.h"
 
@@ -27,17 +28,16 @@
 #include "engines/grim/debug.h"
 
 #include "engines/grim/imuse/imuse.h"
+#include "engines/grim/imuse/imuse_stream.h"
 #include "engines/grim/movie/codecs/vima.h"
 
-#include "audio/audiostream.h"
 #include "audio/mixer.h"
-#include "audio/decoders/raw.h"
 
 namespace Grim {
 
 Imuse *g_imuse = nullptr;
 
-extern uint16 imuseDestTable[];
+extern VimaStep imuseVimaSteps[];
 extern ImuseTable grimStateMusicTable[];
 extern ImuseTable grimSeqMusicTable[];
 extern ImuseTable grimDemoStateMusicTable[];
@@ -50,7 +50,7 @@ void Imuse::timerHandler(void *refCon) {
 
 Imuse::Imuse(int fps, bool demo) {
 	_demo = demo;
-	_pause = false;
+	_pause = 0;
 	_sound = new ImuseSndMgr(_demo);
 	assert(_sound);
 	_callbackFps = fps;
@@ -61,7 +61,7 @@ Imuse::Imuse(int fps, bool demo) {
 		memset(_track[l], 0, sizeof(Track));
 		_track[l]->trackId = l;
 	}
-	vimaInit(imuseDestTable);
+	vimaInit(imuseVimaSteps);
 	if (_demo) {
 		_stateMusicTable = grimDemoStateMusicTable;
 		_seqMusicTable = grimDemoSeqMusicTable;
@@ -69,6 +69,7 @@ Imuse::Imuse(int fps, bool demo) {
 		_stateMusicTable = grimStateMusicTable;
 		_seqMusicTable = grimSeqMusicTable;
 	}
+	// The timer only decodes the tracks ahead, they are mixed by their streams
 	g_system->getTimerManager()->installTimerProc(timerHandler, 1000000 / _callbackFps, this, "imuseCallback");
 }
 
@@ -88,17 +89,20 @@ void Imuse::resetState() {
 }
 
 void Imuse::restoreState(SaveGame *savedState) {
-	Common::StackLock lock(_mutex);
+	Track tracks[MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS];
+	int32 attributes[185];
 
+	// The save is read and the sounds are opened before taking the lock, so
+	// that the tracks still playing keep being decoded meanwhile
 	savedState->beginSection('IMUS');
-	_curMusicState = savedState->readLESint32();
-	_curMusicSeq = savedState->readLESint32();
+	int32 curMusicState = savedState->readLESint32();
+	int32 curMusicSeq = savedState->readLESint32();
 	for (int r = 0; r < 185; r++) {
-		_attributes[r] = savedState->readLESint32();
+		attributes[r] = savedState->readLESint32();
 	}
 
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
-		Track *track = _track[l];
+		Track *track = &tracks[l];
 		memset(track, 0, sizeof(Track));
 		track->trackId = l;
 		track->pan = savedState->readLESint32();
@@ -136,19 +140,47 @@ void Imuse::restoreState(SaveGame *savedState) {
 			continue;
 		}
 
+		// The track was only playing what it had decoded of its last region
+		if (track->curRegion >= _sound->getNumRegions(track->soundDesc)) {
+			_sound->closeSound(track->soundDesc);
+			track->used = false;
+			continue;
+		}
+
 		int channels = _sound->getChannels(track->soundDesc);
-		int freq = _sound->getFreq(track->soundDesc);
 		track->mixerFlags = kFlag16Bits;
 		if (channels == 2)
 			track->mixerFlags |= kFlagStereo | kFlagReverseStereo;
-
-		track->stream = Audio::makeQueuingAudioStream(freq, (track->mixerFlags & kFlagStereo) != 0);
-		g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1, track->getVol(),
-											track->getPan(), DisposeAfterUse::YES, false,
-											(track->mixerFlags & kFlagReverseStereo) != 0);
-		g_system->getMixer()->pauseHandle(track->handle, true);
 	}
 	savedState->endSection();
+
+	{
+		Common::StackLock lock(_mutex);
+
+		_curMusicState = curMusicState;
+		_curMusicSeq = curMusicSeq;
+		memcpy(_attributes, attributes, sizeof(_attributes));
+
+		for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
+			Track *track = _track[l];
+			if (track->used)
+				flushTrack(track);
+			memcpy(track, &tracks[l], sizeof(Track));
+
+			if (!track->used)
+				continue;
+
+			createStream(track);
+			// Fades start over from the restored volume and pan
+			if (track->volFadeUsed)
+				track->stream->postCommand(ImuseStream::kCommandFadeVolume, track->voice, track->volFadeDest, getFadeSamples(track, track->volFadeDelay));
+			if (track->panFadeUsed)
+				track->stream->postCommand(ImuseStream::kCommandFadePan, track->voice, track->panFadeDest, getFadeSamples(track, track->panFadeDelay));
+		}
+	}
+
+	playNewStreams();
+	deleteUnusedStreams();
 	g_system->getMixer()->pauseAll(false);
 }
 
@@ -164,6 +196,9 @@ void Imuse::saveState(SaveGame *savedState) {
 
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		Track *track = _track[l];
+		if (track->used && track->stream)
+			syncTrack(track);
+
 		savedState->writeLESint32(track->pan);
 		savedState->writeLESint32(track->panFadeDest);
 		savedState->writeLESint32(track->panFadeDelay);
@@ -176,7 +211,8 @@ void Imuse::saveState(SaveGame *savedState) {
 		savedState->writeBool(track->used);
 		savedState->writeBool(track->toBeRemoved);
 		savedState->writeLESint32(track->priority);
-		savedState->writeLESint32(track->regionOffset);
+		// What was decoded, but not played yet, is decoded again once restored
+		savedState->writeLESint32(getPlayedOffset(track));
 		savedState->writeLESint32(track->dataOffset);
 		savedState->writeLESint32(track->curRegion);
 		savedState->writeLESint32(track->curHookId);
@@ -187,148 +223,158 @@ void Imuse::saveState(SaveGame *savedState) {
 	savedState->endSection();
 }
 
-int32 Imuse::makeMixerFlags(int32 flags) {
-	int32 mixerFlags = 0;
-	if (flags & kFlagUnsigned)
-		mixerFlags |= Audio::FLAG_UNSIGNED;
-	if (flags & kFlag16Bits)
-		mixerFlags |= Audio::FLAG_16BITS;
-	if (flags & kFlagLittleEndian)
-		mixerFlags |= Audio::FLAG_LITTLE_ENDIAN;
-	if (flags & kFlagStereo)
-		mixerFlags |= Audio::FLAG_STEREO;
-	return mixerFlags;
-}
-
 void Imuse::callback() {
 	Common::StackLock lock(_mutex);
 
 	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
 		Track *track = _track[l];
-		if (track->used) {
-			// Ignore tracks which are about to finish. Also, if it did finish in the meantime,
-			// mark it as unused.
-			if (!track->stream) {
-				if (!track->soundDesc || !g_system->getMixer()->isSoundHandleActive(track->handle))
-					memset(track, 0, sizeof(Track));
-				continue;
-			}
+		if (!track->used || !track->stream)
+			continue;
 
-			if (_pause)
-				return;
-
-			if (track->volFadeUsed) {
-				if (track->volFadeStep < 0) {
-					if (track->vol > track->volFadeDest) {
-						track->vol += track->volFadeStep;
-						//warning("fade: %d", track->vol);
-						if (track->vol < track->volFadeDest) {
-							track->vol = track->volFadeDest;
-							track->volFadeUsed = false;
-						}
-						if (track->vol == 0) {
-							// Fade out complete -> remove this track
-							flushTrack(track);
-							continue;
-						}
-					}
-				} else if (track->volFadeStep > 0) {
-					if (track->vol < track->volFadeDest) {
-						track->vol += track->volFadeStep;
-						//warning("fade: %d", track->vol);
-						if (track->vol > track->volFadeDest) {
-							track->vol = track->volFadeDest;
-							track->volFadeUsed = false;
-						}
-					}
-				}
-			}
+		syncTrack(track);
+		if (track->stream && !track->voice->isEndOfData())
+			decodeTrack(track);
+	}
 
-			if (track->panFadeUsed) {
-				if (track->panFadeStep < 0) {
-					if (track->pan > track->panFadeDest) {
-						track->pan += track->panFadeStep;
-						if (track->pan < track->panFadeDest) {
-							track->pan = track->panFadeDest;
-							track->panFadeUsed = false;
-						}
-					}
-				} else if (track->panFadeStep > 0) {
-					if (track->pan < track->panFadeDest) {
-						track->pan += track->panFadeStep;
-						if (track->pan > track->panFadeDest) {
-							track->pan = track->panFadeDest;
-							track->panFadeUsed = false;
-						}
-					}
-				}
-			}
+	for (Common::List<ImuseStream *>::iterator i = _streams.begin(); i != _streams.end(); ++i)
+		(*i)->flushCommands();
+}
 
-			assert(track->stream);
-			byte *data = nullptr;
-			int32 result = 0;
+void Imuse::syncTrack(Track *track) {
+	ImuseVoice *voice = track->voice;
+	if (voice->isFinished()) {
+		// The track was played to its end, or faded out
+		flushTrack(track);
+		return;
+	}
 
-			if (track->curRegion == -1) {
-				switchToNextRegion(track);
-				if (!track->stream) // Seems we reached the end of the stream
-					continue;
-			}
+	// The mixer moves the fades
+	int32 vol, pan;
+	bool volFadeUsed, panFadeUsed;
+	if (voice->getMixedParams(vol, pan, volFadeUsed, panFadeUsed)) {
+		track->vol = vol;
+		track->pan = pan;
+		track->volFadeUsed = volFadeUsed;
+		track->panFadeUsed = panFadeUsed;
+	}
+}
 
-			int channels = _sound->getChannels(track->soundDesc);
-			int32 mixer_size = track->feedSize / _callbackFps;
+void Imuse::decodeTrack(Track *track) {
+	ImuseVoice *voice = track->voice;
+	const int channels = _sound->getChannels(track->soundDesc);
+	const uint32 ahead = MIN<uint32>(ImuseVoice::kBufferFrames, track->getFreq() * kDecodeAheadMs / 1000);
+	int16 samples[kDecodeFrames * 2];
 
-			if (track->stream->endOfData()) {
-				mixer_size *= 2;
-			}
+	while (!voice->isEndOfData() && voice->getBuffered() < ahead) {
+		if (track->curRegion == -1) {
+			switchToNextRegion(track);
+			continue;
+		}
 
-			if (channels == 1)
-				mixer_size &= ~1;
-			if (channels == 2)
-				mixer_size &= ~3;
+		const int32 frames = MIN<uint32>(ahead - voice->getBuffered(), kDecodeFrames);
+		const int32 result = _sound->getSamplesFromRegion(track->soundDesc, track->curRegion, samples, track->regionOffset, frames * channels * 2);
+		voice->write(samples, result / (channels * 2));
+		track->regionOffset += result;
 
-			if (mixer_size == 0)
-				continue;
+		if (_sound->isEndOfRegion(track->soundDesc, track->curRegion)) {
+			switchToNextRegion(track);
+		} else if (result == 0) {
+			warning("Imuse::decodeTrack(): No data left in '%s'", track->soundName);
+			voice->setEndOfData();
+		}
+	}
+}
 
-			do {
-				result = _sound->getDataFromRegion(track->soundDesc, track->curRegion, &data, track->regionOffset, mixer_size);
-				if (channels == 1) {
-					result &= ~1;
-				}
-				if (channels == 2) {
-					result &= ~3;
-				}
+int32 Imuse::getPlayedOffset(Track *track) {
+	if (!track->voice)
+		return track->regionOffset;
+
+	const int32 frameSize = (track->mixerFlags & kFlagStereo) ? 4 : 2;
+	return MAX<int32>(0, track->regionOffset - (int32)track->voice->getBuffered() * frameSize);
+}
+
+bool Imuse::isStreamUsed(ImuseStream *stream) {
+	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
+		if (_track[l]->used && _track[l]->stream == stream)
+			return true;
+	}
+	return false;
+}
 
-				if (result > mixer_size)
-					result = mixer_size;
+void Imuse::createStream(Track *track) {
+	track->stream = new ImuseStream(&_pause, track->getFreq(), track->getType());
+	_streams.push_back(track->stream);
+	_newStreams.push_back(track->stream);
+	createVoice(track, 0);
+}
+
+void Imuse::createVoice(Track *track, uint32 startFrame) {
+	ImuseStream *stream = track->stream;
+	track->voice = new ImuseVoice(_sound->getChannels(track->soundDesc), (track->mixerFlags & kFlagReverseStereo) != 0, startFrame);
+	stream->postCommand(ImuseStream::kCommandSetVolume, track->voice, track->vol);
+	stream->postCommand(ImuseStream::kCommandSetPan, track->voice, track->pan);
+	stream->postCommand(ImuseStream::kCommandAddVoice, track->voice);
+}
+
+void Imuse::playNewStreams() {
+	Common::Array<ImuseStream *> streams;
+	{
+		Common::StackLock lock(_mutex);
+		streams = _newStreams;
+		_newStreams.clear();
+	}
+
+	// The streams apply the volume and the pan of their tracks themselves
+	for (uint i = 0; i < streams.size(); i++) {
+		g_system->getMixer()->playStream(streams[i]->getType(), &streams[i]->getHandle(), streams[i], -1,
+		                                 Audio::Mixer::kMaxChannelVolume, 0, DisposeAfterUse::NO);
+	}
+}
 
-				if (g_system->getMixer()->isReady()) {
-					track->stream->queueBuffer(data, result, DisposeAfterUse::YES, makeMixerFlags(track->mixerFlags));
-					track->regionOffset += result;
-				} else
-					delete[] data;
+void Imuse::deleteUnusedStreams() {
+	Common::Array<ImuseStream *> unused;
+	{
+		Common::StackLock lock(_mutex);
+		Common::List<ImuseStream *>::iterator i = _streams.begin();
+		while (i != _streams.end()) {
+			ImuseStream *stream = *i;
+			if (isStreamUsed(stream)) {
+				++i;
+				continue;
+			}
 
-				if (_sound->isEndOfRegion(track->soundDesc, track->curRegion)) {
-					switchToNextRegion(track);
-					if (!track->stream)
-						break;
+			stream->finish();
+			unused.push_back(stream);
+			for (uint j = 0; j < _newStreams.size(); j++) {
+				if (_newStreams[j] == stream) {
+					_newStreams.remove_at(j);
+					break;
 				}
-				mixer_size -= result;
-				assert(mixer_size >= 0);
-			} while (mixer_size);
-			if (g_system->getMixer()->isReady()) {
-				g_system->getMixer()->setChannelVolume(track->handle, track->getVol());
-				g_system->getMixer()->setChannelBalance(track->handle, track->getPan());
 			}
+			i = _streams.erase(i);
 		}
 	}
+
+	// Stopping a stream the mixer doesn't own waits until the mixer is done
+	// with it
+	for (uint i = 0; i < unused.size(); i++) {
+		g_system->getMixer()->stopHandle(unused[i]->getHandle());
+		delete unused[i];
+	}
+}
+
+int32 Imuse::getFadeSamples(Track *track, int fadeDelay) {
+	// Fade delays are in 60th of a second
+	return MAX<int32>(1, (int64)fadeDelay * track->getFreq() / 60);
 }
 
 void Imuse::switchToNextRegion(Track *track) {
 	assert(track);
 
+	// The track is flushed once what was decoded of it has been played
 	if (track->trackId >= MAX_IMUSE_TRACKS) {
 		Debug::debug(Debug::Sound, "Imuse::switchToNextRegion(): fadeTrack end: soundName:%s", track->soundName);
-		flushTrack(track);
+		track->voice->setEndOfData();
 		return;
 	}
 
@@ -336,7 +382,7 @@ void Imuse::switchToNextRegion(Track *track) {
 
 	if (++track->curRegion == numRegions) {
 		Debug::debug(Debug::Sound, "Imuse::switchToNextRegion(): end of tracks: soundName:%s", track->soundName);
-		flushTrack(track);
+		track->voice->setEndOfData();
 		return;
 	}
 
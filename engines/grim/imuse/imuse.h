@@ -23,6 +23,8 @@
 #ifndef GRIM_IMUSE_H
 #define GRIM_IMUSE_H
 
+#include "common/array.h"
+#include "common/list.h"
 #include "common/mutex.h"
 
 #include "engines/grim/imuse/imuse_track.h"
@@ -36,16 +38,29 @@ struct ImuseTable;
 class SaveGame;
 
 class Imuse {
+
 private:
 
-	int _callbackFps;
+	enum {
+		// How far ahead of the mixer the tracks are decoded
+		kDecodeAheadMs = 200,
+		// Tracks are decoded in chunks of this many frames, to bound the buffers
+		kDecodeFrames = 1024
+	};
 
+	int _callbackFps;
 	Track *_track[MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS];
 
+	// Guards the tracks, which the scripts change and the timer decodes.
+	// The mixer never takes it: it only sees the voices of the tracks, through
+	// the commands of their streams.
 	Common::Mutex _mutex;
 	ImuseSndMgr *_sound;
 
-	bool _pause;
+	Common::List<ImuseStream *> _streams;
+	Common::Array<ImuseStream *> _newStreams; // created, but not played yet
+
+	volatile uint32 _pause; // read by the mixer
 	bool _demo;
 
 	int32 _attributes[185];
@@ -55,9 +70,17 @@ private:
 	const ImuseTable *_stateMusicTable;
 	const ImuseTable *_seqMusicTable;
 
-	int32 makeMixerFlags(int32 flags);
 	static void timerHandler(void *refConf);
 	void callback();
+	void syncTrack(Track *track);
+	void decodeTrack(Track *track);
+	int32 getPlayedOffset(Track *track);
+	bool isStreamUsed(ImuseStream *stream);
+	void createStream(Track *track);
+	void createVoice(Track *track, uint32 startFrame);
+	void playNewStreams();
+	void deleteUnusedStreams();
+	int32 getFadeSamples(Track *track, int fadeDelay);
 	void switchToNextRegion(Track *track);
 	int allocSlot(int priority);
 	void selectVolumeGroup(const char *soundName, int volGroupId);
@@ -70,6 +93,7 @@ private:
 	void playMusic(const ImuseTable *table, int atribPos, bool sequence);
 
 	void flushTrack(Track *track);
+	bool startTrack(const char *soundName, int volGroupId, int hookId, int volume, int pan, int priority, Track *otherTrack);
 
 public:
 	Imuse(int fps, bool demo);
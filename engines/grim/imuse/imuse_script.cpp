@@ -20,9 +20,11 @@
  *
  */
 
+#include "common/atomic.h"
 #include "common/textconsole.h"
 
 #include "engines/grim/imuse/imuse.h"
+#include "engines/grim/imuse/imuse_stream.h"
 
 #include "engines/grim/debug.h"
 
@@ -32,11 +34,10 @@ void Imuse::flushTrack(Track *track) {
 	track->toBeRemoved = true;
 
 	if (track->stream) {
-		// Finalize the appendable stream, then remove our reference to it.
-		// Note that there might still be some data left in the buffers of the
-		// appendable stream. We play it nice and wait till all of it
-		// played. The audio mixer will take care of it afterwards (and dispose it).
-		track->stream->finish();
+		// Remove our reference to the stream. It stops as soon as no other
+		// track is mixed by it, and is deleted by flushTracks().
+		track->stream->postCommand(ImuseStream::kCommandRemoveVoice, track->voice);
+		track->voice = nullptr;
 		track->stream = nullptr;
 		if (track->soundDesc) {
 			_sound->closeSound(track->soundDesc);
@@ -44,29 +45,33 @@ void Imuse::flushTrack(Track *track) {
 		}
 	}
 
-	if (!g_system->getMixer()->isSoundHandleActive(track->handle)) {
-		memset(track, 0, sizeof(Track));
-	}
+	// The track is cleared by flushTracks(), so it isn't reused while it's
+	// being mixed
 }
 
 void Imuse::flushTracks() {
-	Common::StackLock lock(_mutex);
-	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
-		Track *track = _track[l];
-		if (track->used && track->toBeRemoved && !g_system->getMixer()->isSoundHandleActive(track->handle)) {
-			memset(track, 0, sizeof(Track));
+	{
+		Common::StackLock lock(_mutex);
+		for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
+			Track *track = _track[l];
+			if (track->used && !track->stream) {
+				memset(track, 0, sizeof(Track));
+			}
 		}
 	}
+
+	deleteUnusedStreams();
 }
 
 void Imuse::refreshScripts() {
-	Common::StackLock lock(_mutex);
 	bool found = false;
-
-	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
-		Track *track = _track[l];
-		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
-			found = true;
+	{
+		Common::StackLock lock(_mutex);
+		for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
+			Track *track = _track[l];
+			if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
+				found = true;
+			}
 		}
 	}
 
@@ -106,7 +111,8 @@ int32 Imuse::getPosIn16msTicks(const char *soundName) {
 		return false;
 	}
 
-	int32 pos = (62.5 / 60.0) * (5 * (getTrack->dataOffset + getTrack->regionOffset)) / (getTrack->feedSize / 12); // 16ms is 62.5 Hz
+	// What was decoded ahead isn't played yet
+	int32 pos = (62.5 / 60.0) * (5 * (getTrack->dataOffset + getPlayedOffset(getTrack))) / (getTrack->feedSize / 12); // 16ms is 62.5 Hz
 	return pos;
 }
 
@@ -114,10 +120,8 @@ bool Imuse::isVoicePlaying() {
 	Common::StackLock lock(_mutex);
 	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
 		Track *track = _track[l];
-		if (track->used && track->volGroupId == IMUSE_VOLGRP_VOICE) {
-			if (g_system->getMixer()->isSoundHandleActive(track->handle))
-				return true;
-		}
+		if (track->used && track->stream && track->volGroupId == IMUSE_VOLGRP_VOICE)
+			return true;
 	}
 
 	return false;
@@ -133,7 +137,7 @@ bool Imuse::getSoundStatus(const char *soundName) {
 
 	track = findTrack(soundName);
 	// Warn the user if the track was not found
-	if (track == nullptr || !g_system->getMixer()->isSoundHandleActive(track->handle)) {
+	if (track == nullptr || !track->stream) {
 		// This debug warning should be "light" since this function gets called
 		// on occassion to see if a sound has stopped yet
 		Debug::debug(Debug::Sound, "Sound '%s' could not be found to get status, assume inactive.", soundName);
@@ -157,23 +161,25 @@ void Imuse::stopSound(const char *soundName) {
 }
 
 void Imuse::stopAllSounds() {
-	Common::StackLock lock(_mutex);
 	Debug::debug(Debug::Sound, "Imuse::stopAllSounds()");
-
-	for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
-		Track *track = _track[l];
-		if (track->used) {
-			g_system->getMixer()->stopHandle(track->handle);
-			if (track->soundDesc) {
-				_sound->closeSound(track->soundDesc);
+	{
+		Common::StackLock lock(_mutex);
+		for (int l = 0; l < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; l++) {
+			Track *track = _track[l];
+			if (track->used) {
+				if (track->soundDesc) {
+					_sound->closeSound(track->soundDesc);
+				}
+				memset(track, 0, sizeof(Track));
 			}
-			memset(track, 0, sizeof(Track));
 		}
 	}
+
+	deleteUnusedStreams();
 }
 
 void Imuse::pause(bool p) {
-	_pause = p;
+	Common::atomicStore(&_pause, p ? 1 : 0);
 }
 
 } // end of namespace Grim
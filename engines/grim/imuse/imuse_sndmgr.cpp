@@ -22,6 +22,7 @@
 
 #include "common/endian.h"
 #include "common/stream.h"
+#include "common/textconsole.h"
 
 #include "engines/grim/resource.h"
 
@@ -30,7 +31,41 @@
 
 namespace Grim {
 
-ImuseSndMgr::ImuseSndMgr(bool demo) {
+/**
+ * The decoded samples of a sound along with its header, so that the sound
+ * can be opened again without touching its file.
+ */
+class ImuseSndMgr::CachedSound : public Audio::PCMClip {
+public:
+	CachedSound(int16 *samples, uint32 numSamples, const SoundDesc *sound) :
+			Audio::PCMClip(samples, numSamples, sound->freq, sound->channels == 2) {
+		freq = sound->freq;
+		channels = sound->channels;
+		bits = sound->bits;
+		numRegions = sound->numRegions;
+		numJumps = sound->numJumps;
+		region = new Region[numRegions];
+		jump = new Jump[numJumps];
+		memcpy(region, sound->region, numRegions * sizeof(Region));
+		memcpy(jump, sound->jump, numJumps * sizeof(Jump));
+	}
+
+	uint16 freq;
+	byte channels;
+	byte bits;
+	int numRegions;
+	int numJumps;
+	Region *region;
+	Jump *jump;
+
+protected:
+	~CachedSound() {
+		delete[] region;
+		delete[] jump;
+	}
+};
+
+ImuseSndMgr::ImuseSndMgr(bool demo) : _cache(kCacheSize, kCacheClipLength) {
 	_demo = demo;
 	for (int l = 0; l < MAX_IMUSE_SOUNDS; l++) {
 		memset(&_sounds[l], 0, sizeof(SoundDesc));
@@ -39,6 +74,7 @@ ImuseSndMgr::ImuseSndMgr(bool demo) {
 
 ImuseSndMgr::~ImuseSndMgr() {
 	for (int l = 0; l < MAX_IMUSE_SOUNDS; l++) {
+		_sounds[l].refCount = 0;
 		closeSound(&_sounds[l]);
 	}
 }
@@ -160,9 +196,11 @@ void ImuseSndMgr::parseSoundHeader(SoundDesc *sound, int &headerSize) {
 }
 
 ImuseSndMgr::SoundDesc *ImuseSndMgr::allocSlot() {
+	Common::StackLock lock(_mutex);
 	for (int l = 0; l < MAX_IMUSE_SOUNDS; l++) {
 		if (!_sounds[l].inUse) {
 			_sounds[l].inUse = true;
+			_sounds[l].refCount = 1;
 			return &_sounds[l];
 		}
 	}
@@ -186,6 +224,10 @@ ImuseSndMgr::SoundDesc *ImuseSndMgr::openSound(const char *soundName, int volGro
 	sound->volGroupId = volGroupId;
 	sound->inStream = nullptr;
 
+	if (volGroupId == IMUSE_VOLGRP_SFX && openCachedSound(sound)) {
+		return sound;
+	}
+
 	sound->inStream = g_resourceloader->openNewStreamFile(soundName);
 	if (!sound->inStream) {
 		closeSound(sound);
@@ -209,12 +251,86 @@ ImuseSndMgr::SoundDesc *ImuseSndMgr::openSound(const char *soundName, int volGro
 		error("ImuseSndMgr::openSound() Unrecognized extension for sound file %s", soundName);
 	}
 
+	if (volGroupId == IMUSE_VOLGRP_SFX) {
+		cacheSound(sound);
+	}
+
 	return sound;
 }
 
+bool ImuseSndMgr::openCachedSound(SoundDesc *sound) {
+	CachedSound *cached = static_cast<CachedSound *>(_cache.get(sound->name));
+	if (!cached)
+		return false;
+
+	sound->freq = cached->freq;
+	sound->channels = cached->channels;
+	sound->bits = cached->bits;
+	sound->numRegions = cached->numRegions;
+	sound->numJumps = cached->numJumps;
+	sound->region = new Region[sound->numRegions];
+	sound->jump = new Jump[sound->numJumps];
+	memcpy(sound->region, cached->region, sound->numRegions * sizeof(Region));
+	memcpy(sound->jump, cached->jump, sound->numJumps * sizeof(Jump));
+	sound->clip = cached;
+
+	return true;
+}
+
+void ImuseSndMgr::cacheSound(SoundDesc *sound) {
+	// The mixer is always fed with 16-bit big endian samples
+	if (sound->bits != 16 || sound->freq == 0 || (sound->channels != 1 && sound->channels != 2))
+		return;
+
+	int32 size = 0;
+	for (int i = 0; i < sound->numRegions; i++) {
+		size = MAX(size, sound->region[i].offset + sound->region[i].length);
+	}
+
+	const int32 frameSize = 2 * sound->channels;
+	if (size <= 0 || !_cache.isCacheable((uint64)size * 1000 / (frameSize * sound->freq)))
+		return;
+
+	byte *data = nullptr;
+	int32 result;
+	if (sound->mcmpData) {
+		result = sound->mcmpMgr->decompressSample(0, size, &data);
+	} else {
+		data = static_cast<byte *>(malloc(size));
+		sound->inStream->seek(sound->headerSize, SEEK_SET);
+		result = sound->inStream->read(data, size);
+	}
+
+	if (result != size) {
+		warning("ImuseSndMgr::cacheSound() Failed to decode %s", sound->name);
+		free(data);
+		return;
+	}
+
+	const uint32 numSamples = size / frameSize * sound->channels;
+	int16 *samples = new int16[numSamples];
+	for (uint32 i = 0; i < numSamples; i++) {
+		samples[i] = READ_BE_INT16(data + i * 2);
+	}
+	free(data);
+
+	CachedSound *cached = new CachedSound(samples, numSamples, sound);
+	_cache.put(sound->name, cached);
+	sound->clip = cached;
+
+	// Everything is read from the cached samples from now on
+	delete sound->mcmpMgr;
+	sound->mcmpMgr = nullptr;
+	delete sound->inStream;
+	sound->inStream = nullptr;
+}
+
 void ImuseSndMgr::closeSound(SoundDesc *sound) {
 	assert(checkForProperHandle(sound));
 
+	if (--sound->refCount > 0)
+		return;
+
 	if (sound->mcmpMgr) {
 		delete sound->mcmpMgr;
 		sound->mcmpMgr = nullptr;
@@ -235,13 +351,21 @@ void ImuseSndMgr::closeSound(SoundDesc *sound) {
 		sound->inStream = nullptr;
 	}
 
+	if (sound->clip) {
+		sound->clip->decRef();
+		sound->clip = nullptr;
+	}
+
+	// Releases the slot
+	Common::StackLock lock(_mutex);
 	memset(sound, 0, sizeof(SoundDesc));
 }
 
 ImuseSndMgr::SoundDesc *ImuseSndMgr::cloneSound(SoundDesc *sound) {
 	assert(checkForProperHandle(sound));
 
-	return openSound(sound->name, sound->volGroupId);
+	sound->refCount++;
+	return sound;
 }
 
 bool ImuseSndMgr::checkForProperHandle(SoundDesc *sound) {
@@ -364,4 +488,39 @@ int32 ImuseSndMgr::getDataFromRegion(SoundDesc *sound, int region, byte **buf, i
 	return size;
 }
 
+int32 ImuseSndMgr::getSamplesFromRegion(SoundDesc *sound, int region, int16 *dest, int32 offset, int32 size) {
+	assert(checkForProperHandle(sound));
+	assert(dest && offset >= 0 && size >= 0);
+	assert(region >= 0 && region < sound->numRegions);
+
+	const int32 frameSize = 2 * sound->channels;
+
+	if (!sound->clip) {
+		byte *data;
+		size = getDataFromRegion(sound, region, &data, offset, size);
+		size -= size % frameSize;
+		for (int32 i = 0; i < size / 2; i++)
+			dest[i] = READ_BE_INT16(data + i * 2);
+		free(data);
+		return size;
+	}
+
+	int32 region_offset = sound->region[region].offset;
+	int32 region_length = sound->region[region].length;
+
+	if (offset + size > region_length) {
+		size = region_length - offset;
+		sound->endFlag = true;
+	} else {
+		sound->endFlag = false;
+	}
+
+	// Offsets are in bytes, while the clip counts samples
+	size -= size % frameSize;
+	uint32 start = (region_offset + offset) / frameSize * sound->channels;
+	memcpy(dest, sound->clip->getSamples() + start, size);
+
+	return size;
+}
+
 } // end of namespace Grim
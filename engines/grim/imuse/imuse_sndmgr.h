@@ -23,8 +23,11 @@
 #ifndef GRIM_IMUSE_SNDMGR_H
 #define GRIM_IMUSE_SNDMGR_H
 
+#include "common/mutex.h"
+
 #include "audio/mixer.h"
 #include "audio/audiostream.h"
+#include "audio/pcmcache.h"
 
 namespace Grim {
 
@@ -58,6 +61,8 @@ private:
 		int16 fadeDelay;    // fade delay in ms
 	};
 
+	class CachedSound;
+
 public:
 
 	struct SoundDesc {
@@ -70,6 +75,7 @@ public:
 		Jump *jump;
 		bool endFlag;
 		bool inUse;
+		int refCount;       // tracks sharing the sound
 		char name[32];
 		McmpMgr *mcmpMgr;
 		int type;
@@ -77,17 +83,29 @@ public:
 		bool mcmpData;
 		uint32 headerSize;
 		Common::SeekableReadStream *inStream;
+		Audio::PCMClip *clip; // decoded samples of a cached sound
 	};
 
 private:
 
+	// Short sound effects are kept decoded, as they are played over and over
+	enum {
+		kCacheSize = 4 * 1024 * 1024,
+		kCacheClipLength = 3000
+	};
+
 	SoundDesc _sounds[MAX_IMUSE_SOUNDS];
+	// Sounds are opened by the scripts and closed by the iMuse timer too
+	Common::Mutex _mutex;
 	bool _demo;
+	Audio::PCMCache _cache;
 
 	bool checkForProperHandle(SoundDesc *soundDesc);
 	SoundDesc *allocSlot();
 	void parseSoundHeader(SoundDesc *sound, int &headerSize);
 	void countElements(SoundDesc *sound);
+	bool openCachedSound(SoundDesc *sound);
+	void cacheSound(SoundDesc *sound);
 
 public:
 
@@ -96,6 +114,10 @@ public:
 
 	SoundDesc *openSound(const char *soundName, int volGroupId);
 	void closeSound(SoundDesc *sound);
+	/**
+	 * Shares the sound with another track, which reads it from its own
+	 * offsets. Each user has to close it.
+	 */
 	SoundDesc *cloneSound(SoundDesc *sound);
 
 	int getFreq(SoundDesc *sound);
@@ -112,6 +134,11 @@ public:
 	int getJumpFade(SoundDesc *sound, int number);
 
 	int32 getDataFromRegion(SoundDesc *sound, int region, byte **buf, int32 offset, int32 size);
+	/**
+	 * Like getDataFromRegion(), but copies whole frames of native endian
+	 * samples to dest, from the cache when the sound is cached.
+	 */
+	int32 getSamplesFromRegion(SoundDesc *sound, int region, int16 *dest, int32 offset, int32 size);
 };
 
 } // end of namespace Grim
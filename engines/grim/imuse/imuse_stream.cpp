@@ -0,0 +1,378 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/atomic.h"
+
+#include "engines/grim/imuse/imuse.h"
+#include "engines/grim/imuse/imuse_stream.h"
+
+namespace Grim {
+
+ImuseVoice::ImuseVoice(int channels, bool reverseStereo, uint32 startFrame) :
+		_channels(channels), _reverseStereo(reverseStereo), _startFrame(startFrame),
+		_written(0), _read(0), _endOfData(0), _finished(0), _numPosted(0),
+		_vol(0), _volFadeDest(0), _volFadeFrames(0), _pan(64000), _panFadeDest(0), _panFadeFrames(0),
+		_left(0), _right(0), _numApplied(0), _mixedVol(0), _mixedPan(64000), _mixedFades(0) {
+}
+
+uint32 ImuseVoice::getSpace() const {
+	return kBufferFrames - getBuffered();
+}
+
+uint32 ImuseVoice::getBuffered() const {
+	return _written - Common::atomicLoad(&_read);
+}
+
+void ImuseVoice::write(const int16 *samples, uint32 frames) {
+	assert(frames <= getSpace());
+
+	const uint32 pos = _written & (kBufferFrames - 1);
+	const uint32 first = MIN<uint32>(frames, kBufferFrames - pos);
+	memcpy(_samples + pos * _channels, samples, first * _channels * sizeof(int16));
+	memcpy(_samples, samples + first * _channels, (frames - first) * _channels * sizeof(int16));
+
+	// Publishes the samples to the mixer
+	Common::atomicStore(&_written, _written + frames);
+}
+
+void ImuseVoice::setEndOfData() {
+	Common::atomicStore(&_endOfData, 1);
+}
+
+bool ImuseVoice::isFinished() const {
+	return Common::atomicLoad(&_finished) != 0;
+}
+
+bool ImuseVoice::getMixedParams(int32 &vol, int32 &pan, bool &volFadeUsed, bool &panFadeUsed) const {
+	if (Common::atomicLoad(&_numApplied) != _numPosted)
+		return false;
+
+	vol = (int32)Common::atomicLoad(&_mixedVol);
+	pan = (int32)Common::atomicLoad(&_mixedPan);
+	const uint32 fades = Common::atomicLoad(&_mixedFades);
+	volFadeUsed = (fades & 1) != 0;
+	panFadeUsed = (fades & 2) != 0;
+	return true;
+}
+
+void ImuseVoice::setVolume(int32 vol) {
+	_vol = vol;
+	computeGains(_left, _right);
+}
+
+void ImuseVoice::setPan(int32 pan) {
+	_pan = pan;
+	computeGains(_left, _right);
+}
+
+void ImuseVoice::fadeVolume(int32 dest, int32 frames) {
+	_volFadeDest = dest;
+	_volFadeFrames = MAX<int32>(1, frames);
+}
+
+void ImuseVoice::fadePan(int32 dest, int32 frames) {
+	_panFadeDest = dest;
+	_panFadeFrames = MAX<int32>(1, frames);
+}
+
+void ImuseVoice::commandApplied(uint32 serial) {
+	// The parameters go first, so that they are up to date once the Imuse
+	// sees the command was applied
+	publishParams();
+	Common::atomicStore(&_numApplied, serial);
+}
+
+void ImuseVoice::publishParams() {
+	Common::atomicStore(&_mixedVol, (uint32)_vol);
+	Common::atomicStore(&_mixedPan, (uint32)_pan);
+	Common::atomicStore(&_mixedFades, (_volFadeFrames ? 1 : 0) | (_panFadeFrames ? 2 : 0));
+}
+
+bool ImuseVoice::isDecoding() const {
+	return !_finished && !Common::atomicLoad(&_endOfData);
+}
+
+uint32 ImuseVoice::getFramesReady() const {
+	return Common::atomicLoad(&_written) - _read;
+}
+
+void ImuseVoice::mix(int32 *mix, int frames) {
+	if (_finished)
+		return;
+
+	// Checked first, so that the samples written before the end are all seen
+	const bool endOfData = Common::atomicLoad(&_endOfData) != 0;
+	const uint32 read = _read;
+	const uint32 available = Common::atomicLoad(&_written) - read;
+	const uint32 count = MIN<uint32>(frames, available);
+
+	bool finished = false;
+	uint32 mixed = 0;
+	while (mixed < count) {
+		const uint32 pos = (read + mixed) & (kBufferFrames - 1);
+		// Blocks end where the buffer wraps and where the fades end
+		int block = MIN<uint32>(count - mixed, kBufferFrames - pos);
+		if (_volFadeFrames)
+			block = MIN(block, _volFadeFrames);
+		if (_panFadeFrames)
+			block = MIN(block, _panFadeFrames);
+
+		finished = mixSamples(mix + mixed * 2, _samples + pos * _channels, block);
+		mixed += block;
+		if (finished)
+			break;
+	}
+
+	Common::atomicStore(&_read, read + mixed);
+	if (finished || (endOfData && mixed == available))
+		Common::atomicStore(&_finished, 1);
+	publishParams();
+}
+
+bool ImuseVoice::mixSamples(int32 *mix, const int16 *samples, int frames) {
+	int32 left = _left;
+	int32 right = _right;
+
+	// The gains move linearly from where they were to where the fades
+	// are at the end of the block
+	const bool fadedOut = stepFades(frames);
+	computeGains(_left, _right);
+	const int32 leftStep = (_left - left) / frames;
+	const int32 rightStep = (_right - right) / frames;
+
+	for (int i = 0; i < frames; i++) {
+		int32 sampleL = samples[i * _channels];
+		int32 sampleR = samples[i * _channels + _channels - 1];
+		if (_reverseStereo)
+			SWAP(sampleL, sampleR);
+
+		mix[i * 2] += (sampleL * left) >> 16;
+		mix[i * 2 + 1] += (sampleR * right) >> 16;
+		left += leftStep;
+		right += rightStep;
+	}
+
+	return fadedOut;
+}
+
+bool ImuseVoice::stepFades(int frames) {
+	bool fadedOut = false;
+
+	if (_volFadeFrames) {
+		_vol += (int32)((int64)(_volFadeDest - _vol) * frames / _volFadeFrames);
+		_volFadeFrames -= frames;
+		if (_volFadeFrames == 0) {
+			_vol = _volFadeDest;
+			// Fade out complete -> remove this voice
+			fadedOut = _vol == 0;
+		}
+	}
+	if (_panFadeFrames) {
+		_pan += (int32)((int64)(_panFadeDest - _pan) * frames / _panFadeFrames);
+		_panFadeFrames -= frames;
+		if (_panFadeFrames == 0)
+			_pan = _panFadeDest;
+	}
+
+	return fadedOut;
+}
+
+// Gains are 16.16 fixed point. A track at full volume plays at 127 out of the
+// 255 of a mixer channel.
+void ImuseVoice::computeGains(int32 &left, int32 &right) const {
+	const int32 volume = (int32)((int64)_vol * 65536 / 255000);
+
+	// The pan goes from 0 (left) through 64 (center) to 127 (right)
+	int32 balance;
+	if (_pan < 64000)
+		balance = (_pan - 64000) * 127 / 64;
+	else
+		balance = (_pan - 64000) * 127 / 63;
+	balance = CLIP<int32>(balance, -127000, 127000);
+
+	left = (balance > 0) ? (int32)((int64)volume * (127000 - balance) / 127000) : volume;
+	right = (balance < 0) ? (int32)((int64)volume * (127000 + balance) / 127000) : volume;
+}
+
+ImuseStream::ImuseStream(const volatile uint32 *pause, int rate, Audio::Mixer::SoundType type) :
+		_pause(pause), _rate(rate), _type(type), _finished(0), _numVoices(0), _pos(0) {
+	for (int i = 0; i < kMaxVoices; i++)
+		_voices[i] = nullptr;
+}
+
+ImuseStream::~ImuseStream() {
+	// The mixer is done with the stream, so what's left is applied here
+	while (!_pendingCommands.empty() || !_commands.empty()) {
+		flushCommands();
+		applyCommands();
+	}
+	deleteRetiredVoices();
+
+	for (int i = 0; i < kMaxVoices; i++)
+		delete _voices[i];
+}
+
+int ImuseStream::readBuffer(int16 *buffer, const int numSamples) {
+	if (endOfData())
+		return 0;
+
+	applyCommands();
+
+	const int numFrames = numSamples / 2;
+	if (Common::atomicLoad(_pause)) {
+		memset(buffer, 0, numFrames * 2 * sizeof(int16));
+		return numFrames * 2;
+	}
+
+	int32 mix[kMixFrames * 2];
+	int32 offsets[kMaxVoices];
+	int frames = 0;
+	while (frames < numFrames) {
+		int chunk = MIN<int>(numFrames - frames, kMixFrames);
+
+		for (int i = 0; i < kMaxVoices; i++) {
+			if (!_voices[i])
+				continue;
+
+			// The fade out copy of a track starts where the track jumped
+			// to another region
+			offsets[i] = MAX<int32>(0, (int32)(_voices[i]->_startFrame - _pos));
+			// Nothing to wait for once no more samples are coming
+			if (offsets[i] < chunk && _voices[i]->isDecoding())
+				chunk = MIN<int32>(chunk, offsets[i] + (int32)_voices[i]->getFramesReady());
+		}
+		// Waits for the samples the Imuse didn't decode yet
+		if (chunk == 0)
+			break;
+
+		memset(mix, 0, chunk * 2 * sizeof(int32));
+		for (int i = 0; i < kMaxVoices; i++) {
+			if (_voices[i] && offsets[i] < chunk)
+				_voices[i]->mix(mix + offsets[i] * 2, chunk - offsets[i]);
+		}
+
+		int16 *dest = buffer + frames * 2;
+		for (int i = 0; i < chunk * 2; i++)
+			dest[i] = CLIP<int32>(mix[i], -32768, 32767);
+
+		frames += chunk;
+		_pos += chunk;
+	}
+
+	memset(buffer + frames * 2, 0, (numFrames - frames) * 2 * sizeof(int16));
+	return numFrames * 2;
+}
+
+bool ImuseStream::endOfData() const {
+	return Common::atomicLoad(&_finished) != 0;
+}
+
+void ImuseStream::finish() {
+	Common::atomicStore(&_finished, 1);
+}
+
+void ImuseStream::postCommand(CommandType type, ImuseVoice *voice, int32 value, int32 frames) {
+	Command command;
+	command.type = type;
+	command.voice = voice;
+	command.value = value;
+	command.frames = frames;
+	command.serial = ++voice->_numPosted;
+
+	if (type == kCommandAddVoice)
+		_numVoices++;
+	else if (type == kCommandRemoveVoice)
+		_numVoices--;
+
+	_pendingCommands.push(command);
+	flushCommands();
+}
+
+void ImuseStream::flushCommands() {
+	deleteRetiredVoices();
+
+	// The queue only fills up when the mixer doesn't read the stream for a
+	// while, e.g. before it's played. Nothing waits for it.
+	while (!_pendingCommands.empty() && _commands.push(_pendingCommands.front()))
+		_pendingCommands.pop();
+}
+
+void ImuseStream::applyCommands() {
+	Command command;
+	while (_commands.pop(command)) {
+		ImuseVoice *voice = command.voice;
+
+		switch (command.type) {
+		case kCommandAddVoice: {
+			int i = 0;
+			while (i < kMaxVoices && _voices[i])
+				i++;
+			if (i < kMaxVoices) {
+				_voices[i] = voice;
+			} else {
+				// The Imuse checks hasFreeVoice() first. Should it not, the
+				// voice is finished right away, so that its track is flushed
+				// and the voice retired.
+				Common::atomicStore(&voice->_finished, 1);
+			}
+			break;
+		}
+		case kCommandRemoveVoice:
+			for (int i = 0; i < kMaxVoices; i++) {
+				if (_voices[i] == voice)
+					_voices[i] = nullptr;
+			}
+			break;
+		case kCommandSetVolume:
+			voice->setVolume(command.value);
+			break;
+		case kCommandSetPan:
+			voice->setPan(command.value);
+			break;
+		case kCommandFadeVolume:
+			voice->fadeVolume(command.value, command.frames);
+			break;
+		case kCommandFadePan:
+			voice->fadePan(command.value, command.frames);
+			break;
+		}
+
+		voice->commandApplied(command.serial);
+		// The Imuse may delete the voice as soon as it's retired
+		if (command.type == kCommandRemoveVoice)
+			retireVoice(voice);
+	}
+}
+
+void ImuseStream::retireVoice(ImuseVoice *voice) {
+	// Can't fail as long as the Imuse empties the queue before posting commands
+	if (!_retiredVoices.push(voice))
+		delete voice;
+}
+
+void ImuseStream::deleteRetiredVoices() {
+	ImuseVoice *voice;
+	while (_retiredVoices.pop(voice))
+		delete voice;
+}
+
+} // end of namespace Grim
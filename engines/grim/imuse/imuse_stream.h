@@ -0,0 +1,217 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef GRIM_IMUSE_STREAM_H
+#define GRIM_IMUSE_STREAM_H
+
+#include "common/lockfreequeue.h"
+#include "common/queue.h"
+
+#include "audio/audiostream.h"
+#include "audio/mixer.h"
+
+namespace Grim {
+
+/**
+ * The samples of a track, decoded ahead of the mixer by the Imuse, along
+ * with the volume and the pan the mixer plays them at.
+ *
+ * Only the Imuse writes the samples and only the mixer reads them, so
+ * neither ever waits for the other. The volume and the pan are changed
+ * through the commands of the stream mixing the voice.
+ */
+class ImuseVoice {
+public:
+	enum {
+		kBufferFrames = 8192 // must be a power of two
+	};
+
+	/**
+	 * @param startFrame the frame of the stream the voice starts at
+	 */
+	ImuseVoice(int channels, bool reverseStereo, uint32 startFrame);
+
+	// Called by the Imuse
+
+	/** The number of frames which can be written */
+	uint32 getSpace() const;
+	/** The number of frames written, which the mixer didn't read yet */
+	uint32 getBuffered() const;
+	void write(const int16 *samples, uint32 frames);
+	/** No more samples will be written, the voice finishes once they are mixed. */
+	void setEndOfData();
+	bool isEndOfData() const { return _endOfData != 0; }
+	/** Whether the voice was mixed to its end, or faded out. */
+	bool isFinished() const;
+	/** The frame of the stream right after the last one written */
+	uint32 getEndFrame() const { return _startFrame + _written; }
+
+	/**
+	 * Gets the volume and the pan as the mixer last left them, once it
+	 * applied every command posted for the voice.
+	 *
+	 * @return false if some commands weren't applied yet
+	 */
+	bool getMixedParams(int32 &vol, int32 &pan, bool &volFadeUsed, bool &panFadeUsed) const;
+
+private:
+	friend class ImuseStream;
+
+	// Called by the mixer
+
+	void setVolume(int32 vol);
+	void setPan(int32 pan);
+	void fadeVolume(int32 dest, int32 frames);
+	void fadePan(int32 dest, int32 frames);
+	void commandApplied(uint32 serial);
+	void publishParams();
+	bool isDecoding() const;
+	uint32 getFramesReady() const;
+	void mix(int32 *mix, int frames);
+	bool mixSamples(int32 *mix, const int16 *samples, int frames);
+	bool stepFades(int frames);
+	void computeGains(int32 &left, int32 &right) const;
+
+	int16 _samples[kBufferFrames * 2];
+	const int _channels;
+	const bool _reverseStereo;
+	const uint32 _startFrame;
+
+	/** Frames written so far, only written by the Imuse */
+	volatile uint32 _written;
+	/** Frames read so far, only written by the mixer */
+	volatile uint32 _read;
+	volatile uint32 _endOfData;
+	volatile uint32 _finished;
+
+	/** Commands posted for the voice so far, only used by the Imuse */
+	uint32 _numPosted;
+
+	// The volume and the pan, only used by the mixer. They use the units of
+	// Track: both are multiplied by 1000.
+	int32 _vol, _volFadeDest, _volFadeFrames;
+	int32 _pan, _panFadeDest, _panFadeFrames;
+	int32 _left, _right;
+
+	// What the mixer publishes of them, for the Imuse
+	volatile uint32 _numApplied;
+	volatile uint32 _mixedVol;
+	volatile uint32 _mixedPan;
+	volatile uint32 _mixedFades;
+};
+
+/**
+ * The stream the mixer pulls the samples of an iMuse track from. It mixes
+ * the voice of the track along with the voice of its fade out copy, when
+ * the track jumps to another region, each starting at its own frame.
+ *
+ * The Imuse posts commands to the stream to add and remove voices and to
+ * change their volume and pan, which the stream applies before mixing. The
+ * volume and the pan are moved once per block of samples, and fades start
+ * and end exactly on the frame they should. A voice which runs out of
+ * samples holds the whole stream back, so that the voices stay in step.
+ *
+ * The stream is owned by the Imuse, which deletes it once it finished.
+ * Everything but readBuffer() must be called under the lock of the Imuse.
+ */
+class ImuseStream : public Audio::AudioStream {
+public:
+	enum CommandType {
+		kCommandAddVoice,
+		kCommandRemoveVoice,
+		kCommandSetVolume,
+		kCommandSetPan,
+		kCommandFadeVolume,
+		kCommandFadePan
+	};
+
+	/**
+	 * @param pause the pause flag of the Imuse, which the mixer polls
+	 */
+	ImuseStream(const volatile uint32 *pause, int rate, Audio::Mixer::SoundType type);
+	~ImuseStream();
+
+	int readBuffer(int16 *buffer, const int numSamples);
+	bool isStereo() const { return true; }
+	int getRate() const { return _rate; }
+	bool endOfData() const;
+
+	/**
+	 * Posts a command, which the mixer applies before its next read.
+	 *
+	 * @param value  the volume, the pan, or the destination of the fade
+	 * @param frames the length of the fade
+	 */
+	void postCommand(CommandType type, ImuseVoice *voice, int32 value = 0, int32 frames = 0);
+	/** Posts the commands the queue had no room for yet. */
+	void flushCommands();
+	/** Whether one more voice can be added to the stream. */
+	bool hasFreeVoice() const { return _numVoices < kMaxVoices; }
+
+	/** Called once no track is mixed by the stream anymore. */
+	void finish();
+
+	Audio::Mixer::SoundType getType() const { return _type; }
+	Audio::SoundHandle &getHandle() { return _handle; }
+
+private:
+	enum {
+		kNumCommands = 64,
+		kMaxVoices = 4,
+		// Voices are mixed in chunks of this many frames, to bound the buffers
+		kMixFrames = 512
+	};
+
+	struct Command {
+		CommandType type;
+		ImuseVoice *voice;
+		int32 value;
+		int32 frames;
+		uint32 serial;
+	};
+
+	void applyCommands();
+	void retireVoice(ImuseVoice *voice);
+	void deleteRetiredVoices();
+
+	const volatile uint32 *_pause;
+	int _rate;
+	Audio::Mixer::SoundType _type;
+	uint32 _finished;
+	Audio::SoundHandle _handle;
+
+	Common::LockFreeQueue<Command, kNumCommands> _commands;
+	/** Commands which didn't fit in the queue, only used by the Imuse */
+	Common::Queue<Command> _pendingCommands;
+	/** Voices added and not removed yet, only used by the Imuse */
+	int _numVoices;
+	/** Removed voices, handed back to the Imuse to be deleted */
+	Common::LockFreeQueue<ImuseVoice *, kNumCommands> _retiredVoices;
+
+	// Only used by the mixer
+	ImuseVoice *_voices[kMaxVoices];
+	uint32 _pos;
+};
+
+} // end of namespace Grim
+
+#endif
@@ -25,6 +25,7 @@
 #include "engines/grim/debug.h"
 
 #include "engines/grim/imuse/imuse.h"
+#include "engines/grim/imuse/imuse_stream.h"
 
 namespace Grim {
 
@@ -54,11 +55,8 @@ int Imuse::allocSlot(int priority) {
 			assert(trackId != -1);
 			Track *track = _track[trackId];
 
-			// Stop the track immediately
-			g_system->getMixer()->stopHandle(track->handle);
-			if (track->soundDesc) {
-				_sound->closeSound(track->soundDesc);
-			}
+			// Stop the track immediately, its stream ends with it
+			flushTrack(track);
 
 			// Mark it as unused
 			memset(track, 0, sizeof(Track));
@@ -71,45 +69,60 @@ int Imuse::allocSlot(int priority) {
 }
 
 bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int volume, int pan, int priority, Track *otherTrack) {
-	Common::StackLock lock(_mutex);
-	Track *track = nullptr;
+	bool started = startTrack(soundName, volGroupId, hookId, volume, pan, priority, otherTrack);
+	playNewStreams();
+	return started;
+}
+
+bool Imuse::startTrack(const char *soundName, int volGroupId, int hookId, int volume, int pan, int priority, Track *otherTrack) {
 	int i;
 
-	// If the track is fading out bring it back to the normal running tracks
-	for (i = MAX_IMUSE_TRACKS; i < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; i++) {
-		if (!scumm_stricmp(_track[i]->soundName, soundName) && !_track[i]->toBeRemoved) {
+	{
+		Common::StackLock lock(_mutex);
 
-			Track *fadeTrack = _track[i];
-			track = _track[i - MAX_IMUSE_TRACKS];
+		// If the track is fading out bring it back to the normal running tracks
+		for (i = MAX_IMUSE_TRACKS; i < MAX_IMUSE_TRACKS + MAX_IMUSE_FADETRACKS; i++) {
+			if (!scumm_stricmp(_track[i]->soundName, soundName) && !_track[i]->toBeRemoved) {
 
-			if (track->used) {
-				flushTrack(track);
-				g_system->getMixer()->stopHandle(track->handle);
-			}
+				Track *fadeTrack = _track[i];
+				Track *track = _track[i - MAX_IMUSE_TRACKS];
+
+				if (track->used)
+					flushTrack(track);
 
-			// Clone the settings of the given track
-			memcpy(track, fadeTrack, sizeof(Track));
-			track->trackId = i - MAX_IMUSE_TRACKS;
-			// Reset the track
-			memset(fadeTrack, 0, sizeof(Track));
-			// Mark as used for now so the track won't be reused again this frame
-			track->used = true;
+				// Clone the settings of the given track, it goes on in the same stream
+				memcpy(track, fadeTrack, sizeof(Track));
+				track->trackId = i - MAX_IMUSE_TRACKS;
+				// Reset the track
+				memset(fadeTrack, 0, sizeof(Track));
+				// Mark as used for now so the track won't be reused again this frame
+				track->used = true;
 
-			return true;
+				return true;
+			}
 		}
-	}
 
-	// If the track is already playing then there is absolutely no
-	// reason to start it again, the existing track should be modified
-	// instead of starting a new copy of the track
-	for (i = 0; i < MAX_IMUSE_TRACKS; i++) {
-		// Filenames are case insensitive, see findTrack
-		if (!scumm_stricmp(_track[i]->soundName, soundName)) {
-			Debug::debug(Debug::Sound, "Imuse::startSound(): Track '%s' already playing.", soundName);
-			return true;
+		// If the track is already playing then there is absolutely no
+		// reason to start it again, the existing track should be modified
+		// instead of starting a new copy of the track
+		for (i = 0; i < MAX_IMUSE_TRACKS; i++) {
+			// Filenames are case insensitive, see findTrack
+			if (!scumm_stricmp(_track[i]->soundName, soundName)) {
+				Debug::debug(Debug::Sound, "Imuse::startSound(): Track '%s' already playing.", soundName);
+				return true;
+			}
 		}
 	}
 
+	// Opening the sound reads its file, so it's done without the lock, and
+	// the tracks playing keep being decoded meanwhile. Only this thread
+	// starts tracks, so none can show up in between.
+	ImuseSndMgr::SoundDesc *soundDesc = _sound->openSound(soundName, volGroupId);
+	if (!soundDesc)
+		return false;
+
+	Common::StackLock lock(_mutex);
+
 	// Priority Level 127 appears to mean "load but don't play", so
 	// within our paradigm this is a much lower priority than everything
 	// else we're doing
@@ -119,10 +132,11 @@ bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int vo
 	int l = allocSlot(priority);
 	if (l == -1) {
 		warning("Imuse::startSound() Can't start sound - no free slots");
+		_sound->closeSound(soundDesc);
 		return false;
 	}
 
-	track = _track[l];
+	Track *track = _track[l];
 	// Reset the track
 	memset(track, 0, sizeof(Track));
 
@@ -137,10 +151,7 @@ bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int vo
 	int bits = 0, freq = 0, channels = 0;
 
 	strcpy(track->soundName, soundName);
-	track->soundDesc = _sound->openSound(soundName, volGroupId);
-
-	if (!track->soundDesc)
-		return false;
+	track->soundDesc = soundDesc;
 
 	bits = _sound->getBits(track->soundDesc);
 	channels = _sound->getChannels(track->soundDesc);
@@ -161,10 +172,7 @@ bool Imuse::startSound(const char *soundName, int volGroupId, int hookId, int vo
 		track->regionOffset = otherTrack->regionOffset;
 	}
 
-	track->stream = Audio::makeQueuingAudioStream(freq, track->mixerFlags & kFlagStereo);
-	g_system->getMixer()->playStream(track->getType(), &track->handle, track->stream, -1,
-											track->getVol(), track->getPan(), DisposeAfterUse::YES,
-											false, (track->mixerFlags & kFlagReverseStereo) != 0);
+	createStream(track);
 	track->used = true;
 
 	return true;
@@ -209,6 +217,8 @@ void Imuse::setVolume(const char *soundName, int volume) {
 		return;
 	}
 	changeTrack->vol = volume * 1000;
+	if (changeTrack->stream)
+		changeTrack->stream->postCommand(ImuseStream::kCommandSetVolume, changeTrack->voice, changeTrack->vol);
 }
 
 void Imuse::setPan(const char *soundName, int pan) {
@@ -221,6 +231,8 @@ void Imuse::setPan(const char *soundName, int pan) {
 		return;
 	}
 	changeTrack->pan = pan * 1000;
+	if (changeTrack->stream)
+		changeTrack->stream->postCommand(ImuseStream::kCommandSetPan, changeTrack->voice, changeTrack->pan);
 }
 
 int Imuse::getVolume(const char *soundName) {
@@ -288,8 +300,9 @@ void Imuse::setFadeVolume(const char *soundName, int destVolume, int duration) {
 	}
 	changeTrack->volFadeDelay = duration;
 	changeTrack->volFadeDest = destVolume * 1000;
-	changeTrack->volFadeStep = (changeTrack->volFadeDest - changeTrack->vol) * 60 * (1000 / _callbackFps) / (1000 * duration);
 	changeTrack->volFadeUsed = true;
+	if (changeTrack->stream)
+		changeTrack->stream->postCommand(ImuseStream::kCommandFadeVolume, changeTrack->voice, changeTrack->volFadeDest, getFadeSamples(changeTrack, duration));
 }
 
 void Imuse::setFadePan(const char *soundName, int destPan, int duration) {
@@ -303,8 +316,9 @@ void Imuse::setFadePan(const char *soundName, int destPan, int duration) {
 	}
 	changeTrack->panFadeDelay = duration;
 	changeTrack->panFadeDest = destPan * 1000;
-	changeTrack->panFadeStep = (changeTrack->panFadeDest - changeTrack->pan) * 60 * (1000 / _callbackFps) / (1000 * duration);
 	changeTrack->panFadeUsed = true;
+	if (changeTrack->stream)
+		changeTrack->stream->postCommand(ImuseStream::kCommandFadePan, changeTrack->voice, changeTrack->panFadeDest, getFadeSamples(changeTrack, duration));
 }
 
 char *Imuse::getCurMusicSoundName() {
@@ -352,16 +366,26 @@ void Imuse::fadeOutMusic(int duration) {
 }
 
 void Imuse::fadeOutMusicAndStartNew(int fadeDelay, const char *filename, int hookId, int vol, int pan) {
-	Common::StackLock lock(_mutex);
-
-	for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
-		Track *track = _track[l];
-		if (track->used && !track->toBeRemoved && (track->volGroupId == IMUSE_VOLGRP_MUSIC)) {
-			startMusicWithOtherPos(filename, 0, vol, pan, track);
-			moveToFadeOutTrack(track, fadeDelay);
-			break;
+	Track *track = nullptr;
+	{
+		Common::StackLock lock(_mutex);
+		for (int l = 0; l < MAX_IMUSE_TRACKS; l++) {
+			if (_track[l]->used && !_track[l]->toBeRemoved && (_track[l]->volGroupId == IMUSE_VOLGRP_MUSIC)) {
+				track = _track[l];
+				break;
+			}
 		}
 	}
+
+	if (!track)
+		return;
+
+	// Starting the music plays its stream, which can't be done under the lock
+	startMusicWithOtherPos(filename, 0, vol, pan, track);
+
+	Common::StackLock lock(_mutex);
+	if (track->used && !track->toBeRemoved)
+		moveToFadeOutTrack(track, fadeDelay);
 }
 
 Track *Imuse::cloneToFadeOutTrack(Track *track, int fadeDelay) {
@@ -376,9 +400,12 @@ Track *Imuse::cloneToFadeOutTrack(Track *track, int fadeDelay) {
 	assert(track->trackId < MAX_IMUSE_TRACKS);
 	fadeTrack = _track[track->trackId + MAX_IMUSE_TRACKS];
 
-	if (fadeTrack->used) {
+	if (fadeTrack->used)
 		flushTrack(fadeTrack);
-		g_system->getMixer()->stopHandle(fadeTrack->handle);
+
+	if (!track->stream->hasFreeVoice()) {
+		warning("cloneToFadeOutTrack: No voice left in the stream of %s, not fading it out", track->soundName);
+		return nullptr;
 	}
 
 	// Clone the settings of the given track
@@ -387,21 +414,18 @@ Track *Imuse::cloneToFadeOutTrack(Track *track, int fadeDelay) {
 
 	// Clone the sound.
 	// leaving bug number for now #1635361
-	ImuseSndMgr::SoundDesc *soundDesc = _sound->cloneSound(track->soundDesc);
-	assert(soundDesc);
-	track->soundDesc = soundDesc;
+	fadeTrack->soundDesc = _sound->cloneSound(track->soundDesc);
+	assert(fadeTrack->soundDesc);
+
+	// The stream of the track mixes the copy from where the track was decoded to
+	createVoice(fadeTrack, track->voice->getEndFrame());
 
 	// Set the volume fading parameters to indicate a fade out
 	fadeTrack->volFadeDelay = fadeDelay;
 	fadeTrack->volFadeDest = 0;
-	fadeTrack->volFadeStep = (fadeTrack->volFadeDest - fadeTrack->vol) * 60 * (1000 / _callbackFps) / (1000 * fadeDelay);
 	fadeTrack->volFadeUsed = true;
+	fadeTrack->stream->postCommand(ImuseStream::kCommandFadeVolume, fadeTrack->voice, 0, getFadeSamples(fadeTrack, fadeDelay));
 
-	// Create an appendable output buffer
-	fadeTrack->stream = Audio::makeQueuingAudioStream(_sound->getFreq(fadeTrack->soundDesc), track->mixerFlags & kFlagStereo);
-	g_system->getMixer()->playStream(track->getType(), &fadeTrack->handle, fadeTrack->stream, -1, fadeTrack->getVol(),
-											fadeTrack->getPan(), DisposeAfterUse::YES, false,
-											(track->mixerFlags & kFlagReverseStereo) != 0);
 	fadeTrack->used = true;
 
 	return fadeTrack;
@@ -433,10 +457,8 @@ Track *Imuse::moveToFadeOutTrack(Track *track, int fadeDelay) {
 	assert(track->trackId < MAX_IMUSE_TRACKS);
 	fadeTrack = _track[track->trackId + MAX_IMUSE_TRACKS];
 
-	if (fadeTrack->used) {
+	if (fadeTrack->used)
 		flushTrack(fadeTrack);
-		g_system->getMixer()->stopHandle(fadeTrack->handle);
-	}
 
 	// Clone the settings of the given track
 	memcpy(fadeTrack, track, sizeof(Track));
@@ -451,8 +473,9 @@ Track *Imuse::moveToFadeOutTrack(Track *track, int fadeDelay) {
 	// Set the volume fading parameters to indicate a fade out
 	fadeTrack->volFadeDelay = fadeDelay;
 	fadeTrack->volFadeDest = 0;
-	fadeTrack->volFadeStep = (fadeTrack->volFadeDest - fadeTrack->vol) * 60 * (1000 / _callbackFps) / (1000 * fadeDelay);
 	fadeTrack->volFadeUsed = true;
+	if (fadeTrack->stream)
+		fadeTrack->stream->postCommand(ImuseStream::kCommandFadeVolume, fadeTrack->voice, 0, getFadeSamples(fadeTrack, fadeDelay));
 
 	fadeTrack->used = true;
 
@@ -27,6 +27,9 @@
 
 namespace Grim {
 
+class ImuseStream;
+class ImuseVoice;
+
 enum {
 	kFlagUnsigned = 1 << 0,
 	kFlag16Bits = 1 << 1,
@@ -40,12 +43,10 @@ struct Track {
 
 	int32 pan;
 	int32 panFadeDest;
-	int32 panFadeStep;
 	int32 panFadeDelay;
 	bool panFadeUsed;
 	int32 vol;
 	int32 volFadeDest;
-	int32 volFadeStep;
 	int32 volFadeDelay;
 	bool volFadeUsed;
 
@@ -62,16 +63,14 @@ struct Track {
 	int32 mixerFlags;
 
 	ImuseSndMgr::SoundDesc *soundDesc;
-	Audio::SoundHandle handle;
-	Audio::QueuingAudioStream *stream;
+	ImuseStream *stream; // the stream mixing the track, shared with its fade out copies
+	ImuseVoice *voice;   // the samples decoded ahead, which the stream mixes
 
-	Track() : used(false), stream(NULL) {
+	Track() : used(false), stream(NULL), voice(NULL) {
 		soundName[0] = 0;
 	}
 
-	/* getPan() returns -127 ... 127 */
-	int getPan() const { return (pan != 64000) ? 2 * (pan / 1000) - 127 : 0; }
-	int getVol() const { return vol / 1000; }
+	int getFreq() const { return feedSize / ((mixerFlags & kFlagStereo) ? 4 : 2); }
 	Audio::Mixer::SoundType getType() const {
 		Audio::Mixer::SoundType type = Audio::Mixer::kPlainSoundType;
 		if (volGroupId == IMUSE_VOLGRP_VOICE)
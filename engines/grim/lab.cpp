@@ -20,7 +20,9 @@
  *
  */
 
+#include "common/archiveindex.h"
 #include "common/file.h"
+#include "common/filemapping.h"
 #include "common/substream.h"
 #include "common/memstream.h"
 
@@ -29,48 +31,110 @@
 
 namespace Grim {
 
+/** Identifies the layout of the LAB directories in the archive index cache */
+static const char *const kLabIndexType = "grim-lab-1";
+
 LabEntry::LabEntry(const Common::String &name, uint32 offset, uint32 len, Lab *parent) :
 		_offset(offset), _len(len), _parent(parent), _name(name) {
 	_name.toLowercase();
 }
 
 Common::SeekableReadStream *LabEntry::createReadStream() const {
-	return _parent->createReadStreamForMember(_name);
+	return _parent->createReadStreamForEntry(*this);
 }
 
 Lab::Lab() {
 	_stream = nullptr;
+	_mapping = nullptr;
 }
 
 Lab::~Lab() {
 	delete _stream;
+	if (_mapping)
+		_mapping->decRef();
 }
 
 bool Lab::open(const Common::String &filename, bool keepStream) {
 	_labFileName = filename;
 
-	bool result = true;
+	// The directory of an archive which didn't change since the last
+	// run is read from the index cache, without opening the archive
+	if (!loadIndex()) {
+		Common::File *file = new Common::File();
+		if (!file->open(filename) || file->readUint32BE() != MKTAG('L','A','B','N')) {
+			delete file;
+			return false;
+		}
 
-	Common::File *file = new Common::File();
-	if (!file->open(filename) || file->readUint32BE() != MKTAG('L','A','B','N')) {
-		result = false;
-	} else {
 		file->readUint32LE(); // version
 
 		if (g_grim->getGameType() == GType_GRIM)
 			parseGrimFileTable(file);
 		else
 			parseMonkey4FileTable(file);
+		delete file;
+
+		saveIndex();
+	}
+	buildMemberIndex();
+
+	// Entries are read straight from the mapping when the backend can map
+	// the archive. Otherwise either keep a copy of it, or open it again for
+	// every entry.
+	_mapping = Common::mapFile(filename);
+	if (keepStream && !_mapping) {
+		Common::File *file = new Common::File();
+		if (file->open(filename)) {
+			byte *data = static_cast<byte*>(malloc(sizeof(byte) * file->size()));
+			file->read(data, file->size());
+			_stream = new Common::MemoryReadStream(data, file->size(), DisposeAfterUse::YES);
+		}
+		delete file;
+	}
+
+	return true;
+}
+
+bool Lab::loadIndex() {
+	Common::SeekableReadStream *index = ArchiveIndexMan.getIndex(kLabIndexType, _labFileName);
+	if (!index)
+		return false;
+
+	uint32 entryCount = index->readUint32LE();
+	for (uint32 i = 0; i < entryCount && !index->eos(); i++) {
+		Common::String fname = Common::ArchiveIndexCache::readString(*index);
+		uint32 start = index->readUint32LE();
+		uint32 size = index->readUint32LE();
+
+		_entries.push_back(LabEntryPtr(new LabEntry(fname, start, size, this)));
 	}
-	if (result && keepStream) {
-		file->seek(0, SEEK_SET);
-		byte *data = static_cast<byte*>(malloc(sizeof(byte) * file->size()));
-		file->read(data, file->size());
-		_stream = new Common::MemoryReadStream(data, file->size(), DisposeAfterUse::YES);
+
+	bool valid = !index->eos();
+	delete index;
+	if (!valid)
+		_entries.clear();
+	return valid;
+}
+
+void Lab::saveIndex() const {
+	Common::MemoryWriteStreamDynamic index(DisposeAfterUse::YES);
+	index.writeUint32LE(_entries.size());
+	for (uint i = 0; i < _entries.size(); i++) {
+		Common::ArchiveIndexCache::writeString(index, _entries[i]->_name);
+		index.writeUint32LE(_entries[i]->_offset);
+		index.writeUint32LE(_entries[i]->_len);
 	}
-	delete file;
 
-	return result;
+	ArchiveIndexMan.putIndex(kLabIndexType, _labFileName, index);
+}
+
+void Lab::buildMemberIndex() {
+	Common::Array<Common::String> names;
+	names.reserve(_entries.size());
+	for (uint i = 0; i < _entries.size(); i++)
+		names.push_back(_entries[i]->_name);
+
+	_memberIndex.build(names);
 }
 
 void Lab::parseGrimFileTable(Common::File *file) {
@@ -97,7 +161,7 @@ void Lab::parseGrimFileTable(Common::File *file) {
 			error("File \"%s\" past the end of lab \"%s\". Your game files may be corrupt.", fname.c_str(), _labFileName.c_str());
 
 		LabEntry *entry = new LabEntry(fname, start, size, this);
-		_entries[fname] = LabEntryPtr(entry);
+		_entries.push_back(LabEntryPtr(entry));
 	}
 
 	delete[] stringTable;
@@ -140,23 +204,21 @@ void Lab::parseMonkey4FileTable(Common::File *file) {
 			error("File \"%s\" past the end of lab \"%s\". Your game files may be corrupt.", fname.c_str(), _labFileName.c_str());
 
 		LabEntry *entry = new LabEntry(fname, start, size, this);
-		_entries[fname] = LabEntryPtr(entry);
+		_entries.push_back(LabEntryPtr(entry));
 	}
 
 	delete[] stringTable;
 }
 
 bool Lab::hasFile(const Common::String &filename) const {
-	Common::String fname(filename);
-	fname.toLowercase();
-	return _entries.contains(fname);
+	return _memberIndex.find(filename) != Common::MemberIndex::kNoMember;
 }
 
 int Lab::listMembers(Common::ArchiveMemberList &list) const {
 	int count = 0;
 
-	for (LabMap::const_iterator i = _entries.begin(); i != _entries.end(); ++i) {
-		list.push_back(Common::ArchiveMemberList::value_type(i->_value));
+	for (uint i = 0; i < _entries.size(); i++) {
+		list.push_back(Common::ArchiveMemberList::value_type(_entries[i]));
 		++count;
 	}
 
@@ -164,31 +226,33 @@ int Lab::listMembers(Common::ArchiveMemberList &list) const {
 }
 
 const Common::ArchiveMemberPtr Lab::getMember(const Common::String &name) const {
-	if (!hasFile(name))
+	int entry = _memberIndex.find(name);
+	if (entry == Common::MemberIndex::kNoMember)
 		return Common::ArchiveMemberPtr();
 
-	Common::String fname(name);
-	fname.toLowercase();
-	return _entries[fname];
+	return _entries[entry];
 }
 
 Common::SeekableReadStream *Lab::createReadStreamForMember(const Common::String &filename) const {
-	if (!hasFile(filename))
+	int entry = _memberIndex.find(filename);
+	if (entry == Common::MemberIndex::kNoMember)
 		return nullptr;
 
-	Common::String fname(filename);
-	fname.toLowercase();
-	LabEntryPtr i = _entries[fname];
+	return createReadStreamForEntry(*_entries[entry]);
+}
 
-	if (!_stream) {
+Common::SeekableReadStream *Lab::createReadStreamForEntry(const LabEntry &entry) const {
+	if (_mapping) {
+		return new Common::MappedReadStream(_mapping, entry._offset, entry._len);
+	} else if (!_stream) {
 		Common::File *file = new Common::File();
 		file->open(_labFileName);
-		return new Common::SeekableSubReadStream(file, i->_offset, i->_offset + i->_len, DisposeAfterUse::YES);
+		return new Common::SeekableSubReadStream(file, entry._offset, entry._offset + entry._len, DisposeAfterUse::YES);
 	} else {
-		byte *data = static_cast<byte*>(malloc(sizeof(byte) * i->_len));
-		_stream->seek(i->_offset, SEEK_SET);
-		_stream->read(data, i->_len);
-		return new Common::MemoryReadStream(data, i->_len, DisposeAfterUse::YES);
+		byte *data = static_cast<byte*>(malloc(sizeof(byte) * entry._len));
+		_stream->seek(entry._offset, SEEK_SET);
+		_stream->read(data, entry._len);
+		return new Common::MemoryReadStream(data, entry._len, DisposeAfterUse::YES);
 	}
 }
 
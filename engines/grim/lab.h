@@ -24,9 +24,11 @@
 #define GRIM_LAB_H
 
 #include "common/archive.h"
+#include "common/memberindex.h"
 
 namespace Common {
 	class File;
+	class FileMapping;
 }
 
 namespace Grim {
@@ -58,12 +60,22 @@ public:
 private:
 	void parseGrimFileTable(Common::File *_f);
 	void parseMonkey4FileTable(Common::File *_f);
+	Common::SeekableReadStream *createReadStreamForEntry(const LabEntry &entry) const;
+	bool loadIndex();
+	void saveIndex() const;
+	void buildMemberIndex();
 
 	Common::String _labFileName;
 	typedef Common::SharedPtr<LabEntry> LabEntryPtr;
-	typedef Common::HashMap<Common::String, LabEntryPtr, Common::IgnoreCase_Hash, Common::IgnoreCase_EqualTo> LabMap;
-	LabMap _entries;
+	/** The entries in the order of the directory of the archive */
+	Common::Array<LabEntryPtr> _entries;
+	/** Finds the position of an entry in _entries from its name */
+	Common::MemberIndex _memberIndex;
 	Common::SeekableReadStream *_stream;
+	/** The whole archive mapped into memory, or 0 when the backend can't map it */
+	Common::FileMapping *_mapping;
+
+	friend class LabEntry;
 };
 
 } // end of namespace Grim
@@ -47,6 +47,7 @@ MODULE_OBJS := \
 	imuse/imuse_music.o \
 	imuse/imuse_script.o \
 	imuse/imuse_sndmgr.o \
+	imuse/imuse_stream.o \
 	imuse/imuse_tables.o \
 	imuse/imuse_track.o \
 	lua/lapi.o \
@@ -123,10 +124,12 @@ MODULE_OBJS := \
 	material.o \
 	model.o \
 	objectstate.o \
+	prefetcher.o \
 	primitives.o \
 	patchr.o \
 	registry.o \
 	resource.o \
+	resourcecache.o \
 	savegame.o \
 	set.o \
 	sector.o \
@@ -48,7 +48,7 @@ namespace Grim {
 
 bool SmushDecoder::_demo = false;
 
-static uint16 smushDestTable[5786];
+static VimaStep smushVimaSteps[kVimaStepCount];
 
 SmushDecoder::SmushDecoder() {
 	_file = nullptr;
@@ -609,7 +609,7 @@ void SmushDecoder::SmushAudioTrack::init() {
 	_IACTpos = 0;
 
 	if (_isVima) {
-		vimaInit(smushDestTable);
+		vimaInit(smushVimaSteps);
 	}
 }
 
@@ -625,7 +625,7 @@ void SmushDecoder::SmushAudioTrack::handleVIMA(Common::SeekableReadStream *strea
 
 	// this will be deleted using free() by the stream, so allocate it using malloc().
 	int16 *dst = (int16 *)malloc(decompressedSize * _channels * 2);
-	decompressVima(src, dst, decompressedSize * _channels * 2, smushDestTable);
+	decompressVima(src, dst, decompressedSize * _channels * 2, smushVimaSteps);
 
 	int flags = Audio::FLAG_16BITS;
 	if (_channels == 2) {
@@ -21,6 +21,9 @@
  */
 
 #include "common/endian.h"
+#include "common/util.h"
+
+#include "engines/grim/movie/codecs/vima.h"
 
 namespace Grim {
 
@@ -99,25 +102,29 @@ static int8 *offsets[] = {
 	imcOtherTable4, imcOtherTable5, imcOtherTable6
 };
 
-void vimaInit(uint16 *destTable) {
-	int destTableStartPos, incer;
-
-	for (destTableStartPos = 0, incer = 0; destTableStartPos < 64; destTableStartPos++, incer++) {
-		unsigned int destTablePos, imcTable1Pos;
-		for (imcTable1Pos = 0, destTablePos = destTableStartPos;
-				imcTable1Pos < sizeof(imcTable1) / sizeof(imcTable1[0]); imcTable1Pos++, destTablePos += 64) {
-			int put = 0, count, tableValue;
-			for (count = 32, tableValue = imcTable1[imcTable1Pos]; count != 0; count >>= 1, tableValue >>= 1) {
+void vimaInit(VimaStep *steps) {
+	for (int pos = 0; pos < ARRAYSIZE(imcTable1); pos++) {
+		int numBits = imcTable2[pos];
+		for (int val = 0; val < (1 << (numBits - 1)); val++) {
+			// Each bit of the value adds a fraction of the step size
+			int incer = val << (7 - numBits);
+			int delta = 0, count, tableValue;
+			for (count = 32, tableValue = imcTable1[pos]; count != 0; count >>= 1, tableValue >>= 1) {
 				if (incer & count) {
-					put += tableValue;
+					delta += tableValue;
 				}
 			}
-			destTable[destTablePos] = put;
+			if (val)
+				delta += imcTable1[pos] >> (numBits - 1);
+
+			VimaStep &step = steps[pos * 64 + val];
+			step.delta = delta;
+			step.nextPos = CLIP(pos + offsets[numBits - 2][val], 0, 88);
 		}
 	}
 }
 
-void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable) {
+void decompressVima(const byte *src, int16 *dest, int destLen, const VimaStep *steps) {
 	int numChannels = 1;
 	byte sBytes[2];
 	int16 sWords[2];
@@ -140,6 +147,8 @@ void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable
 	int bitPtr = 0;
 	src += 2;
 
+	// The channels are stored one after the other, and each one is decoded
+	// with its state in locals.
 	for (int channel = 0; channel < numChannels; channel++) {
 		int16 *destPos = dest + channel;
 		int currTablePos = sBytes[channel];
@@ -157,10 +166,9 @@ void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable
 				bitPtr -= 8;
 			}
 
-			if (val & highBit)
-				val ^= highBit;
-			else
-				highBit = 0;
+			const bool negative = (val & highBit) != 0;
+			val &= lowBits;
+			const VimaStep &step = steps[(currTablePos << 6) | val];
 
 			if (val == lowBits) {
 				outputWord = ((int16)(bits << bitPtr) & 0xffffff00);
@@ -168,15 +176,7 @@ void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable
 				outputWord |= ((bits >> (8 - bitPtr)) & 0xff);
 				bits = ((bits & 0xff) << 8) | *src++;
 			} else {
-				int index = (val << (7 - numBits)) | (currTablePos << 6);
-				int delta = destTable[index];
-
-				if (val)
-					delta += (imcTable1[currTablePos] >> (numBits - 1));
-				if (highBit)
-					delta = -delta;
-
-				outputWord += delta;
+				outputWord += negative ? -step.delta : step.delta;
 				if (outputWord < -0x8000)
 					outputWord = -0x8000;
 				else if (outputWord > 0x7fff)
@@ -186,12 +186,7 @@ void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable
 			WRITE_BE_UINT16(destPos, outputWord);
 			destPos += numChannels;
 
-			currTablePos += offsets[numBits - 2][val];
-
-			if (currTablePos < 0)
-				currTablePos = 0;
-			else if (currTablePos > 88)
-				currTablePos = 88;
+			currTablePos = step.nextPos;
 		}
 	}
 }
@@ -23,10 +23,26 @@
 #ifndef GRIM_VIMA_H
 #define GRIM_VIMA_H
 
+#include "common/scummsys.h"
+
 namespace Grim {
 
-void vimaInit(uint16 *destTable);
-void decompressVima(const byte *src, int16 *dest, int destLen, uint16 *destTable);
+/**
+ * How to decode a sample, for a given position in the step table and a
+ * given value read from the stream.
+ */
+struct VimaStep {
+	int32 delta;    // magnitude of the delta to add to the last sample
+	byte nextPos;   // step table position for the next sample
+};
+
+enum {
+	kVimaStepCount = 89 * 64
+};
+
+/** Fills the kVimaStepCount steps used by decompressVima(). */
+void vimaInit(VimaStep *steps);
+void decompressVima(const byte *src, int16 *dest, int destLen, const VimaStep *steps);
 
 } // end of namespace Grim
 
@@ -38,6 +38,7 @@ public:
 	void reset() { };
 	void reference();
 	void dereference();
+	int getRefCount() const { return _refCount; }
 
 	int32 getId() const;
 
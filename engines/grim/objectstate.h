@@ -55,6 +55,8 @@ public:
 	void setPos(Position position) { _pos = position; }
 
 	const Common::String &getBitmapFilename() const;
+	Bitmap *getBitmap() const { return _bitmap; }
+	Bitmap *getZBitmap() const { return _zbitmap; }
 
 	void setActiveImage(int val);
 	void draw();
@@ -0,0 +1,169 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/system.h"
+
+#include "engines/grim/prefetcher.h"
+#include "engines/grim/bitmap.h"
+#include "engines/grim/grim.h"
+#include "engines/grim/resource.h"
+#include "engines/grim/textsplit.h"
+
+namespace Grim {
+
+Prefetcher::Prefetcher() :
+		_numPrefetched(0) {
+}
+
+void Prefetcher::prefetchSet(const Common::String &name) {
+	Common::String filename(name);
+	// EMI-scripts refer to their .setb files as .set
+	if (g_grim->getGameType() == GType_MONKEY4) {
+		filename += "b";
+	}
+	queue(filename, kPriorityHigh, true);
+}
+
+void Prefetcher::prefetch(const Common::String &filename, Priority priority) {
+	queue(filename, priority, false);
+}
+
+void Prefetcher::prefetch(const Bitmap *bitmap, Priority priority) {
+	if (bitmap && !bitmap->isLoaded())
+		queue(bitmap->getFilename(), priority, false);
+}
+
+void Prefetcher::queue(const Common::String &name, Priority priority, bool isSet) {
+	Common::String filename(name);
+	filename.toLowercase();
+
+	if (_queued.contains(filename))
+		return;
+	// A set file has to be read again to find what it references
+	if (!isSet) {
+		const ResourceCache &cache = g_resourceloader->getCache();
+		if (cache.hasFile(filename) || cache.hasRetainedObjectFrom(filename))
+			return;
+	}
+
+	Request request;
+	request.filename = filename;
+	request.isSet = isSet;
+	_queues[priority].push(request);
+	_queued[filename] = true;
+}
+
+void Prefetcher::update(uint32 deadline) {
+	int priority = kPriorityHigh;
+	while (priority < kNumPriorities) {
+		if (_queues[priority].empty()) {
+			++priority;
+			continue;
+		}
+		if (g_system->getMillis() >= deadline)
+			return;
+
+		Request request = _queues[priority].pop();
+		_queued.erase(request.filename);
+
+		Common::SeekableReadStream *stream = g_resourceloader->openNewStreamFile(request.filename, true);
+		if (!stream)
+			continue;
+
+		++_numPrefetched;
+		if (request.isSet) {
+			queueSetFiles(request.filename, stream);
+			priority = kPriorityHigh;
+		}
+		delete stream;
+	}
+}
+
+void Prefetcher::clear() {
+	for (int i = 0; i < kNumPriorities; ++i)
+		_queues[i].clear();
+	_queued.clear();
+}
+
+void Prefetcher::queueSetFiles(const Common::String &filename, Common::SeekableReadStream *data) {
+	char header[7];
+	data->read(header, 7);
+	data->seek(0, SEEK_SET);
+	if (memcmp(header, "section", 7) == 0) {
+		queueTextSetFiles(filename, data);
+	} else {
+		queueBinarySetFiles(data);
+	}
+}
+
+void Prefetcher::queueTextSetFiles(const Common::String &filename, Common::SeekableReadStream *data) {
+	TextSplitter ts(filename, data);
+	int setup = -1;
+	char name[256], file[256];
+
+	while (ts.getCurrentLine()) {
+		const char *line = ts.getCurrentLine();
+		if (sscanf(line, " colormap %255s", file) == 1) {
+			queue(file, kPriorityHigh, false);
+		} else if (sscanf(line, " background %255s", file) == 1) {
+			++setup;
+			queue(file, setup == 0 ? kPriorityHigh : kPriorityNormal, false);
+		} else if (sscanf(line, " zbuffer %255s", file) == 1) {
+			if (strcmp(file, "<none>.lbm") != 0)
+				queue(file, setup == 0 ? kPriorityHigh : kPriorityNormal, false);
+		} else if (sscanf(line, " object_art %255s %255s", name, file) == 2 ||
+				   sscanf(line, " object_z %255s %255s", name, file) == 2) {
+			queue(file, kPriorityLow, false);
+		} else if (ts.checkString("section: sectors")) {
+			// Nothing else references a file
+			break;
+		}
+
+		if (ts.isEof())
+			break;
+		ts.nextLine();
+	}
+}
+
+void Prefetcher::queueBinarySetFiles(Common::SeekableReadStream *data) {
+	uint32 numSetups = data->readUint32LE();
+	for (uint32 i = 0; i < numSetups; ++i) {
+		// The name of the setup
+		data->skip(128);
+
+		uint32 fileNameLen = data->readUint32LE();
+		int32 remaining = data->size() - data->pos();
+		if (data->eos() || remaining < 0 || fileNameLen > (uint32)remaining)
+			break;
+
+		char *fileName = new char[fileNameLen + 1];
+		data->read(fileName, fileNameLen);
+		fileName[fileNameLen] = '\0';
+		queue(fileName, i == 0 ? kPriorityHigh : kPriorityNormal, false);
+		delete[] fileName;
+
+		// The position, the rotation, the fov and the clipping planes
+		data->skip(40);
+	}
+}
+
+} // end of namespace Grim
@@ -0,0 +1,106 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef GRIM_PREFETCHER_H
+#define GRIM_PREFETCHER_H
+
+#include "common/hashmap.h"
+#include "common/hash-str.h"
+#include "common/queue.h"
+#include "common/str.h"
+
+namespace Common {
+class SeekableReadStream;
+}
+
+namespace Grim {
+
+class Bitmap;
+
+/**
+ * Reads the files a set is going to need into the ResourceLoader's cache
+ * ahead of time, so that the first frames drawn in the set don't stall on
+ * disk reads.
+ *
+ * There are no threads, the reads are done by update(), which the main
+ * loop calls with the time left in the frame. Nothing ever waits for a
+ * prefetch: a file still in the queue when it is needed is loaded as usual.
+ */
+class Prefetcher {
+public:
+	enum Priority {
+		/** The set file, its colormaps and its current setup */
+		kPriorityHigh,
+		/** The other setups */
+		kPriorityNormal,
+		/** The object states */
+		kPriorityLow,
+		kNumPriorities
+	};
+
+	Prefetcher();
+
+	/**
+	 * Queues a set file. Once it's read, the files it references are queued too.
+	 */
+	void prefetchSet(const Common::String &name);
+
+	void prefetch(const Common::String &filename, Priority priority);
+	/**
+	 * Queues the file of a bitmap which wasn't loaded yet.
+	 */
+	void prefetch(const Bitmap *bitmap, Priority priority);
+
+	/**
+	 * Reads queued files, highest priority first, until the deadline.
+	 *
+	 * @param deadline a time in g_system->getMillis() units
+	 */
+	void update(uint32 deadline);
+
+	/**
+	 * Drops everything still queued.
+	 */
+	void clear();
+
+	uint32 getNumQueued() const { return _queued.size(); }
+	uint32 getNumPrefetched() const { return _numPrefetched; }
+
+private:
+	struct Request {
+		Common::String filename;
+		bool isSet;
+	};
+
+	void queue(const Common::String &filename, Priority priority, bool isSet);
+	void queueSetFiles(const Common::String &filename, Common::SeekableReadStream *data);
+	void queueTextSetFiles(const Common::String &filename, Common::SeekableReadStream *data);
+	void queueBinarySetFiles(Common::SeekableReadStream *data);
+
+	Common::Queue<Request> _queues[kNumPriorities];
+	Common::HashMap<Common::String, bool> _queued;
+	uint32 _numPrefetched;
+};
+
+} // end of namespace Grim
+
+#endif
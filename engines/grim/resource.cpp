@@ -72,9 +72,17 @@ public:
 	}
 };
 
-ResourceLoader::ResourceLoader() {
-	_cacheDirty = false;
-	_cacheMemorySize = 0;
+static Common::String objectKey(const char *type, const Common::String &filename) {
+	Common::String key = Common::String::format("%s:%s", type, filename.c_str());
+	key.toLowercase();
+	return key;
+}
+
+ResourceLoader::ResourceLoader() :
+		_cache(32 * 1024 * 1024) {
+	// The budget of the cache, in kilobytes
+	if (ConfMan.hasKey("resource_cache_size"))
+		_cache.setMaxSize(ConfMan.getInt("resource_cache_size") * 1024);
 
 	Lab *l;
 	Common::ArchiveMemberList files, updFiles;
@@ -219,56 +227,11 @@ ResourceLoader::ResourceLoader() {
 	files.clear();
 }
 
-template<typename T>
-void clearList(Common::List<T> &list) {
-	while (!list.empty()) {
-		T p = list.front();
-		list.erase(list.begin());
-		delete p;
-	}
-}
-
 ResourceLoader::~ResourceLoader() {
-	for (Common::Array<ResourceCache>::iterator i = _cache.begin(); i != _cache.end(); ++i) {
-		ResourceCache &r = *i;
-		delete[] r.fname;
-		delete[] r.resPtr;
-	}
-	clearList(_models);
-	clearList(_colormaps);
-	clearList(_keyframeAnims);
-	clearList(_lipsyncs);
+	_cache.deleteObjects();
 	MD5Check::clear();
 }
 
-static int sortCallback(const void *entry1, const void *entry2) {
-	return scumm_stricmp(((const ResourceLoader::ResourceCache *)entry1)->fname, ((const ResourceLoader::ResourceCache *)entry2)->fname);
-}
-
-Common::SeekableReadStream *ResourceLoader::getFileFromCache(const Common::String &filename) const {
-	ResourceLoader::ResourceCache *entry = getEntryFromCache(filename);
-	if (!entry)
-		return nullptr;
-
-	return new Common::MemoryReadStream(entry->resPtr, entry->len);
-
-}
-
-ResourceLoader::ResourceCache *ResourceLoader::getEntryFromCache(const Common::String &filename) const {
-	if (_cache.empty())
-		return nullptr;
-
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
-	}
-
-	ResourceCache key;
-	key.fname = const_cast<char *>(filename.c_str());
-
-	return (ResourceLoader::ResourceCache *)bsearch(&key, _cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-}
-
 Common::SeekableReadStream *ResourceLoader::loadFile(const Common::String &filename) const {
 	Common::SeekableReadStream *rs = nullptr;
 	if (SearchMan.hasFile(filename))
@@ -284,8 +247,9 @@ Common::SeekableReadStream *ResourceLoader::openNewStreamFile(Common::String fna
 	Common::SeekableReadStream *s;
 	fname.toLowercase();
 
-	if (cache) {
-		s = getFileFromCache(fname);
+	// Files which were prefetched are also read from the cache
+	if (cache || _cache.hasFile(fname)) {
+		s = _cache.getFile(fname);
 		if (!s) {
 			s = loadFile(fname);
 			if (!s)
@@ -294,9 +258,8 @@ Common::SeekableReadStream *ResourceLoader::openNewStreamFile(Common::String fna
 			uint32 size = s->size();
 			byte *buf = new byte[size];
 			s->read(buf, size);
-			putIntoCache(fname, buf, size);
 			delete s;
-			s = new Common::MemoryReadStream(buf, size);
+			s = _cache.putFile(fname, buf, size);
 		}
 	} else {
 		s = loadFile(fname);
@@ -305,17 +268,6 @@ Common::SeekableReadStream *ResourceLoader::openNewStreamFile(Common::String fna
 	return Common::wrapCompressedReadStream(s);
 }
 
-void ResourceLoader::putIntoCache(const Common::String &fname, byte *res, uint32 len) const {
-	ResourceCache entry;
-	entry.resPtr = res;
-	entry.len = len;
-	entry.fname = new char[fname.size() + 1];
-	strcpy(entry.fname, fname.c_str());
-	_cacheMemorySize += len;
-	_cache.push_back(entry);
-	_cacheDirty = true;
-}
-
 CMap *ResourceLoader::loadColormap(const Common::String &filename) {
 	Common::SeekableReadStream *stream = openNewStreamFile(filename.c_str());
 	if (!stream) {
@@ -323,7 +275,7 @@ CMap *ResourceLoader::loadColormap(const Common::String &filename) {
 	}
 
 	CMap *result = new CMap(filename, stream);
-	_colormaps.push_back(result);
+	_cache.addObject(objectKey("cmap", filename), result, filename, stream->size());
 	delete stream;
 
 	return result;
@@ -410,7 +362,7 @@ KeyframeAnim *ResourceLoader::loadKeyframe(const Common::String &filename) {
 		error("Could not find keyframe file %s", filename.c_str());
 
 	KeyframeAnim *result = new KeyframeAnim(filename, stream);
-	_keyframeAnims.push_back(result);
+	_cache.addObject(objectKey("keyframe", filename), result, filename, stream->size());
 	delete stream;
 
 	return result;
@@ -428,7 +380,7 @@ LipSync *ResourceLoader::loadLipSync(const Common::String &filename) {
 
 	// Some lipsync files have no data
 	if (result->isValid())
-		_lipsyncs.push_back(result);
+		_cache.addObject(objectKey("lipsync", filename), result, filename, stream->size());
 	else {
 		delete result;
 		result = nullptr;
@@ -471,7 +423,7 @@ Model *ResourceLoader::loadModel(const Common::String &filename, CMap *c, Model
 		error("Could not find model %s", filename.c_str());
 
 	Model *result = new Model(filename, stream, c, parent);
-	_models.push_back(result);
+	_cache.addObject(objectKey("model", filename + ":" + c->getFilename()), result, fname, stream->size());
 	delete stream;
 
 	return result;
@@ -488,7 +440,6 @@ EMIModel *ResourceLoader::loadModelEMI(const Common::String &filename, EMICostum
 	}
 
 	EMIModel *result = new EMIModel(filename, stream, costume);
-	_emiModels.push_back(result);
 	delete stream;
 
 	return result;
@@ -540,7 +491,7 @@ AnimationEmi *ResourceLoader::loadAnimationEmi(const Common::String &filename) {
 	}
 
 	AnimationEmi *result = new AnimationEmi(filename, stream);
-	_emiAnims.push_back(result);
+	_cache.addObject(objectKey("animemi", filename), result, fname, stream->size());
 	delete stream;
 
 	return result;
@@ -562,109 +513,84 @@ Overlay *ResourceLoader::loadOverlay(const Common::String &filename) {
 	return result;
 }
 
-void ResourceLoader::uncache(const char *filename) const {
-	Common::String fname = filename;
-	fname.toLowercase();
-
-	if (_cacheDirty) {
-		qsort(_cache.begin(), _cache.size(), sizeof(ResourceCache), sortCallback);
-		_cacheDirty = false;
-	}
-
-	for (unsigned int i = 0; i < _cache.size(); i++) {
-		if (fname.compareTo(_cache[i].fname) == 0) {
-			delete[] _cache[i].fname;
-			_cacheMemorySize -= _cache[i].len;
-			delete[] _cache[i].resPtr;
-			_cache.remove_at(i);
-			_cacheDirty = true;
-		}
-	}
-}
-
 void ResourceLoader::uncacheModel(Model *m) {
-	_models.remove(m);
+	_cache.removeObject(m);
 }
 
 void ResourceLoader::uncacheColormap(CMap *c) {
-	_colormaps.remove(c);
+	_cache.removeObject(c);
 }
 
 void ResourceLoader::uncacheKeyframe(KeyframeAnim *k) {
-	_keyframeAnims.remove(k);
+	_cache.removeObject(k);
 }
 
 void ResourceLoader::uncacheLipSync(LipSync *s) {
-	_lipsyncs.remove(s);
+	_cache.removeObject(s);
 }
 
 void ResourceLoader::uncacheAnimationEmi(AnimationEmi *a) {
-	_emiAnims.remove(a);
+	_cache.removeObject(a);
 }
 
+// The objects found by the getters are shared by reference counting, so the
+// cache can keep them once their users drop them. The ones returned by the
+// loaders belong to their caller and are only registered.
+
 ModelPtr ResourceLoader::getModel(const Common::String &fname, CMap *c) {
-	Common::String filename = fname;
-	filename.toLowercase();
-	for (Common::List<Model *>::const_iterator i = _models.begin(); i != _models.end(); ++i) {
-		Model *m = *i;
-		if (filename == m->getFilename() && *m->getCMap() == *c) {
-			return m;
-		}
-	}
+	Model *m = static_cast<Model *>(_cache.getObject(objectKey("model", fname + ":" + c->getFilename())));
+	if (m)
+		return m;
 
-	return loadModel(fname, c);
+	// Reference it before the cache can evict it
+	ModelPtr ptr = loadModel(fname, c);
+	if (ptr)
+		_cache.retainObject(ptr);
+	return ptr;
 }
 
 CMapPtr ResourceLoader::getColormap(const Common::String &fname) {
-	Common::String filename = fname;
-	filename.toLowercase();
-	for (Common::List<CMap *>::const_iterator i = _colormaps.begin(); i != _colormaps.end(); ++i) {
-		CMap *c = *i;
-		if (filename.equals(c->_fname)) {
-			return c;
-		}
-	}
+	CMap *c = static_cast<CMap *>(_cache.getObject(objectKey("cmap", fname)));
+	if (c)
+		return c;
 
-	return loadColormap(fname);
+	CMapPtr ptr = loadColormap(fname);
+	if (ptr)
+		_cache.retainObject(ptr);
+	return ptr;
 }
 
 KeyframeAnimPtr ResourceLoader::getKeyframe(const Common::String &fname) {
-	Common::String filename = fname;
-	filename.toLowercase();
-	for (Common::List<KeyframeAnim *>::const_iterator i = _keyframeAnims.begin(); i != _keyframeAnims.end(); ++i) {
-		KeyframeAnim *k = *i;
-		if (filename == k->getFilename()) {
-			return k;
-		}
-	}
+	KeyframeAnim *k = static_cast<KeyframeAnim *>(_cache.getObject(objectKey("keyframe", fname)));
+	if (k)
+		return k;
 
-	return loadKeyframe(fname);
+	KeyframeAnimPtr ptr = loadKeyframe(fname);
+	if (ptr)
+		_cache.retainObject(ptr);
+	return ptr;
 }
 
 LipSyncPtr ResourceLoader::getLipSync(const Common::String &fname) {
-	Common::String filename = fname;
-	filename.toLowercase();
-	for (Common::List<LipSync *>::const_iterator i = _lipsyncs.begin(); i != _lipsyncs.end(); ++i) {
-		LipSync *l = *i;
-		if (filename == l->getFilename()) {
-			return l;
-		}
-	}
+	LipSync *l = static_cast<LipSync *>(_cache.getObject(objectKey("lipsync", fname)));
+	if (l)
+		return l;
 
-	return loadLipSync(fname);
+	LipSyncPtr ptr = loadLipSync(fname);
+	if (ptr)
+		_cache.retainObject(ptr);
+	return ptr;
 }
 
 AnimationEmiPtr ResourceLoader::getAnimationEmi(const Common::String &fname) {
-	Common::String filename = fname;
-	filename.toLowercase();
-	for (Common::List<AnimationEmi *>::const_iterator i = _emiAnims.begin(); i != _emiAnims.end(); ++i) {
-		AnimationEmi *a = *i;
-		if (filename == a->getFilename()) {
-			return a;
-		}
-	}
-
-	return loadAnimationEmi(fname);
+	AnimationEmi *a = static_cast<AnimationEmi *>(_cache.getObject(objectKey("animemi", fname)));
+	if (a)
+		return a;
+
+	AnimationEmiPtr ptr = loadAnimationEmi(fname);
+	if (ptr)
+		_cache.retainObject(ptr);
+	return ptr;
 }
 
 } // end of namespace Grim
@@ -27,6 +27,8 @@
 #include "common/array.h"
 
 #include "engines/grim/object.h"
+#include "engines/grim/prefetcher.h"
+#include "engines/grim/resourcecache.h"
 
 namespace Grim {
 
@@ -86,31 +88,15 @@ public:
 	void uncacheLipSync(LipSync *l);
 	void uncacheAnimationEmi(AnimationEmi *a);
 
-	struct ResourceCache {
-		char *fname;
-		byte *resPtr;
-		uint32 len;
-	};
+	ResourceCache &getCache() { return _cache; }
+	Prefetcher &getPrefetcher() { return _prefetcher; }
 
 	static Common::String fixFilename(const Common::String &filename, bool append = true);
 
 private:
 	Common::SeekableReadStream *loadFile(const Common::String &filename) const;
-	Common::SeekableReadStream *getFileFromCache(const Common::String &filename) const;
-	ResourceLoader::ResourceCache *getEntryFromCache(const Common::String &filename) const;
-	void putIntoCache(const Common::String &fname, byte *res, uint32 len) const;
-	void uncache(const char *fname) const;
-
-	mutable Common::Array<ResourceCache> _cache;
-	mutable bool _cacheDirty;
-	mutable int32 _cacheMemorySize;
-
-	Common::List<EMIModel *> _emiModels;
-	Common::List<Model *> _models;
-	Common::List<CMap *> _colormaps;
-	Common::List<KeyframeAnim *> _keyframeAnims;
-	Common::List<LipSync *> _lipsyncs;
-	Common::List<AnimationEmi *> _emiAnims;
+	mutable ResourceCache _cache;
+	Prefetcher _prefetcher;
 };
 
 extern ResourceLoader *g_resourceloader;
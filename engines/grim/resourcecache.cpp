@@ -0,0 +1,250 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#include "common/filemapping.h"
+
+#include "engines/grim/resourcecache.h"
+#include "engines/grim/object.h"
+
+namespace Grim {
+
+/**
+ * The bytes of a cached file, released when the cache and the last
+ * stream over them let go.
+ */
+class CachedFile : public Common::FileMapping {
+public:
+	CachedFile(byte *data, uint32 size) : Common::FileMapping(data, size) {}
+
+protected:
+	~CachedFile() override {
+		delete[] getData();
+	}
+};
+
+ResourceCache::ResourceCache(uint32 maxSize) :
+		_size(0), _maxSize(maxSize), _numRetainedObjects(0),
+		_fileHits(0), _fileMisses(0), _objectHits(0), _objectMisses(0), _evictions(0) {
+}
+
+ResourceCache::~ResourceCache() {
+	deleteObjects();
+	clear();
+}
+
+Common::SeekableReadStream *ResourceCache::getFile(const Common::String &key) {
+	FileMap::iterator file = _files.find(key);
+	if (file == _files.end()) {
+		++_fileMisses;
+		return nullptr;
+	}
+
+	++_fileHits;
+	touch(file->_value);
+	Common::FileMapping *mapping = file->_value->file;
+	return new Common::MappedReadStream(mapping, 0, mapping->size());
+}
+
+Common::SeekableReadStream *ResourceCache::putFile(const Common::String &key, byte *data, uint32 size) {
+	CachedFile *mapping = new CachedFile(data, size);
+	Common::SeekableReadStream *stream = new Common::MappedReadStream(mapping, 0, size);
+
+	FileMap::iterator file = _files.find(key);
+	if (file != _files.end())
+		removeFile(file);
+
+	Entry entry;
+	entry.key = key;
+	entry.file = mapping;
+	entry.object = nullptr;
+	entry.size = size;
+	_entries.push_front(entry);
+	_files[key] = _entries.begin();
+	_size += size;
+
+	evict(_maxSize);
+	return stream;
+}
+
+Object *ResourceCache::getObject(const Common::String &key) {
+	ObjectKeyMap::iterator object = _objectKeys.find(key);
+	if (object == _objectKeys.end()) {
+		++_objectMisses;
+		return nullptr;
+	}
+
+	++_objectHits;
+	ObjectInfo &info = _objects[object->_value];
+	if (info.retained)
+		touch(info.entry);
+	return object->_value;
+}
+
+void ResourceCache::addObject(const Common::String &key, Object *object, const Common::String &file, uint32 size) {
+	ObjectInfo &info = _objects[object];
+	info.key = key;
+	info.file = file;
+	info.file.toLowercase();
+	info.size = size;
+	info.retained = false;
+
+	// When a resource is loaded several times, the last copy is the one found
+	_objectKeys[key] = object;
+}
+
+void ResourceCache::retainObject(Object *object) {
+	ObjectMap::iterator i = _objects.find(object);
+	if (i == _objects.end() || i->_value.retained)
+		return;
+
+	Entry entry;
+	entry.file = nullptr;
+	entry.object = object;
+	entry.size = i->_value.size;
+	_entries.push_front(entry);
+	i->_value.entry = _entries.begin();
+	i->_value.retained = true;
+	_size += entry.size;
+	++_numRetainedObjects;
+	++_retainedFiles[i->_value.file];
+	object->reference();
+
+	// The object is what gets reused now, not the bytes it was decoded from
+	FileMap::iterator file = _files.find(i->_value.file);
+	if (file != _files.end())
+		removeFile(file);
+
+	evict(_maxSize);
+}
+
+void ResourceCache::removeObject(Object *object) {
+	ObjectMap::iterator i = _objects.find(object);
+	if (i == _objects.end())
+		return;
+
+	if (i->_value.retained) {
+		_size -= i->_value.size;
+		_entries.erase(i->_value.entry);
+		releaseObject(i->_value);
+	}
+
+	ObjectKeyMap::iterator key = _objectKeys.find(i->_value.key);
+	if (key != _objectKeys.end() && key->_value == object)
+		_objectKeys.erase(key);
+	_objects.erase(i);
+}
+
+void ResourceCache::setMaxSize(uint32 maxSize) {
+	_maxSize = maxSize;
+	evict(_maxSize);
+}
+
+void ResourceCache::clear() {
+	evict(0);
+}
+
+void ResourceCache::deleteObjects() {
+	while (!_objects.empty()) {
+		ObjectMap::iterator i = _objects.begin();
+		Object *object = i->_key;
+		removeObject(object);
+		delete object;
+	}
+}
+
+ResourceCache::Stats ResourceCache::getStats() const {
+	Stats stats;
+	stats.fileHits = _fileHits;
+	stats.fileMisses = _fileMisses;
+	stats.objectHits = _objectHits;
+	stats.objectMisses = _objectMisses;
+	stats.evictions = _evictions;
+	stats.numFiles = _files.size();
+	stats.numObjects = _objects.size();
+	stats.numRetainedObjects = _numRetainedObjects;
+	stats.size = _size;
+	stats.maxSize = _maxSize;
+	return stats;
+}
+
+void ResourceCache::resetStats() {
+	_fileHits = _fileMisses = _objectHits = _objectMisses = _evictions = 0;
+}
+
+void ResourceCache::removeFile(FileMap::iterator file) {
+	_size -= file->_value->size;
+	file->_value->file->decRef();
+	_entries.erase(file->_value);
+	_files.erase(file);
+}
+
+void ResourceCache::releaseObject(ObjectInfo &info) {
+	info.retained = false;
+	--_numRetainedObjects;
+
+	FileCountMap::iterator file = _retainedFiles.find(info.file);
+	if (file != _retainedFiles.end() && --file->_value == 0)
+		_retainedFiles.erase(file);
+}
+
+void ResourceCache::touch(EntryList::iterator entry) {
+	if (entry == _entries.begin())
+		return;
+
+	_entries.push_front(*entry);
+	_entries.erase(entry);
+	if (_entries.front().file)
+		_files[_entries.front().key] = _entries.begin();
+	else
+		_objects[_entries.front().object].entry = _entries.begin();
+}
+
+void ResourceCache::evict(uint32 maxSize) {
+	// Released objects can release others, such as the colormap of a model,
+	// so they are only dereferenced once the list has been walked
+	Common::List<Object *> released;
+
+	EntryList::iterator i = _entries.reverse_begin();
+	while (_size > maxSize && i != _entries.end()) {
+		EntryList::iterator entry = i--;
+		if (entry->file) {
+			_files.erase(entry->key);
+			entry->file->decRef();
+		} else {
+			// Evicting an object in use wouldn't free anything
+			if (entry->object->getRefCount() > 1)
+				continue;
+
+			releaseObject(_objects[entry->object]);
+			released.push_back(entry->object);
+		}
+
+		_size -= entry->size;
+		++_evictions;
+		_entries.erase(entry);
+	}
+
+	for (Common::List<Object *>::iterator object = released.begin(); object != released.end(); ++object)
+		(*object)->dereference();
+}
+
+} // end of namespace Grim
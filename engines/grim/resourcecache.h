@@ -0,0 +1,178 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the COPYRIGHT
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+#ifndef GRIM_RESOURCECACHE_H
+#define GRIM_RESOURCECACHE_H
+
+#include "common/hashmap.h"
+#include "common/hash-ptr.h"
+#include "common/hash-str.h"
+#include "common/list.h"
+#include "common/str.h"
+
+namespace Common {
+class FileMapping;
+class SeekableReadStream;
+}
+
+namespace Grim {
+
+class Object;
+
+/**
+ * Keeps the resources read by the ResourceLoader within a memory budget.
+ *
+ * The cache holds two kinds of entries, which share one LRU list:
+ * - files read whole from the archives, handed out as streams over the
+ *   cached bytes. A stream keeps the bytes alive after they are evicted.
+ * - decoded objects (models, colormaps, keyframes...). Every object the
+ *   ResourceLoader decodes is registered so that it can be found again by
+ *   its key, but only the retained ones stay alive when their users drop
+ *   them. A retained object is only evicted once nothing else references it.
+ *   It takes the place of the file it was decoded from, which is dropped
+ *   from the cache so that its bytes aren't counted twice.
+ */
+class ResourceCache {
+public:
+	struct Stats {
+		uint32 fileHits;
+		uint32 fileMisses;
+		uint32 objectHits;
+		uint32 objectMisses;
+		uint32 evictions;
+		uint32 numFiles;
+		uint32 numObjects;
+		uint32 numRetainedObjects;
+		/** Bytes of the files and the retained objects, as accounted against the budget */
+		uint32 size;
+		uint32 maxSize;
+	};
+
+	ResourceCache(uint32 maxSize);
+	~ResourceCache();
+
+	/**
+	 * Returns a stream over a cached file, or 0 when it isn't in the cache.
+	 */
+	Common::SeekableReadStream *getFile(const Common::String &key);
+
+	bool hasFile(const Common::String &key) const { return _files.contains(key); }
+
+	/**
+	 * Whether a retained object was decoded from the file, which makes
+	 * reading it again useless.
+	 */
+	bool hasRetainedObjectFrom(const Common::String &file) const { return _retainedFiles.contains(file); }
+
+	/**
+	 * Adds a file to the cache, which takes over the data allocated with new[].
+	 *
+	 * @return a stream over the data
+	 */
+	Common::SeekableReadStream *putFile(const Common::String &key, byte *data, uint32 size);
+
+	/**
+	 * Finds an object registered with the key, or returns 0.
+	 */
+	Object *getObject(const Common::String &key);
+
+	/**
+	 * Registers a decoded object. The object has to call removeObject()
+	 * when it gets deleted.
+	 *
+	 * @param file the name of the file the object was decoded from
+	 * @param size an estimation of the memory used by the object
+	 */
+	void addObject(const Common::String &key, Object *object, const Common::String &file, uint32 size);
+
+	/**
+	 * Keeps a registered object alive after its users dropped it, until it
+	 * gets evicted. Only objects nobody deletes directly can be retained.
+	 */
+	void retainObject(Object *object);
+
+	void removeObject(Object *object);
+
+	void setMaxSize(uint32 maxSize);
+
+	/**
+	 * Evicts all the files and the retained objects nothing else uses.
+	 */
+	void clear();
+
+	/**
+	 * Deletes the objects still registered.
+	 */
+	void deleteObjects();
+
+	Stats getStats() const;
+	void resetStats();
+
+private:
+	struct Entry {
+		Common::String key;
+		Common::FileMapping *file;
+		Object *object;
+		uint32 size;
+	};
+	typedef Common::List<Entry> EntryList;
+
+	struct ObjectInfo {
+		Common::String key;
+		Common::String file;
+		uint32 size;
+		/** Whether entry is valid, and the cache holds a reference to the object */
+		bool retained;
+		EntryList::iterator entry;
+	};
+
+	typedef Common::HashMap<Common::String, EntryList::iterator> FileMap;
+	typedef Common::HashMap<Object *, ObjectInfo> ObjectMap;
+	typedef Common::HashMap<Common::String, Object *> ObjectKeyMap;
+	typedef Common::HashMap<Common::String, uint32> FileCountMap;
+
+	void removeFile(FileMap::iterator file);
+	void releaseObject(ObjectInfo &info);
+	void touch(EntryList::iterator entry);
+	void evict(uint32 maxSize);
+
+	/** The most recently used entry first */
+	EntryList _entries;
+	FileMap _files;
+	ObjectMap _objects;
+	ObjectKeyMap _objectKeys;
+	/** The number of retained objects decoded from each file */
+	FileCountMap _retainedFiles;
+
+	uint32 _size;
+	uint32 _maxSize;
+	uint32 _numRetainedObjects;
+	uint32 _fileHits;
+	uint32 _fileMisses;
+	uint32 _objectHits;
+	uint32 _objectMisses;
+	uint32 _evictions;
+};
+
+} // end of namespace Grim
+
+#endif
@@ -29,6 +29,7 @@
 #include "engines/grim/grim.h"
 #include "engines/grim/savegame.h"
 #include "engines/grim/resource.h"
+#include "engines/grim/prefetcher.h"
 #include "engines/grim/bitmap.h"
 #include "engines/grim/gfx_base.h"
 
@@ -863,6 +864,20 @@ void Set::setSetup(int num) {
 	}
 }
 
+void Set::prefetchBitmaps() const {
+	Prefetcher &prefetcher = g_resourceloader->getPrefetcher();
+	// The bitmaps were only created by the parser, their files are read when they are first drawn
+	for (int i = 0; i < _numSetups; ++i) {
+		Prefetcher::Priority priority = (&_setups[i] == _currSetup) ? Prefetcher::kPriorityHigh : Prefetcher::kPriorityNormal;
+		prefetcher.prefetch(_setups[i]._bkgndBm, priority);
+		prefetcher.prefetch(_setups[i]._bkgndZBm, priority);
+	}
+	foreach (const ObjectState::Ptr &s, _states) {
+		prefetcher.prefetch(s->getBitmap(), Prefetcher::kPriorityLow);
+		prefetcher.prefetch(s->getZBitmap(), Prefetcher::kPriorityLow);
+	}
+}
+
 Bitmap::Ptr Set::loadBackground(const char *fileName) {
 	Bitmap::Ptr bg = Bitmap::create(fileName);
 	if (!bg) {
@@ -88,6 +88,7 @@ public:
 	void setSetup(int num);
 	int getSetup() const { return _currSetup - _setups; }
 	inline int getNumSetups() const { return _numSetups; }
+	void prefetchBitmaps() const;
 
 	// Sector access functions
 	int getSectorCount() { return _numSectors; }
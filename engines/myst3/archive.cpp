@@ -22,12 +22,26 @@
 
 #include "engines/myst3/archive.h"
 
+#include "common/archiveindex.h"
 #include "common/debug.h"
+#include "common/filemapping.h"
 #include "common/memstream.h"
 #include "common/substream.h"
 
 namespace Myst3 {
 
+/** Identifies the decrypted directories in the archive index cache */
+static const char *const kArchiveIndexType = "myst3-m3a-1";
+
+Archive::Archive() :
+		_mapping(nullptr),
+		_directorySize(0) {
+}
+
+Archive::~Archive() {
+	close();
+}
+
 void Archive::decryptHeader(Common::SeekableReadStream &inStream, Common::WriteStream &outStream) {
 	static const uint32 addKey = 0x3C6EF35F;
 	static const uint32 multKey = 0x0019660D;
@@ -65,6 +79,11 @@ static Common::String readFixedString(Common::ReadStream &stream, uint32 length)
 	return value;
 }
 
+/** Formats the key of a directory entry in the entry index */
+static void formatEntryKey(char *key, uint size, const char *room, uint32 index) {
+	snprintf(key, size, "%s/%u", room, index);
+}
+
 static uint32 readUint24(Common::ReadStream &stream) {
 	uint32 value = stream.readUint16LE();
 	value |= stream.readByte() << 16;
@@ -107,16 +126,44 @@ Archive::DirectoryEntry Archive::readEntry(Common::ReadStream &stream) {
 	return entry;
 }
 
-void Archive::readDirectory() {
+void Archive::readDirectory(const char *fileName) {
+	// The decrypted directory of an archive which didn't change since
+	// the last run is kept in the index cache
+	Common::SeekableReadStream *cached = ArchiveIndexMan.getIndex(kArchiveIndexType, fileName);
+	if (cached) {
+		parseDirectory(*cached);
+		delete cached;
+		return;
+	}
+
 	Common::MemoryWriteStreamDynamic buf(DisposeAfterUse::YES);
 	decryptHeader(_file, buf);
+	ArchiveIndexMan.putIndex(kArchiveIndexType, fileName, buf);
 
 	Common::MemoryReadStream directory(buf.getData(), buf.size());
+	parseDirectory(directory);
+}
+
+void Archive::parseDirectory(Common::SeekableReadStream &directory) {
 	_directorySize = directory.readUint32LE();
 
 	while (directory.pos() + 4 < directory.size()) {
 		_directory.push_back(readEntry(directory));
 	}
+
+	buildEntryIndex();
+}
+
+void Archive::buildEntryIndex() {
+	Common::Array<Common::String> keys;
+	keys.reserve(_directory.size());
+	for (uint i = 0; i < _directory.size(); i++) {
+		char key[32];
+		formatEntryKey(key, sizeof(key), _directory[i].roomName.c_str(), _directory[i].index);
+		keys.push_back(key);
+	}
+
+	_entryIndex.build(keys);
 }
 
 void Archive::visit(ArchiveVisitor &visitor) {
@@ -132,6 +179,9 @@ void Archive::visit(ArchiveVisitor &visitor) {
 }
 
 Common::SeekableReadStream *Archive::dumpToMemory(uint32 offset, uint32 size) {
+	if (_mapping && offset <= _mapping->size() && size <= _mapping->size() - offset)
+		return new Common::MappedReadStream(_mapping, offset, size);
+
 	_file.seek(offset);
 	return _file.readStream(size);
 }
@@ -143,14 +193,15 @@ uint32 Archive::copyTo(uint32 offset, uint32 size, Common::WriteStream &out) {
 }
 
 const Archive::DirectoryEntry *Archive::getEntry(const Common::String &room, uint32 index) const {
-	for (uint i = 0; i < _directory.size(); i++) {
-		const DirectoryEntry &entry = _directory[i];
-		if (entry.index == index && entry.roomName == room) {
-			return &entry;
-		}
+	char key[32];
+	formatEntryKey(key, sizeof(key), room.c_str(), index);
+
+	int entry = _entryIndex.find(key);
+	if (entry == Common::MemberIndex::kNoMember) {
+		return nullptr;
 	}
 
-	return nullptr;
+	return &_directory[entry];
 }
 
 ResourceDescription Archive::getDescription(const Common::String &room, uint32 index, uint16 face,
@@ -196,7 +247,8 @@ bool Archive::open(const char *fileName, const char *room) {
 	}
 
 	if (_file.open(fileName)) {
-		readDirectory();
+		readDirectory(fileName);
+		_mapping = Common::mapFile(fileName);
 		return true;
 	}
 	
@@ -207,7 +259,13 @@ void Archive::close() {
 	_directorySize = 0;
 	_roomName.clear();
 	_directory.clear();
+	_entryIndex.clear();
 	_file.close();
+
+	if (_mapping) {
+		_mapping->decRef();
+		_mapping = nullptr;
+	}
 }
 
 ResourceDescription::ResourceDescription() :
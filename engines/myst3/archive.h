@@ -25,9 +25,14 @@
 
 #include "common/array.h"
 #include "common/file.h"
+#include "common/memberindex.h"
 
 #include "math/vector3d.h"
 
+namespace Common {
+class FileMapping;
+}
+
 namespace Myst3 {
 
 class ArchiveVisitor;
@@ -75,6 +80,9 @@ public:
 		DirectoryEntry() : index(0) {}
 	};
 
+	Archive();
+	~Archive();
+
 	ResourceDescription getDescription(const Common::String &room, uint32 index, uint16 face,
 	                                   ResourceType type);
 	ResourceDescriptionArray listFilesMatching(const Common::String &room, uint32 index, uint16 face,
@@ -93,11 +101,15 @@ public:
 private:
 	Common::String _roomName;
 	Common::File _file;
+	Common::FileMapping *_mapping; ///< The mapped archive, when the backend supports it
 	uint32 _directorySize;
 	Common::Array<DirectoryEntry> _directory;
+	Common::MemberIndex _entryIndex; ///< Finds the position of an entry in _directory from its room and index
 
 	void decryptHeader(Common::SeekableReadStream &inStream, Common::WriteStream &outStream);
-	void readDirectory();
+	void readDirectory(const char *fileName);
+	void parseDirectory(Common::SeekableReadStream &directory);
+	void buildEntryIndex();
 	DirectorySubEntry readSubEntry(Common::ReadStream &stream);
 	DirectoryEntry readEntry(Common::ReadStream &stream);
 	const DirectoryEntry *getEntry(const Common::String &room, uint32 index) const;
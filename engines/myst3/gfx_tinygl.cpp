@@ -73,6 +73,7 @@ void TinyGLRenderer::init() {
 	_fb = new TinyGL::FrameBuffer(kOriginalWidth, kOriginalHeight, screenBuffer);
 	TinyGL::glInit(_fb, 512);
 	tglEnableDirtyRects(ConfMan.getBool("dirtyrects"));
+	tglEnableTiledRendering(ConfMan.getBool("tiledrendering"));
 
 	tglMatrixMode(TGL_PROJECTION);
 	tglLoadIdentity();
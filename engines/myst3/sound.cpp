@@ -27,6 +27,7 @@
 #include "engines/myst3/state.h"
 
 #include "audio/audiostream.h"
+#include "audio/decodeahead.h"
 #include "audio/decoders/asf.h"
 #include "audio/decoders/mp3.h"
 #include "audio/decoders/wave.h"
@@ -505,14 +506,14 @@ Audio::RewindableAudioStream *SoundChannel::makeAudioStream(const Common::String
 
 	if (isMP3) {
 #ifdef USE_MAD
-		return Audio::makeMP3Stream(s, DisposeAfterUse::YES);
+		return Audio::makeDecodeAheadStream(Audio::makeMP3Stream(s, DisposeAfterUse::YES));
 #else
 		warning("Unable to play sound '%s', MP3 support is not compiled in.", filename.c_str());
 		delete s;
 		return NULL;
 #endif
 	} else if (isWMA) {
-		return Audio::makeASFStream(s, DisposeAfterUse::YES);
+		return Audio::makeDecodeAheadStream(Audio::makeASFStream(s, DisposeAfterUse::YES));
 	} else {
 		return Audio::makeWAVStream(s, DisposeAfterUse::YES);
 	}
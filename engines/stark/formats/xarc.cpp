@@ -26,18 +26,25 @@
 #include "engines/stark/formats/xarc.h"
 #include "engines/stark/debug.h"
 
+#include "common/archiveindex.h"
 #include "common/debug.h"
 #include "common/file.h"
+#include "common/filemapping.h"
+#include "common/memstream.h"
 #include "common/substream.h"
 
 namespace Stark {
 namespace Formats {
 
+/** Identifies the layout of the XARC directories in the archive index cache */
+static const char *const kXARCIndexType = "stark-xarc-1";
+
 // ARCHIVE MEMBER
 
 class XARCMember : public Common::ArchiveMember {
 public:
 	XARCMember(const XARCArchive *xarc, Common::ReadStream &stream, uint32 offset);
+	XARCMember(const XARCArchive *xarc, const Common::String &name, uint32 offset, uint32 length);
 
 	Common::SeekableReadStream *createReadStream() const;
 	Common::String getName() const { return _name; }
@@ -71,6 +78,13 @@ XARCMember::XARCMember(const XARCArchive *xarc, Common::ReadStream &stream, uint
 	}
 }
 
+XARCMember::XARCMember(const XARCArchive *xarc, const Common::String &name, uint32 offset, uint32 length) :
+		_xarc(xarc),
+		_name(name),
+		_offset(offset),
+		_length(length) {
+}
+
 Common::SeekableReadStream *XARCMember::createReadStream() const {
 	return _xarc->createReadStreamForMember(this);
 }
@@ -95,38 +109,102 @@ Common::String XARCMember::readString(Common::ReadStream &stream) {
 
 // ARCHIVE
 
+XARCArchive::XARCArchive() :
+		_mapping(nullptr) {
+}
+
+XARCArchive::~XARCArchive() {
+	if (_mapping)
+		_mapping->decRef();
+}
+
 bool XARCArchive::open(const Common::String &filename) {
-	Common::File stream;
-	if (!stream.open(filename)) {
-		return false;
+	_filename = filename;
+
+	// The directory of an archive which didn't change since the last
+	// run is read from the index cache, without opening the archive
+	if (!loadIndex()) {
+		Common::File stream;
+		if (!stream.open(filename)) {
+			return false;
+		}
+
+		// Unknown: always 1? version?
+		uint32 unknown = stream.readUint32LE();
+		debugC(kDebugUnknown, "Stark::XARC: \"%s\" has unknown=%d", _filename.c_str(), unknown);
+		if (unknown != 1) {
+			warning("Stark::XARC: \"%s\" has unknown=%d with unknown meaning", _filename.c_str(), unknown);
+		}
+
+		// Read the number of contained files
+		uint32 numFiles = stream.readUint32LE();
+		debugC(20, kDebugArchive, "Stark::XARC: \"%s\" contains %d files", _filename.c_str(), numFiles);
+
+		// Read the offset to the contents of the first file
+		uint32 offset = stream.readUint32LE();
+		debugC(20, kDebugArchive, "Stark::XARC: \"%s\"'s first file has offset=%d", _filename.c_str(), offset);
+
+		for (uint32 i = 0; i < numFiles; i++) {
+			XARCMember *member = new XARCMember(this, stream, offset);
+			_members.push_back(Common::ArchiveMemberPtr(member));
+
+			// Set the offset to the next member
+			offset += member->getLength();
+		}
+
+		saveIndex();
 	}
+	buildMemberIndex();
 
-	_filename = filename;
+	// Members are read straight from memory when the archive can be mapped
+	_mapping = Common::mapFile(_filename);
 
-	// Unknown: always 1? version?
-	uint32 unknown = stream.readUint32LE();
-	debugC(kDebugUnknown, "Stark::XARC: \"%s\" has unknown=%d", _filename.c_str(), unknown);
-	if (unknown != 1) {
-		warning("Stark::XARC: \"%s\" has unknown=%d with unknown meaning", _filename.c_str(), unknown);
+	return true;
+}
+
+bool XARCArchive::loadIndex() {
+	Common::SeekableReadStream *index = ArchiveIndexMan.getIndex(kXARCIndexType, _filename);
+	if (!index) {
+		return false;
 	}
 
-	// Read the number of contained files
-	uint32 numFiles = stream.readUint32LE();
-	debugC(20, kDebugArchive, "Stark::XARC: \"%s\" contains %d files", _filename.c_str(), numFiles);
+	uint32 numFiles = index->readUint32LE();
+	for (uint32 i = 0; i < numFiles && !index->eos(); i++) {
+		Common::String name = Common::ArchiveIndexCache::readString(*index);
+		uint32 offset = index->readUint32LE();
+		uint32 length = index->readUint32LE();
+		_members.push_back(Common::ArchiveMemberPtr(new XARCMember(this, name, offset, length)));
+	}
 
-	// Read the offset to the contents of the first file
-	uint32 offset = stream.readUint32LE();
-	debugC(20, kDebugArchive, "Stark::XARC: \"%s\"'s first file has offset=%d", _filename.c_str(), offset);
+	bool valid = !index->eos();
+	delete index;
+	if (!valid) {
+		_members.clear();
+	}
+	return valid;
+}
 
-	for (uint32 i = 0; i < numFiles; i++) {
-		XARCMember *member = new XARCMember(this, stream, offset);
-		_members.push_back(Common::ArchiveMemberPtr(member));
+void XARCArchive::saveIndex() const {
+	Common::MemoryWriteStreamDynamic index(DisposeAfterUse::YES);
+	index.writeUint32LE(_members.size());
+	for (Common::Array<Common::ArchiveMemberPtr>::const_iterator it = _members.begin(); it != _members.end(); ++it) {
+		const XARCMember *member = static_cast<const XARCMember *>(it->get());
+		Common::ArchiveIndexCache::writeString(index, member->getName());
+		index.writeUint32LE(member->getOffset());
+		index.writeUint32LE(member->getLength());
+	}
 
-		// Set the offset to the next member
-		offset += member->getLength();
+	ArchiveIndexMan.putIndex(kXARCIndexType, _filename, index);
+}
+
+void XARCArchive::buildMemberIndex() {
+	Common::Array<Common::String> names;
+	names.reserve(_members.size());
+	for (uint i = 0; i < _members.size(); i++) {
+		names.push_back(_members[i]->getName());
 	}
 
-	return true;
+	_memberIndex.build(names);
 }
 
 Common::String XARCArchive::getFilename() const {
@@ -134,20 +212,12 @@ Common::String XARCArchive::getFilename() const {
 }
 
 bool XARCArchive::hasFile(const Common::String &name) const {
-	for (Common::ArchiveMemberList::const_iterator it = _members.begin(); it != _members.end(); ++it) {
-		if ((*it)->getName() == name) {
-			// Found it
-			return true;
-		}
-	}
-
-	// Not found
-	return false;
+	return _memberIndex.find(name) != Common::MemberIndex::kNoMember;
 }
 
 int XARCArchive::listMatchingMembers(Common::ArchiveMemberList &list, const Common::String &pattern) const {
 	int matches = 0;
-	for (Common::ArchiveMemberList::const_iterator it = _members.begin(); it != _members.end(); ++it) {
+	for (Common::Array<Common::ArchiveMemberPtr>::const_iterator it = _members.begin(); it != _members.end(); ++it) {
 		if ((*it)->getName().matchString(pattern)) {
 			// This file matches, add it
 			list.push_back(*it);
@@ -160,7 +230,7 @@ int XARCArchive::listMatchingMembers(Common::ArchiveMemberList &list, const Comm
 
 int XARCArchive::listMembers(Common::ArchiveMemberList &list) const {
 	int files = 0;
-	for (Common::ArchiveMemberList::const_iterator it = _members.begin(); it != _members.end(); ++it) {
+	for (Common::Array<Common::ArchiveMemberPtr>::const_iterator it = _members.begin(); it != _members.end(); ++it) {
 		// Add all the members to the list
 		list.push_back(*it);
 		files++;
@@ -170,30 +240,31 @@ int XARCArchive::listMembers(Common::ArchiveMemberList &list) const {
 }
 
 const Common::ArchiveMemberPtr XARCArchive::getMember(const Common::String &name) const {
-	for (Common::ArchiveMemberList::const_iterator it = _members.begin(); it != _members.end(); ++it) {
-		if ((*it)->getName() == name) {
-			// Found it
-			return *it;
-		}
+	int member = _memberIndex.find(name);
+	if (member == Common::MemberIndex::kNoMember) {
+		// Not found, return an empty ptr
+		return Common::ArchiveMemberPtr();
 	}
 
-	// Not found, return an empty ptr
-	return Common::ArchiveMemberPtr();
+	return _members[member];
 }
 
 Common::SeekableReadStream *XARCArchive::createReadStreamForMember(const Common::String &name) const {
-	for (Common::ArchiveMemberList::const_iterator it = _members.begin(); it != _members.end(); ++it) {
-		if ((*it)->getName() == name) {
-			// Found it
-			return createReadStreamForMember((const XARCMember *)it->get());
-		}
+	int member = _memberIndex.find(name);
+	if (member == Common::MemberIndex::kNoMember) {
+		// Not found
+		return 0;
 	}
 
-	// Not found
-	return 0;
+	return createReadStreamForMember((const XARCMember *)_members[member].get());
 }
 
 Common::SeekableReadStream *XARCArchive::createReadStreamForMember(const XARCMember *member) const {
+	uint32 offset = member->getOffset();
+	uint32 length = member->getLength();
+	if (_mapping && offset <= _mapping->size() && length <= _mapping->size() - offset)
+		return new Common::MappedReadStream(_mapping, offset, length);
+
 	// Open the xarc file
 	Common::File *f = new Common::File;
 	if (!f)
@@ -205,8 +276,6 @@ Common::SeekableReadStream *XARCArchive::createReadStreamForMember(const XARCMem
 	}
 
 	// Return the substream that contains the archive member
-	uint32 offset = member->getOffset();
-	uint32 length = member->getLength();
 	return new Common::SeekableSubReadStream(f, offset, offset + length, DisposeAfterUse::YES);
 
 	// Different approach: keep the archive open and read full resources to memory
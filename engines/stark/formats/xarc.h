@@ -24,8 +24,13 @@
 #define STARK_ARCHIVE_H
 
 #include "common/archive.h"
+#include "common/memberindex.h"
 #include "common/stream.h"
 
+namespace Common {
+class FileMapping;
+}
+
 namespace Stark {
 namespace Formats {
 
@@ -33,6 +38,9 @@ class XARCMember;
 
 class XARCArchive : public Common::Archive {
 public:
+	XARCArchive();
+	~XARCArchive() override;
+
 	bool open(const Common::String &filename);
 	Common::String getFilename() const;
 
@@ -46,8 +54,14 @@ public:
 	Common::SeekableReadStream *createReadStreamForMember(const XARCMember *member) const;
 
 private:
+	bool loadIndex();
+	void saveIndex() const;
+	void buildMemberIndex();
+
 	Common::String _filename;
-	Common::ArchiveMemberList _members;
+	Common::FileMapping *_mapping; ///< The mapped archive, when the backend supports it
+	Common::Array<Common::ArchiveMemberPtr> _members;
+	Common::MemberIndex _memberIndex; ///< Finds the position of a member in _members from its name
 };
 
 } // End of namespace Formats
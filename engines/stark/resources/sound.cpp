@@ -23,6 +23,7 @@
 #include "engines/stark/resources/sound.h"
 
 #include "audio/decoders/vorbis.h"
+#include "audio/pcmcache.h"
 
 #include "common/system.h"
 
@@ -64,6 +65,15 @@ Audio::RewindableAudioStream *Sound::makeAudioStream() {
 	Common::SeekableReadStream *stream = nullptr;
 	Audio::RewindableAudioStream *audioStream = nullptr;
 
+	// Sound effects are short and often replayed, keep them decoded
+	Common::String cacheName = _archiveName + "/" + _filename;
+	if (_soundType == kSoundTypeEffect) {
+		audioStream = StarkSoundCache->makeStream(cacheName);
+		if (audioStream) {
+			return audioStream;
+		}
+	}
+
 	// First try the .iss / isn files
 	if (_loadFromFile) {
 		stream = StarkArchiveLoader->getExternalFile(_filename, _archiveName);
@@ -95,6 +105,8 @@ Audio::RewindableAudioStream *Sound::makeAudioStream() {
 
 	if (!audioStream) {
 		warning("Unable to load sound '%s'", _filename.c_str());
+	} else if (_soundType == kSoundTypeEffect) {
+		audioStream = StarkSoundCache->cacheStream(cacheName, audioStream);
 	}
 
 	return audioStream;
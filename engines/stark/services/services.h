@@ -30,6 +30,10 @@ namespace Common {
 class RandomSource;
 }
 
+namespace Audio {
+class PCMCache;
+}
+
 namespace Stark {
 
 namespace Gfx {
@@ -73,6 +77,7 @@ public:
 		gameChapter = nullptr;
 		gameMessage = nullptr;
 		stateProvider = nullptr;
+		soundCache = nullptr;
 	}
 
 	ArchiveLoader *archiveLoader;
@@ -91,6 +96,7 @@ public:
 	GameChapter *gameChapter;
 	GameMessage *gameMessage;
 	StateProvider *stateProvider;
+	Audio::PCMCache *soundCache;
 };
 
 /** Shortcuts for accessing the services. */
@@ -110,6 +116,7 @@ public:
 #define StarkGameChapter        StarkServices::instance().gameChapter
 #define StarkGameMessage        StarkServices::instance().gameMessage
 #define StarkStateProvider      StarkServices::instance().stateProvider
+#define StarkSoundCache         StarkServices::instance().soundCache
 
 } // End of namespace Stark
 
@@ -46,6 +46,7 @@
 #include "engines/stark/gfx/framelimiter.h"
 
 #include "audio/mixer.h"
+#include "audio/pcmcache.h"
 #include "common/config-manager.h"
 #include "common/debug-channels.h"
 #include "common/events.h"
@@ -91,6 +92,7 @@ StarkEngine::~StarkEngine() {
 	delete StarkServices::instance().settings;
 	delete StarkServices::instance().gameChapter;
 	delete StarkServices::instance().gameMessage;
+	delete StarkServices::instance().soundCache;
 
 	StarkServices::destroy();
 
@@ -125,6 +127,7 @@ Common::Error StarkEngine::run() {
 	services.settings = new Settings(_mixer, _gameDescription);
 	services.gameChapter = new GameChapter();
 	services.gameMessage = new GameMessage();
+	services.soundCache = new Audio::PCMCache(_soundCacheSize, _soundCacheClipLength);
 
 	// Load global resources
 	services.staticProvider->init();
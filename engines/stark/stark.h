@@ -96,6 +96,10 @@ private:
 	// Double click handling
 	static const uint _doubleClickDelay = 500; // ms
 	uint _lastClickTime;
+
+	// Decoded sound effects
+	static const uint _soundCacheSize = 8 * 1024 * 1024; // bytes
+	static const uint _soundCacheClipLength = 5000; // ms
 };
 
 } // End of namespace Stark
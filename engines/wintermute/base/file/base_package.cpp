@@ -31,12 +31,18 @@
 #include "engines/wintermute/base/file/base_file_entry.h"
 #include "engines/wintermute/base/file/dcpackage.h"
 #include "engines/wintermute/wintermute.h"
+#include "common/archiveindex.h"
 #include "common/file.h"
+#include "common/memstream.h"
 #include "common/stream.h"
 #include "common/debug.h"
 
 namespace Wintermute {
 
+/** Identify the layout of the package directories in the archive index cache */
+static const char *const kPackageIndexType = "wintermute-dcp-1";
+static const char *const kBoundPackageIndexType = "wintermute-exe-1";
+
 BasePackage::BasePackage() {
 	_name = "";
 	_cd = 0;
@@ -113,7 +119,18 @@ void TPackageHeader::readFromStream(Common::ReadStream *stream) {
 PackageSet::PackageSet(Common::FSNode file, const Common::String &filename, bool searchSignature) {
 	uint32 absoluteOffset = 0;
 	_priority = 0;
+	_version = 0;
 	bool boundToExe = false;
+
+	// The directory of a package which didn't change since the last run is
+	// read from the index cache, without searching or parsing the file
+	const char *indexType = searchSignature ? kBoundPackageIndexType : kPackageIndexType;
+	if (loadIndex(file, indexType)) {
+		buildFileIndex();
+		debugC(kWintermuteDebugFileAccess, "  Registered %d files in %d package(s) from the index cache", _files.size(), _packages.size());
+		return;
+	}
+
 	Common::SeekableReadStream *stream = file.createReadStream();
 	if (!stream) {
 		return;
@@ -152,6 +169,7 @@ PackageSet::PackageSet(Common::FSNode file, const Common::String &filename, bool
 		stream->seek(dirOffset, SEEK_SET);
 	}
 	assert(hdr._numDirs == 1);
+	Common::HashMap<Common::String, uint> filePositions;
 	for (uint32 i = 0; i < hdr._numDirs; i++) {
 		BasePackage *pkg = new BasePackage();
 		if (!pkg) {
@@ -210,8 +228,8 @@ PackageSet::PackageSet(Common::FSNode file, const Common::String &filename, bool
 				/* timeDate1 = */ stream->readUint32LE();
 				/* timeDate2 = */ stream->readUint32LE();
 			}
-			_filesIter = _files.find(upcName);
-			if (_filesIter == _files.end()) {
+			Common::HashMap<Common::String, uint>::const_iterator position = filePositions.find(upcName);
+			if (position == filePositions.end()) {
 				BaseFileEntry *fileEntry = new BaseFileEntry();
 				fileEntry->_package = pkg;
 				fileEntry->_offset = offset;
@@ -220,11 +238,12 @@ PackageSet::PackageSet(Common::FSNode file, const Common::String &filename, bool
 				fileEntry->_flags = flags;
 				fileEntry->_filename = upcName;
 
-				_files[upcName] = Common::ArchiveMemberPtr(fileEntry);
+				filePositions[upcName] = _files.size();
+				_files.push_back(Common::ArchiveMemberPtr(fileEntry));
 			} else {
 				// current package has higher priority than the registered
 				// TODO: This cast might be a bit ugly.
-				BaseFileEntry *filePtr = (BaseFileEntry *) &*(_filesIter->_value);
+				BaseFileEntry *filePtr = (BaseFileEntry *) &*(_files[position->_value]);
 				if (pkg->_priority > filePtr->_package->_priority) {
 					filePtr->_package = pkg;
 					filePtr->_offset = offset;
@@ -238,6 +257,102 @@ PackageSet::PackageSet(Common::FSNode file, const Common::String &filename, bool
 	debugC(kWintermuteDebugFileAccess, "  Registered %d files in %d package(s)", _files.size(), _packages.size());
 
 	delete stream;
+	saveIndex(file, indexType);
+	buildFileIndex();
+}
+
+bool PackageSet::loadIndex(const Common::FSNode &file, const char *type) {
+	Common::SeekableReadStream *index = ArchiveIndexMan.getIndex(type, file);
+	if (!index) {
+		return false;
+	}
+
+	_priority = index->readByte();
+	_version = index->readUint32LE();
+
+	uint32 numPackages = index->readUint32LE();
+	for (uint32 i = 0; i < numPackages && !index->eos(); i++) {
+		BasePackage *pkg = new BasePackage();
+		pkg->_fsnode = file;
+		pkg->_name = Common::ArchiveIndexCache::readString(*index);
+		pkg->_cd = index->readSint32LE();
+		pkg->_priority = index->readByte();
+		pkg->_boundToExe = index->readByte() != 0;
+		_packages.push_back(pkg);
+	}
+
+	bool valid = true;
+	uint32 numFiles = index->readUint32LE();
+	for (uint32 i = 0; i < numFiles && valid; i++) {
+		BaseFileEntry *fileEntry = new BaseFileEntry();
+		fileEntry->_filename = Common::ArchiveIndexCache::readString(*index);
+		uint32 package = index->readUint32LE();
+		fileEntry->_offset = index->readUint32LE();
+		fileEntry->_length = index->readUint32LE();
+		fileEntry->_compressedLength = index->readUint32LE();
+		fileEntry->_flags = index->readUint32LE();
+
+		valid = !index->eos() && package < _packages.size();
+		fileEntry->_package = valid ? _packages[package] : nullptr;
+		_files.push_back(Common::ArchiveMemberPtr(fileEntry));
+	}
+
+	valid = valid && !index->eos();
+	delete index;
+
+	if (!valid) {
+		_files.clear();
+		for (Common::Array<BasePackage *>::iterator it = _packages.begin(); it != _packages.end(); ++it) {
+			delete *it;
+		}
+		_packages.clear();
+		_priority = 0;
+		_version = 0;
+	}
+	return valid;
+}
+
+void PackageSet::saveIndex(const Common::FSNode &file, const char *type) const {
+	Common::MemoryWriteStreamDynamic index(DisposeAfterUse::YES);
+	index.writeByte(_priority);
+	index.writeUint32LE(_version);
+
+	index.writeUint32LE(_packages.size());
+	for (uint32 i = 0; i < _packages.size(); i++) {
+		Common::ArchiveIndexCache::writeString(index, _packages[i]->_name);
+		index.writeSint32LE(_packages[i]->_cd);
+		index.writeByte(_packages[i]->_priority);
+		index.writeByte(_packages[i]->_boundToExe);
+	}
+
+	index.writeUint32LE(_files.size());
+	for (uint32 i = 0; i < _files.size(); i++) {
+		const BaseFileEntry *fileEntry = static_cast<const BaseFileEntry *>(_files[i].get());
+
+		uint32 package = 0;
+		while (package < _packages.size() && _packages[package] != fileEntry->_package) {
+			package++;
+		}
+
+		Common::ArchiveIndexCache::writeString(index, fileEntry->_filename);
+		index.writeUint32LE(package);
+		index.writeUint32LE(fileEntry->_offset);
+		index.writeUint32LE(fileEntry->_length);
+		index.writeUint32LE(fileEntry->_compressedLength);
+		index.writeUint32LE(fileEntry->_flags);
+	}
+
+	ArchiveIndexMan.putIndex(type, file, index);
+}
+
+void PackageSet::buildFileIndex() {
+	Common::Array<Common::String> names;
+	names.reserve(_files.size());
+	for (uint32 i = 0; i < _files.size(); i++) {
+		names.push_back(static_cast<const BaseFileEntry *>(_files[i].get())->_filename);
+	}
+
+	_fileIndex.build(names);
 }
 
 PackageSet::~PackageSet() {
@@ -248,40 +363,30 @@ PackageSet::~PackageSet() {
 }
 
 bool PackageSet::hasFile(const Common::String &name) const {
-	Common::String upcName = name;
-	upcName.toUppercase();
-	Common::HashMap<Common::String, Common::ArchiveMemberPtr>::const_iterator it;
-	it = _files.find(upcName.c_str());
-	return (it != _files.end());
+	return _fileIndex.find(name) != Common::MemberIndex::kNoMember;
 }
 
 int PackageSet::listMembers(Common::ArchiveMemberList &list) const {
-	Common::HashMap<Common::String, Common::ArchiveMemberPtr>::const_iterator it = _files.begin();
-	Common::HashMap<Common::String, Common::ArchiveMemberPtr>::const_iterator end = _files.end();
 	int count = 0;
-	for (; it != end; ++it) {
-		const Common::ArchiveMemberPtr ptr(it->_value);
-		list.push_back(ptr);
+	for (uint32 i = 0; i < _files.size(); i++) {
+		list.push_back(_files[i]);
 		count++;
 	}
 	return count;
 }
 
 const Common::ArchiveMemberPtr PackageSet::getMember(const Common::String &name) const {
-	Common::String upcName = name;
-	upcName.toUppercase();
-	Common::HashMap<Common::String, Common::ArchiveMemberPtr>::const_iterator it;
-	it = _files.find(upcName.c_str());
-	return Common::ArchiveMemberPtr(it->_value);
+	int file = _fileIndex.find(name);
+	if (file == Common::MemberIndex::kNoMember) {
+		return Common::ArchiveMemberPtr();
+	}
+	return _files[file];
 }
 
 Common::SeekableReadStream *PackageSet::createReadStreamForMember(const Common::String &name) const {
-	Common::String upcName = name;
-	upcName.toUppercase();
-	Common::HashMap<Common::String, Common::ArchiveMemberPtr>::const_iterator it;
-	it = _files.find(upcName.c_str());
-	if (it != _files.end()) {
-		return it->_value->createReadStream();
+	int file = _fileIndex.find(name);
+	if (file != Common::MemberIndex::kNoMember) {
+		return _files[file]->createReadStream();
 	}
 	return nullptr;
 }
@@ -32,6 +32,7 @@
 #include "common/archive.h"
 #include "common/stream.h"
 #include "common/fs.h"
+#include "common/memberindex.h"
 
 namespace Wintermute {
 class BasePackage {
@@ -81,11 +82,15 @@ public:
 	uint32 getVersion() const { return _version; }
 
 private:
+	bool loadIndex(const Common::FSNode &file, const char *type);
+	void saveIndex(const Common::FSNode &file, const char *type) const;
+	void buildFileIndex();
+
 	byte _priority;
 	uint32 _version;
 	Common::Array<BasePackage *> _packages;
-	Common::HashMap<Common::String, Common::ArchiveMemberPtr> _files;
-	Common::HashMap<Common::String, Common::ArchiveMemberPtr>::iterator _filesIter;
+	Common::Array<Common::ArchiveMemberPtr> _files;
+	Common::MemberIndex _fileIndex; ///< Finds the position of a file in _files from its name
 };
 
 } // End of namespace Wintermute
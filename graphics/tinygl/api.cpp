@@ -653,6 +653,22 @@ void tglCallList(unsigned int list) {
 	TinyGL::gl_add_op(p);
 }
 
+unsigned int tglGenLists(int range) {
+	return TinyGL::glGenLists(range);
+}
+
+int tglIsList(unsigned int list) {
+	return TinyGL::glIsList(list);
+}
+
+void tglNewList(unsigned int list, int mode) {
+	TinyGL::glNewList(list, mode);
+}
+
+void tglEndList() {
+	TinyGL::glEndList();
+}
+
 void tglFlush() {
 	// nothing to do
 }
@@ -690,3 +706,24 @@ void tglEnableDirtyRects(bool enable) {
 	TinyGL::GLContext *c = TinyGL::gl_get_context();
 	c->_enableDirtyRectangles = enable;
 }
+
+void tglEnableTiledRendering(bool enable) {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	c->_enableTiledRendering = enable;
+}
+
+void tglGetDirtyRectStats(int *rasterizedPixels, int *restoredPixels, int *reusedPixels) {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	*rasterizedPixels = c->_rasterizedPixels;
+	*restoredPixels = c->_restoredPixels;
+	*reusedPixels = c->_reusedPixels;
+}
+
+void tglGetDrawCallMemoryStats(int *usedBytes, int *highWaterBytes, int *reservedBytes) {
+	TinyGL::GLContext *c = TinyGL::gl_get_context();
+	const TinyGL::LinearAllocator &current = c->_drawCallAllocator[c->_currentAllocatorIndex];
+	const TinyGL::LinearAllocator &previous = c->_drawCallAllocator[c->_currentAllocatorIndex ^ 1];
+	*usedBytes = current.getUsedSize();
+	*highWaterBytes = MAX(current.getHighWaterSize(), previous.getHighWaterSize());
+	*reservedBytes = current.getReservedSize() + previous.getReservedSize();
+}
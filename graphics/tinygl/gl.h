@@ -846,6 +846,13 @@ void tglTexCoordPointer(TGLint size, TGLenum type, TGLsizei stride, const TGLvoi
 void tglPolygonOffset(TGLfloat factor, TGLfloat units);
 
 void tglEnableDirtyRects(bool enable);
+void tglEnableTiledRendering(bool enable);
+// Pixels of the last presented frame which were fully rasterized, restored from the snapshot
+// of the unchanged draw calls (only the others being rasterized), and kept from the previous frame.
+void tglGetDirtyRectStats(int *rasterizedPixels, int *restoredPixels, int *reusedPixels);
+// Bytes used by the draw calls of the current frame, the most used by a single frame,
+// and reserved for the draw calls of the current and previous frames.
+void tglGetDrawCallMemoryStats(int *usedBytes, int *highWaterBytes, int *reservedBytes);
 
 void tglDebug(int mode);
 
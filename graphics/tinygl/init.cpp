@@ -62,7 +62,7 @@ void glInit(void *zbuffer1, int textureSize) {
 	if ((textureSize & (textureSize - 1)))
 		error("glInit: texture size not power of two: %d", textureSize);
 
-	if (textureSize <= 1 || textureSize > 4096)
+	if (textureSize < ZB_TEXTURE_MIN_SIZE || textureSize > 4096)
 		error("glInit: texture size not allowed: %d", textureSize);
 
 	c = new GLContext();
@@ -71,6 +71,9 @@ void glInit(void *zbuffer1, int textureSize) {
 	c->fb = zbuffer;
 
 	c->fb->_textureSize = c->_textureSize = textureSize;
+	c->fb->_textureSizeShift = 0;
+	while ((1 << c->fb->_textureSizeShift) < textureSize)
+		c->fb->_textureSizeShift++;
 	c->fb->_textureSizeMask = (textureSize - 1) << ZB_POINT_ST_FRAC_BITS;
 	c->renderRect = Common::Rect(0, 0, zbuffer->xsize, zbuffer->ysize);
 
@@ -93,9 +96,11 @@ void glInit(void *zbuffer1, int textureSize) {
 
 	c->exec_flag = 1;
 	c->compile_flag = 0;
+	c->current_list = NULL;
 	c->print_flag = 0;
 
 	c->in_begin = 0;
+	c->vertex_processed = 0;
 
 	// lights
 	for (int i = 0; i < T_MAX_LIGHTS; i++) {
@@ -228,12 +233,21 @@ void glInit(void *zbuffer1, int textureSize) {
 
 	c->color_mask = (1 << 24) | (1 << 16) | (1 << 8) | (1 << 0);
 
-	const int kDrawCallMemory = 5 * 1024 * 1024;
+	// Initial size of the draw call allocators, they grow as needed.
+	const int kDrawCallMemory = 1024 * 1024;
 
 	c->_currentAllocatorIndex = 0;
 	c->_drawCallAllocator[0].initialize(kDrawCallMemory);
 	c->_drawCallAllocator[1].initialize(kDrawCallMemory);
 	c->_enableDirtyRectangles = true;
+	c->_enableTiledRendering = false;
+
+	c->_snapshotDrawCallCount = 0;
+	c->_snapshotColorBuffer = nullptr;
+	c->_snapshotZBuffer = nullptr;
+	c->_rasterizedPixels = 0;
+	c->_restoredPixels = 0;
+	c->_reusedPixels = 0;
 
 	Graphics::Internal::tglBlitResetScissorRect();
 }
@@ -243,6 +257,8 @@ void glClose() {
 
 	tglDisposeDrawCallLists(c);
 	tglDisposeResources(c);
+	gl_free(c->_snapshotColorBuffer);
+	gl_free(c->_snapshotZBuffer);
 
 	specbuf_cleanup(c);
 	for (int i = 0; i < 3; i++)
@@ -68,6 +68,8 @@ static void delete_list(GLContext *c, int list) {
 	l = find_list(c, list);
 	assert(l);
 
+	delete l->compiled;
+
 	// free param buffer
 	pb = l->first_op_buffer;
 	while (pb) {
@@ -182,6 +184,197 @@ void glopNextBuffer(GLContext *, GLParam *) {
 	assert(0);
 }
 
+static const uint kAttributeNotSet = 0xFFFFFFFF;
+
+// Flattens the list if it only specifies geometry. Returns NULL for the other lists, which
+// are replayed from their op stream.
+static GLCompiledList *compile_list(GLList *l) {
+	GLCompiledList *compiled = new GLCompiledList();
+	GLCompiledPrimitive primitive;
+	GLVertex vertex;
+	bool inBegin = false, setColor = false, setNormal = false, setTexCoord = false, setEdgeFlag = false;
+
+	vertex = GLVertex();
+	compiled->transformedValid = false;
+
+	GLParam *p = l->first_op_buffer->ops;
+	while (1) {
+		int op = p[0].op;
+		if (op == OP_EndList)
+			break;
+		if (op == OP_NextBuffer) {
+			p = (GLParam *)p[1].p;
+			continue;
+		}
+
+		switch (op) {
+		case OP_Begin:
+			if (inBegin) {
+				delete compiled;
+				return NULL;
+			}
+			inBegin = true;
+			primitive.type = p[1].i;
+			primitive.first = compiled->vertices.size();
+			break;
+		case OP_End:
+			if (!inBegin) {
+				delete compiled;
+				return NULL;
+			}
+			inBegin = false;
+			primitive.count = compiled->vertices.size() - primitive.first;
+			compiled->primitives.push_back(primitive);
+			break;
+		case OP_Vertex:
+			if (!inBegin) {
+				delete compiled;
+				return NULL;
+			}
+			vertex.coord = Vector4(p[1].f, p[2].f, p[3].f, p[4].f);
+			compiled->vertices.push_back(vertex);
+			break;
+		case OP_Color:
+			if (!setColor)
+				compiled->colorSetAt = compiled->vertices.size();
+			setColor = true;
+			vertex.color = Vector4(p[1].f, p[2].f, p[3].f, p[4].f);
+			break;
+		case OP_Normal:
+			if (!setNormal)
+				compiled->normalSetAt = compiled->vertices.size();
+			setNormal = true;
+			vertex.normal = Vector3(p[1].f, p[2].f, p[3].f);
+			compiled->normal = Vector4(p[1].f, p[2].f, p[3].f, 0.0f);
+			break;
+		case OP_TexCoord:
+			if (!setTexCoord)
+				compiled->texCoordSetAt = compiled->vertices.size();
+			setTexCoord = true;
+			vertex.tex_coord = Vector4(p[1].f, p[2].f, p[3].f, p[4].f);
+			break;
+		case OP_EdgeFlag:
+			if (!setEdgeFlag)
+				compiled->edgeFlagSetAt = compiled->vertices.size();
+			setEdgeFlag = true;
+			vertex.edge_flag = p[1].i;
+			break;
+		default:
+			// state changes are left to the op stream
+			delete compiled;
+			return NULL;
+		}
+		p += op_table_size[op];
+	}
+
+	if (inBegin) {
+		delete compiled;
+		return NULL;
+	}
+
+	// attributes never set are taken from the current state by all the vertices
+	if (!setColor)
+		compiled->colorSetAt = kAttributeNotSet;
+	if (!setNormal)
+		compiled->normalSetAt = kAttributeNotSet;
+	if (!setTexCoord)
+		compiled->texCoordSetAt = kAttributeNotSet;
+	if (!setEdgeFlag)
+		compiled->edgeFlagSetAt = kAttributeNotSet;
+
+	// the current state after the list
+	compiled->color = vertex.color;
+	compiled->texCoord = vertex.tex_coord;
+	compiled->edgeFlag = vertex.edge_flag;
+
+	return compiled;
+}
+
+// Only the transformation of the vertices is cached, so the lighting must be off and the
+// transformed attributes must not come from the current state.
+static bool can_cache_transformed(GLContext *c, GLCompiledList *l) {
+	return !c->lighting_enabled && l->colorSetAt == 0 &&
+		(!c->texture_2d_enabled || l->texCoordSetAt == 0);
+}
+
+static bool is_transformed_valid(GLContext *c, GLCompiledList *l) {
+	if (!l->transformedValid || l->transformedTexture2D != c->texture_2d_enabled)
+		return false;
+	if (l->transformedViewport[0] != c->viewport.xmin || l->transformedViewport[1] != c->viewport.ymin ||
+	    l->transformedViewport[2] != c->viewport.xsize || l->transformedViewport[3] != c->viewport.ysize)
+		return false;
+	if (memcmp(l->transformedModelProjection._m, c->matrix_model_projection._m, sizeof(l->transformedModelProjection._m)))
+		return false;
+	return !c->texture_2d_enabled ||
+		!memcmp(l->transformedTextureMatrix._m, c->matrix_stack_ptr[2]->_m, sizeof(l->transformedTextureMatrix._m));
+}
+
+static void call_compiled_list(GLContext *c, GLCompiledList *l) {
+	bool useTransformed = false, storeTransformed = false;
+
+	for (uint i = 0; i < l->primitives.size(); i++) {
+		const GLCompiledPrimitive &primitive = l->primitives[i];
+		GLParam p[2];
+		p[1].i = primitive.type;
+		glopBegin(c, p);
+
+		// glopBegin() has updated the matrices and the viewport
+		if (i == 0 && can_cache_transformed(c, l)) {
+			useTransformed = is_transformed_valid(c, l);
+			storeTransformed = !useTransformed;
+			if (storeTransformed)
+				l->transformed.resize(l->vertices.size());
+		}
+
+		gl_reserve_vertices(c, primitive.count);
+		GLVertex *vertices = c->vertex;
+		const GLVertex *source = useTransformed ? &l->transformed[primitive.first] : &l->vertices[primitive.first];
+		memcpy(vertices, source, primitive.count * sizeof(GLVertex));
+
+		for (int j = 0; j < primitive.count; j++) {
+			uint index = primitive.first + j;
+			if (index < l->edgeFlagSetAt)
+				vertices[j].edge_flag = c->current_edge_flag;
+			if (useTransformed)
+				continue;
+			if (index < l->colorSetAt)
+				vertices[j].color = c->current_color;
+			if (index < l->normalSetAt)
+				vertices[j].normal = Vector3(c->current_normal.X, c->current_normal.Y, c->current_normal.Z);
+			if (index < l->texCoordSetAt)
+				vertices[j].tex_coord = c->current_tex_coord;
+		}
+
+		c->vertex_n = c->vertex_cnt = primitive.count;
+		c->vertex_processed = useTransformed ? primitive.count : 0;
+		gl_process_vertices(c);
+		if (storeTransformed)
+			memcpy(&l->transformed[primitive.first], vertices, primitive.count * sizeof(GLVertex));
+
+		glopEnd(c, p);
+	}
+
+	if (storeTransformed) {
+		l->transformedValid = true;
+		l->transformedModelProjection = c->matrix_model_projection;
+		l->transformedTextureMatrix = *c->matrix_stack_ptr[2];
+		l->transformedTexture2D = c->texture_2d_enabled;
+		l->transformedViewport[0] = c->viewport.xmin;
+		l->transformedViewport[1] = c->viewport.ymin;
+		l->transformedViewport[2] = c->viewport.xsize;
+		l->transformedViewport[3] = c->viewport.ysize;
+	}
+
+	if (l->colorSetAt != kAttributeNotSet)
+		c->current_color = l->color;
+	if (l->normalSetAt != kAttributeNotSet)
+		c->current_normal = l->normal;
+	if (l->texCoordSetAt != kAttributeNotSet)
+		c->current_tex_coord = l->texCoord;
+	if (l->edgeFlagSetAt != kAttributeNotSet)
+		c->current_edge_flag = l->edgeFlag;
+}
+
 void glopCallList(GLContext *c, GLParam *p) {
 	GLList *l;
 	int list, op;
@@ -190,6 +383,13 @@ void glopCallList(GLContext *c, GLParam *p) {
 	l = find_list(c, list);
 	if (!l)
 		error("list %d not defined", list);
+
+	// with color material, glColor also changes the material
+	if (l->compiled && !(c->color_material_enabled && l->compiled->colorSetAt != kAttributeNotSet)) {
+		call_compiled_list(c, l->compiled);
+		return;
+	}
+
 	p = l->first_op_buffer->ops;
 
 	while (1) {
@@ -217,6 +417,7 @@ void glNewList(unsigned int list, int mode) {
 		delete_list(c, list);
 	l = alloc_list(c, list);
 
+	c->current_list = l;
 	c->current_op_buffer = l->first_op_buffer;
 	c->current_op_buffer_index = 0;
 
@@ -227,6 +428,7 @@ void glNewList(unsigned int list, int mode) {
 void glEndList() {
 	GLContext *c = gl_get_context();
 	GLParam p[1];
+	GLList *l;
 
 	assert(c->compile_flag == 1);
 
@@ -234,6 +436,10 @@ void glEndList() {
 	p[0].op = OP_EndList;
 	gl_compile_op(c, p);
 
+	l = c->current_list;
+	l->compiled = compile_list(l);
+	c->current_list = NULL;
+
 	c->compile_flag = 0;
 	c->exec_flag = 1;
 }
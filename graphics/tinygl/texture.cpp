@@ -88,6 +88,8 @@ GLTexture *alloc_texture(GLContext *c, int h) {
 	t->handle = h;
 	t->disposed = false;
 	t->versionNumber = 0;
+	t->levelCount = 0;
+	t->minFilter = TGL_NEAREST_MIPMAP_LINEAR;
 
 	return t;
 }
@@ -112,6 +114,58 @@ void glopBindTexture(GLContext *c, GLParam *p) {
 	c->current_texture = t;
 }
 
+// Averages each 2x2 block of the 4 bytes per texel image src, of size x size texels, into dst.
+static void gl_halve_image(byte *dst, const byte *src, int size) {
+	int pitch = size * 4;
+	for (int y = 0; y < size / 2; y++) {
+		const byte *row0 = src + y * 2 * pitch;
+		const byte *row1 = row0 + pitch;
+		for (int x = 0; x < size / 2; x++) {
+			for (int i = 0; i < 4; i++) {
+				*dst++ = (row0[i] + row0[i + 4] + row1[i] + row1[i + 4] + 2) >> 2;
+			}
+			row0 += 8;
+			row1 += 8;
+		}
+	}
+}
+
+// Stores a copy of the texels of a level, given in rows, in the tiled layout used by the
+// rasterizer (see textureTexelOffset()).
+static void set_texture_level(GLTexture *texture, int level, const Graphics::PixelFormat &pf, byte *texels, int size) {
+	int sizeShift = 0;
+	while ((1 << sizeShift) < size)
+		sizeShift++;
+
+	uint32 *tiled = (uint32 *)new byte[size * size * 4];
+	const uint32 *rows = (const uint32 *)texels;
+	for (int t = 0; t < size; t++) {
+		for (int s = 0; s < size; s++) {
+			tiled[textureTexelOffset(s, t, sizeShift)] = rows[t * size + s];
+		}
+	}
+
+	GLImage *im = &texture->images[level];
+	im->xsize = size;
+	im->ysize = size;
+	if (im->pixmap)
+		im->pixmap.free();
+	im->pixmap = Graphics::PixelBuffer(pf, (byte *)tiled);
+	texture->levelTexels[level] = tiled;
+}
+
+int gl_texture_level_count(GLTexture *texture) {
+	switch (texture->minFilter) {
+	case TGL_NEAREST_MIPMAP_NEAREST:
+	case TGL_NEAREST_MIPMAP_LINEAR:
+	case TGL_LINEAR_MIPMAP_NEAREST:
+	case TGL_LINEAR_MIPMAP_LINEAR:
+		return MAX(texture->levelCount, 1);
+	default:
+		return 1;
+	}
+}
+
 void glopTexImage2D(GLContext *c, GLParam *p) {
 	int target = p[1].i;
 	int level = p[2].i;
@@ -122,7 +176,6 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 	int format = p[7].i;
 	int type = p[8].i;
 	byte *pixels = (byte *)p[9].p;
-	GLImage *im;
 	byte *pixels1;
 	bool do_free_after_rgb2rgba = false;
 
@@ -191,15 +244,20 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 		error("tglTexImage2D: combination of parameters not handled");
 	}
 
-	pixels1 = new byte[c->_textureSize * c->_textureSize * bytes];
+	// the levels of the mipmap chain are all square, down to one texel tile
+	int levelSize = c->_textureSize >> level;
+	if (level >= MAX_TEXTURE_LEVELS || levelSize < ZB_TEXTURE_MIN_SIZE)
+		error("tglTexImage2D: mipmap level %d not handled", level);
+
+	pixels1 = new byte[levelSize * levelSize * bytes];
 	if (pixels != NULL) {
-		if (width != c->_textureSize || height != c->_textureSize) {
+		if (width != levelSize || height != levelSize) {
 			// we use interpolation for better looking result
-			gl_resizeImage(pixels1, c->_textureSize, c->_textureSize, pixels, width, height);
-			width = c->_textureSize;
-			height = c->_textureSize;
+			gl_resizeImage(pixels1, levelSize, levelSize, pixels, width, height);
+			width = levelSize;
+			height = levelSize;
 		} else {
-			memcpy(pixels1, pixels, c->_textureSize * c->_textureSize * bytes);
+			memcpy(pixels1, pixels, levelSize * levelSize * bytes);
 		}
 #if defined(SCUMM_BIG_ENDIAN)
 		if (type == TGL_UNSIGNED_INT_8_8_8_8_REV) {
@@ -214,13 +272,28 @@ void glopTexImage2D(GLContext *c, GLParam *p) {
 #endif
 	}
 
-	c->current_texture->versionNumber++;
-	im = &c->current_texture->images[level];
-	im->xsize = width;
-	im->ysize = height;
-	if (im->pixmap)
-		im->pixmap.free();
-	im->pixmap = Graphics::PixelBuffer(pf, pixels1);
+	GLTexture *texture = c->current_texture;
+	texture->versionNumber++;
+	if (level == 0) {
+		// generate the smaller levels from this one, which are replaced if the application
+		// specifies them afterwards
+		texture->levelCount = 1;
+		if (pixels != NULL) {
+			byte *previous = pixels1;
+			for (int size = levelSize / 2; size >= ZB_TEXTURE_MIN_SIZE; size /= 2) {
+				byte *halved = new byte[size * size * bytes];
+				gl_halve_image(halved, previous, size * 2);
+				set_texture_level(texture, texture->levelCount++, pf, halved, size);
+				if (previous != pixels1)
+					delete[] previous;
+				previous = halved;
+			}
+			if (previous != pixels1)
+				delete[] previous;
+		}
+	}
+	set_texture_level(texture, level, pf, pixels1, levelSize);
+	delete[] pixels1;
 
 	if (do_free_after_rgb2rgba) {
 		// pixels as been assigned to tmp.getRawBuffer() which was created with
@@ -248,7 +321,7 @@ error:
 }
 
 // TODO: not all tests are done
-void glopTexParameter(GLContext *, GLParam *p) {
+void glopTexParameter(GLContext *c, GLParam *p) {
 	int target = p[1].i;
 	int pname = p[2].i;
 	int param = p[3].i;
@@ -264,6 +337,12 @@ error:
 		if (param != TGL_REPEAT)
 			goto error;
 		break;
+	case TGL_TEXTURE_MIN_FILTER:
+		if (c->current_texture->minFilter != param) {
+			c->current_texture->minFilter = param;
+			c->current_texture->versionNumber++;
+		}
+		break;
 	default:
 		;
 	}
@@ -93,6 +93,7 @@ void glopBegin(GLContext *c, GLParam *p) {
 	c->in_begin = 1;
 	c->vertex_n = 0;
 	c->vertex_cnt = 0;
+	c->vertex_processed = 0;
 
 	if (c->matrix_model_projection_updated) {
 		if (c->lighting_enabled) {
@@ -150,42 +151,85 @@ void glopBegin(GLContext *c, GLParam *p) {
 	}
 }
 
-// coords, tranformation, clip code and projection
-// TODO : handle all cases
-static inline void gl_vertex_transform(GLContext *c, GLVertex *v) {
-	Matrix4 *m;
+// coords, tranformation, clip code, lighting and projection of the vertices recorded since the
+// last call. The vertices are processed one stage at a time, so that the matrices stay in
+// registers and the transformations can use the batched versions.
+void gl_process_vertices(GLContext *c) {
+	int first = c->vertex_processed;
+	int count = c->vertex_n - first;
+	if (count <= 0)
+		return;
+
+	GLVertex *vertices = &c->vertex[first];
+	const int stride = sizeof(GLVertex);
 
 	if (c->lighting_enabled) {
 		// eye coordinates needed for lighting
-
-		m = c->matrix_stack_ptr[0];
-		m->transform3x4(v->coord,v->ec);
+		c->matrix_stack_ptr[0]->transformArray3x4(&vertices[0].coord, &vertices[0].ec, count, stride);
 
 		// projection coordinates
-		m = c->matrix_stack_ptr[1];
-		m->transform(v->ec, v->pc);
-
-		m = &c->matrix_model_view_inv;
-
-		m->transform3x3(c->current_normal, v->normal);
-
-		if (c->normalize_enabled) {
-			v->normal.normalize();
+		c->matrix_stack_ptr[1]->transformArray(&vertices[0].ec, &vertices[0].pc, count, stride);
+
+		const Matrix4 &m = c->matrix_model_view_inv;
+		for (int i = 0; i < count; i++) {
+			GLVertex *v = &vertices[i];
+			const Vector3 normal = v->normal;
+			m.transform3x3(normal, v->normal);
+			if (c->normalize_enabled) {
+				v->normal.normalize();
+			}
+		}
+		for (int i = 0; i < count; i++) {
+			gl_shade_vertex(c, &vertices[i]);
 		}
 	} else {
 		// no eye coordinates needed, no normal
 		// NOTE: W = 1 is assumed
-		m = &c->matrix_model_projection;
-
-		m->transform3x4(v->coord, v->pc);
-		if (c->matrix_model_projection_no_w_transform) {
-			v->pc.W = (m->_m[3][3]);
+		const Matrix4 &m = c->matrix_model_projection;
+
+		m.transformArray3x4(&vertices[0].coord, &vertices[0].pc, count, stride);
+		for (int i = 0; i < count; i++) {
+			GLVertex *v = &vertices[i];
+			if (c->matrix_model_projection_no_w_transform) {
+				v->pc.W = (m._m[3][3]);
+			}
+			v->normal.X = v->normal.Y = v->normal.Z = 0;
+			v->ec.X = v->ec.Y = v->ec.Z = v->ec.W = 0;
 		}
-		v->normal.X = v->normal.Y = v->normal.Z = 0;
-		v->ec.X = v->ec.Y = v->ec.Z = v->ec.W = 0;
 	}
 
-	v->clip_code = gl_clipcode(v->pc.X, v->pc.Y, v->pc.Z, v->pc.W);
+	// tex coords
+	if (c->texture_2d_enabled && c->apply_texture_matrix) {
+		c->matrix_stack_ptr[2]->transformArray(&vertices[0].tex_coord, &vertices[0].tex_coord, count, stride);
+	}
+
+	for (int i = 0; i < count; i++) {
+		GLVertex *v = &vertices[i];
+		v->clip_code = gl_clipcode(v->pc.X, v->pc.Y, v->pc.Z, v->pc.W);
+		// precompute the mapping to the viewport
+		if (v->clip_code == 0)
+			gl_transform_to_viewport(c, v);
+	}
+
+	c->vertex_processed = c->vertex_n;
+}
+
+// quick fix to avoid crashes on large polygons
+void gl_reserve_vertices(GLContext *c, int count) {
+	if (count <= c->vertex_max)
+		return;
+
+	int maxVertices = c->vertex_max;
+	while (maxVertices < count)
+		maxVertices <<= 1;    // just double size
+	GLVertex *newarray = (GLVertex *)gl_malloc(sizeof(GLVertex) * maxVertices);
+	if (!newarray) {
+		error("unable to allocate GLVertex array.");
+	}
+	memcpy(newarray, c->vertex, c->vertex_n * sizeof(GLVertex));
+	gl_free(c->vertex);
+	c->vertex = newarray;
+	c->vertex_max = maxVertices;
 }
 
 void glopVertex(GLContext *c, GLParam *p) {
@@ -199,18 +243,7 @@ void glopVertex(GLContext *c, GLParam *p) {
 	cnt++;
 	c->vertex_cnt = cnt;
 
-	// quick fix to avoid crashes on large polygons
-	if (n >= c->vertex_max) {
-		GLVertex *newarray;
-		c->vertex_max <<= 1;    // just double size
-		newarray = (GLVertex *)gl_malloc(sizeof(GLVertex) * c->vertex_max);
-		if (!newarray) {
-			error("unable to allocate GLVertex array.");
-		}
-		memcpy(newarray, c->vertex, n * sizeof(GLVertex));
-		gl_free(c->vertex);
-		c->vertex = newarray;
-	}
+	gl_reserve_vertices(c, n + 1);
 	// new vertex entry
 	v = &c->vertex[n];
 	n++;
@@ -220,28 +253,18 @@ void glopVertex(GLContext *c, GLParam *p) {
 	v->coord.Z = p[3].f;
 	v->coord.W = p[4].f;
 
-	gl_vertex_transform(c, v);
-
-	// color
-
+	// the current state is only recorded here, the vertex is transformed and lit later by
+	// gl_process_vertices() together with the other vertices of the primitive
 	if (c->lighting_enabled) {
-		gl_shade_vertex(c, v);
-	} else {
-		v->color = c->current_color;
+		v->normal.X = c->current_normal.X;
+		v->normal.Y = c->current_normal.Y;
+		v->normal.Z = c->current_normal.Z;
 	}
-
-	// tex coords
+	v->color = c->current_color;
 
 	if (c->texture_2d_enabled) {
-		if (c->apply_texture_matrix) {
-			c->matrix_stack_ptr[2]->transform(c->current_tex_coord, v->tex_coord);
-		} else {
-			v->tex_coord = c->current_tex_coord;
-		}
+		v->tex_coord = c->current_tex_coord;
 	}
-	// precompute the mapping to the viewport
-	if (v->clip_code == 0)
-		gl_transform_to_viewport(c, v);
 
 	// edge flag
 
@@ -252,7 +275,9 @@ void glopVertex(GLContext *c, GLParam *p) {
 
 void glopEnd(GLContext *c, GLParam *) {
 	assert(c->in_begin == 1);
-	
+
+	gl_process_vertices(c);
+
 	if (c->vertex_cnt > 0) {
 		tglIssueDrawCall(new Graphics::RasterizationDrawCall());
 	}
@@ -41,7 +41,7 @@ Common::Rect rotateRectangle(int x, int y, int width, int height, int rotation,
 
 struct BlitImage {
 public:
-	BlitImage() : _isDisposed(false), _version(0), _binaryTransparent(false), _refcount(1) { }
+	BlitImage() : _isDisposed(false), _version(0), _refcount(1) { }
 
 	void loadData(const Graphics::Surface &surface, uint32 colorKey, bool applyColorKey) {
 		const Graphics::PixelFormat textureFormat(4, 8, 8, 8, 8, 0, 8, 16, 24);
@@ -59,34 +59,38 @@ public:
 			}
 		}
 
-		// Create opaque lines data.
-		// A line of pixels can not wrap more that one line of the image, since it would break
-		// blitting of bitmaps with a non-zero x position.
-		Graphics::PixelBuffer srcBuf = dataBuffer;
-		_lines.clear();
-		_binaryTransparent = true;
+		// Index the opaque and partially transparent runs of each line, so that blitting
+		// can copy the former, blend the latter and skip the transparent pixels. A span can
+		// not wrap more than one line of the image, since it would break blitting of bitmaps
+		// with a non-zero x position.
+		_spans.clear();
+		_rowSpans.resize(surface.h + 1);
 		for (int y = 0; y < surface.h; y++) {
-			int start = -1;
-			for (int x = 0; x < surface.w; ++x) {
-				// We found a transparent pixel, so save a line from 'start' to the pixel before this.
-				uint8 r, g, b, a;
-				srcBuf.getARGBAt(x, a, r, g, b);
-				if (a != 0 && a != 0xFF) {
-					_binaryTransparent = false;
+			_rowSpans[y] = _spans.size();
+			int start = 0;
+			int startClass = kTransparent;
+			for (int x = 0; x <= surface.w; ++x) {
+				int pixelClass = kTransparent;
+				if (x < surface.w) {
+					uint8 r, g, b, a;
+					dataBuffer.getARGBAt(y * surface.w + x, a, r, g, b);
+					pixelClass = a == 0 ? kTransparent : (a == 0xFF ? kOpaque : kTranslucent);
 				}
-				if (a == 0 && start >= 0) {
-					_lines.push_back(Line(start, y, x - start, srcBuf.getRawBuffer(start), textureFormat));
-					start = -1;
-				} else if (a != 0 && start == -1) {
+				if (pixelClass != startClass) {
+					if (startClass != kTransparent) {
+						_spans.push_back(Span(start, x - start, startClass == kOpaque));
+					}
 					start = x;
+					startClass = pixelClass;
 				}
 			}
-			// end of the bitmap line. if start is an actual pixel save the line.
-			if (start >= 0) {
-				_lines.push_back(Line(start, y, surface.w - start, srcBuf.getRawBuffer(start), textureFormat));
-			}
-			srcBuf.shiftBy(surface.w);
 		}
+		_rowSpans[surface.h] = _spans.size();
+
+		// Opaque spans are copied from a copy of the image converted to the screen format.
+		_screenPixels.free();
+		_screenPixels.create(TinyGL::gl_get_context()->fb->cmode, size, DisposeAfterUse::NO);
+		_screenPixels.copyBuffer(0, 0, size, dataBuffer);
 
 		_version++;
 	}
@@ -97,33 +101,24 @@ public:
 
 	~BlitImage() {
 		_surface.free();
+		_screenPixels.free();
 	}
 
-	struct Line {
+	enum {
+		kTransparent,
+		kTranslucent,
+		kOpaque
+	};
+
+	// A run of pixels of a line of the image, which are either all opaque or all partially
+	// transparent. Fully transparent pixels are not part of any span.
+	struct Span {
 		int _x;
-		int _y;
 		int _length;
-		byte *_pixels;
-		Graphics::PixelBuffer _buf; // This is needed for the conversion.
-
-		Line() : _x(0), _y(0), _length(0), _pixels(nullptr) { }
-		Line(int x, int y, int length, byte *pixels, const Graphics::PixelFormat &textureFormat) : _buf(TinyGL::gl_get_context()->fb->cmode, length, DisposeAfterUse::NO),
-					_x(x), _y(y), _length(length) {
-			// Performing texture to screen conversion.
-			Graphics::PixelBuffer srcBuf(textureFormat, pixels);
-			_buf.copyBuffer(0, 0, length, srcBuf);
-			_pixels = _buf.getRawBuffer();
-		}
-
-		Line(const Line& other) : _buf(other._buf.getFormat(), other._length, DisposeAfterUse::NO),
-					_x(other._x), _y(other._y), _length(other._length){
-			_buf.copyBuffer(0, 0, _length, other._buf);
-			_pixels = _buf.getRawBuffer();
-		}
+		bool _opaque;
 
-		~Line() {
-			_buf.free();
-		}
+		Span() : _x(0), _length(0), _opaque(false) { }
+		Span(int x, int length, bool opaque) : _x(x), _length(length), _opaque(opaque) { }
 	};
 
 	FORCEINLINE bool clipBlitImage(TinyGL::GLContext *c, int &srcX, int &srcY, int &srcWidth, int &srcHeight, int &width, int &height, int &dstX, int &dstY, int &clampWidth, int &clampHeight) {
@@ -198,6 +193,7 @@ public:
 			dstBuf.shiftBy(c->fb->xsize);
 			srcBuf.shiftBy(_surface.w);
 		}
+		c->fb->refreshHierarchicalZ(dstX, dstY, clampWidth, clampHeight);
 	}
 
 	template <bool kDisableColoring, bool kDisableBlending, bool kEnableAlphaBlending>
@@ -251,8 +247,9 @@ public:
 	bool isDisposed() const { return _isDisposed; }
 private:
 	bool _isDisposed;
-	bool _binaryTransparent;
-	Common::Array<Line> _lines;
+	Common::Array<Span> _spans;
+	Common::Array<uint32> _rowSpans; // The spans of line y are [_rowSpans[y], _rowSpans[y + 1]).
+	Graphics::PixelBuffer _screenPixels;
 	Graphics::Surface _surface;
 	int _version;
 	int _refcount;
@@ -290,7 +287,8 @@ void tglDeleteBlitImage(BlitImage *blitImage) {
 	}
 }
 
-// This function uses RLE encoding to skip transparent bitmap parts
+// This function uses the span index of the image to skip transparent bitmap parts, copy
+// the opaque ones and blend only the partially transparent ones.
 // This blit only supports tinting but it will fall back to simpleBlit
 // if flipping is required (or anything more complex than that, including rotationd and scaling).
 template <bool kDisableColoring, bool kDisableBlending, bool kEnableAlphaBlending>
@@ -306,78 +304,39 @@ FORCEINLINE void BlitImage::tglBlitRLE(int dstX, int dstY, int srcX, int srcY, i
 		return;
 
 	Graphics::PixelBuffer srcBuf(_surface.format, (byte *)_surface.getPixels());
-	srcBuf.shiftBy(srcX + (srcY * _surface.w));
-
-	Graphics::PixelBuffer dstBuf(c->fb->cmode, c->fb->getPixelBuffer());
-	dstBuf.shiftBy(dstY * c->fb->xsize + dstX);
-
+	byte *dstPixels = c->fb->getPixelBuffer();
 	int kBytesPerPixel = c->fb->cmode.bytesPerPixel;
 
-	uint32 lineIndex = 0;
 	int maxY = srcY + clampHeight;
 	int maxX = srcX + clampWidth;
-	while (lineIndex < _lines.size() && _lines[lineIndex]._y < srcY) {
-		lineIndex++;
-	}
-
-	if (_binaryTransparent || (kDisableBlending || !kEnableAlphaBlending)) { // If bitmap is binary transparent or if  we need complex forms of blending (not just alpha) we need to use writePixel, which is slower 
-		while (lineIndex < _lines.size() && _lines[lineIndex]._y < maxY) {
-			const BlitImage::Line &l = _lines[lineIndex];
-			if (l._x < maxX && l._x + l._length > srcX) {
-				int length = l._length;
-				int skipStart = (l._x < srcX) ? (srcX - l._x) : 0;
-				length -= skipStart;
-				int skipEnd   = (l._x + l._length > maxX) ? (l._x + l._length - maxX) : 0;
-				length -= skipEnd;
-				if (kDisableColoring && (kEnableAlphaBlending == false || kDisableBlending)) {
-					memcpy(dstBuf.getRawBuffer((l._y - srcY) * c->fb->xsize + MAX(l._x - srcX, 0)),
-						l._pixels + skipStart * kBytesPerPixel, length * kBytesPerPixel);
-				} else {
-					int xStart = MAX(l._x - srcX, 0);
+	for (int y = srcY; y < maxY; y++) {
+		// The frame buffer pixel where column 0 of the image line would go.
+		int dstLine = (dstY + y - srcY) * c->fb->xsize + dstX - srcX;
+		int srcLine = y * _surface.w;
+		for (uint32 i = _rowSpans[y]; i < _rowSpans[y + 1]; i++) {
+			const Span &span = _spans[i];
+			int start = MAX(span._x, srcX);
+			int end = MIN(span._x + span._length, maxX);
+			if (start >= end)
+				continue;
+
+			if (kDisableColoring && (kDisableBlending || (kEnableAlphaBlending && span._opaque))) {
+				memcpy(dstPixels + (dstLine + start) * kBytesPerPixel, _screenPixels.getRawBuffer(srcLine + start), (end - start) * kBytesPerPixel);
+			} else if (kDisableColoring && kEnableAlphaBlending) {
+				c->fb->blendPixels(dstLine + start, (const uint32 *)srcBuf.getRawBuffer(srcLine + start), _surface.format, end - start);
+			} else {
+				// Tinted pixels and other forms of blending than alpha blending go through
+				// writePixel, which is slower.
+				for (int x = start; x < end; x++) {
+					byte aDst, rDst, gDst, bDst;
+					srcBuf.getARGBAt(srcLine + x, aDst, rDst, gDst, bDst);
 					if (kDisableColoring) {
-						dstBuf.copyBuffer(xStart + (l._y - srcY) * c->fb->xsize, skipStart, length, l._buf);
+						c->fb->writePixel(dstLine + x, aDst, rDst, gDst, bDst);
 					} else {
-						for(int x = xStart; x < xStart + length; x++) {
-							byte aDst, rDst, gDst, bDst;
-							srcBuf.getARGBAt((l._y - srcY) * _surface.w + x, aDst, rDst, gDst, bDst);
-							c->fb->writePixel((dstX + x) + (dstY + (l._y - srcY)) * c->fb->xsize, aDst * aTint, rDst * rTint, gDst * gTint, bDst * bTint);
-						}
+						c->fb->writePixel(dstLine + x, aDst * aTint, rDst * rTint, gDst * gTint, bDst * bTint);
 					}
-
 				}
 			}
-			lineIndex++;
-		}
-	} else { // Otherwise can use setPixel in some cases which speeds up things quite a bit
-		while (lineIndex < _lines.size() && _lines[lineIndex]._y < maxY) {
-			const BlitImage::Line &l = _lines[lineIndex];
-			if (l._x < maxX && l._x + l._length > srcX) {
-				int length = l._length;
-				int skipStart = (l._x < srcX) ? (srcX - l._x) : 0;
-				length -= skipStart;
-				int skipEnd   = (l._x + l._length > maxX) ? (l._x + l._length - maxX) : 0;
-				length -= skipEnd;
-				if (kDisableColoring && (kEnableAlphaBlending == false || kDisableBlending)) {
-					memcpy(dstBuf.getRawBuffer((l._y - srcY) * c->fb->xsize + MAX(l._x - srcX, 0)),
-						l._pixels + skipStart * kBytesPerPixel, length * kBytesPerPixel);
-				} else {
-					int xStart = MAX(l._x - srcX, 0);
-					for(int x = xStart; x < xStart + length; x++) {
-						byte aDst, rDst, gDst, bDst;
-						srcBuf.getARGBAt((l._y - srcY) * _surface.w + x, aDst, rDst, gDst, bDst);
-						if (kDisableColoring) {
-							if (aDst != 0xFF) {
-								c->fb->writePixel((dstX + x) + (dstY + (l._y - srcY)) * c->fb->xsize, aDst, rDst, gDst, bDst);
-							} else {
-								dstBuf.setPixelAt(x + (l._y - srcY) * c->fb->xsize, aDst, rDst, gDst, bDst);
-							}
-						} else {
-							c->fb->writePixel((dstX + x) + (dstY + (l._y - srcY)) * c->fb->xsize, aDst * aTint, rDst * rTint, gDst * gTint, bDst * bTint);
-						}
-					}
-				}
-			}
-			lineIndex++;
 		}
 	}
 }
@@ -389,9 +348,14 @@ FORCEINLINE void BlitImage::tglBlitSimple(int dstX, int dstY, int srcX, int srcY
 
 	int clampWidth, clampHeight;
 	int width = srcWidth, height = srcHeight;
+	int unclippedDstX = dstX;
 	if (clipBlitImage(c, srcX, srcY, srcWidth, srcHeight, width, height, dstX, dstY, clampWidth, clampHeight) == false)
 		return;
 
+	// When flipping, the first unclipped destination column shows the last source column.
+	int skipX = dstX - unclippedDstX;
+	int lastSrcX = srcX - skipX + srcWidth - 1;
+
 	Graphics::PixelBuffer srcBuf(_surface.format, (byte *)_surface.getPixels());
 
 	if (kFlipVertical) {
@@ -406,7 +370,7 @@ FORCEINLINE void BlitImage::tglBlitSimple(int dstX, int dstY, int srcX, int srcY
 		for (int x = 0; x < clampWidth; ++x) {
 			byte aDst, rDst, gDst, bDst;
 			if (kFlipHorizontal) {
-				srcBuf.getARGBAt(srcX + clampWidth - x, aDst, rDst, gDst, bDst);
+				srcBuf.getARGBAt(lastSrcX - skipX - x, aDst, rDst, gDst, bDst);
 			} else {
 				srcBuf.getARGBAt(srcX + x, aDst, rDst, gDst, bDst);
 			}
@@ -441,10 +405,21 @@ FORCEINLINE void BlitImage::tglBlitScale(int dstX, int dstY, int width, int heig
 					 float aTint, float rTint, float gTint, float bTint) {
 	TinyGL::GLContext *c = TinyGL::gl_get_context();
 
+	// The source is sampled in the coordinates of the unclipped destination rectangle, so
+	// only the destination is clipped here.
 	int clampWidth, clampHeight;
-	if (clipBlitImage(c, srcX, srcY, srcWidth, srcHeight, width, height, dstX, dstY, clampWidth, clampHeight) == false)
+	int clipDstX = dstX, clipDstY = dstY, clipSrcX = srcX, clipSrcY = srcY;
+	int clipWidth = width, clipHeight = height;
+	if (clipBlitImage(c, clipSrcX, clipSrcY, srcWidth, srcHeight, clipWidth, clipHeight, clipDstX, clipDstY, clampWidth, clampHeight) == false)
 		return;
 
+	int skipX = clipDstX - dstX;
+	int skipY = clipDstY - dstY;
+	width = clipWidth + skipX;
+	height = clipHeight + skipY;
+	dstX = clipDstX;
+	dstY = clipDstY;
+
 	Graphics::PixelBuffer srcBuf(_surface.format, (byte *)_surface.getPixels());
 	srcBuf.shiftBy(srcX + (srcY * _surface.w));
 
@@ -455,15 +430,15 @@ FORCEINLINE void BlitImage::tglBlitScale(int dstX, int dstY, int width, int heig
 			byte aDst, rDst, gDst, bDst;
 			int xSource, ySource;
 			if (kFlipVertical) {
-				ySource = clampHeight - y - 1;
+				ySource = height - (skipY + y) - 1;
 			} else {
-				ySource = y;
+				ySource = skipY + y;
 			}
 
 			if (kFlipHorizontal) {
-				xSource = clampWidth - x - 1;
+				xSource = width - (skipX + x) - 1;
 			} else {
-				xSource = x;
+				xSource = skipX + x;
 			}
 
 			srcBuf.getARGBAt(((ySource * srcHeight) / height) * _surface.w + ((xSource * srcWidth) / width), aDst, rDst, gDst, bDst);
@@ -530,10 +505,16 @@ FORCEINLINE void BlitImage::tglBlitRotoScale(int dstX, int dstY, int width, int
 							 int originX, int originY, float aTint, float rTint, float gTint, float bTint) {
 	TinyGL::GLContext *c = TinyGL::gl_get_context();
 	
-	int clampWidth, clampHeight;
-	if (clipBlitImage(c, srcX, srcY, srcWidth, srcHeight, width, height, dstX, dstY, clampWidth, clampHeight) == false)
-		return;
-	
+	if (srcWidth == 0 || srcHeight == 0) {
+		srcWidth = _surface.w;
+		srcHeight = _surface.h;
+	}
+
+	if (width == 0 && height == 0) {
+		width = srcWidth;
+		height = srcHeight;
+	}
+
 	Graphics::PixelBuffer srcBuf(_surface.format, (byte *)_surface.getPixels());
 	srcBuf.shiftBy(srcX + (srcY * _surface.w));
 	
@@ -541,15 +522,15 @@ FORCEINLINE void BlitImage::tglBlitRotoScale(int dstX, int dstY, int width, int
 	
 	// Transform destination rectangle accordingly.
 	Common::Rect destinationRectangle = rotateRectangle(dstX, dstY, width, height, rotation, originX, originY);
-	
-	if (dstX + destinationRectangle.width() > c->fb->xsize)
-		clampWidth = c->fb->xsize - dstX;
-	else
-		clampWidth = destinationRectangle.width();
-	if (dstY + destinationRectangle.height() > c->fb->ysize)
-		clampHeight = c->fb->ysize - dstY;
-	else
-		clampHeight = destinationRectangle.height();
+
+	// The rotation is computed for the whole destination rectangle, clipping only restricts
+	// the pixels that are written.
+	int startX = MAX(0, c->_scissorRect.left - dstX);
+	int startY = MAX(0, c->_scissorRect.top - dstY);
+	int clampWidth = MIN<int>(destinationRectangle.width(), c->_scissorRect.right - dstX);
+	int clampHeight = MIN<int>(destinationRectangle.height(), c->_scissorRect.bottom - dstY);
+	if (startX >= clampWidth || startY >= clampHeight)
+		return;
 	
 	uint32 invAngle = 360 - (rotation % 360);
 	float invCos = cos(invAngle * (float)M_PI / 180.0f);
@@ -570,11 +551,11 @@ FORCEINLINE void BlitImage::tglBlitRotoScale(int dstX, int dstY, int width, int
 	int sw = width - 1;
 	int sh = height - 1;
 	
-	for (int y = 0; y < clampHeight; y++) {
+	for (int y = startY; y < clampHeight; y++) {
 		int t = cy - y;
-		int sdx = ax + (isinx * t) + xd;
-		int sdy = ay - (icosy * t) + yd;
-		for (int x = 0; x < clampWidth; ++x) {
+		int sdx = ax + (isinx * t) + xd + icosx * startX;
+		int sdy = ay - (icosy * t) + yd + isiny * startX;
+		for (int x = startX; x < clampWidth; ++x) {
 			byte aDst, rDst, gDst, bDst;
 			
 			int dx = (sdx >> 16);
@@ -33,6 +33,7 @@
 
 #include "graphics/tinygl/zbuffer.h"
 #include "graphics/tinygl/zgl.h"
+#include "graphics/tinygl/zspan.h"
 
 namespace TinyGL {
 
@@ -96,6 +97,8 @@ FrameBuffer::FrameBuffer(int width, int height, const Graphics::PixelBuffer &fra
 	this->pbuf = frame_buffer;
 
 	this->current_texture = NULL;
+	this->_textureLevels = NULL;
+	this->_textureLevelCount = 0;
 	this->shadow_mask_buf = NULL;
 
 	this->buffer.pbuf = this->pbuf.getRawBuffer();
@@ -104,6 +107,13 @@ FrameBuffer::FrameBuffer(int width, int height, const Graphics::PixelBuffer &fra
 	_alphaTestEnabled = false;
 	_depthTestEnabled = false;
 	_depthFunc = TGL_LESS;
+	initSimdSpans();
+
+	_hiZWidth = (xsize + kHiZTileSize - 1) >> kHiZTileShift;
+	_hiZHeight = (ysize + kHiZTileSize - 1) >> kHiZTileShift;
+	_hiZ = (HierarchicalZTile *)gl_malloc(_hiZWidth * _hiZHeight * sizeof(HierarchicalZTile));
+	_hiZSegments = (HierarchicalZTile *)gl_malloc(_hiZWidth * ysize * sizeof(HierarchicalZTile));
+	refreshHierarchicalZ(0, 0, xsize, ysize);
 }
 
 FrameBuffer::FrameBuffer(int width, int height, const Graphics::PixelFormat &format) : _depthWrite(true), _enableScissor(false) {
@@ -123,6 +133,8 @@ FrameBuffer::FrameBuffer(int width, int height, const Graphics::PixelFormat &for
 	this->frame_buffer_allocated = 1;
 
 	this->current_texture = NULL;
+	this->_textureLevels = NULL;
+	this->_textureLevelCount = 0;
 	this->shadow_mask_buf = NULL;
 
 	this->buffer.pbuf = this->pbuf.getRawBuffer();
@@ -131,12 +143,105 @@ FrameBuffer::FrameBuffer(int width, int height, const Graphics::PixelFormat &for
 	_alphaTestEnabled = false;
 	_depthTestEnabled = false;
 	_depthFunc = TGL_LESS;
+	initSimdSpans();
+
+	_hiZWidth = (xsize + kHiZTileSize - 1) >> kHiZTileShift;
+	_hiZHeight = (ysize + kHiZTileSize - 1) >> kHiZTileShift;
+	_hiZ = (HierarchicalZTile *)gl_malloc(_hiZWidth * _hiZHeight * sizeof(HierarchicalZTile));
+	_hiZSegments = (HierarchicalZTile *)gl_malloc(_hiZWidth * ysize * sizeof(HierarchicalZTile));
+	refreshHierarchicalZ(0, 0, xsize, ysize);
+}
+
+void FrameBuffer::initSimdSpans() {
+	// The span kernels work on 32bpp pixels with 8 bits per color channel. The alpha
+	// channel is either 8 bits wide too or missing.
+	_simdSpans = TGL_SIMD_SPANS && cmode.bytesPerPixel == 4 &&
+	             cmode.rLoss == 0 && cmode.gLoss == 0 && cmode.bLoss == 0 &&
+	             (cmode.aLoss == 0 || cmode.aLoss == 8);
+}
+
+void FrameBuffer::blendPixels(int pixel, const uint32 *src, const Graphics::PixelFormat &srcFormat, int count) {
+	int i = 0;
+#if TGL_SIMD_SPANS
+	if (_simdSpans) {
+		Span::SpanSetup setup;
+		setup.alphaTestEnabled = _alphaTestEnabled;
+		setup.alphaFunc = _alphaTestFunc;
+		setup.alphaRefValue = _alphaTestRefVal;
+		setup.rShift = cmode.rShift;
+		setup.gShift = cmode.gShift;
+		setup.bShift = cmode.bShift;
+		setup.aShift = cmode.aShift;
+		setup.alphaMask = cmode.aLoss == 0 ? 0xFFFFFFFF : 0;
+		setup.textureRShift = srcFormat.rShift;
+		setup.textureGShift = srcFormat.gShift;
+		setup.textureBShift = srcFormat.bShift;
+		setup.textureAShift = srcFormat.aShift;
+		uint32 *color = (uint32 *)pbuf.getRawBuffer(pixel);
+		if (_alphaTestEnabled) {
+			for (; i + 4 <= count; i += 4)
+				Span::blendPixels<true>(setup, color + i, src + i);
+		} else {
+			for (; i + 4 <= count; i += 4)
+				Span::blendPixels<false>(setup, color + i, src + i);
+		}
+	}
+#endif
+	Graphics::PixelBuffer srcBuf(srcFormat, (byte *)const_cast<uint32 *>(src));
+	for (; i < count; i++) {
+		byte a, r, g, b;
+		srcBuf.getARGBAt(i, a, r, g, b);
+		writePixel(pixel + i, a, r, g, b);
+	}
 }
 
 FrameBuffer::~FrameBuffer() {
 	if (frame_buffer_allocated)
 		pbuf.free();
 	gl_free(_zbuf);
+	gl_free(_hiZ);
+	gl_free(_hiZSegments);
+}
+
+void FrameBuffer::refreshHierarchicalZ(int x, int y, int w, int h) {
+	int left = MAX(x, 0);
+	int top = MAX(y, 0);
+	int right = MIN(x + w, xsize);
+	int bottom = MIN(y + h, ysize);
+	if (left >= right || top >= bottom)
+		return;
+	int firstTileX = left >> kHiZTileShift;
+	int lastTileX = (right - 1) >> kHiZTileShift;
+	for (int py = top; py < bottom; py++) {
+		const unsigned int *pz = buffer.zbuf + py * xsize;
+		for (int tx = firstTileX; tx <= lastTileX; tx++) {
+			int end = MIN((tx + 1) << kHiZTileShift, xsize);
+			unsigned int zMin = 0xFFFFFFFF, zMax = 0;
+			for (int px = tx << kHiZTileShift; px < end; px++) {
+				zMin = MIN(zMin, pz[px]);
+				zMax = MAX(zMax, pz[px]);
+			}
+			_hiZSegments[py * _hiZWidth + tx].zMin = zMin;
+			_hiZSegments[py * _hiZWidth + tx].zMax = zMax;
+		}
+	}
+	for (int ty = top >> kHiZTileShift; ty <= ((bottom - 1) >> kHiZTileShift); ty++) {
+		for (int tx = firstTileX; tx <= lastTileX; tx++) {
+			refreshHierarchicalZTile(tx, ty);
+		}
+	}
+}
+
+void FrameBuffer::refreshHierarchicalZTile(int tx, int ty) {
+	int end = MIN((ty + 1) << kHiZTileShift, ysize);
+	unsigned int zMin = 0xFFFFFFFF, zMax = 0;
+	for (int py = ty << kHiZTileShift; py < end; py++) {
+		const HierarchicalZTile &segment = _hiZSegments[py * _hiZWidth + tx];
+		zMin = MIN(zMin, segment.zMin);
+		zMax = MAX(zMax, segment.zMax);
+	}
+	_hiZ[ty * _hiZWidth + tx].zMin = zMin;
+	_hiZ[ty * _hiZWidth + tx].zMax = zMax;
 }
 
 Buffer *FrameBuffer::genOffscreenBuffer() {
@@ -166,6 +271,14 @@ void FrameBuffer::clear(int clearZ, int z, int clearColor, int r, int g, int b)
 			// Cannot use memset, use a variant working on integers (slow)
 			memset_l(this->_zbuf, z, this->xsize * this->ysize);
 		}
+		if (_zbuf == buffer.zbuf) {
+			for (int tile = 0; tile < _hiZWidth * _hiZHeight; tile++) {
+				_hiZ[tile].zMin = _hiZ[tile].zMax = z;
+			}
+			for (int segment = 0; segment < _hiZWidth * ysize; segment++) {
+				_hiZSegments[segment].zMin = _hiZSegments[segment].zMax = z;
+			}
+		}
 	}
 	if (clearColor) {
 		byte *pp = this->pbuf.getRawBuffer();
@@ -212,6 +325,9 @@ void FrameBuffer::clearRegion(int x, int y, int w, int h, int clearZ, int z, int
 				zbuf += this->xsize;
 			}
 		}
+		if (_zbuf == buffer.zbuf) {
+			refreshHierarchicalZ(x, y, w, h);
+		}
 	}
 	if (clearColor) {
 		int height = h;
@@ -304,6 +420,9 @@ void FrameBuffer::blitOffscreenBuffer(Buffer *buf) {
 		case 0x1: blitPixel(0x0, from_z, to_z, sizeof(int), from, to, pixel_bytes); // fall through
 		case 0x0: break;
 		}
+		if (_zbuf == buffer.zbuf) {
+			refreshHierarchicalZ(0, 0, xsize, ysize);
+		}
 	}
 #undef UNROLL_COUNT
 }
@@ -325,8 +444,10 @@ void FrameBuffer::clearOffscreenBuffer(Buffer *buf) {
 	buf->used = false;
 }
 
-void FrameBuffer::setTexture(const Graphics::PixelBuffer &texture) {
+void FrameBuffer::setTexture(const Graphics::PixelBuffer &texture, const uint32 *const *levels, int levelCount) {
 	current_texture = texture;
+	_textureLevels = levels;
+	_textureLevelCount = levelCount;
 }
 
 } // end of namespace TinyGL
@@ -67,6 +67,28 @@ namespace TinyGL {
 
 #define RGB_TO_PIXEL(r, g, b) cmode.ARGBToColor(255, r, g, b) // Default to 255 alpha aka solid colour.
 
+// Texels are stored in tiles of 4x4, so that the texels sampled for neighbouring pixels,
+// horizontally as well as vertically, usually share a cache line. The smallest mipmap
+// level is one tile.
+#define ZB_TEXTURE_TILE_BITS 2
+#define ZB_TEXTURE_MIN_SIZE (1 << ZB_TEXTURE_TILE_BITS)
+
+// Offset of texel (s, t) in a texture level of size (1 << sizeShift).
+FORCEINLINE unsigned int textureTexelOffset(unsigned int s, unsigned int t, int sizeShift) {
+	const unsigned int tileMask = (1 << ZB_TEXTURE_TILE_BITS) - 1;
+	unsigned int tile = ((t >> ZB_TEXTURE_TILE_BITS) << (sizeShift - ZB_TEXTURE_TILE_BITS)) + (s >> ZB_TEXTURE_TILE_BITS);
+	return (tile << (2 * ZB_TEXTURE_TILE_BITS)) | ((t & tileMask) << ZB_TEXTURE_TILE_BITS) | (s & tileMask);
+}
+
+// A mipmap level of the texture being drawn, and how to address it with the s and t
+// coordinates, which are in texels of the largest level.
+struct TextureLevel {
+	const uint32 *texels;
+	uint32 mask;   // bits of s and t addressing the level
+	int shift;     // shift from the masked s and t to texel coordinates of the level
+	int sizeShift; // log2 of the level size
+};
+
 static const int DRAW_DEPTH_ONLY = 0;
 static const int DRAW_FLAT = 1;
 static const int DRAW_SMOOTH = 2;
@@ -236,6 +258,10 @@ struct FrameBuffer {
 		writePixel(pixel, 255, rSrc, gSrc, bSrc);
 	}
 
+	// Writes count pixels of a 32 bit format from pixel on, like writePixel does with
+	// (TGL_SRC_ALPHA, TGL_ONE_MINUS_SRC_ALPHA) blending enabled.
+	void blendPixels(int pixel, const uint32 *src, const Graphics::PixelFormat &srcFormat, int count);
+
 	FORCEINLINE bool scissorPixel(int x, int y) {
 		return !_clipRectangle.contains(x, y);
 	}
@@ -424,7 +450,9 @@ struct FrameBuffer {
 	void blitOffscreenBuffer(Buffer *buffer);
 	void selectOffscreenBuffer(Buffer *buffer);
 	void clearOffscreenBuffer(Buffer *buffer);
-	void setTexture(const Graphics::PixelBuffer &texture);
+	// levels are the texels of the mipmap levels of texture, from the largest one. Only
+	// the first one is used when levelCount is 1.
+	void setTexture(const Graphics::PixelBuffer &texture, const uint32 *const *levels, int levelCount);
 
 	template <bool kInterpRGB, bool kInterpZ, bool kInterpST, bool kInterpSTZ, int kDrawLogic, bool kDepthWrite, bool enableAlphaTest, bool kEnableScissor, bool enableBlending>
 	void fillTriangle(ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2);
@@ -457,6 +485,104 @@ struct FrameBuffer {
 	void fillLineFlat(ZBufferPoint *p1, ZBufferPoint *p2);
 	void fillLineInterp(ZBufferPoint *p1, ZBufferPoint *p2);
 
+	/**
+	 * Hierarchical z buffer.
+	 * Keeps conservative bounds of the depth values of every kHiZTileSize pixels of each
+	 * scanline, and of every kHiZTileSize x kHiZTileSize tile, so that spans and triangles
+	 * failing the depth test at every pixel can be skipped before any per-pixel work.
+	 * The bounds are recomputed by clears and z buffer blits, and updated by depth writes.
+	 * refreshHierarchicalZ() must be called after writing to getZBuffer() directly.
+	 */
+	void refreshHierarchicalZ(int x, int y, int w, int h);
+
+	// Accounts for depth values in [zMin, zMax] written to the (inclusive) range x0..x1 of
+	// scanline y. fullyWritten tells that every pixel of the range passing the depth test
+	// was written, which allows to tighten the bounds instead of only widening them.
+	FORCEINLINE void updateHierarchicalZ(int x0, int x1, int y, unsigned int zMin, unsigned int zMax, bool fullyWritten) {
+		if (_zbuf != buffer.zbuf || y < 0 || y >= ysize)
+			return;
+		x0 = MAX(x0, 0);
+		x1 = MIN(x1, xsize - 1);
+		// With an ordering depth test the stored values can only move in one direction.
+		int direction = 0;
+		if (_depthTestEnabled) {
+			switch (_depthFunc) {
+			case TGL_LESS:
+			case TGL_LEQUAL:
+				direction = 1;
+				break;
+			case TGL_GREATER:
+			case TGL_GEQUAL:
+				direction = -1;
+				break;
+			case TGL_EQUAL:
+			case TGL_NEVER:
+				return;
+			default:
+				break;
+			}
+		}
+		HierarchicalZTile *segment = _hiZSegments + y * _hiZWidth;
+		HierarchicalZTile *tile = _hiZ + (y >> kHiZTileShift) * _hiZWidth;
+		for (int i = x0 >> kHiZTileShift; i <= (x1 >> kHiZTileShift); i++) {
+			if (direction >= 0 && zMax > segment[i].zMax) {
+				segment[i].zMax = zMax;
+				tile[i].zMax = MAX(tile[i].zMax, zMax);
+			}
+			if (direction <= 0 && zMin < segment[i].zMin) {
+				segment[i].zMin = zMin;
+				tile[i].zMin = MIN(tile[i].zMin, zMin);
+			}
+			// Every pixel of a fully covered segment either got a fragment which passed the
+			// depth test, or kept a value which made it fail: both are beyond the fragment.
+			if (!fullyWritten || x0 > (i << kHiZTileShift) || x1 < MIN((i + 1) << kHiZTileShift, xsize) - 1)
+				continue;
+			if (direction > 0 && zMin > segment[i].zMin) {
+				bool tileBound = segment[i].zMin == tile[i].zMin;
+				segment[i].zMin = zMin;
+				if (tileBound)
+					refreshHierarchicalZTile(i, y >> kHiZTileShift);
+			} else if (direction < 0 && zMax < segment[i].zMax) {
+				bool tileBound = segment[i].zMax == tile[i].zMax;
+				segment[i].zMax = zMax;
+				if (tileBound)
+					refreshHierarchicalZTile(i, y >> kHiZTileShift);
+			}
+		}
+	}
+
+	// Returns true if every fragment with a depth in [zMin, zMax] inside the (inclusive)
+	// range x0..x1 of scanline y fails the depth test.
+	FORCEINLINE bool isSpanOccluded(int x0, int x1, int y, unsigned int zMin, unsigned int zMax) const {
+		if (!_depthTestEnabled || _zbuf != buffer.zbuf || y < 0 || y >= ysize)
+			return false;
+		const HierarchicalZTile *segment = _hiZSegments + y * _hiZWidth;
+		x1 = MIN(x1, xsize - 1) >> kHiZTileShift;
+		for (int i = MAX(x0, 0) >> kHiZTileShift; i <= x1; i++) {
+			if (!failsDepthTest(segment[i], zMin, zMax))
+				return false;
+		}
+		return true;
+	}
+
+	// Same as isSpanOccluded(), for the (inclusive) rectangle x0,y0 - x1,y1.
+	FORCEINLINE bool isOccluded(int x0, int y0, int x1, int y1, unsigned int zMin, unsigned int zMax) const {
+		if (!_depthTestEnabled || _zbuf != buffer.zbuf)
+			return false;
+		x0 = MAX(x0, 0) >> kHiZTileShift;
+		y0 = MAX(y0, 0) >> kHiZTileShift;
+		x1 = MIN(x1, xsize - 1) >> kHiZTileShift;
+		y1 = MIN(y1, ysize - 1) >> kHiZTileShift;
+		for (int ty = y0; ty <= y1; ty++) {
+			const HierarchicalZTile *tile = _hiZ + ty * _hiZWidth;
+			for (int tx = x0; tx <= x1; tx++) {
+				if (!failsDepthTest(tile[tx], zMin, zMax))
+					return false;
+			}
+		}
+		return true;
+	}
+
 	void setScissorRectangle(const Common::Rect &rect) {
 		_clipRectangle = rect;
 		_enableScissor = true;
@@ -483,13 +609,18 @@ struct FrameBuffer {
 	unsigned char *dctable;
 	int *ctable;
 	Graphics::PixelBuffer current_texture;
+	const uint32 *const *_textureLevels;
+	int _textureLevelCount;
 	int _textureSize;
+	int _textureSizeShift;
 	int _textureSizeMask;
 
 	FORCEINLINE bool isBlendingEnabled() const { return _blendingEnabled; }
 	FORCEINLINE void getBlendingFactors(int &sourceFactor, int &destinationFactor) const { sourceFactor = _sourceBlendingFactor; destinationFactor = _destinationBlendingFactor; }
 	FORCEINLINE bool isAlphaTestEnabled() const { return _alphaTestEnabled; }
 	FORCEINLINE bool isDepthWriteEnabled() const { return _depthWrite; }
+	// Falls back to the scalar span functions, whose output the SIMD ones must match.
+	void disableSimdSpans() { _simdSpans = false; }
 	FORCEINLINE int getDepthFunc() const { return _depthFunc; }
 	FORCEINLINE int getDepthWrite() const { return _depthWrite; }
 	FORCEINLINE int getAlphaTestFunc() const { return _alphaTestFunc; }
@@ -498,6 +629,36 @@ struct FrameBuffer {
 
 private:
 
+	void initSimdSpans();
+
+	static const int kHiZTileShift = 4;
+	static const int kHiZTileSize = 1 << kHiZTileShift;
+
+	struct HierarchicalZTile {
+		unsigned int zMin, zMax;
+	};
+
+	void refreshHierarchicalZTile(int tx, int ty);
+
+	FORCEINLINE bool failsDepthTest(const HierarchicalZTile &tile, unsigned int zMin, unsigned int zMax) const {
+		switch (_depthFunc) {
+		case TGL_LESS:
+			return tile.zMin >= zMax;
+		case TGL_LEQUAL:
+			return tile.zMin > zMax;
+		case TGL_GREATER:
+			return tile.zMax <= zMin;
+		case TGL_GEQUAL:
+			return tile.zMax < zMin;
+		case TGL_EQUAL:
+			return tile.zMin > zMax || zMin > tile.zMax;
+		case TGL_NEVER:
+			return true;
+		default:
+			return false;
+		}
+	}
+
 	template <bool kDepthWrite>
 	FORCEINLINE void putPixel(unsigned int pixelOffset, int color, int x, int y, unsigned int z);
 
@@ -524,6 +685,11 @@ private:
 	int _alphaTestFunc;
 	int _alphaTestRefVal;
 	int _depthFunc;
+	bool _simdSpans; // The pixel format is supported by the SIMD span kernels in zspan.h.
+	// Only track the z buffer of the main buffer, not offscreen ones.
+	HierarchicalZTile *_hiZ;
+	HierarchicalZTile *_hiZSegments;
+	int _hiZWidth, _hiZHeight;
 };
 
 // memory.c
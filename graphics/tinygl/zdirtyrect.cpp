@@ -30,13 +30,29 @@
 #include "graphics/tinygl/zgl.h"
 #include "graphics/tinygl/gl.h"
 #include "common/debug.h"
+#include "common/hashmap.h"
 #include "common/math.h"
 
 namespace TinyGL {
 
+// Draw calls are binned into horizontal bands of the render target and every band is
+// rasterized on its own, so the color and z buffer rows it covers stay in cache while all
+// of its draw calls are executed. Bands span the whole render width: the rasterizer skips
+// scanlines outside of the scissor rectangle, but still walks every pixel of a span, so
+// vertical cuts would multiply the per-pixel work instead of splitting it.
+static const int kDrawCallTileHeight = 32;
+
+// Granularity at which the color and z buffers of the static draw calls are captured.
+// Dirty regions are aligned to it while a snapshot is in use.
+static const int kSnapshotTileSize = 32;
+
+bool tglNeedsDirtyRegions(GLContext *c) {
+	return c->_enableDirtyRectangles || c->_enableTiledRendering;
+}
+
 void tglIssueDrawCall(Graphics::DrawCall *drawCall) {
 	TinyGL::GLContext *c = TinyGL::gl_get_context();
-	if (c->_enableDirtyRectangles && drawCall->getDirtyRegion().isEmpty())
+	if (tglNeedsDirtyRegions(c) && drawCall->getDirtyRegion().isEmpty())
 		return;
 	c->_drawCallsQueue.push_back(drawCall);
 }
@@ -102,13 +118,12 @@ void tglDisposeResources(TinyGL::GLContext *c) {
 }
 
 void tglDisposeDrawCallLists(TinyGL::GLContext *c) {
-	typedef Common::List<Graphics::DrawCall *>::const_iterator DrawCallIterator;
-	for (DrawCallIterator it = c->_previousFrameDrawCallsQueue.begin(); it != c->_previousFrameDrawCallsQueue.end(); ++it) {
-		delete *it;
+	for (uint i = 0; i < c->_previousFrameDrawCallsQueue.size(); i++) {
+		delete c->_previousFrameDrawCallsQueue[i];
 	}
 	c->_previousFrameDrawCallsQueue.clear();
-	for (DrawCallIterator it = c->_drawCallsQueue.begin(); it != c->_drawCallsQueue.end(); ++it) {
-		delete *it;
+	for (uint i = 0; i < c->_drawCallsQueue.size(); i++) {
+		delete c->_drawCallsQueue[i];
 	}
 	c->_drawCallsQueue.clear();
 }
@@ -119,41 +134,238 @@ static inline void _appendDirtyRectangle(const Graphics::DrawCall &call, Common:
 		rectangles.push_back(DirtyRectangle(dirty_region, r, g, b));
 }
 
-static void tglPresentBufferDirtyRects(TinyGL::GLContext *c) {
-	typedef Common::List<Graphics::DrawCall *>::const_iterator DrawCallIterator;
-	typedef Common::List<TinyGL::DirtyRectangle>::iterator RectangleIterator;
+// Executes every queued draw call inside the given regions, one tile at a time.
+// Each tile replays its bin in submission order, and a draw call only ever touches pixels
+// inside the scissor rectangle it is executed with, so the result is identical to executing
+// the whole queue over each region in turn.
+static void tglExecuteDrawCallsTiled(TinyGL::GLContext *c, const Common::Array<Common::Rect> &regions, uint firstDrawCall) {
+	const Common::Rect &renderRect = c->renderRect;
+	if (renderRect.isEmpty())
+		return;
 
-	Common::List<DirtyRectangle> rectangles;
+	int tileCount = (renderRect.height() + kDrawCallTileHeight - 1) / kDrawCallTileHeight;
+	Common::Array<Common::Array<const Graphics::DrawCall *> > bins;
+	bins.resize(tileCount);
+
+	for (uint i = firstDrawCall; i < c->_drawCallsQueue.size(); i++) {
+		Common::Rect drawCallRegion = c->_drawCallsQueue[i]->getDirtyRegion();
+		drawCallRegion.clip(renderRect);
+		if (drawCallRegion.isEmpty())
+			continue;
+		int firstTile = (drawCallRegion.top - renderRect.top) / kDrawCallTileHeight;
+		int lastTile = (drawCallRegion.bottom - 1 - renderRect.top) / kDrawCallTileHeight;
+		for (int tile = firstTile; tile <= lastTile; tile++) {
+			bins[tile].push_back(c->_drawCallsQueue[i]);
+		}
+	}
 
-	DrawCallIterator itFrame = c->_drawCallsQueue.begin();
-	DrawCallIterator endFrame = c->_drawCallsQueue.end();
-	DrawCallIterator itPrevFrame = c->_previousFrameDrawCallsQueue.begin();
-	DrawCallIterator endPrevFrame = c->_previousFrameDrawCallsQueue.end();
+	for (int tile = 0; tile < tileCount; tile++) {
+		const Common::Array<const Graphics::DrawCall *> &bin = bins[tile];
+		if (bin.empty())
+			continue;
 
-	// Compare draw calls.
-	for ( ; itPrevFrame != endPrevFrame && itFrame != endFrame;
-		++itPrevFrame, ++itFrame) {
-			const Graphics::DrawCall &currentCall = **itFrame;
-			const Graphics::DrawCall &previousCall = **itPrevFrame;
+		int tileTop = renderRect.top + tile * kDrawCallTileHeight;
+		Common::Rect tileRect(renderRect.left, tileTop, renderRect.right, MIN<int>(tileTop + kDrawCallTileHeight, renderRect.bottom));
 
-			if (previousCall != currentCall) {
-				_appendDirtyRectangle(previousCall, rectangles, 255, 255, 255);
+		for (uint i = 0; i < bin.size(); i++) {
+			Common::Rect drawCallRegion = bin[i]->getDirtyRegion();
+			for (uint r = 0; r < regions.size(); r++) {
+				Common::Rect clippingRectangle = regions[r].findIntersectingRect(tileRect);
+				if (!clippingRectangle.isEmpty() && clippingRectangle.intersects(drawCallRegion)) {
+					bin[i]->execute(clippingRectangle, true);
+				}
+			}
+		}
+	}
+}
+
+// Appends the dirty regions of the draw calls which changed since the previous frame.
+// Draw calls are matched by signature, so inserting or removing a draw call only dirties its
+// own region. A matched draw call is dirty as well when it now comes before another matched
+// draw call it used to follow, as the pixels they share would be drawn in a different order.
+static void tglFindChangedDrawCalls(const Common::Array<Graphics::DrawCall *> &previousFrame, const Common::Array<Graphics::DrawCall *> &frame, Common::List<DirtyRectangle> &rectangles) {
+	typedef Common::HashMap<uint32, Common::Array<uint> > SignatureMap;
+
+	SignatureMap previousCalls;
+	for (uint i = 0; i < previousFrame.size(); i++) {
+		previousCalls[previousFrame[i]->getSignature()].push_back(i);
+	}
+
+	Common::Array<bool> matched(previousFrame.size(), false);
+	int lastMatch = -1;
+	for (uint i = 0; i < frame.size(); i++) {
+		const Graphics::DrawCall &currentCall = *frame[i];
+		int match = -1;
+		SignatureMap::iterator bucket = previousCalls.find(currentCall.getSignature());
+		if (bucket != previousCalls.end()) {
+			Common::Array<uint> &candidates = bucket->_value;
+			for (uint j = 0; j < candidates.size(); j++) {
+				if (*previousFrame[candidates[j]] == currentCall) {
+					match = candidates[j];
+					candidates.remove_at(j);
+					break;
+				}
+			}
+		}
+
+		if (match < 0) {
+			_appendDirtyRectangle(currentCall, rectangles, 255, 0, 0);
+		} else {
+			matched[match] = true;
+			if (match < lastMatch) {
+				_appendDirtyRectangle(*previousFrame[match], rectangles, 255, 255, 255);
 				_appendDirtyRectangle(currentCall, rectangles, 255, 0, 0);
+			} else {
+				lastMatch = match;
+			}
+		}
+	}
+
+	for (uint i = 0; i < previousFrame.size(); i++) {
+		if (!matched[i])
+			_appendDirtyRectangle(*previousFrame[i], rectangles, 255, 255, 255);
+	}
+}
+
+// Returns how many draw calls at the start of the frame can be replaced by the snapshot:
+// they must be the same as in the previous frame, only use the color and z buffers, and
+// start with a clear of both, so that their result does not depend on earlier frames.
+static uint tglCountStaticDrawCalls(const Common::Array<Graphics::DrawCall *> &previousFrame, const Common::Array<Graphics::DrawCall *> &frame) {
+	if (frame.empty() || frame[0]->getType() != Graphics::DrawCall::DrawCall_Clear)
+		return 0;
+	if (!((const Graphics::ClearBufferDrawCall *)frame[0])->clearsColorAndZBuffer())
+		return 0;
+
+	uint count = 0;
+	while (count < frame.size() && count < previousFrame.size() &&
+			!frame[count]->usesShadowMask() &&
+			frame[count]->getSignature() == previousFrame[count]->getSignature() &&
+			*previousFrame[count] == *frame[count]) {
+		count++;
+	}
+	return count;
+}
+
+static void tglUpdateSnapshot(TinyGL::GLContext *c, uint staticDrawCalls) {
+	const Common::Rect &renderRect = c->renderRect;
+	uint tileCount = ((renderRect.width() + kSnapshotTileSize - 1) / kSnapshotTileSize) *
+	                 ((renderRect.height() + kSnapshotTileSize - 1) / kSnapshotTileSize);
+
+	// The snapshot stays valid as long as its draw calls keep being drawn first. It is only
+	// extended to more draw calls while none of its tiles have been captured yet.
+	bool reset = staticDrawCalls < (uint)c->_snapshotDrawCallCount || c->_snapshotValidTiles.size() != tileCount;
+	if (!reset && staticDrawCalls > (uint)c->_snapshotDrawCallCount) {
+		reset = true;
+		for (uint i = 0; i < tileCount; i++) {
+			if (c->_snapshotValidTiles[i]) {
+				reset = false;
+				break;
 			}
+		}
 	}
+	if (!reset)
+		return;
 
-	for ( ; itPrevFrame != endPrevFrame; ++itPrevFrame) {
-		_appendDirtyRectangle(**itPrevFrame, rectangles, 255, 255, 255);
+	c->_snapshotDrawCallCount = staticDrawCalls;
+	c->_snapshotValidTiles.resize(tileCount);
+	for (uint i = 0; i < tileCount; i++) {
+		c->_snapshotValidTiles[i] = false;
+	}
+	if (staticDrawCalls != 0 && c->_snapshotColorBuffer == nullptr) {
+		c->_snapshotColorBuffer = (byte *)gl_malloc(c->fb->ysize * c->fb->linesize);
+		c->_snapshotZBuffer = (unsigned int *)gl_malloc(c->fb->ysize * c->fb->xsize * sizeof(unsigned int));
 	}
+}
 
-	for ( ; itFrame != endFrame; ++itFrame) {
-		_appendDirtyRectangle(**itFrame, rectangles, 255, 0, 0);
+// Brings the region to the state following the static draw calls of the frame. The region is
+// aligned to the snapshot tiles: when all of them were captured, their content is copied back,
+// otherwise the static draw calls are executed and their result captured. Returns whether the
+// region was restored from the snapshot.
+static bool tglRestoreSnapshot(TinyGL::GLContext *c, const Common::Array<Graphics::DrawCall *> &frame, const Common::Rect &region) {
+	const Common::Rect &renderRect = c->renderRect;
+	int tilesPerRow = (renderRect.width() + kSnapshotTileSize - 1) / kSnapshotTileSize;
+	int firstTileX = (region.left - renderRect.left) / kSnapshotTileSize;
+	int lastTileX = (region.right - 1 - renderRect.left) / kSnapshotTileSize;
+	int firstTileY = (region.top - renderRect.top) / kSnapshotTileSize;
+	int lastTileY = (region.bottom - 1 - renderRect.top) / kSnapshotTileSize;
+
+	bool captured = true;
+	for (int ty = firstTileY; ty <= lastTileY && captured; ty++) {
+		for (int tx = firstTileX; tx <= lastTileX; tx++) {
+			if (!c->_snapshotValidTiles[ty * tilesPerRow + tx]) {
+				captured = false;
+				break;
+			}
+		}
+	}
+
+	if (!captured) {
+		for (int i = 0; i < c->_snapshotDrawCallCount; i++) {
+			if (region.intersects(frame[i]->getDirtyRegion())) {
+				frame[i]->execute(region, true);
+			}
+		}
+	}
+
+	TinyGL::FrameBuffer *fb = c->fb;
+	int colorOffset = region.top * fb->linesize + region.left * fb->pixelbytes;
+	int zOffset = region.top * fb->xsize + region.left;
+	for (int y = region.top; y < region.bottom; y++) {
+		if (captured) {
+			memcpy(fb->getPixelBuffer() + colorOffset, c->_snapshotColorBuffer + colorOffset, region.width() * fb->pixelbytes);
+			memcpy(fb->getZBuffer() + zOffset, c->_snapshotZBuffer + zOffset, region.width() * sizeof(unsigned int));
+		} else {
+			memcpy(c->_snapshotColorBuffer + colorOffset, fb->getPixelBuffer() + colorOffset, region.width() * fb->pixelbytes);
+			memcpy(c->_snapshotZBuffer + zOffset, fb->getZBuffer() + zOffset, region.width() * sizeof(unsigned int));
+		}
+		colorOffset += fb->linesize;
+		zOffset += fb->xsize;
+	}
+
+	if (captured) {
+		fb->refreshHierarchicalZ(region.left, region.top, region.width(), region.height());
+	} else {
+		for (int ty = firstTileY; ty <= lastTileY; ty++) {
+			for (int tx = firstTileX; tx <= lastTileX; tx++) {
+				c->_snapshotValidTiles[ty * tilesPerRow + tx] = true;
+			}
+		}
 	}
+	return captured;
+}
+
+// Grows the rectangle to the snapshot tiles it overlaps.
+static void tglAlignToSnapshotTiles(const Common::Rect &renderRect, Common::Rect &rect) {
+	rect.clip(renderRect);
+	if (rect.isEmpty())
+		return;
+	rect.left = renderRect.left + (rect.left - renderRect.left) / kSnapshotTileSize * kSnapshotTileSize;
+	rect.top = renderRect.top + (rect.top - renderRect.top) / kSnapshotTileSize * kSnapshotTileSize;
+	rect.right = renderRect.left + (rect.right - renderRect.left + kSnapshotTileSize - 1) / kSnapshotTileSize * kSnapshotTileSize;
+	rect.bottom = renderRect.top + (rect.bottom - renderRect.top + kSnapshotTileSize - 1) / kSnapshotTileSize * kSnapshotTileSize;
+	rect.clip(renderRect);
+}
+
+static void tglPresentBufferDirtyRects(TinyGL::GLContext *c) {
+	typedef Common::List<TinyGL::DirtyRectangle>::iterator RectangleIterator;
+
+	Common::List<DirtyRectangle> rectangles;
+
+	const Common::Array<Graphics::DrawCall *> &frame = c->_drawCallsQueue;
+	const Common::Array<Graphics::DrawCall *> &previousFrame = c->_previousFrameDrawCallsQueue;
+
+	// Compare draw calls.
+	tglFindChangedDrawCalls(previousFrame, frame, rectangles);
+	tglUpdateSnapshot(c, tglCountStaticDrawCalls(previousFrame, frame));
+	bool useSnapshot = c->_snapshotDrawCallCount != 0;
 
 	// This loop increases outer rectangle coordinates to favor merging of adjacent rectangles.
 	for (RectangleIterator it = rectangles.begin(); it != rectangles.end(); ++it) {
 		(*it).rectangle.right++;
 		(*it).rectangle.bottom++;
+		if (useSnapshot) {
+			tglAlignToSnapshotTiles(c->renderRect, (*it).rectangle);
+		}
 	}
 
 	// Merge coalesce dirty rects.
@@ -193,14 +405,38 @@ static void tglPresentBufferDirtyRects(TinyGL::GLContext *c) {
 		(*it1).rectangle.clip(c->renderRect);
 	}
 
+	c->_rasterizedPixels = 0;
+	c->_restoredPixels = 0;
+	c->_reusedPixels = c->renderRect.width() * c->renderRect.height();
+
 	if (!rectangles.empty()) {
+		// Restore the result of the static draw calls from the snapshot, then execute the others.
+		uint firstDrawCall = useSnapshot ? c->_snapshotDrawCallCount : 0;
+		for (RectangleIterator itRect = rectangles.begin(); itRect != rectangles.end(); ++itRect) {
+			int area = (*itRect).rectangle.width() * (*itRect).rectangle.height();
+			if (useSnapshot && tglRestoreSnapshot(c, frame, (*itRect).rectangle)) {
+				c->_restoredPixels += area;
+			} else {
+				c->_rasterizedPixels += area;
+			}
+			c->_reusedPixels -= area;
+		}
+
 		// Execute draw calls.
-		for (DrawCallIterator it = c->_drawCallsQueue.begin(); it != c->_drawCallsQueue.end(); ++it) {
-			Common::Rect drawCallRegion = (*it)->getDirtyRegion();
+		if (c->_enableTiledRendering) {
+			Common::Array<Common::Rect> regions;
 			for (RectangleIterator itRect = rectangles.begin(); itRect != rectangles.end(); ++itRect) {
-				Common::Rect dirtyRegion = (*itRect).rectangle;
-				if (dirtyRegion.intersects(drawCallRegion)) {
-					(*it)->execute(dirtyRegion, true);
+				regions.push_back((*itRect).rectangle);
+			}
+			tglExecuteDrawCallsTiled(c, regions, firstDrawCall);
+		} else {
+			for (uint i = firstDrawCall; i < frame.size(); i++) {
+				Common::Rect drawCallRegion = frame[i]->getDirtyRegion();
+				for (RectangleIterator itRect = rectangles.begin(); itRect != rectangles.end(); ++itRect) {
+					Common::Rect dirtyRegion = (*itRect).rectangle;
+					if (dirtyRegion.intersects(drawCallRegion)) {
+						frame[i]->execute(dirtyRegion, true);
+					}
 				}
 			}
 		}
@@ -225,12 +461,16 @@ static void tglPresentBufferDirtyRects(TinyGL::GLContext *c) {
 	}
 
 	// Dispose not necessary draw calls.
-	for (DrawCallIterator it = c->_previousFrameDrawCallsQueue.begin(); it != c->_previousFrameDrawCallsQueue.end(); ++it) {
-		delete *it;
+	for (uint i = 0; i < c->_previousFrameDrawCallsQueue.size(); i++) {
+		delete c->_previousFrameDrawCallsQueue[i];
 	}
 
-	c->_previousFrameDrawCallsQueue = c->_drawCallsQueue;
-	c->_drawCallsQueue.clear();
+	// Hand the queue over without freeing the storage of either array.
+	c->_previousFrameDrawCallsQueue.resize(c->_drawCallsQueue.size());
+	for (uint i = 0; i < c->_drawCallsQueue.size(); i++) {
+		c->_previousFrameDrawCallsQueue[i] = c->_drawCallsQueue[i];
+	}
+	c->_drawCallsQueue.resize(0);
 
 
 	tglDisposeResources(c);
@@ -240,14 +480,25 @@ static void tglPresentBufferDirtyRects(TinyGL::GLContext *c) {
 }
 
 static void tglPresentBufferSimple(TinyGL::GLContext *c) {
-	typedef Common::List<Graphics::DrawCall *>::const_iterator DrawCallIterator;
-
-	for (DrawCallIterator it = c->_drawCallsQueue.begin(); it != c->_drawCallsQueue.end(); ++it) {
-		(*it)->execute(true);
-		delete *it;
+	if (c->_enableTiledRendering) {
+		Common::Array<Common::Rect> regions;
+		regions.push_back(c->renderRect);
+		tglExecuteDrawCallsTiled(c, regions, 0);
+		for (uint i = 0; i < c->_drawCallsQueue.size(); i++) {
+			delete c->_drawCallsQueue[i];
+		}
+	} else {
+		for (uint i = 0; i < c->_drawCallsQueue.size(); i++) {
+			c->_drawCallsQueue[i]->execute(true);
+			delete c->_drawCallsQueue[i];
+		}
 	}
 
-	c->_drawCallsQueue.clear();
+	c->_drawCallsQueue.resize(0);
+
+	c->_rasterizedPixels = c->renderRect.width() * c->renderRect.height();
+	c->_restoredPixels = 0;
+	c->_reusedPixels = 0;
 
 	tglDisposeResources(c);
 
@@ -267,6 +518,32 @@ void tglPresentBuffer() {
 
 namespace Graphics {
 
+Common::Rect rotateRectangle(int x, int y, int width, int height, int rotation, int originX, int originY);
+
+// FNV-1a over 32 bit words, used for the draw call signatures.
+static const uint32 kSignatureSeed = 2166136261u;
+
+static inline uint32 hashSignature(uint32 hash, uint32 value) {
+	return (hash ^ value) * 16777619u;
+}
+
+static inline uint32 hashSignature(uint32 hash, float value) {
+	uint32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return hashSignature(hash, bits);
+}
+
+static inline uint32 hashSignature(uint32 hash, const void *pointer) {
+	return hashSignature(hash, (uint32)(uintptr)pointer);
+}
+
+static inline uint32 hashSignature(uint32 hash, const Common::Rect &rect) {
+	hash = hashSignature(hash, (uint32)rect.left);
+	hash = hashSignature(hash, (uint32)rect.top);
+	hash = hashSignature(hash, (uint32)rect.right);
+	return hashSignature(hash, (uint32)rect.bottom);
+}
+
 bool DrawCall::operator==(const DrawCall &other) const {
 	if (_type == other._type) {
 		switch (_type) {
@@ -295,9 +572,55 @@ RasterizationDrawCall::RasterizationDrawCall() : DrawCall(DrawCall_Rasterization
 	_drawTriangleBack = c->draw_triangle_back;
 	memcpy(_vertex, c->vertex, sizeof(TinyGL::GLVertex) * _vertexCount);
 	_state = captureState();
-	if (c->_enableDirtyRectangles) {
+	if (TinyGL::tglNeedsDirtyRegions(c)) {
 		computeDirtyRegion();
 	}
+	if (c->_enableDirtyRectangles) {
+		computeSignature();
+	}
+}
+
+void RasterizationDrawCall::computeSignature() {
+	// Only covers fields compared by operator==, so that equal draw calls get equal signatures.
+	uint32 hash = kSignatureSeed;
+	hash = hashSignature(hash, (uint32)_vertexCount);
+	hash = hashSignature(hash, (uint32)_state.beginType);
+	hash = hashSignature(hash, (uint32)_state.currentFrontFace);
+	hash = hashSignature(hash, (uint32)_state.cullFaceEnabled);
+	hash = hashSignature(hash, (uint32)_state.colorMask);
+	hash = hashSignature(hash, (uint32)_state.depthTest);
+	hash = hashSignature(hash, (uint32)_state.depthFunction);
+	hash = hashSignature(hash, (uint32)_state.depthWrite);
+	hash = hashSignature(hash, (uint32)_state.depthTestEnabled);
+	hash = hashSignature(hash, (uint32)_state.shadowMode);
+	hash = hashSignature(hash, (uint32)_state.texture2DEnabled);
+	hash = hashSignature(hash, (uint32)_state.currentShadeModel);
+	hash = hashSignature(hash, (uint32)_state.lightingEnabled);
+	hash = hashSignature(hash, (uint32)_state.enableBlending);
+	hash = hashSignature(hash, (uint32)_state.sfactor);
+	hash = hashSignature(hash, (uint32)_state.dfactor);
+	hash = hashSignature(hash, (uint32)_state.alphaTest);
+	hash = hashSignature(hash, (uint32)_state.alphaFunc);
+	hash = hashSignature(hash, (uint32)_state.alphaRefValue);
+	hash = hashSignature(hash, _state.texture);
+	hash = hashSignature(hash, _state.shadowMaskBuf);
+	if (_state.texture != nullptr) {
+		hash = hashSignature(hash, (uint32)_state.textureVersion);
+	}
+	for (int i = 0; i < _vertexCount; i++) {
+		const TinyGL::ZBufferPoint &zp = _vertex[i].zp;
+		hash = hashSignature(hash, (uint32)_vertex[i].clip_code);
+		hash = hashSignature(hash, (uint32)zp.x);
+		hash = hashSignature(hash, (uint32)zp.y);
+		hash = hashSignature(hash, (uint32)zp.z);
+		hash = hashSignature(hash, (uint32)zp.s);
+		hash = hashSignature(hash, (uint32)zp.t);
+		hash = hashSignature(hash, (uint32)zp.r);
+		hash = hashSignature(hash, (uint32)zp.g);
+		hash = hashSignature(hash, (uint32)zp.b);
+		hash = hashSignature(hash, (uint32)zp.a);
+	}
+	_signature = hash;
 }
 
 void RasterizationDrawCall::computeDirtyRegion() {
@@ -521,9 +844,38 @@ BlittingDrawCall::BlittingDrawCall(Graphics::BlitImage *image, const BlitTransfo
 	tglIncBlitImageRef(image);
 	_blitState = captureState();
 	_imageVersion = tglGetBlitImageVersion(image);
-	if (TinyGL::gl_get_context()->_enableDirtyRectangles) {
+	if (TinyGL::tglNeedsDirtyRegions(TinyGL::gl_get_context())) {
 		computeDirtyRegion();
 	}
+	if (TinyGL::gl_get_context()->_enableDirtyRectangles) {
+		computeSignature();
+	}
+}
+
+void BlittingDrawCall::computeSignature() {
+	uint32 hash = kSignatureSeed;
+	hash = hashSignature(hash, (uint32)_mode);
+	hash = hashSignature(hash, _image);
+	hash = hashSignature(hash, (uint32)_imageVersion);
+	hash = hashSignature(hash, _transform._sourceRectangle);
+	hash = hashSignature(hash, _transform._destinationRectangle);
+	hash = hashSignature(hash, (uint32)_transform._rotation);
+	hash = hashSignature(hash, (uint32)_transform._originX);
+	hash = hashSignature(hash, (uint32)_transform._originY);
+	hash = hashSignature(hash, _transform._aTint);
+	hash = hashSignature(hash, _transform._rTint);
+	hash = hashSignature(hash, _transform._gTint);
+	hash = hashSignature(hash, _transform._bTint);
+	hash = hashSignature(hash, (uint32)_transform._flipHorizontally);
+	hash = hashSignature(hash, (uint32)_transform._flipVertically);
+	hash = hashSignature(hash, (uint32)_blitState.enableBlending);
+	hash = hashSignature(hash, (uint32)_blitState.sfactor);
+	hash = hashSignature(hash, (uint32)_blitState.dfactor);
+	hash = hashSignature(hash, (uint32)_blitState.alphaTest);
+	hash = hashSignature(hash, (uint32)_blitState.alphaFunc);
+	hash = hashSignature(hash, (uint32)_blitState.alphaRefValue);
+	hash = hashSignature(hash, (uint32)_blitState.depthTestEnabled);
+	_signature = hash;
 }
 
 BlittingDrawCall::~BlittingDrawCall() {
@@ -602,6 +954,13 @@ void BlittingDrawCall::computeDirtyRegion() {
 			tglGetBlitImageSize(_image, blitWidth, blitHeight);
 		}
 	}
+	if (_transform._rotation != 0) {
+		// Rotated blits fill a box as large as the rotated rectangle from their destination corner.
+		Common::Rect rotated = rotateRectangle(_transform._destinationRectangle.left, _transform._destinationRectangle.top,
+		                                       blitWidth, blitHeight, _transform._rotation, _transform._originX, _transform._originY);
+		blitWidth = rotated.width();
+		blitHeight = rotated.height();
+	}
 	if (blitWidth == 0 || blitHeight == 0) {
 		_dirtyRegion = Common::Rect();
 	} else {
@@ -626,9 +985,23 @@ bool BlittingDrawCall::operator==(const BlittingDrawCall &other) const {
 ClearBufferDrawCall::ClearBufferDrawCall(bool clearZBuffer, int zValue, bool clearColorBuffer, int rValue, int gValue, int bValue) 
 	: _clearZBuffer(clearZBuffer), _clearColorBuffer(clearColorBuffer), _zValue(zValue), _rValue(rValue), _gValue(gValue), _bValue(bValue), DrawCall(DrawCall_Clear) {
 	TinyGL::GLContext *c = TinyGL::gl_get_context();
-	if (c->_enableDirtyRectangles) {
+	if (TinyGL::tglNeedsDirtyRegions(c)) {
 		_dirtyRegion = c->renderRect;
 	}
+	if (c->_enableDirtyRectangles) {
+		computeSignature();
+	}
+}
+
+void ClearBufferDrawCall::computeSignature() {
+	uint32 hash = kSignatureSeed;
+	hash = hashSignature(hash, (uint32)_clearZBuffer);
+	hash = hashSignature(hash, (uint32)_clearColorBuffer);
+	hash = hashSignature(hash, (uint32)_zValue);
+	hash = hashSignature(hash, (uint32)_rValue);
+	hash = hashSignature(hash, (uint32)_gValue);
+	hash = hashSignature(hash, (uint32)_bValue);
+	_signature = hash;
 }
 
 void ClearBufferDrawCall::execute(bool restoreState) const {
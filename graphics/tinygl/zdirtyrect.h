@@ -54,7 +54,7 @@ public:
 		DrawCall_Clear
 	};
 
-	DrawCall(DrawCallType type) : _type(type) { }
+	DrawCall(DrawCallType type) : _type(type), _signature(0) { }
 	virtual ~DrawCall() { }
 	bool operator==(const DrawCall &other) const;
 	bool operator!=(const DrawCall &other) const {
@@ -64,8 +64,13 @@ public:
 	virtual void execute(const Common::Rect &clippingRectangle, bool restoreState) const = 0;
 	DrawCallType getType() const { return _type; }
 	virtual const Common::Rect getDirtyRegion() const { return _dirtyRegion; }
+	// Hash of the parameters compared by operator==: equal draw calls have equal signatures.
+	uint32 getSignature() const { return _signature; }
+	// Whether the draw call reads or writes the shadow mask buffer, besides the color and z buffers.
+	virtual bool usesShadowMask() const { return false; }
 protected:
 	Common::Rect _dirtyRegion;
+	uint32 _signature;
 private:
 	DrawCallType _type;
 };
@@ -77,6 +82,7 @@ public:
 	bool operator==(const ClearBufferDrawCall &other) const;
 	virtual void execute(bool restoreState) const;
 	virtual void execute(const Common::Rect &clippingRectangle, bool restoreState) const;
+	bool clearsColorAndZBuffer() const { return _clearZBuffer && _clearColorBuffer; }
 
 	void *operator new(size_t size) {
 		return ::Internal::allocateFrame(size);
@@ -84,6 +90,7 @@ public:
 
 	void operator delete(void *p) { }
 private:
+	void computeSignature();
 	bool _clearZBuffer, _clearColorBuffer;
 	int _rValue, _gValue, _bValue, _zValue;
 };
@@ -96,6 +103,7 @@ public:
 	bool operator==(const RasterizationDrawCall &other) const;
 	virtual void execute(bool restoreState) const;
 	virtual void execute(const Common::Rect &clippingRectangle, bool restoreState) const;
+	virtual bool usesShadowMask() const { return _state.shadowMode != 0; }
 
 	void *operator new(size_t size) {
 		return ::Internal::allocateFrame(size);
@@ -104,6 +112,7 @@ public:
 	void operator delete(void *p) { }
 private:
 	void computeDirtyRegion();
+	void computeSignature();
 	typedef void (*gl_draw_triangle_func_ptr)(TinyGL::GLContext *c, TinyGL::GLVertex *p0, TinyGL::GLVertex *p1, TinyGL::GLVertex *p2);
 	int _vertexCount;
 	TinyGL::GLVertex *_vertex;
@@ -168,6 +177,7 @@ public:
 	void operator delete(void *p) { }
 private:
 	void computeDirtyRegion();
+	void computeSignature();
 	BlitImage *_image;
 	BlitTransform _transform;
 	BlittingMode _mode;
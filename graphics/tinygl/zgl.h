@@ -138,8 +138,11 @@ struct GLParamBuffer {
 	struct GLParamBuffer *next;
 };
 
+struct GLCompiledList;
+
 struct GLList {
 	GLParamBuffer *first_op_buffer;
+	GLCompiledList *compiled; // NULL if the list cannot be replayed without the op stream
 	// TODO: extensions for an hash table or a better allocating scheme
 };
 
@@ -173,6 +176,37 @@ struct GLVertex {
 	}
 };
 
+struct GLCompiledPrimitive {
+	int type;
+	int first, count;
+};
+
+/**
+ * A display list holding only geometry, flattened at glEndList() into its vertices and the
+ * primitives drawing them, so that calling it does not go through the op stream.
+ * The first vertices of the list may take some attributes from the current state, up to
+ * the first op changing them.
+ * When the list is called again under the same transformation, without lighting, the
+ * transformed vertices of the previous call are used again.
+ */
+struct GLCompiledList {
+	Common::Array<GLVertex> vertices;
+	Common::Array<GLCompiledPrimitive> primitives;
+
+	// number of vertices specified before the first op setting each attribute
+	uint colorSetAt, normalSetAt, texCoordSetAt, edgeFlagSetAt;
+
+	// the current state left by the list
+	Vector4 color, normal, texCoord;
+	int edgeFlag;
+
+	// the vertices transformed by the last call and the state they depend on
+	Common::Array<GLVertex> transformed;
+	bool transformedValid;
+	Matrix4 transformedModelProjection, transformedTextureMatrix;
+	int transformedTexture2D, transformedViewport[4];
+};
+
 struct GLImage {
 	Graphics::PixelBuffer pixmap;
 	int xsize, ysize;
@@ -184,6 +218,9 @@ struct GLImage {
 
 struct GLTexture {
 	GLImage images[MAX_TEXTURE_LEVELS];
+	const uint32 *levelTexels[MAX_TEXTURE_LEVELS]; // texels of images, for the rasterizer
+	int levelCount; // number of levels of the mipmap chain, the first level included
+	int minFilter;
 	unsigned int handle;
 	int versionNumber;
 	struct GLTexture *next, *prev;
@@ -200,52 +237,105 @@ struct GLSharedState {
 
 /**
  * A linear allocator implementation.
- * The allocator can be initialized to a specific buffer size only once.
  * The allocation scheme is pretty simple: pointers are returned relative to a current memory position,
  * the allocator starts with an offset of 0 and increases its offset by the allocated amount every time.
- * Memory is released through the method free(), care has to be taken to call the destructors of the deallocated objects either manually (for complex struct arrays) or
+ * When the current chunk of memory is exhausted, allocation continues in the next one, and a new chunk
+ * twice as large as the last one is added if there is none. Chunks are kept when resetting the allocator,
+ * so once it has grown to the largest amount of memory needed between two resets no more memory is allocated.
+ * Memory is released through the method reset(), care has to be taken to call the destructors of the deallocated objects either manually (for complex struct arrays) or
  * by overriding the delete operator (with an empty implementation).
  */
 class LinearAllocator {
 public:
 	LinearAllocator() {
-		_memoryBuffer = nullptr;
-		_memorySize = 0;
+		_currentChunk = 0;
 		_memoryPosition = 0;
+		_usedSize = 0;
+		_highWaterSize = 0;
 	}
 
 	void initialize(size_t newSize) {
-		assert(_memoryBuffer == nullptr);
-		void *newBuffer = gl_malloc(newSize);
-		if (newBuffer == nullptr) {
-			error("Couldn't allocate memory for linear allocator.");
-		}
-		_memoryBuffer = newBuffer;
-		_memorySize = newSize;
+		assert(_chunks.empty());
+		addChunk(newSize);
 	}
 
 	~LinearAllocator() {
-		if (_memoryBuffer != nullptr) {
-			gl_free(_memoryBuffer);
+		for (uint i = 0; i < _chunks.size(); i++) {
+			gl_free(_chunks[i].buffer);
 		}
 	}
 
 	void *allocate(size_t size) {
-		if (_memoryPosition + size >= _memorySize) {
-			error("Allocator out of memory: couldn't allocate more memory from linear allocator.");
+		// Keep every allocation aligned for any type, as draw calls and vertex arrays are interleaved.
+		size = (size + kAlignment - 1) & ~(kAlignment - 1);
+		if (_memoryPosition + size > _chunks[_currentChunk].size) {
+			nextChunk(size);
 		}
 		size_t returnPos = _memoryPosition;
 		_memoryPosition += size;
-		return ((char *)_memoryBuffer) + returnPos;
+		_usedSize += size;
+		return _chunks[_currentChunk].buffer + returnPos;
 	}
 
 	void reset() {
+		_highWaterSize = MAX(_highWaterSize, _usedSize);
+		_currentChunk = 0;
 		_memoryPosition = 0;
+		_usedSize = 0;
+	}
+
+	// Bytes allocated since the last reset.
+	size_t getUsedSize() const { return _usedSize; }
+	// Largest amount of bytes allocated between two resets.
+	size_t getHighWaterSize() const { return MAX(_highWaterSize, _usedSize); }
+	// Bytes reserved by all the chunks.
+	size_t getReservedSize() const {
+		size_t reservedSize = 0;
+		for (uint i = 0; i < _chunks.size(); i++) {
+			reservedSize += _chunks[i].size;
+		}
+		return reservedSize;
 	}
 private:
-	void *_memoryBuffer;
-	size_t _memorySize;
+	static const size_t kAlignment = 16;
+
+	struct Chunk {
+		char *buffer;
+		size_t size;
+	};
+
+	void addChunk(size_t size) {
+		Chunk chunk;
+		chunk.buffer = (char *)gl_malloc(size);
+		if (chunk.buffer == nullptr) {
+			error("Couldn't allocate memory for linear allocator.");
+		}
+		chunk.size = size;
+		_chunks.push_back(chunk);
+	}
+
+	void nextChunk(size_t size) {
+		// Skip the chunks too small for the allocation, they are used again after the next reset.
+		// The memory left unused in them still counts as used.
+		_usedSize += _chunks[_currentChunk].size - _memoryPosition;
+		_currentChunk++;
+		while (true) {
+			if (_currentChunk == _chunks.size()) {
+				addChunk(MAX(_chunks.back().size * 2, size));
+			}
+			if (_chunks[_currentChunk].size >= size)
+				break;
+			_usedSize += _chunks[_currentChunk].size;
+			_currentChunk++;
+		}
+		_memoryPosition = 0;
+	}
+
+	Common::Array<Chunk> _chunks;
+	uint _currentChunk;
 	size_t _memoryPosition;
+	size_t _usedSize;
+	size_t _highWaterSize;
 };
 
 struct GLContext;
@@ -284,6 +374,7 @@ struct GLContext {
 	GLSharedState shared_state;
 
 	// current list
+	GLList *current_list;
 	GLParamBuffer *current_op_buffer;
 	int current_op_buffer_index;
 	int exec_flag, compile_flag, print_flag;
@@ -341,6 +432,7 @@ struct GLContext {
 	int begin_type;
 	int vertex_n, vertex_cnt;
 	int vertex_max;
+	int vertex_processed; // vertices before this one have been transformed and lit
 	GLVertex *vertex;
 
 	// opengl 1.1 arrays
@@ -382,21 +474,43 @@ struct GLContext {
 	Common::Rect _scissorRect;
 
 	bool _enableDirtyRectangles;
+	bool _enableTiledRendering;
 
 	// blit test
 	Common::List<Graphics::BlitImage *> _blitImages;
 
 	// Draw call queue
-	Common::List<Graphics::DrawCall *> _drawCallsQueue;
-	Common::List<Graphics::DrawCall *> _previousFrameDrawCallsQueue;
+	// Arrays rather than lists, so that their storage is reused from frame to frame.
+	Common::Array<Graphics::DrawCall *> _drawCallsQueue;
+	Common::Array<Graphics::DrawCall *> _previousFrameDrawCallsQueue;
 	int _currentAllocatorIndex;
 	LinearAllocator _drawCallAllocator[2];
+
+	// Color and z buffer contents after the first _snapshotDrawCallCount draw calls of the
+	// frame, which were the same in the previous frames. Dirty regions restore them instead
+	// of executing those draw calls again. Only the tiles flagged in _snapshotValidTiles
+	// have been captured so far.
+	int _snapshotDrawCallCount;
+	byte *_snapshotColorBuffer;
+	unsigned int *_snapshotZBuffer;
+	Common::Array<bool> _snapshotValidTiles;
+
+	// Dirty rectangle statistics of the last presented frame, in pixels
+	int _rasterizedPixels;
+	int _restoredPixels;
+	int _reusedPixels;
 };
 
 extern GLContext *gl_ctx;
 
 void gl_add_op(GLParam *p);
 
+// list.cpp
+unsigned int glGenLists(int range);
+int glIsList(unsigned int list);
+void glNewList(unsigned int list, int mode);
+void glEndList();
+
 // clip.c
 void gl_transform_to_viewport(GLContext *c, GLVertex *v);
 void gl_draw_triangle(GLContext *c, GLVertex *p0, GLVertex *p1, GLVertex *p2);
@@ -415,12 +529,16 @@ void gl_print_matrix(const float *m);
 void gl_add_select(GLContext *c, unsigned int zmin, unsigned int zmax);
 void gl_enable_disable_light(GLContext *c, int light, int v);
 void gl_shade_vertex(GLContext *c, GLVertex *v);
+void gl_process_vertices(GLContext *c);
+void gl_reserve_vertices(GLContext *c, int count);
 
 void glInitTextures(GLContext *c);
 void glEndTextures(GLContext *c);
 GLTexture *alloc_texture(GLContext *c, int h);
 void free_texture(GLContext *c, int h);
 void free_texture(GLContext *c, GLTexture *t);
+// number of mipmap levels to sample texture with, depending on its minification filter
+int gl_texture_level_count(GLTexture *texture);
 
 // image_util.c
 void gl_resizeImage(unsigned char *dest, int xsize_dest, int ysize_dest,
@@ -433,6 +551,7 @@ void tglIssueDrawCall(Graphics::DrawCall *drawCall);
 // zdirtyrect.cpp
 void tglDisposeResources(GLContext *c);
 void tglDisposeDrawCallLists(TinyGL::GLContext *c);
+bool tglNeedsDirtyRegions(GLContext *c);
 
 GLContext *gl_get_context();
 
@@ -46,6 +46,9 @@ FORCEINLINE void FrameBuffer::putPixel(unsigned int pixelOffset, int color, int
 	unsigned int *pz = _zbuf + pixelOffset;
 	if (compareDepth(z, *pz)) {
 		writePixel<true, true, kDepthWrite>(pixelOffset, color, z);
+		if (kDepthWrite) {
+			updateHierarchicalZ(x, x, y, z, z, true);
+		}
 	}
 }
 
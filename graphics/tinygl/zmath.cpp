@@ -28,6 +28,14 @@
 
 #include "common/scummsys.h"
 
+#if defined(__SSE__) || defined(_M_X64)
+#include <xmmintrin.h>
+#define TGL_SIMD_TRANSFORM_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TGL_SIMD_TRANSFORM_NEON 1
+#endif
+
 #include "graphics/tinygl/zmath.h"
 
 namespace TinyGL {
@@ -332,6 +340,63 @@ void Matrix4::translate(float x, float y, float z) {
 	_m[3][3] += _m[3][0] * x + _m[3][1] * y + _m[3][2] * z;
 }
 
+// The SIMD versions work on the columns of the matrix, and add the products in the same order
+// as the scalar version, so that both give the same results.
+template <bool kUseW>
+static void transformArray(const Matrix4 &m, const Vector4 *vectors, Vector4 *out, int count, int stride) {
+	const byte *in = (const byte *)vectors;
+	byte *dst = (byte *)out;
+#if defined(TGL_SIMD_TRANSFORM_SSE)
+	__m128 c0 = _mm_setr_ps(m._m[0][0], m._m[1][0], m._m[2][0], m._m[3][0]);
+	__m128 c1 = _mm_setr_ps(m._m[0][1], m._m[1][1], m._m[2][1], m._m[3][1]);
+	__m128 c2 = _mm_setr_ps(m._m[0][2], m._m[1][2], m._m[2][2], m._m[3][2]);
+	__m128 c3 = _mm_setr_ps(m._m[0][3], m._m[1][3], m._m[2][3], m._m[3][3]);
+	for (int i = 0; i < count; i++, in += stride, dst += stride) {
+		const float *v = (const float *)in;
+		__m128 r = _mm_mul_ps(_mm_set1_ps(v[0]), c0);
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v[1]), c1));
+		r = _mm_add_ps(r, _mm_mul_ps(_mm_set1_ps(v[2]), c2));
+		r = _mm_add_ps(r, kUseW ? _mm_mul_ps(_mm_set1_ps(v[3]), c3) : c3);
+		_mm_storeu_ps((float *)dst, r);
+	}
+#elif defined(TGL_SIMD_TRANSFORM_NEON)
+	const float c[4][4] = {
+		{ m._m[0][0], m._m[1][0], m._m[2][0], m._m[3][0] },
+		{ m._m[0][1], m._m[1][1], m._m[2][1], m._m[3][1] },
+		{ m._m[0][2], m._m[1][2], m._m[2][2], m._m[3][2] },
+		{ m._m[0][3], m._m[1][3], m._m[2][3], m._m[3][3] }
+	};
+	float32x4_t c0 = vld1q_f32(c[0]);
+	float32x4_t c1 = vld1q_f32(c[1]);
+	float32x4_t c2 = vld1q_f32(c[2]);
+	float32x4_t c3 = vld1q_f32(c[3]);
+	for (int i = 0; i < count; i++, in += stride, dst += stride) {
+		const float *v = (const float *)in;
+		float32x4_t r = vmulq_n_f32(c0, v[0]);
+		r = vaddq_f32(r, vmulq_n_f32(c1, v[1]));
+		r = vaddq_f32(r, vmulq_n_f32(c2, v[2]));
+		r = vaddq_f32(r, kUseW ? vmulq_n_f32(c3, v[3]) : c3);
+		vst1q_f32((float *)dst, r);
+	}
+#else
+	for (int i = 0; i < count; i++, in += stride, dst += stride) {
+		const Vector4 v = *(const Vector4 *)in;
+		if (kUseW)
+			m.transform(v, *(Vector4 *)dst);
+		else
+			m.transform3x4(v, *(Vector4 *)dst);
+	}
+#endif
+}
+
+void Matrix4::transformArray(const Vector4 *vectors, Vector4 *out, int count, int stride) const {
+	TinyGL::transformArray<true>(*this, vectors, out, count, stride);
+}
+
+void Matrix4::transformArray3x4(const Vector4 *vectors, Vector4 *out, int count, int stride) const {
+	TinyGL::transformArray<false>(*this, vectors, out, count, stride);
+}
+
 void Matrix4::scale(float x, float y, float z) {
 	_m[0][0] *= x; _m[0][1] *= y; _m[0][2] *= z;
 	_m[1][0] *= x; _m[1][1] *= y; _m[1][2] *= z;
@@ -263,6 +263,12 @@ public:
 		out.W = vector.X * _m[3][0] + vector.Y * _m[3][1] + vector.Z * _m[3][2] + vector.W * _m[3][3];
 	}
 
+	// Same as transform() and transform3x4() for count vectors, stride being the distance
+	// in bytes from a vector to the next one, both in the input and the output.
+	// The output vectors may be the input ones.
+	void transformArray(const Vector4 *vectors, Vector4 *out, int count, int stride) const;
+	void transformArray3x4(const Vector4 *vectors, Vector4 *out, int count, int stride) const;
+
 	float _m[4][4];
 };
 
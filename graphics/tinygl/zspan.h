@@ -0,0 +1,332 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the AUTHORS
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+/*
+ * SIMD span kernels for the triangle rasterizer.
+ *
+ * The kernels process four pixels of a scanline at once: the depth, scissor and alpha
+ * tests are evaluated for the whole group and the pixels which pass them are written
+ * back through a masked store. They produce exactly the same output as the scalar
+ * putPixel* functions in ztriangle.cpp, and are only used on 32bpp frame buffers with
+ * 8 bits per color channel (see FrameBuffer::_simdSpans).
+ */
+
+#ifndef GRAPHICS_TINYGL_ZSPAN_H_
+#define GRAPHICS_TINYGL_ZSPAN_H_
+
+#include "common/scummsys.h"
+#include "graphics/tinygl/zbuffer.h"
+
+#if defined(SCUMM_LITTLE_ENDIAN) && defined(__SSE2__)
+#define TGL_SIMD_SPANS 1
+#define TGL_SIMD_SPANS_SSE2
+#include <emmintrin.h>
+#elif defined(SCUMM_LITTLE_ENDIAN) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define TGL_SIMD_SPANS 1
+#define TGL_SIMD_SPANS_NEON
+#include <arm_neon.h>
+#else
+#define TGL_SIMD_SPANS 0
+#endif
+
+#if TGL_SIMD_SPANS
+
+namespace TinyGL {
+namespace Span {
+
+#if defined(TGL_SIMD_SPANS_SSE2)
+
+typedef __m128i Vec4;
+
+FORCEINLINE Vec4 splat(uint32 value) { return _mm_set1_epi32((int)value); }
+FORCEINLINE Vec4 load(const uint32 *p) { return _mm_loadu_si128((const __m128i *)p); }
+FORCEINLINE void store(uint32 *p, Vec4 v) { _mm_storeu_si128((__m128i *)p, v); }
+FORCEINLINE Vec4 add(Vec4 a, Vec4 b) { return _mm_add_epi32(a, b); }
+FORCEINLINE Vec4 sub(Vec4 a, Vec4 b) { return _mm_sub_epi32(a, b); }
+FORCEINLINE Vec4 bitAnd(Vec4 a, Vec4 b) { return _mm_and_si128(a, b); }
+FORCEINLINE Vec4 bitOr(Vec4 a, Vec4 b) { return _mm_or_si128(a, b); }
+// a & ~b
+FORCEINLINE Vec4 andNot(Vec4 a, Vec4 b) { return _mm_andnot_si128(b, a); }
+FORCEINLINE Vec4 bitNot(Vec4 a) { return _mm_xor_si128(a, _mm_set1_epi32(-1)); }
+FORCEINLINE Vec4 shl(Vec4 v, int count) { return _mm_sll_epi32(v, _mm_cvtsi32_si128(count)); }
+FORCEINLINE Vec4 shr(Vec4 v, int count) { return _mm_srl_epi32(v, _mm_cvtsi32_si128(count)); }
+FORCEINLINE Vec4 cmpEq(Vec4 a, Vec4 b) { return _mm_cmpeq_epi32(a, b); }
+FORCEINLINE Vec4 cmpGtSigned(Vec4 a, Vec4 b) { return _mm_cmpgt_epi32(a, b); }
+FORCEINLINE Vec4 cmpGt(Vec4 a, Vec4 b) {
+	const __m128i bias = _mm_set1_epi32((int)0x80000000);
+	return _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+}
+// Only the low 16 bits of each lane hold the product (modulo 2^16).
+FORCEINLINE Vec4 mulLow16(Vec4 a, Vec4 b) { return _mm_mullo_epi16(a, b); }
+// Only valid for lanes below 2^15.
+FORCEINLINE Vec4 minSmall(Vec4 a, Vec4 b) { return _mm_min_epi16(a, b); }
+FORCEINLINE bool any(Vec4 mask) { return _mm_movemask_epi8(mask) != 0; }
+
+#elif defined(TGL_SIMD_SPANS_NEON)
+
+typedef uint32x4_t Vec4;
+
+FORCEINLINE Vec4 splat(uint32 value) { return vdupq_n_u32(value); }
+FORCEINLINE Vec4 load(const uint32 *p) { return vld1q_u32(p); }
+FORCEINLINE void store(uint32 *p, Vec4 v) { vst1q_u32(p, v); }
+FORCEINLINE Vec4 add(Vec4 a, Vec4 b) { return vaddq_u32(a, b); }
+FORCEINLINE Vec4 sub(Vec4 a, Vec4 b) { return vsubq_u32(a, b); }
+FORCEINLINE Vec4 bitAnd(Vec4 a, Vec4 b) { return vandq_u32(a, b); }
+FORCEINLINE Vec4 bitOr(Vec4 a, Vec4 b) { return vorrq_u32(a, b); }
+// a & ~b
+FORCEINLINE Vec4 andNot(Vec4 a, Vec4 b) { return vbicq_u32(a, b); }
+FORCEINLINE Vec4 bitNot(Vec4 a) { return vmvnq_u32(a); }
+FORCEINLINE Vec4 shl(Vec4 v, int count) { return vshlq_u32(v, vdupq_n_s32(count)); }
+FORCEINLINE Vec4 shr(Vec4 v, int count) { return vshlq_u32(v, vdupq_n_s32(-count)); }
+FORCEINLINE Vec4 cmpEq(Vec4 a, Vec4 b) { return vceqq_u32(a, b); }
+FORCEINLINE Vec4 cmpGtSigned(Vec4 a, Vec4 b) { return vcgtq_s32(vreinterpretq_s32_u32(a), vreinterpretq_s32_u32(b)); }
+FORCEINLINE Vec4 cmpGt(Vec4 a, Vec4 b) { return vcgtq_u32(a, b); }
+// Only the low 16 bits of each lane hold the product (modulo 2^16).
+FORCEINLINE Vec4 mulLow16(Vec4 a, Vec4 b) { return vmulq_u32(a, b); }
+// Only valid for lanes below 2^15.
+FORCEINLINE Vec4 minSmall(Vec4 a, Vec4 b) { return vminq_u32(a, b); }
+FORCEINLINE bool any(Vec4 mask) {
+	uint32x2_t folded = vorr_u32(vget_low_u32(mask), vget_high_u32(mask));
+	return (vget_lane_u32(folded, 0) | vget_lane_u32(folded, 1)) != 0;
+}
+
+#endif
+
+// Returns a vector whose lanes are start, start + step, start + 2 * step, start + 3 * step,
+// with the same wrap-around as four successive unsigned additions.
+FORCEINLINE Vec4 ramp(uint32 start, int step) {
+	uint32 lanes[4] = { start, start + step, start + 2 * (uint32)step, start + 3 * (uint32)step };
+	return load(lanes);
+}
+
+FORCEINLINE Vec4 select(Vec4 mask, Vec4 a, Vec4 b) {
+	return bitOr(bitAnd(a, mask), andNot(b, mask));
+}
+
+// Frame buffer and per-triangle state shared by all the spans of a triangle.
+struct SpanSetup {
+	bool depthTestEnabled;
+	int depthFunc;
+	int clipLeft, clipRight;
+	bool alphaTestEnabled;
+	int alphaFunc, alphaRefValue;
+	int rShift, gShift, bShift, aShift;
+	uint32 alphaMask;
+	int textureRShift, textureGShift, textureBShift, textureAShift;
+};
+
+// Mirrors FrameBuffer::compareDepth(zSrc, zDst).
+FORCEINLINE Vec4 depthTestMask(const SpanSetup &setup, Vec4 zSrc, Vec4 zDst) {
+	if (!setup.depthTestEnabled)
+		return splat(0xFFFFFFFF);
+
+	switch (setup.depthFunc) {
+	case TGL_LESS:
+		return cmpGt(zSrc, zDst);
+	case TGL_EQUAL:
+		return cmpEq(zDst, zSrc);
+	case TGL_LEQUAL:
+		return bitNot(cmpGt(zDst, zSrc));
+	case TGL_GREATER:
+		return cmpGt(zDst, zSrc);
+	case TGL_NOTEQUAL:
+		return bitNot(cmpEq(zDst, zSrc));
+	case TGL_GEQUAL:
+		return bitNot(cmpGt(zSrc, zDst));
+	case TGL_ALWAYS:
+		return splat(0xFFFFFFFF);
+	default:
+		return splat(0);
+	}
+}
+
+// Mirrors FrameBuffer::checkAlphaTest(aSrc), alpha values are in the 0..255 range.
+FORCEINLINE Vec4 alphaTestMask(const SpanSetup &setup, Vec4 aSrc) {
+	if (!setup.alphaTestEnabled)
+		return splat(0xFFFFFFFF);
+
+	Vec4 ref = splat(setup.alphaRefValue);
+	switch (setup.alphaFunc) {
+	case TGL_LESS:
+		return cmpGtSigned(ref, aSrc);
+	case TGL_EQUAL:
+		return cmpEq(aSrc, ref);
+	case TGL_LEQUAL:
+		return bitNot(cmpGtSigned(aSrc, ref));
+	case TGL_GREATER:
+		return cmpGtSigned(aSrc, ref);
+	case TGL_NOTEQUAL:
+		return bitNot(cmpEq(aSrc, ref));
+	case TGL_GEQUAL:
+		return bitNot(cmpGtSigned(ref, aSrc));
+	case TGL_ALWAYS:
+		return splat(0xFFFFFFFF);
+	default:
+		return splat(0);
+	}
+}
+
+FORCEINLINE Vec4 scissorMask(const SpanSetup &setup, int x) {
+	Vec4 lanes = ramp(x, 1);
+	return andNot(cmpGtSigned(splat(setup.clipRight), lanes), cmpGtSigned(splat(setup.clipLeft), lanes));
+}
+
+// Packs 8 bit channels into frame buffer pixels, mirroring PixelFormat::ARGBToColor.
+FORCEINLINE Vec4 packPixels(const SpanSetup &setup, Vec4 a, Vec4 r, Vec4 g, Vec4 b) {
+	const Vec4 channelMask = splat(0xFF);
+	Vec4 pixel = shl(bitAnd(r, channelMask), setup.rShift);
+	pixel = bitOr(pixel, shl(bitAnd(g, channelMask), setup.gShift));
+	pixel = bitOr(pixel, shl(bitAnd(b, channelMask), setup.bShift));
+	return bitOr(pixel, bitAnd(shl(bitAnd(a, channelMask), setup.aShift), splat(setup.alphaMask)));
+}
+
+FORCEINLINE Vec4 extractChannel(Vec4 pixels, int shift) {
+	return bitAnd(shr(pixels, shift), splat(0xFF));
+}
+
+// Blends with (TGL_SRC_ALPHA, TGL_ONE_MINUS_SRC_ALPHA), mirroring FrameBuffer::writePixel.
+FORCEINLINE Vec4 blendAlpha(const SpanSetup &setup, Vec4 dst, Vec4 cA, Vec4 cR, Vec4 cG, Vec4 cB) {
+	const Vec4 full = splat(255);
+	Vec4 invA = sub(full, cA);
+	Vec4 finalR = add(shr(mulLow16(cR, cA), 8), shr(mulLow16(extractChannel(dst, setup.rShift), invA), 8));
+	Vec4 finalG = add(shr(mulLow16(cG, cA), 8), shr(mulLow16(extractChannel(dst, setup.gShift), invA), 8));
+	Vec4 finalB = add(shr(mulLow16(cB, cA), 8), shr(mulLow16(extractChannel(dst, setup.bShift), invA), 8));
+	return packPixels(setup, full, minSmall(finalR, full), minSmall(finalG, full), minSmall(finalB, full));
+}
+
+// Gouraud shaded span without alpha test and blending (see putPixelSmooth).
+template <bool kDepthWrite, bool kEnableScissor>
+FORCEINLINE void putPixelsSmooth(const SpanSetup &setup, uint32 *color, uint32 *pz, int x,
+                                 unsigned int &z, unsigned int &r, unsigned int &g, unsigned int &b, unsigned int &a,
+                                 int dzdx, int drdx, int dgdx, int dbdx, int dadx) {
+	Vec4 zSrc = ramp(z, dzdx);
+	Vec4 zDst = load(pz);
+	Vec4 mask = depthTestMask(setup, zSrc, zDst);
+	if (kEnableScissor) {
+		mask = bitAnd(mask, scissorMask(setup, x));
+	}
+
+	Vec4 pixels = packPixels(setup,
+	                         shr(ramp(a, dadx), ZB_POINT_ALPHA_BITS - 8),
+	                         shr(ramp(r, drdx), ZB_POINT_RED_BITS - 8),
+	                         shr(ramp(g, dgdx), ZB_POINT_GREEN_BITS - 8),
+	                         shr(ramp(b, dbdx), ZB_POINT_BLUE_BITS - 8));
+	store(color, select(mask, pixels, load(color)));
+	if (kDepthWrite) {
+		store(pz, select(mask, zSrc, zDst));
+	}
+
+	z += 4 * dzdx;
+	r += 4 * drdx;
+	g += 4 * dgdx;
+	b += 4 * dbdx;
+	a += 4 * dadx;
+}
+
+// Perspective correct textured span, optionally lit, alpha tested and alpha blended with
+// (TGL_SRC_ALPHA, TGL_ONE_MINUS_SRC_ALPHA) (see putPixelTextureMappingPerspective).
+template <bool kDepthWrite, bool kLightsMode, bool kSmoothMode, bool kEnableAlphaTest, bool kEnableScissor, bool kEnableBlending>
+FORCEINLINE void putPixelsTextureMappingPerspective(const SpanSetup &setup, uint32 *color, const TextureLevel &texture, uint32 *pz, int x,
+                                                    unsigned int &z, unsigned int &t, unsigned int &s,
+                                                    unsigned int &r, unsigned int &g, unsigned int &b, unsigned int &a,
+                                                    int dzdx, int dsdx, int dtdx, int drdx, int dgdx, int dbdx, int dadx) {
+	Vec4 zSrc = ramp(z, dzdx);
+	Vec4 zDst = load(pz);
+	Vec4 mask = depthTestMask(setup, zSrc, zDst);
+	if (kEnableScissor) {
+		mask = bitAnd(mask, scissorMask(setup, x));
+	}
+
+	if (any(mask)) {
+		const Vec4 textureMask = splat(texture.mask);
+		const Vec4 tileMask = splat((1 << ZB_TEXTURE_TILE_BITS) - 1);
+		Vec4 sss = shr(bitAnd(ramp(s, dsdx), textureMask), texture.shift);
+		Vec4 ttt = shr(bitAnd(ramp(t, dtdx), textureMask), texture.shift);
+		// see textureTexelOffset()
+		Vec4 tile = add(shl(shr(ttt, ZB_TEXTURE_TILE_BITS), texture.sizeShift - ZB_TEXTURE_TILE_BITS), shr(sss, ZB_TEXTURE_TILE_BITS));
+		Vec4 offset = bitOr(shl(tile, 2 * ZB_TEXTURE_TILE_BITS), bitOr(shl(bitAnd(ttt, tileMask), ZB_TEXTURE_TILE_BITS), bitAnd(sss, tileMask)));
+		uint32 texels[4];
+		store(texels, offset);
+		for (int i = 0; i < 4; i++) {
+			texels[i] = texture.texels[texels[i]];
+		}
+		Vec4 texel = load(texels);
+
+		Vec4 cA = extractChannel(texel, setup.textureAShift);
+		Vec4 cR = extractChannel(texel, setup.textureRShift);
+		Vec4 cG = extractChannel(texel, setup.textureGShift);
+		Vec4 cB = extractChannel(texel, setup.textureBShift);
+		if (kLightsMode) {
+			const Vec4 channelMask = splat(0xFF);
+			cA = bitAnd(shr(mulLow16(cA, shr(ramp(a, dadx), ZB_POINT_ALPHA_BITS - 8)), ZB_POINT_ALPHA_BITS - 8), channelMask);
+			cR = bitAnd(shr(mulLow16(cR, shr(ramp(r, drdx), ZB_POINT_RED_BITS - 8)), ZB_POINT_RED_BITS - 8), channelMask);
+			cG = bitAnd(shr(mulLow16(cG, shr(ramp(g, dgdx), ZB_POINT_GREEN_BITS - 8)), ZB_POINT_GREEN_BITS - 8), channelMask);
+			cB = bitAnd(shr(mulLow16(cB, shr(ramp(b, dbdx), ZB_POINT_BLUE_BITS - 8)), ZB_POINT_BLUE_BITS - 8), channelMask);
+		}
+
+		if (kEnableAlphaTest) {
+			mask = bitAnd(mask, alphaTestMask(setup, cA));
+		}
+
+		Vec4 dst = load(color);
+		Vec4 pixels;
+		if (kEnableBlending) {
+			pixels = blendAlpha(setup, dst, cA, cR, cG, cB);
+		} else {
+			pixels = packPixels(setup, cA, cR, cG, cB);
+		}
+		store(color, select(mask, pixels, dst));
+		if (kDepthWrite) {
+			store(pz, select(mask, zSrc, zDst));
+		}
+	}
+
+	z += 4 * dzdx;
+	s += 4 * dsdx;
+	t += 4 * dtdx;
+	if (kSmoothMode) {
+		a += 4 * dadx;
+		r += 4 * drdx;
+		g += 4 * dgdx;
+		b += 4 * dbdx;
+	}
+}
+
+// Alpha blended pixels of a blit image, whose format is described by the texture shifts
+// of the setup (see FrameBuffer::blendPixels).
+template <bool kEnableAlphaTest>
+FORCEINLINE void blendPixels(const SpanSetup &setup, uint32 *color, const uint32 *src) {
+	Vec4 texel = load(src);
+	Vec4 cA = extractChannel(texel, setup.textureAShift);
+	Vec4 mask = kEnableAlphaTest ? alphaTestMask(setup, cA) : splat(0xFFFFFFFF);
+	Vec4 dst = load(color);
+	Vec4 pixels = blendAlpha(setup, dst, cA, extractChannel(texel, setup.textureRShift),
+	                         extractChannel(texel, setup.textureGShift), extractChannel(texel, setup.textureBShift));
+	store(color, select(mask, pixels, dst));
+}
+
+} // end of namespace Span
+} // end of namespace TinyGL
+
+#endif // TGL_SIMD_SPANS
+
+#endif // GRAPHICS_TINYGL_ZSPAN_H_
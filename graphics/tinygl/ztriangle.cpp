@@ -29,6 +29,7 @@
 #include "common/endian.h"
 #include "graphics/tinygl/zbuffer.h"
 #include "graphics/tinygl/zgl.h"
+#include "graphics/tinygl/zspan.h"
 
 namespace TinyGL {
 
@@ -77,16 +78,14 @@ FORCEINLINE static void putPixelShadow(FrameBuffer *buffer, int buf, unsigned in
 
 template <bool kDepthWrite, bool kLightsMode, bool kSmoothMode, bool kEnableAlphaTest, bool kEnableScissor, bool kEnableBlending>
 FORCEINLINE static void putPixelTextureMappingPerspective(FrameBuffer *buffer, int buf,
-                        Graphics::PixelFormat &textureFormat, Graphics::PixelBuffer &texture, unsigned int *pz, int _a,
+                        const Graphics::PixelFormat &textureFormat, const TextureLevel &texture, unsigned int *pz, int _a,
                         int x, int y, unsigned int &z, unsigned int &t, unsigned int &s, unsigned int &r, unsigned int &g, unsigned int &b, unsigned int &a,
                         int &dzdx, int &dsdx, int &dtdx, int &drdx, int &dgdx, int &dbdx, unsigned int dadx) {
 	if ((!kEnableScissor || !buffer->scissorPixel(x + _a, y)) && buffer->compareDepth(z, pz[_a])) {
-		unsigned sss = (s & buffer->_textureSizeMask) >> ZB_POINT_ST_FRAC_BITS;
-		unsigned ttt = (t & buffer->_textureSizeMask) >> ZB_POINT_ST_FRAC_BITS;
-		int pixel = ttt * buffer->_textureSize + sss;
+		unsigned sss = (s & texture.mask) >> texture.shift;
+		unsigned ttt = (t & texture.mask) >> texture.shift;
 		uint8 c_a, c_r, c_g, c_b;
-		uint32 *textureBuffer = (uint32 *)texture.getRawBuffer(pixel);
-		uint32 col = *textureBuffer;
+		uint32 col = texture.texels[textureTexelOffset(sss, ttt, texture.sizeShift)];
 		c_a = (col >> textureFormat.aShift) & 0xFF;
 		c_r = (col >> textureFormat.rShift) & 0xFF;
 		c_g = (col >> textureFormat.gShift) & 0xFF;
@@ -114,11 +113,34 @@ FORCEINLINE static void putPixelTextureMappingPerspective(FrameBuffer *buffer, i
 	}
 }
 
+static void setTextureLevel(const FrameBuffer *buffer, int level, TextureLevel &texture) {
+	texture.texels = buffer->_textureLevels[level];
+	texture.shift = ZB_POINT_ST_FRAC_BITS + level;
+	texture.mask = buffer->_textureSizeMask & (0xFFFFFFFF << texture.shift);
+	texture.sizeShift = buffer->_textureSizeShift - level;
+}
+
+// Selects the mipmap level closest to the footprint of a pixel in the texture, given the
+// derivatives of s and t along x and y.
+static int selectTextureLevel(const FrameBuffer *buffer, float dsdx, float dtdx, float dsdy, float dtdy) {
+	float rho = MAX(MAX(ABS(dsdx), ABS(dtdx)), MAX(ABS(dsdy), ABS(dtdy)));
+	// the next level is used once the footprint is above sqrt(2) texels of the current one
+	float limit = 1.41421356f * (1 << ZB_POINT_ST_FRAC_BITS);
+	int level = 0;
+	while (rho >= limit && level < buffer->_textureLevelCount - 1) {
+		level++;
+		limit *= 2;
+	}
+	return level;
+}
+
 template <bool kInterpRGB, bool kInterpZ, bool kInterpST, bool kInterpSTZ, int kDrawLogic, bool kDepthWrite, bool kAlphaTestEnabled, bool kEnableScissor, bool kBlendingEnabled>
 void FrameBuffer::fillTriangle(ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint *p2) {
-	Graphics::PixelBuffer texture;
+	TextureLevel texture;
 	Graphics::PixelFormat textureFormat;
-	float fdzdx = 0, fndzdx = 0, ndszdx = 0, ndtzdx = 0;
+	float fdzdx = 0, fdzdy = 0, fndzdx = 0, ndszdx = 0, ndtzdx = 0;
+	bool mipmapping = false;
+	int textureLevel = 0;
 
 	ZBufferPoint *tp, *pr1 = 0, *pr2 = 0, *l1 = 0, *l2 = 0;
 	float fdx1, fdx2, fdy1, fdy2, fz0, d1, d2;
@@ -183,6 +205,29 @@ void FrameBuffer::fillTriangle(ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint
 		d2 = (float)(p2->z - p0->z);
 		dzdx = (int)(fdy2 * d1 - fdy1 * d2);
 		dzdy = (int)(fdx1 * d2 - fdx2 * d1);
+
+		// The scanline loop steps z along the left edge and then along each span, so the
+		// depth of every fragment is exactly the plane through the left edge's starting
+		// vertex (p0, or p1 for the second part). Its extremes lie on the bounding box
+		// corners, which makes the whole triangle testable against the hierarchical z.
+		if (kDrawLogic != DRAW_SHADOW_MASK) {
+			int minX = MIN(p0->x, MIN(p1->x, p2->x)) - 1;
+			int maxX = MAX(p0->x, MAX(p1->x, p2->x)) + 1;
+			int minY = p0->y, maxY = p2->y;
+			int64 zMin = 0xFFFFFFFF, zMax = 0;
+			for (int i = 0; i < 2; i++) {
+				const ZBufferPoint *base = i == 0 ? p0 : p1;
+				for (int corner = 0; corner < 4; corner++) {
+					int cx = (corner & 1) ? maxX : minX;
+					int cy = (corner & 2) ? maxY : minY;
+					int64 z = (int64)(unsigned int)base->z + (int64)(cy - base->y) * dzdy + (int64)(cx - base->x) * dzdx;
+					zMin = MIN(zMin, z);
+					zMax = MAX(zMax, z);
+				}
+			}
+			if (zMin >= 0 && zMax <= 0xFFFFFFFF && isOccluded(minX, minY, maxX, maxY, (unsigned int)zMin, (unsigned int)zMax))
+				return;
+		}
 	}
 
 	if (kInterpRGB) {
@@ -269,15 +314,49 @@ void FrameBuffer::fillTriangle(ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint
 	}
 
 	if ((kInterpST || kInterpSTZ) && (kDrawLogic == DRAW_FLAT || kDrawLogic == DRAW_SMOOTH)) {
-		texture = current_texture;
-		textureFormat = texture.getFormat();
+		textureFormat = current_texture.getFormat();
 		assert(textureFormat.bytesPerPixel == 4);
+		setTextureLevel(this, 0, texture);
+		mipmapping = _textureLevelCount > 1;
 		fdzdx = (float)dzdx;
+		fdzdy = (float)dzdy;
 		fndzdx = NB_INTERP * fdzdx;
 		ndszdx = NB_INTERP * dszdx;
 		ndtzdx = NB_INTERP * dtzdx;
 	}
 
+#if TGL_SIMD_SPANS
+	// Use the SIMD span kernels when they support the current state, otherwise
+	// fall back to the scalar putPixel* functions below.
+	bool simdSpans = false;
+	Span::SpanSetup spanSetup;
+	if (_simdSpans) {
+		if (kDrawLogic == DRAW_SMOOTH && !(kInterpST || kInterpSTZ)) {
+			simdSpans = !kAlphaTestEnabled && !kBlendingEnabled;
+		} else if ((kInterpST || kInterpSTZ) && (kDrawLogic == DRAW_FLAT || kDrawLogic == DRAW_SMOOTH)) {
+			simdSpans = !kBlendingEnabled || isAlphaBlendingEnabled();
+		}
+	}
+	if (simdSpans) {
+		spanSetup.depthTestEnabled = _depthTestEnabled;
+		spanSetup.depthFunc = _depthFunc;
+		spanSetup.clipLeft = _clipRectangle.left;
+		spanSetup.clipRight = _clipRectangle.right;
+		spanSetup.alphaTestEnabled = _alphaTestEnabled;
+		spanSetup.alphaFunc = _alphaTestFunc;
+		spanSetup.alphaRefValue = _alphaTestRefVal;
+		spanSetup.rShift = cmode.rShift;
+		spanSetup.gShift = cmode.gShift;
+		spanSetup.bShift = cmode.bShift;
+		spanSetup.aShift = cmode.aShift;
+		spanSetup.alphaMask = cmode.aLoss == 0 ? 0xFFFFFFFF : 0;
+		spanSetup.textureRShift = textureFormat.rShift;
+		spanSetup.textureGShift = textureFormat.gShift;
+		spanSetup.textureBShift = textureFormat.bShift;
+		spanSetup.textureAShift = textureFormat.aShift;
+	}
+#endif
+
 	if (fz0 > 0) {
 		l1 = p0;
 		l2 = p2;
@@ -371,7 +450,35 @@ void FrameBuffer::fillTriangle(ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint
 		// we draw all the scan line of the part
 		while (nb_lines > 0) {
 			int x = x1;
-			{
+			// Depth range of the span, used to skip it when the hierarchical z shows that
+			// it is hidden everywhere. Skipped when the range wraps around.
+			int spanEnd = x2 >> 16;
+			bool spanHiZ = false;
+			unsigned int spanZMin = 0, spanZMax = 0;
+			if (kInterpZ && kDrawLogic != DRAW_SHADOW_MASK && spanEnd >= x1) {
+				int64 zStart = (unsigned int)z1;
+				int64 zEnd = zStart + (int64)(spanEnd - x1) * dzdx;
+				if (zEnd >= 0 && zEnd <= 0xFFFFFFFF) {
+					spanHiZ = true;
+					spanZMin = (unsigned int)MIN(zStart, zEnd);
+					spanZMax = (unsigned int)MAX(zStart, zEnd);
+				}
+			}
+			// Scanlines outside of the scissor rectangle have no visible pixel, skip them
+			// entirely. Shadow masks are written regardless of the scissor, so they are kept.
+			if ((!kEnableScissor || kDrawLogic == DRAW_SHADOW_MASK ||
+					(y >= _clipRectangle.top && y < _clipRectangle.bottom)) &&
+					!(spanHiZ && isSpanOccluded(x1, spanEnd, y, spanZMin, spanZMax))) {
+				if (kDepthWrite && kDrawLogic != DRAW_SHADOW_MASK && spanEnd >= x1) {
+					// Alpha tested and shadowed pixels may be left out even if they pass the depth test.
+					const bool fullyWritten = spanHiZ && !kAlphaTestEnabled && kDrawLogic != DRAW_SHADOW;
+					int left = kEnableScissor ? MAX(x1, (int)_clipRectangle.left) : x1;
+					int right = kEnableScissor ? MIN(spanEnd, _clipRectangle.right - 1) : spanEnd;
+					if (left <= right) {
+						updateHierarchicalZ(left, right, y, spanHiZ ? spanZMin : 0,
+						                    spanHiZ ? spanZMax : 0xFFFFFFFF, fullyWritten);
+					}
+				}
 				if (kDrawLogic == DRAW_DEPTH_ONLY ||
 						(kDrawLogic == DRAW_FLAT && !(kInterpST || kInterpSTZ))) {
 					int pp;
@@ -495,6 +602,19 @@ void FrameBuffer::fillTriangle(ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint
 					g = g1;
 					b = b1;
 					a = a1;
+#if TGL_SIMD_SPANS
+					if (simdSpans) {
+						uint32 *color = (uint32 *)pbuf.getRawBuffer(buf);
+						while (n >= 3) {
+							Span::putPixelsSmooth<kDepthWrite, kEnableScissor>(spanSetup, color, pz, x, z, r, g, b, a, dzdx, drdx, dgdx, dbdx, dadx);
+							color += 4;
+							pz += 4;
+							buf += 4;
+							n -= 4;
+							x += 4;
+						}
+					}
+#endif
 					while (n >= 3) {
 						putPixelSmooth<kDepthWrite, kAlphaTestEnabled, kEnableScissor, kBlendingEnabled>(this, buf, pz, 0, x, y, z, r, g, b, a, dzdx, drdx, dgdx, dbdx, dadx);
 						putPixelSmooth<kDepthWrite, kAlphaTestEnabled, kEnableScissor, kBlendingEnabled>(this, buf, pz, 1, x, y, z, r, g, b, a, dzdx, drdx, dgdx, dbdx, dadx);
@@ -542,9 +662,26 @@ void FrameBuffer::fillTriangle(ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint
 							t = (int)tt;
 							dsdx = (int)((dszdx - ss * fdzdx) * zinv);
 							dtdx = (int)((dtzdx - tt * fdzdx) * zinv);
+							if (mipmapping) {
+								int level = selectTextureLevel(this, (float)dsdx, (float)dtdx,
+								                               (dszdy - ss * fdzdy) * zinv, (dtzdy - tt * fdzdy) * zinv);
+								if (level != textureLevel) {
+									textureLevel = level;
+									setTextureLevel(this, level, texture);
+								}
+							}
 							fz += fndzdx;
 							zinv = (float)(1.0 / fz);
 						}
+#if TGL_SIMD_SPANS
+						if (simdSpans) {
+							uint32 *color = (uint32 *)pbuf.getRawBuffer(buf);
+							for (int _a = 0; _a < NB_INTERP; _a += 4) {
+								Span::putPixelsTextureMappingPerspective<kDepthWrite, kInterpRGB, kDrawLogic == DRAW_SMOOTH, kAlphaTestEnabled, kEnableScissor, kBlendingEnabled>(spanSetup, color + _a, texture,
+								                           pz + _a, x + _a, z, t, s, r, g, b, a, dzdx, dsdx, dtdx, drdx, dgdx, dbdx, dadx);
+							}
+						} else
+#endif
 						for (int _a = 0; _a < NB_INTERP; _a++) {
 							putPixelTextureMappingPerspective<kDepthWrite, kInterpRGB, kDrawLogic == DRAW_SMOOTH, kAlphaTestEnabled, kEnableScissor, kBlendingEnabled>(this, buf, textureFormat, texture,
 							                           pz, _a, x, y, z, t, s, r, g, b, a, dzdx, dsdx, dtdx, drdx, dgdx, dbdx, dadx);
@@ -565,7 +702,30 @@ void FrameBuffer::fillTriangle(ZBufferPoint *p0, ZBufferPoint *p1, ZBufferPoint
 						t = (int)tt;
 						dsdx = (int)((dszdx - ss * fdzdx) * zinv);
 						dtdx = (int)((dtzdx - tt * fdzdx) * zinv);
+						if (mipmapping) {
+							int level = selectTextureLevel(this, (float)dsdx, (float)dtdx,
+							                               (dszdy - ss * fdzdy) * zinv, (dtzdy - tt * fdzdy) * zinv);
+							if (level != textureLevel) {
+								textureLevel = level;
+								setTextureLevel(this, level, texture);
+							}
+						}
+					}
+
+#if TGL_SIMD_SPANS
+					if (simdSpans) {
+						uint32 *color = (uint32 *)pbuf.getRawBuffer(buf);
+						while (n >= 3) {
+							Span::putPixelsTextureMappingPerspective<kDepthWrite, kInterpRGB, kDrawLogic == DRAW_SMOOTH, kAlphaTestEnabled, kEnableScissor, kBlendingEnabled>(spanSetup, color, texture,
+							                           pz, x, z, t, s, r, g, b, a, dzdx, dsdx, dtdx, drdx, dgdx, dbdx, dadx);
+							color += 4;
+							pz += 4;
+							buf += 4;
+							n -= 4;
+							x += 4;
+						}
 					}
+#endif
 
 					while (n >= 0) {
 						putPixelTextureMappingPerspective<kDepthWrite, kInterpRGB, kDrawLogic == DRAW_SMOOTH, kAlphaTestEnabled, kEnableScissor, kBlendingEnabled>(this, buf, textureFormat, texture,
@@ -0,0 +1,58 @@
+#include <cxxtest/TestSuite.h>
+
+#include "mixer_workloads.h"
+
+class ADPCMTestSuite : public CxxTest::TestSuite
+{
+	// Decodes a whole stream with reads of the given sizes, used in turn
+	int16 *decode(Audio::ADPCMType type, int channels, const int *readSizes, int numReadSizes, int &numSamples) {
+		MixerWorkloadRandom generator(channels * 31 + type);
+		Audio::SeekableAudioStream *stream = createMixerWorkloadADPCM(generator, type, 11025, channels);
+
+		const int capacity = 11025 * channels * 2;
+		int16 *samples = new int16[capacity];
+		numSamples = 0;
+		for (int i = 0; !stream->endOfData() && numSamples < capacity; i++) {
+			const int readSize = MIN(readSizes[i % numReadSizes], capacity - numSamples);
+			const int read = stream->readBuffer(samples + numSamples, readSize);
+			if (read <= 0)
+				break;
+			numSamples += read;
+		}
+
+		delete stream;
+		return samples;
+	}
+
+	void checkPartialReads(Audio::ADPCMType type, int channels) {
+		static const int wholeReads[] = { 11025 * 4 };
+		static const int partialReads[] = { 2, 6, 14, 126, 4, 1022 };
+
+		int wholeCount, partialCount;
+		int16 *whole = decode(type, channels, wholeReads, ARRAYSIZE(wholeReads), wholeCount);
+		int16 *partial = decode(type, channels, partialReads, ARRAYSIZE(partialReads), partialCount);
+
+		TS_ASSERT_LESS_THAN(0, wholeCount);
+		TS_ASSERT_EQUALS(wholeCount, partialCount);
+		TS_ASSERT_EQUALS(memcmp(whole, partial, MIN(wholeCount, partialCount) * sizeof(int16)), 0);
+
+		delete[] whole;
+		delete[] partial;
+	}
+
+	public:
+	void test_ms_ima_partial_reads() {
+		checkPartialReads(Audio::kADPCMMSIma, 1);
+		checkPartialReads(Audio::kADPCMMSIma, 2);
+	}
+
+	void test_ms_partial_reads() {
+		checkPartialReads(Audio::kADPCMMS, 1);
+		checkPartialReads(Audio::kADPCMMS, 2);
+	}
+
+	void test_dvi_partial_reads() {
+		checkPartialReads(Audio::kADPCMDVI, 1);
+		checkPartialReads(Audio::kADPCMDVI, 2);
+	}
+};
@@ -0,0 +1,133 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/effects.h"
+
+#include <math.h>
+
+class EffectsTestSuite : public CxxTest::TestSuite
+{
+	// Peak of the second half of a sine filtered by the effects, once the filters settled
+	float filteredPeak(const Audio::EffectSettings &settings, float frequency) {
+		const uint rate = 44100, numFrames = 4096;
+		float *frames = new float[numFrames * 2];
+		for (uint i = 0; i < numFrames; ++i)
+			frames[i * 2] = frames[i * 2 + 1] = 1000.0f * sin(2.0 * M_PI * frequency * i / rate);
+
+		Audio::ChannelEffects effects;
+		TS_ASSERT(!effects.setChain(new Audio::EffectChain(Audio::EffectSettings(), settings, rate)));
+		effects.process(frames, numFrames, nullptr);
+
+		float peak = 0.0f;
+		for (uint i = numFrames; i < numFrames * 2; ++i)
+			peak = MAX(peak, fabsf(frames[i]));
+		delete[] frames;
+		return peak;
+	}
+
+	public:
+	void test_low_pass() {
+		Audio::EffectSettings settings;
+		settings.filters[0] = Audio::FilterSettings(Audio::FilterSettings::kFilterLowPass, 1000.0f);
+
+		TS_ASSERT_DELTA(filteredPeak(settings, 100.0f), 1000.0f, 20.0f);
+		TS_ASSERT_LESS_THAN(filteredPeak(settings, 10000.0f), 20.0f);
+	}
+
+	void test_peaking() {
+		Audio::EffectSettings settings;
+		settings.filters[1] = Audio::FilterSettings(Audio::FilterSettings::kFilterPeaking, 1000.0f, 1.0f, 6.0f);
+
+		// +6dB doubles the amplitude at the centre, and leaves far frequencies alone
+		TS_ASSERT_DELTA(filteredPeak(settings, 1000.0f), 1995.0f, 40.0f);
+		TS_ASSERT_DELTA(filteredPeak(settings, 15000.0f), 1000.0f, 40.0f);
+	}
+
+	void test_reverb_send() {
+		Audio::EffectSettings settings;
+		settings.reverbSend = 255;
+
+		float frames[8] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f };
+		float reverbInput[8] = { 0.0f };
+		Audio::ChannelEffects effects;
+		TS_ASSERT(!effects.isActive());
+		TS_ASSERT(!effects.setChain(new Audio::EffectChain(Audio::EffectSettings(), settings, 44100)));
+		TS_ASSERT(effects.hasReverbSend());
+
+		effects.process(frames, 4, reverbInput);
+		for (int i = 0; i < 8; ++i) {
+			TS_ASSERT_EQUALS(frames[i], i + 1.0f);
+			TS_ASSERT_EQUALS(reverbInput[i], i + 1.0f);
+		}
+
+		// The replaced chain is handed back, to be deleted away from the mixer callback
+		Audio::EffectChain *replaced = effects.setChain(0);
+		TS_ASSERT(replaced);
+		TS_ASSERT(!effects.isActive());
+		delete replaced;
+	}
+
+	void test_mix_float_samples() {
+		float in[10] = { 0.4f, 0.6f, -0.6f, 1000.0f, 40000.0f, -40000.0f, 1e9f, -1e9f, 2.0f, -3.0f };
+		int16 out[10] = { 0, 0, 0, 32000, 0, 0, 0, 0, 100, -100 };
+		Audio::mixFloatSamples(out, in, 10);
+
+		TS_ASSERT_EQUALS(out[0], 0);
+		TS_ASSERT_EQUALS(out[1], 1);
+		TS_ASSERT_EQUALS(out[2], -1);
+		TS_ASSERT_EQUALS(out[3], 32767);
+		TS_ASSERT_EQUALS(out[4], 32767);
+		TS_ASSERT_EQUALS(out[5], -32768);
+		TS_ASSERT_EQUALS(out[6], 32767);
+		TS_ASSERT_EQUALS(out[7], -32768);
+		TS_ASSERT_EQUALS(out[8], 102);
+		TS_ASSERT_EQUALS(out[9], -103);
+
+		// Halves round away from zero, whether they are converted by the
+		// vectorized part or by the scalar tail
+		float halves[13] = { 0.5f, -0.5f, 1.5f, -1.5f, 2.5f, -2.5f, 0.0f, -0.0f, 0.5f, -0.5f, 1.5f, -1.5f, 2.5f };
+		const int16 rounded[13] = { 1, -1, 2, -2, 3, -3, 0, 0, 1, -1, 2, -2, 3 };
+		int16 mixed[13];
+		memset(mixed, 0, sizeof(mixed));
+		Audio::mixFloatSamples(mixed, halves, 13);
+		for (int i = 0; i < 13; ++i)
+			TS_ASSERT_EQUALS(mixed[i], rounded[i]);
+
+		int16 samples[9] = { -32768, -1, 0, 1, 2, 3, 4, 5, 32767 };
+		float converted[9];
+		Audio::convertSamplesToFloat(samples, converted, 9);
+		for (int i = 0; i < 9; ++i)
+			TS_ASSERT_EQUALS(converted[i], (float)samples[i]);
+	}
+
+	void test_reverb_tail() {
+		Audio::Reverb reverb(22050);
+		TS_ASSERT(!reverb.isEnabled());
+
+		Audio::ReverbSettings settings;
+		settings.level = 255;
+		reverb.setSettings(settings);
+		TS_ASSERT(reverb.isEnabled());
+
+		const uint numFrames = 1024;
+		float input[numFrames * 2];
+		int16 output[numFrames * 2];
+		memset(input, 0, sizeof(input));
+		input[0] = input[1] = 30000.0f;
+
+		// The impulse comes back after the delay of the combs
+		memset(output, 0, sizeof(output));
+		reverb.process(input, output, numFrames);
+		TS_ASSERT(reverb.isRinging());
+		TS_ASSERT_EQUALS(output[0], 0);
+		int16 peak = 0;
+		for (uint i = 0; i < numFrames * 2; ++i)
+			peak = MAX<int16>(peak, ABS(output[i]));
+		TS_ASSERT_LESS_THAN(100, peak);
+
+		// Then fades out
+		input[0] = input[1] = 0.0f;
+		for (int i = 0; i < 1000 && reverb.isRinging(); ++i)
+			reverb.process(input, output, numFrames);
+		TS_ASSERT(!reverb.isRinging());
+	}
+};
@@ -0,0 +1,90 @@
+#include <cxxtest/TestSuite.h>
+
+#include "mixer_workloads.h"
+
+class MixerTestSuite : public CxxTest::TestSuite
+{
+	public:
+	void test_golden_output() {
+		for (int i = 0; i < kMixerWorkloadCount; i++) {
+			MixerWorkloadResult result = runMixerWorkload(i, kMixerGoldenChannels, kMixerGoldenBlocks);
+			TSM_ASSERT_EQUALS(mixerWorkloadNames[i], result.hash, mixerGoldenHashes[i]);
+		}
+	}
+
+	void test_repeatable_output() {
+		// Mixing must not depend on anything left over by a previous mixer
+		for (int i = 0; i < kMixerWorkloadCount; i++) {
+			MixerWorkloadResult first = runMixerWorkload(i, 3, 4);
+			MixerWorkloadResult second = runMixerWorkload(i, 3, 4);
+			TSM_ASSERT_EQUALS(mixerWorkloadNames[i], first.hash, second.hash);
+		}
+	}
+
+	void test_silence_without_channels() {
+		MixerWorkloadResult silence = runMixerWorkload(kMixerRaw16Mono, 0, 2);
+
+		int16 zeros[kMixerWorkloadBlockFrames * 2];
+		memset(zeros, 0, sizeof(zeros));
+		uint32 hash = hashMixerBuffer(0, zeros, ARRAYSIZE(zeros));
+		hash = hashMixerBuffer(hash, zeros, ARRAYSIZE(zeros));
+		TS_ASSERT_EQUALS(silence.hash, hash);
+	}
+
+	void test_empty_effects_keep_output() {
+		// Channels without effects are mixed exactly like before
+		MixerWorkloadEffects effects;
+		for (int i = 0; i < kMixerWorkloadCount; i++) {
+			MixerWorkloadResult result = runMixerWorkload(i, kMixerGoldenChannels, kMixerGoldenBlocks, true, &effects);
+			TSM_ASSERT_EQUALS(mixerWorkloadNames[i], result.hash, mixerGoldenHashes[i]);
+		}
+	}
+
+	void test_effects_change_output() {
+		MixerWorkloadEffects effects = makeMixerWorkloadEffects();
+		MixerWorkloadResult first = runMixerWorkload(kMixerRaw16Mono, 3, 4, true, &effects);
+		MixerWorkloadResult second = runMixerWorkload(kMixerRaw16Mono, 3, 4, true, &effects);
+		TS_ASSERT_EQUALS(first.hash, second.hash);
+		TS_ASSERT_DIFFERS(first.hash, runMixerWorkload(kMixerRaw16Mono, 3, 4).hash);
+	}
+
+	void test_reverb_large_blocks() {
+		// Blocks larger than the input of the reverb are mixed a part at a time
+		MixerWorkloadEffects effects = makeMixerWorkloadEffects();
+		MixerWorkloadResult small = runMixerWorkload(kMixerRaw8Stereo, 3, 6, true, &effects, 512);
+		MixerWorkloadResult large = runMixerWorkload(kMixerRaw8Stereo, 3, 1, true, &effects, 3072);
+		TS_ASSERT_EQUALS(small.hash, large.hash);
+	}
+
+	void test_full_command_queue() {
+		// The callback doesn't run while the commands pile up, which must not
+		// make the engine wait for it
+		MixerWorkloadSystem system;
+		MixerWorkloadRandom generator(1);
+		Audio::MixerImpl *mixer = new Audio::MixerImpl(kMixerWorkloadOutputRate);
+		mixer->setReady(true);
+
+		Audio::SoundHandle played, stopped;
+		mixer->playStream(Audio::Mixer::kSFXSoundType, &played, createMixerWorkloadRaw(generator, 22050, false, false), -1,
+		                  Audio::Mixer::kMaxChannelVolume, 0, DisposeAfterUse::YES, false, false);
+		mixer->playStream(Audio::Mixer::kSFXSoundType, &stopped, createMixerWorkloadRaw(generator, 22050, false, false), -1,
+		                  Audio::Mixer::kMaxChannelVolume, 0, DisposeAfterUse::YES, false, false);
+		for (int i = 0; i < 3000; i++)
+			mixer->setChannelVolume(played, i & 0xFF);
+		mixer->setChannelVolume(played, 0);
+		mixer->stopHandle(stopped);
+		TS_ASSERT(!mixer->isSoundHandleActive(stopped));
+
+		// The stop reaches the callback right away, the last volume once it
+		// caught up with the queue
+		int16 buffer[256 * 2];
+		mixer->mixCallback((byte *)buffer, sizeof(buffer));
+		TS_ASSERT(mixer->isSoundHandleActive(played));
+		mixer->mixCallback((byte *)buffer, sizeof(buffer));
+
+		int16 zeros[256 * 2];
+		memset(zeros, 0, sizeof(zeros));
+		TS_ASSERT_SAME_DATA(buffer, zeros, sizeof(buffer));
+		delete mixer;
+	}
+};
@@ -0,0 +1,397 @@
+#ifndef TEST_AUDIO_MIXER_WORKLOADS_H
+#define TEST_AUDIO_MIXER_WORKLOADS_H
+
+// Synthetic workloads for the audio mixer, shared by the determinism tests
+// (test/audio/mixer.h) and the mixer benchmark (test/bench/mixer.cpp).
+// The mixer callback is called directly, so no backend is needed.
+
+#include "audio/audiostream.h"
+#include "audio/effects.h"
+#include "audio/mixer_intern.h"
+#include "audio/decoders/adpcm.h"
+#include "audio/decoders/raw.h"
+#include "base/plugins.h"
+#include "common/endian.h"
+#include "common/memstream.h"
+#include "common/system.h"
+#include "graphics/pixelformat.h"
+
+#if PLUGIN_ENABLED_STATIC(GRIM)
+#include "engines/grim/movie/codecs/vima.h"
+#endif
+
+enum {
+	kMixerWorkloadOutputRate = 44100,
+	kMixerWorkloadBlockFrames = 1024
+};
+
+enum MixerWorkloadType {
+	kMixerRaw16Mono,
+	kMixerRaw8Stereo,
+	kMixerRawResampled,
+	kMixerSincResampled,
+	kMixerIMAADPCM,
+	kMixerMSADPCM,
+	kMixerDVIADPCM,
+#if PLUGIN_ENABLED_STATIC(GRIM)
+	kMixerVIMA,
+#endif
+	kMixerWorkloadCount
+};
+
+static const char *const mixerWorkloadNames[kMixerWorkloadCount] = {
+	"raw 16 mono",
+	"raw 8 stereo",
+	"raw resampled",
+	"sinc resampled",
+	"ima adpcm",
+	"ms adpcm",
+	"dvi adpcm",
+#if PLUGIN_ENABLED_STATIC(GRIM)
+	"vima",
+#endif
+};
+
+// Hashes of the first kMixerGoldenBlocks blocks mixed by each workload with
+// kMixerGoldenChannels channels. They must only change along with an intended
+// change of the output of the mixer, its rate converters or the decoders.
+static const int kMixerGoldenBlocks = 8;
+static const int kMixerGoldenChannels = 8;
+
+static const uint32 mixerGoldenHashes[kMixerWorkloadCount] = {
+	0x24e07ad0,
+	0xbe879dc2,
+	0x1fa19818,
+	0xf8013d10,
+	0x66bc339b,
+	0x19ce55bb,
+	0x77bccaa4,
+#if PLUGIN_ENABLED_STATIC(GRIM)
+	0x63f9d629,
+#endif
+};
+
+struct MixerWorkloadResult {
+	uint32 hash;      // hash of all the mixed samples
+	int blocks;
+	int frames;       // frames mixed, for all the channels
+
+	MixerWorkloadResult() : hash(0), blocks(0), frames(0) {}
+};
+
+// Deterministic generator, so that the output only depends on the mixer.
+class MixerWorkloadRandom {
+public:
+	MixerWorkloadRandom(uint32 seed) : _state(seed) {}
+
+	uint32 next() {
+		_state = _state * 1103515245 + 12345;
+		return (_state >> 8) & 0xFFFF;
+	}
+
+	int16 nextSample(int amplitude) {
+		return (int16)((int)next() * amplitude / 0x8000 - amplitude);
+	}
+
+private:
+	uint32 _state;
+};
+
+static uint32 hashMixerBuffer(uint32 hash, const int16 *samples, int numSamples) {
+	for (int i = 0; i < numSamples; i++) {
+		uint16 sample = samples[i];
+		hash ^= sample & 0xFF;
+		hash *= 16777619;
+		hash ^= sample >> 8;
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+// Just enough of a system for the mixer, which only needs mutexes and a clock.
+// Everything runs on a single thread, so the mutexes don't lock anything.
+class MixerWorkloadSystem : public OSystem {
+public:
+	MixerWorkloadSystem() : _previous(g_system) { g_system = this; }
+	~MixerWorkloadSystem() { g_system = _previous; }
+
+	Graphics::PixelFormat getScreenFormat() const { return Graphics::PixelFormat(); }
+	Common::List<Graphics::PixelFormat> getSupportedFormats() const { return Common::List<Graphics::PixelFormat>(); }
+	void initSize(uint width, uint height, const Graphics::PixelFormat *format) {}
+	int16 getHeight() { return 0; }
+	int16 getWidth() { return 0; }
+	PaletteManager *getPaletteManager() { return nullptr; }
+	void copyRectToScreen(const void *buf, int pitch, int x, int y, int w, int h) {}
+	Graphics::Surface *lockScreen() { return nullptr; }
+	void unlockScreen() {}
+	void fillScreen(uint32 col) {}
+	void updateScreen() {}
+	void setShakePos(int shakeXOffset, int shakeYOffset) {}
+	void showOverlay() {}
+	void hideOverlay() {}
+	bool isOverlayVisible() const { return false; }
+	Graphics::PixelFormat getOverlayFormat() const { return Graphics::PixelFormat(); }
+	void clearOverlay() {}
+	void grabOverlay(void *buf, int pitch) {}
+	void copyRectToOverlay(const void *buf, int pitch, int x, int y, int w, int h) {}
+	int16 getOverlayHeight() { return 0; }
+	int16 getOverlayWidth() { return 0; }
+	bool showMouse(bool visible) { return false; }
+	void warpMouse(int x, int y) {}
+	void setMouseCursor(const void *buf, uint w, uint h, int hotspotX, int hotspotY, uint32 keycolor, bool dontScale, const Graphics::PixelFormat *format) {}
+	uint32 getMillis(bool skipRecord) { return 0; }
+	void delayMillis(uint msecs) {}
+	void getTimeAndDate(TimeDate &t) const {}
+	MutexRef createMutex() { return (MutexRef)this; }
+	void lockMutex(MutexRef mutex) {}
+	void unlockMutex(MutexRef mutex) {}
+	void deleteMutex(MutexRef mutex) {}
+	Audio::Mixer *getMixer() { return nullptr; }
+	void quit() {}
+	void displayMessageOnOSD(const Common::U32String &msg) {}
+	void displayActivityIconOnOSD(const Graphics::Surface *icon) {}
+	void logMessage(LogMessageType::Type type, const char *message) {}
+
+private:
+	OSystem *_previous;
+};
+
+static Audio::SeekableAudioStream *createMixerWorkloadRaw(MixerWorkloadRandom &generator, int rate, bool stereo, bool eightBits) {
+	const int numSamples = rate * (stereo ? 2 : 1);
+	byte *data;
+	uint32 size;
+	if (eightBits) {
+		size = numSamples;
+		data = (byte *)malloc(size);
+		for (int i = 0; i < numSamples; i++)
+			data[i] = (generator.nextSample(96) + 128) & 0xFF;
+	} else {
+		size = numSamples * 2;
+		data = (byte *)malloc(size);
+		for (int i = 0; i < numSamples; i++)
+			WRITE_LE_UINT16(data + i * 2, generator.nextSample(24000));
+	}
+
+	byte flags = Audio::FLAG_LITTLE_ENDIAN;
+	if (eightBits)
+		flags |= Audio::FLAG_UNSIGNED;
+	else
+		flags |= Audio::FLAG_16BITS;
+	if (stereo)
+		flags |= Audio::FLAG_STEREO;
+	return Audio::makeRawStream(data, size, rate, flags);
+}
+
+// One second of ADPCM blocks with valid headers and random nibbles.
+static Audio::SeekableAudioStream *createMixerWorkloadADPCM(MixerWorkloadRandom &generator, Audio::ADPCMType type, int rate, int channels) {
+	const uint32 blockAlign = 256 * channels;
+	const uint32 numBlocks = rate / 500;
+	const uint32 size = blockAlign * numBlocks;
+	byte *data = (byte *)malloc(size);
+
+	for (uint32 block = 0; block < numBlocks; block++) {
+		byte *pos = data + block * blockAlign;
+		byte *end = pos + blockAlign;
+
+		if (type == Audio::kADPCMMSIma) {
+			for (int i = 0; i < channels; i++, pos += 4) {
+				WRITE_LE_UINT16(pos, generator.nextSample(8000));
+				WRITE_LE_UINT16(pos + 2, generator.next() % 89);
+			}
+		} else if (type == Audio::kADPCMMS) {
+			for (int i = 0; i < channels; i++)
+				*pos++ = generator.next() % 7;
+			for (int i = 0; i < channels; i++, pos += 2)
+				WRITE_LE_UINT16(pos, 16 + generator.next() % 1024);
+			for (int i = 0; i < channels * 2; i++, pos += 2)
+				WRITE_LE_UINT16(pos, generator.nextSample(8000));
+		}
+
+		while (pos < end)
+			*pos++ = generator.next() & 0xFF;
+	}
+
+	Common::SeekableReadStream *stream = new Common::MemoryReadStream(data, size, DisposeAfterUse::YES);
+	const uint32 dataBlockAlign = (type == Audio::kADPCMDVI) ? 0 : blockAlign;
+	return Audio::makeADPCMStream(stream, DisposeAfterUse::YES, size, type, rate, channels, dataBlockAlign);
+}
+
+#if PLUGIN_ENABLED_STATIC(GRIM)
+
+// Decodes random VIMA blocks the way McmpMgr does for iMuse, endlessly.
+class MixerWorkloadVIMAStream : public Audio::AudioStream {
+public:
+	enum {
+		kBlockSize = 0x2000,  // decoded bytes per block, as in the MCMP archives
+		kNumBlocks = 4
+	};
+
+	MixerWorkloadVIMAStream(MixerWorkloadRandom &generator, int rate, bool stereo) :
+			_rate(rate), _stereo(stereo), _block(0), _decodedPos(kBlockSize / 2) {
+		static Grim::VimaStep steps[Grim::kVimaStepCount];
+		static bool stepsReady = false;
+		if (!stepsReady) {
+			Grim::vimaInit(steps);
+			stepsReady = true;
+		}
+		_steps = steps;
+
+		// At most 7 bits per sample, plus 16 bits for the escaped ones
+		const int numSamples = kBlockSize / 2;
+		_compressedSize = numSamples * 3 + 16;
+		for (int i = 0; i < kNumBlocks; i++) {
+			byte *block = new byte[_compressedSize];
+			const byte tablePos = generator.next() % 89;
+			block[0] = stereo ? ~tablePos : tablePos;
+			WRITE_BE_UINT16(block + 1, generator.nextSample(8000));
+			int headerSize = 3;
+			if (stereo) {
+				block[3] = generator.next() % 89;
+				WRITE_BE_UINT16(block + 4, generator.nextSample(8000));
+				headerSize = 6;
+			}
+			for (int j = headerSize; j < _compressedSize; j++)
+				block[j] = generator.next() & 0xFF;
+			_blocks[i] = block;
+		}
+	}
+
+	~MixerWorkloadVIMAStream() {
+		for (int i = 0; i < kNumBlocks; i++)
+			delete[] _blocks[i];
+	}
+
+	int readBuffer(int16 *buffer, const int numSamples) {
+		for (int i = 0; i < numSamples; i++) {
+			if (_decodedPos == kBlockSize / 2) {
+				Grim::decompressVima(_blocks[_block], _decoded, kBlockSize, _steps);
+				_block = (_block + 1) % kNumBlocks;
+				_decodedPos = 0;
+			}
+			buffer[i] = READ_BE_UINT16(&_decoded[_decodedPos++]);
+		}
+		return numSamples;
+	}
+
+	bool isStereo() const { return _stereo; }
+	int getRate() const { return _rate; }
+	bool endOfData() const { return false; }
+
+private:
+	const int _rate;
+	const bool _stereo;
+	const Grim::VimaStep *_steps;
+
+	byte *_blocks[kNumBlocks];
+	int _compressedSize;
+	int _block;
+
+	int16 _decoded[kBlockSize / 2];
+	int _decodedPos;
+};
+
+#endif
+
+static Audio::AudioStream *createMixerWorkloadStream(int type, int channel, MixerWorkloadRandom &generator) {
+	static const int resampledRates[] = { 11025, 22050, 32000, 48000 };
+
+	Audio::SeekableAudioStream *stream = nullptr;
+	switch (type) {
+	case kMixerRaw16Mono:
+		stream = createMixerWorkloadRaw(generator, kMixerWorkloadOutputRate, false, false);
+		break;
+	case kMixerRaw8Stereo:
+		stream = createMixerWorkloadRaw(generator, 22050, true, true);
+		break;
+	case kMixerRawResampled:
+	case kMixerSincResampled:
+		stream = createMixerWorkloadRaw(generator, resampledRates[channel % ARRAYSIZE(resampledRates)], true, false);
+		break;
+	case kMixerIMAADPCM:
+		stream = createMixerWorkloadADPCM(generator, Audio::kADPCMMSIma, 22050, 1);
+		break;
+	case kMixerMSADPCM:
+		stream = createMixerWorkloadADPCM(generator, Audio::kADPCMMS, 22050, 2);
+		break;
+	case kMixerDVIADPCM:
+		stream = createMixerWorkloadADPCM(generator, Audio::kADPCMDVI, 22050, 1);
+		break;
+#if PLUGIN_ENABLED_STATIC(GRIM)
+	case kMixerVIMA:
+		return new MixerWorkloadVIMAStream(generator, 22050, (channel & 1) != 0);
+#endif
+	default:
+		break;
+	}
+
+	return Audio::makeLoopingAudioStream(stream, 0);
+}
+
+// Effects of the sound type of the workload channels and of the reverb.
+struct MixerWorkloadEffects {
+	Audio::EffectSettings effects;
+	Audio::ReverbSettings reverb;
+};
+
+// Low-pass, EQ and reverb, as an engine would use to muffle sounds in a room.
+static MixerWorkloadEffects makeMixerWorkloadEffects() {
+	MixerWorkloadEffects effects;
+	effects.effects.filters[0] = Audio::FilterSettings(Audio::FilterSettings::kFilterLowPass, 2000.0f);
+	effects.effects.filters[1] = Audio::FilterSettings(Audio::FilterSettings::kFilterPeaking, 300.0f, 1.0f, 6.0f);
+	effects.effects.reverbSend = 128;
+	effects.reverb.level = 128;
+	return effects;
+}
+
+// Mixes blocks of the given streams, which the mixer takes over.
+static MixerWorkloadResult mixMixerWorkloadStreams(Audio::AudioStream *const *streams, int count, Audio::RateQuality quality,
+                                                   int blocks, bool hashBlocks = true, const MixerWorkloadEffects *effects = nullptr,
+                                                   int blockFrames = kMixerWorkloadBlockFrames) {
+	MixerWorkloadSystem system;
+	MixerWorkloadResult result;
+
+	Audio::MixerImpl *mixer = new Audio::MixerImpl(kMixerWorkloadOutputRate, quality);
+	mixer->setReady(true);
+
+	if (effects) {
+		mixer->setEffectsForSoundType(Audio::Mixer::kSFXSoundType, effects->effects);
+		mixer->setReverb(effects->reverb);
+	}
+
+	for (int i = 0; i < count; i++) {
+		byte volume = 64 + (i * 37) % 192;
+		int8 balance = (i * 29) % 255 - 127;
+		mixer->playStream(Audio::Mixer::kSFXSoundType, nullptr, streams[i], -1, volume, balance,
+		                  DisposeAfterUse::YES, false, false);
+	}
+
+	int16 *buffer = new int16[blockFrames * 2];
+	for (int i = 0; i < blocks; i++) {
+		mixer->mixCallback((byte *)buffer, blockFrames * 4);
+		if (hashBlocks)
+			result.hash = hashMixerBuffer(result.hash, buffer, blockFrames * 2);
+	}
+	delete[] buffer;
+
+	delete mixer;
+
+	result.blocks = blocks;
+	result.frames = blocks * blockFrames * count;
+	return result;
+}
+
+static MixerWorkloadResult runMixerWorkload(int type, int channels, int blocks, bool hashBlocks = true,
+                                            const MixerWorkloadEffects *effects = nullptr,
+                                            int blockFrames = kMixerWorkloadBlockFrames) {
+	MixerWorkloadRandom generator(type + 1);
+	Audio::AudioStream **streams = new Audio::AudioStream *[channels];
+	for (int i = 0; i < channels; i++)
+		streams[i] = createMixerWorkloadStream(type, i, generator);
+
+	const Audio::RateQuality quality = (type == kMixerSincResampled) ? Audio::kRateQualityHigh : Audio::kRateQualityFast;
+	MixerWorkloadResult result = mixMixerWorkloadStreams(streams, channels, quality, blocks, hashBlocks, effects, blockFrames);
+	delete[] streams;
+	return result;
+}
+
+#endif
@@ -0,0 +1,148 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/pcmcache.h"
+
+#include "helper.h"
+
+class PCMCacheTestSuite : public CxxTest::TestSuite
+{
+	Audio::PCMClip *createClip(uint32 numSamples, bool stereo) {
+		int16 *samples = new int16[numSamples];
+		for (uint32 i = 0; i < numSamples; ++i)
+			samples[i] = i;
+		return new Audio::PCMClip(samples, numSamples, 11025, stereo);
+	}
+
+	public:
+	void test_clip_stream_range() {
+		Audio::PCMClip *clip = createClip(16, false);
+		Audio::PCMClipStream *stream = new Audio::PCMClipStream(clip, 4, 12);
+		clip->decRef();
+
+		TS_ASSERT_EQUALS(stream->getLength().totalNumberOfFrames(), 8);
+
+		int16 buffer[16];
+		TS_ASSERT_EQUALS(stream->readBuffer(buffer, 16), 8);
+		for (int i = 0; i < 8; ++i)
+			TS_ASSERT_EQUALS(buffer[i], i + 4);
+		TS_ASSERT(stream->endOfData());
+
+		delete stream;
+	}
+
+	void test_clip_stream_seek() {
+		Audio::PCMClip *clip = createClip(22050, true);
+		Audio::PCMClipStream *stream = new Audio::PCMClipStream(clip);
+		clip->decRef();
+
+		TS_ASSERT(stream->seek(Audio::Timestamp(500, 11025)));
+		int16 buffer[2];
+		TS_ASSERT_EQUALS(stream->readBuffer(buffer, 2), 2);
+		TS_ASSERT_EQUALS(buffer[0], 11024);
+		TS_ASSERT_EQUALS(buffer[1], 11025);
+
+		TS_ASSERT(stream->rewind());
+		TS_ASSERT_EQUALS(stream->readBuffer(buffer, 2), 2);
+		TS_ASSERT_EQUALS(buffer[0], 0);
+
+		TS_ASSERT(!stream->seek(Audio::Timestamp(1001, 11025)));
+		TS_ASSERT(stream->endOfData());
+
+		delete stream;
+	}
+
+	void test_lru_eviction() {
+		Audio::PCMCache cache(250, 1000);
+
+		for (int i = 0; i < 2; ++i) {
+			Audio::PCMClip *clip = createClip(50, false);
+			cache.put(Common::String::format("clip%d", i), clip);
+			clip->decRef();
+		}
+		TS_ASSERT_EQUALS(cache.getSize(), 200u);
+
+		// Using clip0 makes clip1 the oldest one
+		Audio::PCMClip *clip0 = cache.get("clip0");
+		TS_ASSERT(clip0);
+		clip0->decRef();
+
+		Audio::PCMClip *clip = createClip(50, false);
+		cache.put("clip2", clip);
+		clip->decRef();
+
+		TS_ASSERT_EQUALS(cache.getSize(), 200u);
+		TS_ASSERT(!cache.makeStream("clip1"));
+
+		Audio::SeekableAudioStream *stream = cache.makeStream("clip0");
+		TS_ASSERT(stream);
+		delete stream;
+
+		// Clips bigger than the whole cache aren't kept
+		clip = createClip(200, false);
+		cache.put("big", clip);
+		clip->decRef();
+		TS_ASSERT(!cache.makeStream("big"));
+		TS_ASSERT_EQUALS(cache.getSize(), 200u);
+	}
+
+	void test_evicted_clip_outlives_cache() {
+		Audio::PCMCache *cache = new Audio::PCMCache(1000, 1000);
+
+		Audio::PCMClip *clip = createClip(100, false);
+		cache->put("clip", clip);
+		clip->decRef();
+
+		Audio::SeekableAudioStream *stream = cache->makeStream("clip");
+		delete cache;
+
+		int16 buffer[100];
+		TS_ASSERT_EQUALS(stream->readBuffer(buffer, 100), 100);
+		TS_ASSERT_EQUALS(buffer[99], 99);
+		delete stream;
+	}
+
+	void test_cache_stream() {
+		Audio::PCMCache cache(1024 * 1024, 2000);
+
+		int16 *sine;
+		Audio::RewindableAudioStream *source = createSineStream<int16>(8000, 1, &sine, false, true);
+		Audio::RewindableAudioStream *stream = cache.cacheStream("sine", source);
+		TS_ASSERT_DIFFERS(stream, source);
+		TS_ASSERT_EQUALS(cache.getSize(), 8000u * 2 * 2);
+
+		int16 *buffer = new int16[16000];
+		TS_ASSERT_EQUALS(stream->readBuffer(buffer, 16000), 16000);
+		TS_ASSERT_EQUALS(memcmp(buffer, sine, 16000 * sizeof(int16)), 0);
+		TS_ASSERT(stream->endOfData());
+		delete stream;
+
+		Audio::SeekableAudioStream *cached = cache.makeStream("sine");
+		TS_ASSERT(cached);
+		TS_ASSERT(cached->isStereo());
+		TS_ASSERT_EQUALS(cached->getRate(), 8000);
+		TS_ASSERT_EQUALS(cached->readBuffer(buffer, 16000), 16000);
+		TS_ASSERT_EQUALS(memcmp(buffer, sine, 16000 * sizeof(int16)), 0);
+		delete cached;
+
+		delete[] buffer;
+		delete[] sine;
+	}
+
+	void test_cache_stream_too_long() {
+		Audio::PCMCache cache(1024 * 1024, 500);
+
+		int16 *sine;
+		Audio::RewindableAudioStream *source = createSineStream<int16>(8000, 1, &sine, false, false);
+		Audio::RewindableAudioStream *stream = cache.cacheStream("sine", source);
+		TS_ASSERT_EQUALS(stream, source);
+		TS_ASSERT_EQUALS(cache.getSize(), 0u);
+		TS_ASSERT(!cache.makeStream("sine"));
+
+		int16 sample;
+		TS_ASSERT_EQUALS(stream->readBuffer(&sample, 1), 1);
+		TS_ASSERT_EQUALS(sample, sine[0]);
+
+		delete stream;
+		delete[] sine;
+	}
+};
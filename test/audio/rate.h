@@ -0,0 +1,270 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/audiostream.h"
+#include "audio/mixer.h"
+#include "audio/rate.h"
+
+#include "helper.h"
+
+class RateConverterTestSuite : public CxxTest::TestSuite
+{
+private:
+	// The samples of input frame i, which the converters pick or interpolate.
+	static void getFrame(const int16 *input, bool stereo, int i, int &out0, int &out1) {
+		out0 = input[stereo ? i * 2 : i];
+		out1 = stereo ? input[i * 2 + 1] : out0;
+	}
+
+	// Scalar model of the converters: the frames that each of them outputs, mixed
+	// with clampedAdd. Returns the number of output frames.
+	static int convertReference(const int16 *input, int inputFrames, int inRate, int outRate, bool stereo, bool reverseStereo,
+	                            int16 *output, int outputFrames, int volL, int volR) {
+		const int fracBits = 15;
+		const int fracOne = 1 << fracBits;
+		int frames = 0;
+		int out0, out1;
+
+		if (inRate == outRate) {
+			for (; frames < inputFrames && frames < outputFrames; frames++) {
+				getFrame(input, stereo, frames, out0, out1);
+				mixReference(output + frames * 2, out0, out1, volL, volR, reverseStereo);
+			}
+		} else if (inRate % outRate == 0) {
+			// Picks every (inRate / outRate)th frame, starting from the second one.
+			int step = inRate / outRate;
+			for (; 1 + frames * step < inputFrames && frames < outputFrames; frames++) {
+				getFrame(input, stereo, 1 + frames * step, out0, out1);
+				mixReference(output + frames * 2, out0, out1, volL, volR, reverseStereo);
+			}
+		} else {
+			int position = fracOne;
+			int step = (inRate << fracBits) / outRate;
+			int consumed = 0;
+			int last0 = 0, last1 = 0, cur0 = 0, cur1 = 0;
+			for (; frames < outputFrames; frames++) {
+				while (position >= fracOne && consumed < inputFrames) {
+					last0 = cur0;
+					last1 = cur1;
+					getFrame(input, stereo, consumed++, cur0, cur1);
+					position -= fracOne;
+				}
+				if (position >= fracOne)
+					break;
+				out0 = (int16)(last0 + (((cur0 - last0) * position + fracOne / 2) >> fracBits));
+				out1 = stereo ? (int16)(last1 + (((cur1 - last1) * position + fracOne / 2) >> fracBits)) : out0;
+				mixReference(output + frames * 2, out0, out1, volL, volR, reverseStereo);
+				position += step;
+			}
+		}
+		return frames;
+	}
+
+	static void mixReference(int16 *output, int out0, int out1, int volL, int volR, bool reverseStereo) {
+		Audio::clampedAdd(output[reverseStereo ? 1 : 0], out0 * volL / Audio::Mixer::kMaxMixerVolume);
+		Audio::clampedAdd(output[reverseStereo ? 0 : 1], out1 * volR / Audio::Mixer::kMaxMixerVolume);
+	}
+
+	// Output that was already mixed by other channels, spanning the whole sample range
+	// so that the mixing saturates.
+	static void fillOutput(int16 *output, int samples) {
+		for (int i = 0; i < samples; i++)
+			output[i] = (int16)((i * 7919) & 0xFFFF);
+	}
+
+	void checkConverter(int inRate, int outRate, bool stereo, bool reverseStereo, int volL, int volR) {
+		int16 *input;
+		Audio::SeekableAudioStream *stream = createSineStream<int16>(inRate, 1, &input, true, stereo);
+		const int inputFrames = inRate;
+		const int outputFrames = (int)((int64)inputFrames * outRate / inRate) + 16;
+
+		int16 *expected = new int16[outputFrames * 2];
+		int16 *output = new int16[outputFrames * 2];
+		fillOutput(expected, outputFrames * 2);
+		fillOutput(output, outputFrames * 2);
+		int expectedFrames = convertReference(input, inputFrames, inRate, outRate, stereo, reverseStereo, expected, outputFrames, volL, volR);
+
+		// Flows of varying sizes, which must carry the state of the converter over.
+		Audio::RateConverter *converter = Audio::makeRateConverter(inRate, outRate, stereo, reverseStereo);
+		const int chunks[] = { 1, 7, 64, 333, 1000, 3 };
+		int frames = 0;
+		for (int i = 0; frames < outputFrames; i++) {
+			int chunk = MIN(chunks[i % ARRAYSIZE(chunks)], outputFrames - frames);
+			int flowed = converter->flow(*stream, output + frames * 2, chunk, volL, volR);
+			frames += flowed;
+			if (flowed < chunk)
+				break;
+		}
+
+		TS_ASSERT_EQUALS(frames, expectedFrames);
+		TS_ASSERT_EQUALS(memcmp(output, expected, outputFrames * 2 * sizeof(int16)), 0);
+
+		delete converter;
+		delete stream;
+		delete[] input;
+		delete[] expected;
+		delete[] output;
+	}
+
+	void checkVolumes(int inRate, int outRate, bool stereo, bool reverseStereo) {
+		checkConverter(inRate, outRate, stereo, reverseStereo, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume);
+		checkConverter(inRate, outRate, stereo, reverseStereo, 255, 37);
+		checkConverter(inRate, outRate, stereo, reverseStereo, 0, 128);
+		// Above the mixer volume range, the scaled samples don't fit 16 bits.
+		checkConverter(inRate, outRate, stereo, reverseStereo, 300, 1000);
+	}
+
+	// A sine tone of the given frequency and amplitude, in both channels for stereo.
+	static Audio::AudioStream *createToneStream(int rate, int frames, double frequency, double amplitude, bool stereo) {
+		const int channels = stereo ? 2 : 1;
+		byte *data = (byte *)malloc(frames * channels * 2);
+		for (int i = 0; i < frames; i++) {
+			int16 sample = (int16)floor(sin(2 * M_PI * frequency * i / rate) * amplitude + 0.5);
+			for (int c = 0; c < channels; c++)
+				WRITE_LE_UINT16(data + (i * channels + c) * 2, sample);
+		}
+		Common::SeekableReadStream *stream = new Common::MemoryReadStream(data, frames * channels * 2, DisposeAfterUse::YES);
+		return Audio::makeRawStream(stream, rate, Audio::FLAG_16BITS | Audio::FLAG_LITTLE_ENDIAN | (stereo ? Audio::FLAG_STEREO : 0));
+	}
+
+	// Converts a tone with the band-limited converter, and returns the RMS difference of
+	// the left channel to the exact tone at the output rate (or to silence, when the tone
+	// is above the output Nyquist frequency), in fractions of the amplitude.
+	double convertTone(int inRate, int outRate, double frequency, bool stereo) {
+		const double amplitude = 16000;
+		const int inputFrames = inRate / 4;
+		// The filter needs 16 input samples past each output one.
+		const int outputFrames = (int)((int64)(inputFrames - 16) * outRate / inRate) - 1;
+		const bool audible = frequency < outRate / 2;
+
+		Audio::AudioStream *stream = createToneStream(inRate, inputFrames, frequency, amplitude, stereo);
+		Audio::RateConverter *converter = Audio::makeRateConverter(inRate, outRate, stereo, false, Audio::kRateQualityHigh);
+		int16 *output = new int16[outputFrames * 2];
+		memset(output, 0, outputFrames * 2 * sizeof(int16));
+		TS_ASSERT_EQUALS(converter->flow(*stream, output, outputFrames, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume), outputFrames);
+
+		// The output is centred on the input, skip the filter start up.
+		double error = 0;
+		int count = 0;
+		for (int i = 32; i < outputFrames; i++) {
+			double expected = audible ? sin(2 * M_PI * frequency * i / outRate) * amplitude : 0.0;
+			error += (output[i * 2] - expected) * (output[i * 2] - expected);
+			TS_ASSERT_EQUALS(output[i * 2], output[i * 2 + 1]);
+			count++;
+		}
+
+		delete[] output;
+		delete converter;
+		delete stream;
+		return sqrt(error / count) / amplitude;
+	}
+
+public:
+	void test_copy_mono() {
+		checkVolumes(11025, 11025, false, false);
+	}
+
+	void test_copy_stereo() {
+		checkVolumes(11025, 11025, true, false);
+	}
+
+	void test_copy_reverse_stereo() {
+		checkVolumes(11025, 11025, true, true);
+	}
+
+	void test_simple_mono() {
+		checkVolumes(22050, 11025, false, false);
+	}
+
+	void test_simple_stereo() {
+		checkVolumes(44100, 11025, true, false);
+	}
+
+	void test_simple_reverse_stereo() {
+		checkVolumes(22050, 11025, true, true);
+	}
+
+	void test_linear_mono() {
+		checkVolumes(11025, 48000, false, false);
+	}
+
+	void test_linear_stereo() {
+		checkVolumes(22050, 44100, true, false);
+	}
+
+	void test_linear_reverse_stereo() {
+		checkVolumes(44100, 22050 + 1, true, true);
+	}
+
+	void test_sinc_passband() {
+		TS_ASSERT_LESS_THAN(convertTone(22050, 48000, 1000, false), 0.01);
+		TS_ASSERT_LESS_THAN(convertTone(22050, 48000, 8000, true), 0.01);
+		TS_ASSERT_LESS_THAN(convertTone(11025, 44100, 3000, false), 0.01);
+		TS_ASSERT_LESS_THAN(convertTone(44100, 22050, 5000, true), 0.01);
+		// Rates with few common factors use the nearest of the filter phases.
+		TS_ASSERT_LESS_THAN(convertTone(22051, 48000, 2000, false), 0.01);
+	}
+
+	void test_sinc_stopband() {
+		// Above the output Nyquist frequency, the tone must not alias.
+		TS_ASSERT_LESS_THAN(convertTone(44100, 11025, 8000, false), 0.01);
+		TS_ASSERT_LESS_THAN(convertTone(48000, 22050, 16000, true), 0.01);
+	}
+
+	void test_sinc_tail() {
+		// The output goes on until its position passes the last input frame
+		const int inRate = 22050, outRate = 44100, frames = 1000;
+		byte *data = (byte *)malloc(frames * 2);
+		for (int i = 0; i < frames; i++)
+			WRITE_LE_UINT16(data + i * 2, 10000);
+		Audio::AudioStream *stream = Audio::makeRawStream(data, frames * 2, inRate, Audio::FLAG_16BITS | Audio::FLAG_LITTLE_ENDIAN);
+		Audio::RateConverter *converter = Audio::makeRateConverter(inRate, outRate, false, false, Audio::kRateQualityHigh);
+
+		const int outputFrames = frames * 2 + 64;
+		int16 *output = new int16[outputFrames * 2];
+		memset(output, 0, outputFrames * 2 * sizeof(int16));
+		TS_ASSERT_EQUALS(converter->flow(*stream, output, outputFrames, Audio::Mixer::kMaxMixerVolume, Audio::Mixer::kMaxMixerVolume), frames * 2);
+
+		// The last frames are filtered with the silence past the end of the input:
+		// the last one is half way between the last input frame and the silence.
+		TS_ASSERT_DELTA(output[(frames * 2 - 100) * 2], 10000, 50);
+		TS_ASSERT_DELTA(output[(frames * 2 - 1) * 2], 5000, 500);
+
+		delete[] output;
+		delete converter;
+		delete stream;
+	}
+
+	void test_sinc_flow_sizes() {
+		const int inRate = 22050, outRate = 48000, frames = 8000;
+		Audio::AudioStream *stream1 = createToneStream(inRate, frames, 440, 20000, true);
+		Audio::AudioStream *stream2 = createToneStream(inRate, frames, 440, 20000, true);
+		Audio::RateConverter *converter1 = Audio::makeRateConverter(inRate, outRate, true, true, Audio::kRateQualityHigh);
+		Audio::RateConverter *converter2 = Audio::makeRateConverter(inRate, outRate, true, true, Audio::kRateQualityHigh);
+
+		const int outputFrames = frames * outRate / inRate + 64;
+		int16 *output1 = new int16[outputFrames * 2];
+		int16 *output2 = new int16[outputFrames * 2];
+		fillOutput(output1, outputFrames * 2);
+		fillOutput(output2, outputFrames * 2);
+
+		int frames1 = converter1->flow(*stream1, output1, outputFrames, 200, 90);
+		int frames2 = 0;
+		for (int chunk = 1; frames2 < outputFrames; chunk = chunk * 3 % 1000 + 1) {
+			int flowed = converter2->flow(*stream2, output2 + frames2 * 2, MIN(chunk, outputFrames - frames2), 200, 90);
+			frames2 += flowed;
+			if (flowed == 0)
+				break;
+		}
+
+		TS_ASSERT_EQUALS(frames1, frames2);
+		TS_ASSERT_LESS_THAN(frames1, outputFrames);
+		TS_ASSERT_EQUALS(memcmp(output1, output2, outputFrames * 2 * sizeof(int16)), 0);
+
+		delete[] output1;
+		delete[] output2;
+		delete converter1;
+		delete converter2;
+		delete stream1;
+		delete stream2;
+	}
+};
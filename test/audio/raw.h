@@ -3,6 +3,9 @@
 #include "audio/decoders/raw.h"
 #include "audio/audiostream.h"
 
+#include "common/filemapping.h"
+#include "common/substream.h"
+
 #include "helper.h"
 
 class RawStreamTestSuite : public CxxTest::TestSuite
@@ -288,4 +291,46 @@ public:
 	void test_seek_stereo() {
 		seekTest(11025, 2, true);
 	}
+
+	void test_buffered_read_matches_memory_read() {
+		// Streams which aren't in memory go through the sample buffer
+		byte data[8192];
+		for (int i = 0; i < ARRAYSIZE(data); ++i)
+			data[i] = i * 7;
+
+		const byte flags = Audio::FLAG_16BITS | Audio::FLAG_LITTLE_ENDIAN | Audio::FLAG_STEREO;
+		Audio::SeekableAudioStream *memory = Audio::makeRawStream(data, sizeof(data), 11025, flags, DisposeAfterUse::NO);
+		Common::SeekableReadStream *parent = new Common::MemoryReadStream(data, sizeof(data));
+		Audio::SeekableAudioStream *buffered = Audio::makeRawStream(
+			new Common::SeekableSubReadStream(parent, 0, sizeof(data), DisposeAfterUse::YES), 11025, flags);
+
+		int16 memoryBuffer[1000], bufferedBuffer[1000];
+		while (!memory->endOfData()) {
+			const int read = memory->readBuffer(memoryBuffer, ARRAYSIZE(memoryBuffer));
+			TS_ASSERT_EQUALS(buffered->readBuffer(bufferedBuffer, ARRAYSIZE(bufferedBuffer)), read);
+			TS_ASSERT_EQUALS(memcmp(memoryBuffer, bufferedBuffer, read * sizeof(int16)), 0);
+		}
+		TS_ASSERT(buffered->endOfData());
+
+		delete memory;
+		delete buffered;
+	}
+
+	void test_mapped_stream() {
+		byte data[] = { 0x01, 0x00, 0x02, 0x00, 0x03, 0x00, 0x04, 0x00 };
+		Common::FileMapping *mapping = new Common::FileMapping(data, sizeof(data));
+
+		Audio::SeekableAudioStream *s = Audio::makeRawStream(mapping, 2, 4, 11025,
+		                                                     Audio::FLAG_16BITS | Audio::FLAG_LITTLE_ENDIAN);
+		mapping->decRef();
+
+		int16 buffer[4];
+		TS_ASSERT_EQUALS(s->getLength().totalNumberOfFrames(), 2);
+		TS_ASSERT_EQUALS(s->readBuffer(buffer, 4), 2);
+		TS_ASSERT_EQUALS(buffer[0], 2);
+		TS_ASSERT_EQUALS(buffer[1], 3);
+		TS_ASSERT(s->endOfData());
+
+		delete s;
+	}
 };
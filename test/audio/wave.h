@@ -0,0 +1,66 @@
+#include <cxxtest/TestSuite.h>
+
+#include "audio/decoders/wave.h"
+#include "audio/audiostream.h"
+
+#include "common/memstream.h"
+
+class WaveStreamTestSuite : public CxxTest::TestSuite
+{
+private:
+	// A mono 16-bit PCM WAVE file whose data chunk announces dataSize bytes, of which only dataPresent follow
+	Common::SeekableReadStream *createWAV(uint32 dataSize, uint32 dataPresent) {
+		Common::MemoryWriteStreamDynamic wav(DisposeAfterUse::NO);
+		wav.write("RIFF", 4);
+		wav.writeUint32LE(36 + dataSize);
+		wav.write("WAVE", 4);
+		wav.write("fmt ", 4);
+		wav.writeUint32LE(16);
+		wav.writeUint16LE(1);     // PCM
+		wav.writeUint16LE(1);     // mono
+		wav.writeUint32LE(22050);
+		wav.writeUint32LE(44100);
+		wav.writeUint16LE(2);
+		wav.writeUint16LE(16);
+		wav.write("data", 4);
+		wav.writeUint32LE(dataSize);
+		for (uint32 i = 0; i < dataPresent / 2; i++)
+			wav.writeSint16LE(i);
+
+		return new Common::MemoryReadStream(wav.getData(), wav.size(), DisposeAfterUse::YES);
+	}
+
+public:
+	void test_empty_data_chunk() {
+		Audio::SeekableAudioStream *s = Audio::makeWAVStream(createWAV(0, 0), DisposeAfterUse::YES);
+		TS_ASSERT(s);
+
+		int16 buffer[4];
+		TS_ASSERT_EQUALS(s->readBuffer(buffer, 4), 0);
+		TS_ASSERT(s->endOfData());
+		TS_ASSERT_EQUALS(s->getLength().totalNumberOfFrames(), 0);
+		delete s;
+	}
+
+	void test_truncated_at_data_chunk() {
+		Audio::SeekableAudioStream *s = Audio::makeWAVStream(createWAV(100, 0), DisposeAfterUse::YES);
+		TS_ASSERT(s);
+
+		int16 buffer[4];
+		TS_ASSERT_EQUALS(s->readBuffer(buffer, 4), 0);
+		TS_ASSERT(s->endOfData());
+		delete s;
+	}
+
+	void test_truncated_data() {
+		Audio::SeekableAudioStream *s = Audio::makeWAVStream(createWAV(100, 7), DisposeAfterUse::YES);
+		TS_ASSERT(s);
+
+		// The incomplete last sample is dropped
+		int16 buffer[8];
+		TS_ASSERT_EQUALS(s->readBuffer(buffer, 8), 3);
+		TS_ASSERT_EQUALS(buffer[2], 2);
+		TS_ASSERT(s->endOfData());
+		delete s;
+	}
+};
@@ -0,0 +1,177 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the AUTHORS
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+// Headless benchmark of the audio mixer. Each synthetic workload is first checked
+// against its golden output, then timed with growing numbers of channels.
+// The first workload is also timed with the effects of every channel enabled.
+// Compressed files given on the command line are decoded and timed the same way,
+// and the hash of their output is printed so that runs can be compared.
+//
+// Usage: mixer [blocks] [file.wav|file.mp3|file.ogg|file.flac]...
+// Exits with 1 when the output of a workload doesn't match its golden output.
+
+#define FORBIDDEN_SYMBOL_ALLOW_ALL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "test/audio/mixer_workloads.h"
+
+#include "audio/decoders/flac.h"
+#include "audio/decoders/mp3.h"
+#include "audio/decoders/vorbis.h"
+#include "audio/decoders/wave.h"
+
+static const int benchChannels[] = { 1, 8, 32 };
+
+struct BenchFile {
+	const char *name;
+	byte *data;
+	uint32 size;
+};
+
+static bool hasExtension(const char *name, const char *extension) {
+	size_t length = strlen(name), extensionLength = strlen(extension);
+	return length >= extensionLength && !scumm_stricmp(name + length - extensionLength, extension);
+}
+
+static Audio::AudioStream *createFileStream(const BenchFile &file) {
+	Common::SeekableReadStream *data = new Common::MemoryReadStream(file.data, file.size, DisposeAfterUse::NO);
+	Audio::RewindableAudioStream *stream = nullptr;
+
+	if (hasExtension(file.name, ".wav")) {
+		stream = Audio::makeWAVStream(data, DisposeAfterUse::YES);
+#ifdef USE_MAD
+	} else if (hasExtension(file.name, ".mp3")) {
+		stream = Audio::makeMP3Stream(data, DisposeAfterUse::YES);
+#endif
+#ifdef USE_VORBIS
+	} else if (hasExtension(file.name, ".ogg")) {
+		stream = Audio::makeVorbisStream(data, DisposeAfterUse::YES);
+#endif
+#ifdef USE_FLAC
+	} else if (hasExtension(file.name, ".flac")) {
+		stream = Audio::makeFLACStream(data, DisposeAfterUse::YES);
+#endif
+	} else {
+		delete data;
+	}
+
+	if (!stream)
+		return nullptr;
+	return Audio::makeLoopingAudioStream(stream, 0);
+}
+
+static bool loadFile(const char *name, BenchFile &file) {
+	FILE *f = fopen(name, "rb");
+	if (!f)
+		return false;
+
+	fseek(f, 0, SEEK_END);
+	file.name = name;
+	file.size = ftell(f);
+	file.data = (byte *)malloc(file.size);
+	fseek(f, 0, SEEK_SET);
+	bool read = fread(file.data, 1, file.size, f) == file.size;
+	fclose(f);
+
+	return read;
+}
+
+static void printTimed(const char *name, int channels, const MixerWorkloadResult &result, double seconds) {
+	if (seconds <= 0.0)
+		seconds = 1.0 / CLOCKS_PER_SEC;
+
+	printf("%-16s %8d %8d %10.1f %14.2f  ", name, channels, result.blocks, seconds * 1000.0,
+	       result.frames / seconds / 1000000.0);
+}
+
+int main(int argc, char *argv[]) {
+	int blocks = 1000;
+	Common::Array<BenchFile> files;
+	for (int i = 1; i < argc; i++) {
+		BenchFile file;
+		if (atoi(argv[i]) > 0) {
+			blocks = atoi(argv[i]);
+		} else if (loadFile(argv[i], file)) {
+			files.push_back(file);
+		} else {
+			fprintf(stderr, "Usage: %s [blocks] [file.wav|file.mp3|file.ogg|file.flac]...\n", argv[0]);
+			return 2;
+		}
+	}
+
+	bool matches = true;
+	printf("%-16s %8s %8s %10s %14s  %s\n", "workload", "channels", "blocks", "ms", "Mframes/s", "golden");
+	for (int i = 0; i < kMixerWorkloadCount; i++) {
+		MixerWorkloadResult golden = runMixerWorkload(i, kMixerGoldenChannels, kMixerGoldenBlocks);
+		bool match = golden.hash == mixerGoldenHashes[i];
+		matches = matches && match;
+
+		for (int j = 0; j < ARRAYSIZE(benchChannels); j++) {
+			clock_t start = clock();
+			MixerWorkloadResult result = runMixerWorkload(i, benchChannels[j], blocks, false);
+			printTimed(mixerWorkloadNames[i], benchChannels[j], result, (double)(clock() - start) / CLOCKS_PER_SEC);
+
+			printf("%s", match ? "ok" : "MISMATCH");
+			if (!match)
+				printf(" (%08x, expected %08x)", golden.hash, mixerGoldenHashes[i]);
+			printf("\n");
+		}
+	}
+
+	const MixerWorkloadEffects effects = makeMixerWorkloadEffects();
+	for (int j = 0; j < ARRAYSIZE(benchChannels); j++) {
+		clock_t start = clock();
+		MixerWorkloadResult result = runMixerWorkload(kMixerRaw16Mono, benchChannels[j], blocks, false, &effects);
+		printTimed("effects", benchChannels[j], result, (double)(clock() - start) / CLOCKS_PER_SEC);
+		printf("\n");
+	}
+
+	for (uint i = 0; i < files.size(); i++) {
+		const char *name = strrchr(files[i].name, '/') ? strrchr(files[i].name, '/') + 1 : files[i].name;
+
+		for (int j = 0; j < ARRAYSIZE(benchChannels); j++) {
+			Common::Array<Audio::AudioStream *> streams;
+			for (int k = 0; k < benchChannels[j]; k++) {
+				Audio::AudioStream *stream = createFileStream(files[i]);
+				if (stream)
+					streams.push_back(stream);
+			}
+			if (streams.empty()) {
+				printf("%-16s unsupported format\n", name);
+				break;
+			}
+
+			clock_t start = clock();
+			MixerWorkloadResult result = mixMixerWorkloadStreams(&streams.front(), streams.size(), Audio::kRateQualityFast, blocks);
+			printTimed(name, streams.size(), result, (double)(clock() - start) / CLOCKS_PER_SEC);
+			printf("%08x\n", result.hash);
+		}
+
+		free(files[i].data);
+	}
+
+	return matches ? 0 : 1;
+}
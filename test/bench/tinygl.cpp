@@ -0,0 +1,81 @@
+/* ResidualVM - A 3D game interpreter
+ *
+ * ResidualVM is the legal property of its developers, whose names
+ * are too numerous to list here. Please refer to the AUTHORS
+ * file distributed with this source distribution.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+
+// Headless benchmark of the TinyGL software renderer. Each workload is first checked
+// against its golden frames, then timed with the hashing of the frames turned off.
+//
+// Usage: tinygl [frames] [dirty|tiled|scalar]...
+// Exits with 1 when the output of a workload doesn't match its golden frames.
+
+#define FORBIDDEN_SYMBOL_ALLOW_ALL
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "test/graphics/tinygl_workloads.h"
+
+int main(int argc, char *argv[]) {
+	int frames = 100;
+	TinyGLWorkloadOptions options;
+	for (int i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "dirty")) {
+			options.dirtyRects = true;
+		} else if (!strcmp(argv[i], "tiled")) {
+			options.dirtyRects = true;
+			options.tiledRendering = true;
+		} else if (!strcmp(argv[i], "scalar")) {
+			options.simdSpans = false;
+		} else if (atoi(argv[i]) > 0) {
+			frames = atoi(argv[i]);
+		} else {
+			fprintf(stderr, "Usage: %s [frames] [dirty|tiled|scalar]...\n", argv[0]);
+			return 2;
+		}
+	}
+
+	bool matches = true;
+	printf("%-16s %8s %10s %12s %12s  %s\n", "workload", "frames", "ms", "Mpixels/s", "triangles/s", "golden");
+	for (int i = 0; i < kTinyGLWorkloadCount; i++) {
+		TinyGLWorkloadResult golden = runTinyGLWorkload(i, kTinyGLGoldenFrames, options);
+		bool match = golden.hash == tinyGLGoldenHashes[i];
+		matches = matches && match;
+
+		TinyGLWorkloadOptions timedOptions = options;
+		timedOptions.hashFrames = false;
+		clock_t start = clock();
+		TinyGLWorkloadResult result = runTinyGLWorkload(i, frames, timedOptions);
+		double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+		if (seconds <= 0.0)
+			seconds = 1.0 / CLOCKS_PER_SEC;
+
+		printf("%-16s %8d %10.1f %12.2f %12.0f  %s",
+		       tinyGLWorkloadNames[i], result.frames, seconds * 1000.0, result.pixels / seconds / 1000000.0,
+		       result.triangles / seconds, match ? "ok" : "MISMATCH");
+		if (!match)
+			printf(" (%08x, expected %08x)", golden.hash, tinyGLGoldenHashes[i]);
+		printf("\n");
+	}
+
+	return matches ? 0 : 1;
+}
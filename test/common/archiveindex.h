@@ -0,0 +1,50 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/archiveindex.h"
+#include "common/memstream.h"
+
+class ArchiveIndexTestSuite : public CxxTest::TestSuite {
+	public:
+	void test_get_put() {
+		const byte data[] = { 1, 2, 3, 4 };
+		ArchiveIndexMan.putIndex("test", "/data/data.lab", 1234, 5678, data, sizeof(data));
+
+		Common::SeekableReadStream *index = ArchiveIndexMan.getIndex("test", "/data/data.lab", 1234, 5678);
+		TS_ASSERT(index);
+		TS_ASSERT_EQUALS(index->size(), 4);
+		TS_ASSERT_EQUALS(index->readUint32BE(), 0x01020304u);
+		delete index;
+
+		// A file which changed since doesn't use the index
+		TS_ASSERT(!ArchiveIndexMan.getIndex("test", "/data/data.lab", 1235, 5678));
+		TS_ASSERT(!ArchiveIndexMan.getIndex("test", "/data/data.lab", 1234, 5679));
+		TS_ASSERT(!ArchiveIndexMan.getIndex("other", "/data/data.lab", 1234, 5678));
+	}
+
+	void test_save_load() {
+		Common::MemoryWriteStreamDynamic data(DisposeAfterUse::YES);
+		Common::ArchiveIndexCache::writeString(data, "FILE.TXT");
+		data.writeUint32LE(42);
+		ArchiveIndexMan.putIndex("test", "/data/data.xarc", 100, 200, data.getData(), data.size());
+
+		Common::MemoryWriteStreamDynamic file(DisposeAfterUse::YES);
+		ArchiveIndexMan.save(file);
+
+		ArchiveIndexMan.putIndex("test", "/data/data.xarc", 100, 200, nullptr, 0);
+		Common::MemoryReadStream in(file.getData(), file.size());
+		TS_ASSERT(ArchiveIndexMan.load(in));
+
+		Common::SeekableReadStream *index = ArchiveIndexMan.getIndex("test", "/data/data.xarc", 100, 200);
+		TS_ASSERT(index);
+		TS_ASSERT_EQUALS(Common::ArchiveIndexCache::readString(*index), "FILE.TXT");
+		TS_ASSERT_EQUALS(index->readUint32LE(), 42u);
+		delete index;
+	}
+
+	void test_load_invalid() {
+		const byte garbage[] = { 'A', 'I', 'D', 'X', 1, 0, 0, 0, 5, 0, 0, 0 };
+		Common::MemoryReadStream in(garbage, sizeof(garbage));
+		TS_ASSERT(!ArchiveIndexMan.load(in));
+		TS_ASSERT(!ArchiveIndexMan.getIndex("test", "/data/data.xarc", 100, 200));
+	}
+};
@@ -0,0 +1,62 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/filemapping.h"
+
+class FileMappingTestSuite : public CxxTest::TestSuite {
+	class TestMapping : public Common::FileMapping {
+	public:
+		TestMapping(const byte *data, uint32 size, bool *deleted) :
+			Common::FileMapping(data, size), _deleted(deleted) {}
+
+	protected:
+		~TestMapping() { *_deleted = true; }
+
+	private:
+		bool *_deleted;
+	};
+
+	public:
+	void test_read_stream_is_a_view() {
+		byte contents[] = { 'a', 'b', 'c', 'd', 'e', 'f' };
+		Common::FileMapping *mapping = new Common::FileMapping(contents, sizeof(contents));
+		Common::MappedReadStream ms(mapping, 1, 4);
+		mapping->decRef();
+
+		TS_ASSERT_EQUALS(ms.readByte(), 'b');
+
+		Common::SeekableReadStream *sub = ms.readStream(2);
+		Common::MemoryReadStream *memory = dynamic_cast<Common::MemoryReadStream *>(sub);
+		TS_ASSERT(memory);
+		TS_ASSERT_EQUALS(memory->getData(), contents + 2);
+		TS_ASSERT_EQUALS(sub->size(), 2);
+		TS_ASSERT_EQUALS(sub->readByte(), 'c');
+		TS_ASSERT_EQUALS(ms.pos(), 3);
+		TS_ASSERT(!ms.eos());
+		delete sub;
+
+		// Reading past the end gives a short stream
+		sub = ms.readStream(4);
+		TS_ASSERT_EQUALS(sub->size(), 1);
+		TS_ASSERT_EQUALS(sub->readByte(), 'e');
+		TS_ASSERT(ms.eos());
+		delete sub;
+	}
+
+	void test_streams_keep_the_mapping() {
+		byte contents[] = { 1, 2, 3, 4 };
+		bool deleted = false;
+		Common::FileMapping *mapping = new TestMapping(contents, sizeof(contents), &deleted);
+
+		Common::MappedReadStream *ms = new Common::MappedReadStream(mapping, 0, 4);
+		mapping->decRef();
+		TS_ASSERT(!deleted);
+
+		Common::SeekableReadStream *sub = ms->readStream(2);
+		delete ms;
+		TS_ASSERT(!deleted);
+
+		TS_ASSERT_EQUALS(sub->readByte(), 1);
+		delete sub;
+		TS_ASSERT(deleted);
+	}
+};
@@ -0,0 +1,63 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/lockfreequeue.h"
+
+class LockFreeQueueTestSuite : public CxxTest::TestSuite {
+public:
+	void test_push_pop() {
+		Common::LockFreeQueue<int, 4> queue;
+		int item = -1;
+		TS_ASSERT(queue.empty());
+		TS_ASSERT(!queue.pop(item));
+		TS_ASSERT_EQUALS(item, -1);
+
+		TS_ASSERT(queue.push(1));
+		TS_ASSERT(queue.push(2));
+		TS_ASSERT(!queue.empty());
+		TS_ASSERT_EQUALS(queue.size(), 2U);
+
+		TS_ASSERT(queue.pop(item));
+		TS_ASSERT_EQUALS(item, 1);
+		TS_ASSERT(queue.pop(item));
+		TS_ASSERT_EQUALS(item, 2);
+		TS_ASSERT(queue.empty());
+	}
+
+	void test_full() {
+		Common::LockFreeQueue<int, 4> queue;
+		TS_ASSERT_EQUALS(queue.capacity(), 4U);
+		for (int i = 0; i < 4; i++)
+			TS_ASSERT(queue.push(i));
+		TS_ASSERT(!queue.push(4));
+		TS_ASSERT_EQUALS(queue.size(), 4U);
+
+		int item;
+		TS_ASSERT(queue.pop(item));
+		TS_ASSERT_EQUALS(item, 0);
+		TS_ASSERT(queue.push(4));
+		for (int i = 1; i <= 4; i++) {
+			TS_ASSERT(queue.pop(item));
+			TS_ASSERT_EQUALS(item, i);
+		}
+		TS_ASSERT(queue.empty());
+	}
+
+	void test_wrap_around() {
+		Common::LockFreeQueue<int, 8> queue;
+		int next = 0, expected = 0, item;
+		// Interleaved pushes and pops, so that the items wrap around the storage many times
+		for (int round = 0; round < 1000; round++) {
+			for (int i = 0; i < round % 7 + 1; i++) {
+				if (queue.push(next))
+					next++;
+			}
+			for (int i = 0; i < round % 5 + 1; i++) {
+				if (queue.pop(item)) {
+					TS_ASSERT_EQUALS(item, expected);
+					expected++;
+				}
+			}
+			TS_ASSERT_EQUALS(queue.size(), (uint32)(next - expected));
+		}
+	}
+};
@@ -0,0 +1,62 @@
+#include <cxxtest/TestSuite.h>
+
+#include "common/memberindex.h"
+
+class MemberIndexTestSuite : public CxxTest::TestSuite {
+	public:
+	void test_empty() {
+		Common::MemberIndex index;
+		TS_ASSERT(index.empty());
+		TS_ASSERT_EQUALS(index.find("anything"), (int)Common::MemberIndex::kNoMember);
+
+		index.build(Common::Array<Common::String>());
+		TS_ASSERT(index.empty());
+		TS_ASSERT_EQUALS(index.find(""), (int)Common::MemberIndex::kNoMember);
+	}
+
+	void test_find() {
+		Common::Array<Common::String> names;
+		for (int i = 0; i < 5000; i++)
+			names.push_back(Common::String::format("data/file%04d.bin", i));
+
+		Common::MemberIndex index;
+		index.build(names);
+		TS_ASSERT_EQUALS(index.size(), 5000u);
+
+		for (int i = 0; i < 5000; i++) {
+			TS_ASSERT_EQUALS(index.find(names[i]), i);
+			TS_ASSERT_EQUALS(Common::String(index.getName(i)), names[i]);
+		}
+
+		TS_ASSERT_EQUALS(index.find("data/file5000.bin"), (int)Common::MemberIndex::kNoMember);
+		TS_ASSERT_EQUALS(index.find("data/file0001.bi"), (int)Common::MemberIndex::kNoMember);
+		TS_ASSERT_EQUALS(index.find(""), (int)Common::MemberIndex::kNoMember);
+	}
+
+	void test_ignore_case() {
+		Common::Array<Common::String> names;
+		names.push_back("Intro.SNM");
+		names.push_back("mo.cos");
+
+		Common::MemberIndex index;
+		index.build(names);
+		TS_ASSERT_EQUALS(index.find("intro.snm"), 0);
+		TS_ASSERT_EQUALS(index.find("INTRO.SNM"), 0);
+		TS_ASSERT_EQUALS(index.find("MO.COS"), 1);
+		TS_ASSERT_EQUALS(Common::String(index.getName(0)), "Intro.SNM");
+	}
+
+	void test_duplicates() {
+		Common::Array<Common::String> names;
+		names.push_back("a.txt");
+		names.push_back("b.txt");
+		names.push_back("A.TXT");
+
+		Common::MemberIndex index;
+		index.build(names);
+		TS_ASSERT_EQUALS(index.size(), 3u);
+		TS_ASSERT_EQUALS(index.find("a.txt"), 0);
+		TS_ASSERT_EQUALS(index.find("b.txt"), 1);
+		TS_ASSERT_EQUALS(Common::String(index.getName(2)), "A.TXT");
+	}
+};
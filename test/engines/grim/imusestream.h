@@ -0,0 +1,84 @@
+#include <cxxtest/TestSuite.h>
+
+#include "engines/grim/imuse/imuse_stream.h"
+
+class ImuseStreamTestSuite : public CxxTest::TestSuite {
+	volatile uint32 _pause;
+
+	// Writes frames of a constant mono sample to the voice
+	void writeFrames(Grim::ImuseVoice *voice, uint32 frames, int16 sample) {
+		int16 samples[256];
+		for (int i = 0; i < 256; i++)
+			samples[i] = sample;
+		while (frames) {
+			const uint32 count = MIN<uint32>(frames, 256);
+			voice->write(samples, count);
+			frames -= count;
+		}
+	}
+
+	Grim::ImuseVoice *addVoice(Grim::ImuseStream &stream, uint32 startFrame) {
+		Grim::ImuseVoice *voice = new Grim::ImuseVoice(1, false, startFrame);
+		stream.postCommand(Grim::ImuseStream::kCommandSetVolume, voice, 127000);
+		stream.postCommand(Grim::ImuseStream::kCommandSetPan, voice, 64000);
+		stream.postCommand(Grim::ImuseStream::kCommandAddVoice, voice);
+		return voice;
+	}
+
+	public:
+	void test_short_fade_region() {
+		_pause = 0;
+		Grim::ImuseStream stream(&_pause, 22050, Audio::Mixer::kMusicSoundType);
+		Grim::ImuseVoice *track = addVoice(stream, 0);
+		writeFrames(track, 1000, 1000);
+
+		// The track jumps to another region, and the fade out copy is
+		// decoded to its end before the mixer gets to it
+		Grim::ImuseVoice *fade = addVoice(stream, track->getEndFrame());
+		stream.postCommand(Grim::ImuseStream::kCommandFadeVolume, fade, 0, 50);
+		writeFrames(fade, 100, 1000);
+		fade->setEndOfData();
+		writeFrames(track, 1000, 1000);
+
+		int16 buffer[2048 * 2];
+		TS_ASSERT_EQUALS(stream.readBuffer(buffer, 2048 * 2), 2048 * 2);
+		TS_ASSERT(fade->isFinished());
+		TS_ASSERT_EQUALS(track->getBuffered(), 0u);
+		TS_ASSERT(!track->isFinished());
+
+		// Both voices play where they overlap
+		TS_ASSERT_EQUALS(buffer[0], buffer[1]);
+		TS_ASSERT_LESS_THAN(buffer[999 * 2], buffer[1000 * 2]);
+		TS_ASSERT_EQUALS(buffer[1999 * 2], buffer[999 * 2]);
+		// The track ran out of samples after that
+		TS_ASSERT_EQUALS(buffer[2000 * 2], 0);
+
+		stream.postCommand(Grim::ImuseStream::kCommandRemoveVoice, fade);
+	}
+
+	void test_no_free_voice() {
+		_pause = 0;
+		Grim::ImuseStream stream(&_pause, 22050, Audio::Mixer::kSFXSoundType);
+		Grim::ImuseVoice *voices[5];
+		for (int i = 0; i < 4; i++) {
+			TS_ASSERT(stream.hasFreeVoice());
+			voices[i] = addVoice(stream, 0);
+			writeFrames(voices[i], 100, 100);
+		}
+		TS_ASSERT(!stream.hasFreeVoice());
+		voices[4] = addVoice(stream, 0);
+		writeFrames(voices[4], 100, 100);
+
+		// The voice which doesn't fit finishes right away, so that its track
+		// is flushed
+		int16 buffer[64 * 2];
+		stream.readBuffer(buffer, 64 * 2);
+		TS_ASSERT(!voices[0]->isFinished());
+		TS_ASSERT(voices[4]->isFinished());
+
+		stream.postCommand(Grim::ImuseStream::kCommandRemoveVoice, voices[4]);
+		TS_ASSERT(!stream.hasFreeVoice());
+		stream.postCommand(Grim::ImuseStream::kCommandRemoveVoice, voices[0]);
+		TS_ASSERT(stream.hasFreeVoice());
+	}
+};
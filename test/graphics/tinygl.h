@@ -0,0 +1,39 @@
+#include <cxxtest/TestSuite.h>
+
+#include "tinygl_workloads.h"
+
+class TinyGLTestSuite : public CxxTest::TestSuite {
+public:
+	void test_golden_frames() {
+		TinyGLWorkloadOptions options;
+		for (int i = 0; i < kTinyGLWorkloadCount; i++) {
+			TinyGLWorkloadResult result = runTinyGLWorkload(i, kTinyGLGoldenFrames, options);
+			TSM_ASSERT_EQUALS(tinyGLWorkloadNames[i], result.hash, tinyGLGoldenHashes[i]);
+		}
+	}
+
+	// The optional code paths of the renderer must draw the same pixels as the reference one.
+	void test_dirty_rects() {
+		checkOptions(true, false, true);
+	}
+
+	void test_tiled_rendering() {
+		checkOptions(true, true, true);
+	}
+
+	void test_scalar_spans() {
+		checkOptions(false, false, false);
+	}
+
+private:
+	void checkOptions(bool dirtyRects, bool tiledRendering, bool simdSpans) {
+		TinyGLWorkloadOptions options;
+		options.dirtyRects = dirtyRects;
+		options.tiledRendering = tiledRendering;
+		options.simdSpans = simdSpans;
+		for (int i = 0; i < kTinyGLWorkloadCount; i++) {
+			TinyGLWorkloadResult result = runTinyGLWorkload(i, kTinyGLGoldenFrames, options);
+			TSM_ASSERT_EQUALS(tinyGLWorkloadNames[i], result.hash, tinyGLGoldenHashes[i]);
+		}
+	}
+};
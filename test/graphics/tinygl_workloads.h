@@ -0,0 +1,364 @@
+#ifndef TEST_GRAPHICS_TINYGL_WORKLOADS_H
+#define TEST_GRAPHICS_TINYGL_WORKLOADS_H
+
+// Synthetic workloads for the TinyGL software renderer, shared by the golden image tests
+// (test/graphics/tinygl.h) and the rasterizer benchmark (test/bench/tinygl.cpp).
+// Everything is drawn off screen into a FrameBuffer, so no backend is needed.
+
+#include "graphics/tinygl/zgl.h"
+#include "graphics/tinygl/gl.h"
+#include "graphics/tinygl/zblit.h"
+#include "graphics/surface.h"
+
+enum {
+	kTinyGLWorkloadWidth = 320,
+	kTinyGLWorkloadHeight = 240
+};
+
+enum TinyGLWorkloadType {
+	kTinyGLTriangleStorm,
+	kTinyGLTexturedQuads,
+	kTinyGLBlitSprites,
+	kTinyGLZBufferBlit,
+	kTinyGLWorkloadCount
+};
+
+static const char *const tinyGLWorkloadNames[kTinyGLWorkloadCount] = {
+	"triangle storm",
+	"textured quads",
+	"blit sprites",
+	"z buffer blit"
+};
+
+// Hashes of the first kTinyGLGoldenFrames frames drawn by each workload. They must only
+// change along with an intended change of the output of the renderer.
+static const int kTinyGLGoldenFrames = 3;
+
+static const uint32 tinyGLGoldenHashes[kTinyGLWorkloadCount] = {
+	0x9c67fc32,
+	0xd5bf87df,
+	0x711ad996,
+	0x6cd85d15
+};
+
+struct TinyGLWorkloadOptions {
+	bool dirtyRects;
+	bool tiledRendering;
+	bool simdSpans;
+	bool hashFrames;  // off when only timing the renderer
+
+	TinyGLWorkloadOptions() : dirtyRects(false), tiledRendering(false), simdSpans(true), hashFrames(true) {}
+};
+
+struct TinyGLWorkloadResult {
+	uint32 hash;      // hash of the color and z buffers of all the frames
+	int frames;
+	int triangles;    // triangles submitted
+	int pixels;       // pixels presented
+
+	TinyGLWorkloadResult() : hash(0), frames(0), triangles(0), pixels(0) {}
+};
+
+// Deterministic generator, so that the frames only depend on the renderer.
+class TinyGLWorkloadRandom {
+public:
+	TinyGLWorkloadRandom(uint32 seed) : _state(seed) {}
+
+	float next() {
+		_state = _state * 1103515245 + 12345;
+		return ((_state >> 8) & 0xFFFF) / 65535.0f;
+	}
+
+	float range(float min, float max) {
+		return min + next() * (max - min);
+	}
+
+private:
+	uint32 _state;
+};
+
+static uint32 hashTinyGLBuffer(uint32 hash, const byte *data, int size) {
+	for (int i = 0; i < size; i++) {
+		hash ^= data[i];
+		hash *= 16777619;
+	}
+	return hash;
+}
+
+static void createTinyGLWorkloadTexture(int size) {
+	byte *texels = new byte[size * size * 4];
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			byte *texel = texels + (y * size + x) * 4;
+			bool checker = ((x >> 3) ^ (y >> 3)) & 1;
+			texel[0] = checker ? 255 : x * 255 / size;
+			texel[1] = checker ? 255 : y * 255 / size;
+			texel[2] = checker ? 64 : 192;
+			texel[3] = (x + y) % 32 < 4 ? 0 : 255;
+		}
+	}
+	tglTexImage2D(TGL_TEXTURE_2D, 0, TGL_RGBA, size, size, 0, TGL_RGBA, TGL_UNSIGNED_BYTE, texels);
+	delete[] texels;
+}
+
+static Graphics::BlitImage *createTinyGLWorkloadSprite(int width, int height) {
+	Graphics::Surface surface;
+	surface.create(width, height, Graphics::PixelFormat(4, 8, 8, 8, 8, 0, 8, 16, 24));
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			int dx = x - width / 2, dy = y - height / 2;
+			int distance = dx * dx + dy * dy;
+			int radius = width * width / 4;
+			// opaque center, translucent ring and transparent corners
+			byte a = distance < radius / 2 ? 255 : (distance < radius ? 128 : 0);
+			*(uint32 *)surface.getBasePtr(x, y) = surface.format.ARGBToColor(a, x * 255 / width, y * 255 / height, 255 - x * 255 / width);
+		}
+	}
+	Graphics::BlitImage *image = Graphics::tglGenBlitImage();
+	Graphics::tglUploadBlitImage(image, surface, 0, false);
+	surface.free();
+	return image;
+}
+
+static Graphics::BlitImage *createTinyGLWorkloadDepthImage(int width, int height) {
+	Graphics::Surface surface;
+	surface.create(width, height, Graphics::PixelFormat(4, 8, 8, 8, 8, 0, 8, 16, 24));
+	for (int y = 0; y < height; y++) {
+		for (int x = 0; x < width; x++) {
+			// a ramp across the depth range, as a prerendered background would have
+			*(uint32 *)surface.getBasePtr(x, y) = (x + y) * ((1 << (ZB_Z_BITS + ZB_POINT_Z_FRAC_BITS)) / (width + height));
+		}
+	}
+	Graphics::BlitImage *image = Graphics::tglGenBlitImage();
+	Graphics::tglUploadBlitImage(image, surface, 0, false);
+	surface.free();
+	return image;
+}
+
+static void setTinyGLWorkloadProjection() {
+	tglViewport(0, 0, kTinyGLWorkloadWidth, kTinyGLWorkloadHeight);
+	tglMatrixMode(TGL_PROJECTION);
+	tglLoadIdentity();
+	tglFrustum(-1, 1, -0.75, 0.75, 1, 100);
+	tglMatrixMode(TGL_MODELVIEW);
+	tglLoadIdentity();
+}
+
+// Small random triangles with all the fragment paths: flat and smooth shading, depth test
+// functions, depth mask, blending and alpha test.
+static int drawTinyGLTriangleStorm(int frame) {
+	TinyGLWorkloadRandom rnd(1 + frame);
+	const int triangles = 600;
+
+	tglClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+	tglClear(TGL_COLOR_BUFFER_BIT | TGL_DEPTH_BUFFER_BIT);
+	tglEnable(TGL_DEPTH_TEST);
+	for (int i = 0; i < triangles; i++) {
+		tglShadeModel(i % 4 == 0 ? TGL_FLAT : TGL_SMOOTH);
+		tglDepthFunc(i % 7 == 0 ? TGL_GEQUAL : TGL_LESS);
+		tglDepthMask(i % 5 != 0);
+		if (i % 3 == 0) {
+			tglEnable(TGL_BLEND);
+			tglBlendFunc(TGL_SRC_ALPHA, TGL_ONE_MINUS_SRC_ALPHA);
+		} else {
+			tglDisable(TGL_BLEND);
+		}
+		if (i % 11 == 0) {
+			tglEnable(TGL_ALPHA_TEST);
+			tglAlphaFunc(TGL_GREATER, 0.5f);
+		} else {
+			tglDisable(TGL_ALPHA_TEST);
+		}
+
+		float x = rnd.range(-4, 4), y = rnd.range(-3, 3), z = rnd.range(-12, -2);
+		tglBegin(TGL_TRIANGLES);
+		for (int v = 0; v < 3; v++) {
+			tglColor4f(rnd.next(), rnd.next(), rnd.next(), rnd.next());
+			tglVertex3f(x + rnd.range(-0.5f, 0.5f), y + rnd.range(-0.5f, 0.5f), z + rnd.range(-0.5f, 0.5f));
+		}
+		tglEnd();
+	}
+	tglDisable(TGL_BLEND);
+	tglDisable(TGL_ALPHA_TEST);
+	tglDepthMask(TGL_TRUE);
+	tglDepthFunc(TGL_LESS);
+	return triangles;
+}
+
+// Perspective textured quads from close by to far away, so that all the mipmap levels
+// are sampled, lit by the vertex colors and sometimes alpha tested or blended.
+static int drawTinyGLTexturedQuads(int frame) {
+	TinyGLWorkloadRandom rnd(100 + frame);
+	const int quads = 80;
+
+	tglClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+	tglClear(TGL_COLOR_BUFFER_BIT | TGL_DEPTH_BUFFER_BIT);
+	tglEnable(TGL_DEPTH_TEST);
+	tglEnable(TGL_TEXTURE_2D);
+	tglShadeModel(TGL_SMOOTH);
+	for (int i = 0; i < quads; i++) {
+		if (i % 4 == 1) {
+			tglEnable(TGL_ALPHA_TEST);
+			tglAlphaFunc(TGL_GREATER, 0.5f);
+		} else {
+			tglDisable(TGL_ALPHA_TEST);
+		}
+		if (i % 4 == 2) {
+			tglEnable(TGL_BLEND);
+			tglBlendFunc(TGL_SRC_ALPHA, TGL_ONE_MINUS_SRC_ALPHA);
+		} else {
+			tglDisable(TGL_BLEND);
+		}
+
+		float x = rnd.range(-6, 6), y = rnd.range(-4, 1), z = rnd.range(-60, -2);
+		float size = rnd.range(1, 4), repeat = rnd.range(1, 4);
+		tglBegin(TGL_QUADS);
+		tglColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+		tglTexCoord2f(0, 0);
+		tglVertex3f(x, y, z);
+		tglColor4f(rnd.next(), rnd.next(), rnd.next(), 1.0f);
+		tglTexCoord2f(repeat, 0);
+		tglVertex3f(x + size, y, z);
+		tglColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+		tglTexCoord2f(repeat, repeat);
+		tglVertex3f(x + size, y, z - size * 4);
+		tglColor4f(rnd.next(), rnd.next(), rnd.next(), 1.0f);
+		tglTexCoord2f(0, repeat);
+		tglVertex3f(x, y, z - size * 4);
+		tglEnd();
+	}
+	tglDisable(TGL_TEXTURE_2D);
+	tglDisable(TGL_BLEND);
+	tglDisable(TGL_ALPHA_TEST);
+	return quads * 2;
+}
+
+// The same sprite drawn with every blitting mode: the regular one, with and without
+// blending and with a transform, tint and flip, the one without blending and the fast one.
+static void drawTinyGLBlitSprites(int frame, Graphics::BlitImage *sprite) {
+	TinyGLWorkloadRandom rnd(200 + frame);
+
+	tglClearColor(0.3f, 0.1f, 0.1f, 1.0f);
+	tglClear(TGL_COLOR_BUFFER_BIT | TGL_DEPTH_BUFFER_BIT);
+	for (int i = 0; i < 120; i++) {
+		int x = (int)rnd.range(-32, kTinyGLWorkloadWidth);
+		int y = (int)rnd.range(-32, kTinyGLWorkloadHeight);
+		switch (i % 6) {
+		case 0:
+			tglDisable(TGL_BLEND);
+			Graphics::tglBlit(sprite, x, y);
+			break;
+		case 1:
+			tglEnable(TGL_BLEND);
+			tglBlendFunc(TGL_SRC_ALPHA, TGL_ONE_MINUS_SRC_ALPHA);
+			Graphics::tglBlit(sprite, x, y);
+			break;
+		case 2: {
+			Graphics::BlitTransform transform(x, y);
+			transform.scale((int)rnd.range(16, 96), (int)rnd.range(16, 96));
+			transform.tint(rnd.next(), rnd.next(), rnd.next(), rnd.next());
+			transform.flip(i % 4 == 0, i % 8 == 0);
+			tglEnable(TGL_BLEND);
+			tglBlendFunc(TGL_SRC_ALPHA, TGL_ONE_MINUS_SRC_ALPHA);
+			Graphics::tglBlit(sprite, transform);
+			break;
+		}
+		case 3: {
+			Graphics::BlitTransform transform(x, y);
+			transform.rotate((int)rnd.range(0, 360), 16, 16);
+			tglEnable(TGL_BLEND);
+			tglBlendFunc(TGL_ONE, TGL_ONE);
+			Graphics::tglBlit(sprite, transform);
+			break;
+		}
+		case 4: {
+			Graphics::BlitTransform transform(x, y);
+			transform.flip(i % 4 == 0, false);
+			Graphics::tglBlitNoBlend(sprite, transform);
+			break;
+		}
+		default:
+			Graphics::tglBlitFast(sprite, x, y);
+			break;
+		}
+	}
+	tglDisable(TGL_BLEND);
+}
+
+// A prerendered depth background, as Grim uses it, with triangles depth tested against it.
+static int drawTinyGLZBufferBlit(int frame, Graphics::BlitImage *depth) {
+	TinyGLWorkloadRandom rnd(300 + frame);
+	const int triangles = 200;
+
+	tglClear(TGL_COLOR_BUFFER_BIT | TGL_DEPTH_BUFFER_BIT);
+	Graphics::tglBlitZBuffer(depth, 0, 0);
+	tglEnable(TGL_DEPTH_TEST);
+	tglShadeModel(TGL_SMOOTH);
+	for (int i = 0; i < triangles; i++) {
+		float x = rnd.range(-4, 4), y = rnd.range(-3, 3), z = rnd.range(-8, -1.5f);
+		tglBegin(TGL_TRIANGLES);
+		for (int v = 0; v < 3; v++) {
+			tglColor4f(rnd.next(), rnd.next(), rnd.next(), 1.0f);
+			tglVertex3f(x + rnd.range(-1, 1), y + rnd.range(-1, 1), z + rnd.range(-1, 1));
+		}
+		tglEnd();
+	}
+	return triangles;
+}
+
+// Draws frames of a workload and returns the hash of all of them.
+static TinyGLWorkloadResult runTinyGLWorkload(int workload, int frames, const TinyGLWorkloadOptions &options) {
+	TinyGLWorkloadResult result;
+	Graphics::PixelFormat format(4, 8, 8, 8, 8, 16, 8, 0, 24);
+	TinyGL::FrameBuffer *fb = new TinyGL::FrameBuffer(kTinyGLWorkloadWidth, kTinyGLWorkloadHeight, format);
+	TinyGL::glInit(fb, 256);
+	if (!options.simdSpans)
+		fb->disableSimdSpans();
+	tglEnableDirtyRects(options.dirtyRects);
+	tglEnableTiledRendering(options.tiledRendering);
+	setTinyGLWorkloadProjection();
+
+	unsigned int texture;
+	tglGenTextures(1, &texture);
+	tglBindTexture(TGL_TEXTURE_2D, texture);
+	createTinyGLWorkloadTexture(128);
+	Graphics::BlitImage *sprite = createTinyGLWorkloadSprite(32, 32);
+	Graphics::BlitImage *depth = createTinyGLWorkloadDepthImage(kTinyGLWorkloadWidth, kTinyGLWorkloadHeight);
+
+	result.hash = 2166136261u;
+	for (int frame = 0; frame < frames; frame++) {
+		switch (workload) {
+		case kTinyGLTriangleStorm:
+			result.triangles += drawTinyGLTriangleStorm(frame);
+			break;
+		case kTinyGLTexturedQuads:
+			result.triangles += drawTinyGLTexturedQuads(frame);
+			break;
+		case kTinyGLBlitSprites:
+			drawTinyGLBlitSprites(frame, sprite);
+			break;
+		case kTinyGLZBufferBlit:
+			result.triangles += drawTinyGLZBufferBlit(frame, depth);
+			break;
+		default:
+			break;
+		}
+		TinyGL::tglPresentBuffer();
+
+		if (options.hashFrames) {
+			result.hash = hashTinyGLBuffer(result.hash, fb->getPixelBuffer(), fb->linesize * fb->ysize);
+			result.hash = hashTinyGLBuffer(result.hash, (const byte *)fb->getZBuffer(), fb->xsize * fb->ysize * sizeof(uint));
+		}
+		result.frames++;
+		result.pixels += fb->xsize * fb->ysize;
+	}
+
+	Graphics::tglDeleteBlitImage(sprite);
+	Graphics::tglDeleteBlitImage(depth);
+	tglDeleteTextures(1, &texture);
+	TinyGL::glClose();
+	delete fb;
+	return result;
+}
+
+#endif
@@ -1,18 +1,25 @@
 ######################################################################
 # Unit/regression tests, based on CxxTest.
-# Use the 'test' target to run them.
+# Use the 'test' target to run them, and the 'bench' target to run the
+# benchmarks.
 # Edit TESTS and TESTLIBS to add more tests.
 #
 ######################################################################
 
-TESTS        := $(srcdir)/test/common/*.h $(srcdir)/test/audio/*.h $(srcdir)/test/math/*.h
-TEST_LIBS    := audio/libaudio.a math/libmath.a common/libcommon.a
+TESTS        := $(srcdir)/test/common/*.h $(srcdir)/test/audio/*.h $(srcdir)/test/math/*.h $(srcdir)/test/graphics/*.h
+TEST_LIBS    := audio/libaudio.a math/libmath.a graphics/libgraphics.a common/libcommon.a
 
 ifeq ($(ENABLE_WINTERMUTE), STATIC_PLUGIN)
 	TESTS += $(srcdir)/test/engines/wintermute/*.h
 	TEST_LIBS += engines/wintermute/libwintermute.a
 endif
 
+# The mixer workloads decode VIMA with the codec of the Grim engine
+ifeq ($(ENABLE_GRIM), STATIC_PLUGIN)
+	TESTS += $(srcdir)/test/engines/grim/*.h
+	TEST_LIBS += engines/grim/libgrim.a
+endif
+
 ifeq ($(ENABLE_ULTIMA), STATIC_PLUGIN)
 	TESTS += $(srcdir)/test/engines/ultima/*/*/*.h
 	TEST_LIBS += engines/ultima/libultima.a
@@ -51,8 +58,21 @@ test/runner.cpp: $(TESTS)
 	@mkdir -p test
 	$(srcdir)/test/cxxtest/cxxtestgen.py $(TEST_FLAGS) -o $@ $+
 
+BENCH_FRAMES := 100
+BENCH_BLOCKS := 1000
+
+bench: test/bench/tinygl test/bench/mixer
+	./test/bench/tinygl $(BENCH_FRAMES)
+	./test/bench/mixer $(BENCH_BLOCKS)
+test/bench/tinygl: $(srcdir)/test/bench/tinygl.cpp $(TEST_LIBS)
+	@mkdir -p test/bench
+	$(QUIET_CXX)$(CXX) $(TEST_CXXFLAGS) $(CPPFLAGS) -o $@ $+ $(TEST_LDFLAGS)
+test/bench/mixer: $(srcdir)/test/bench/mixer.cpp $(TEST_LIBS)
+	@mkdir -p test/bench
+	$(QUIET_CXX)$(CXX) $(TEST_CXXFLAGS) $(CPPFLAGS) -o $@ $+ $(TEST_LDFLAGS)
+
 clean: clean-test
 clean-test:
-	-$(RM) test/runner.cpp test/runner
+	-$(RM) test/runner.cpp test/runner test/bench/tinygl test/bench/mixer
 
-.PHONY: test clean-test
+.PHONY: test bench clean-test